@@ -191,6 +191,9 @@ const UserDef U_default = {
     .factor_display_type = USER_FACTOR_AS_FACTOR,
     .render_display_type = USER_RENDER_DISPLAY_WINDOW,
     .filebrowser_display_type = USER_TEMP_SPACE_DISPLAY_WINDOW,
+    .sequencer_disk_cache_dir = "",
+    .sequencer_disk_cache_compression = USER_SEQ_DISK_CACHE_COMPRESSION_LOW,
+    .sequencer_disk_cache_size_limit = 100,
     .viewport_aa = 8,
 
     .walk_navigation =
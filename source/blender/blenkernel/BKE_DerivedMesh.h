@@ -373,6 +373,10 @@ void makeDerivedMesh(struct Depsgraph *depsgraph,
                      struct BMEditMesh *em,
                      const struct CustomData_MeshMasks *dataMask);
 
+void mesh_modifier_stack_cache_free(struct Object *ob);
+/* Number of evaluations reusing the modifier stack cache of the object, -1 without cache. */
+int mesh_modifier_stack_cache_hits_get(const struct Object *ob);
+
 void DM_calc_loop_tangents(DerivedMesh *dm,
                            bool calc_active_tangent,
                            const char (*tangent_names)[MAX_NAME],
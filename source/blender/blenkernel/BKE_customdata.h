@@ -73,6 +73,13 @@ typedef enum eCDAllocType {
   CD_REFERENCE = 3,
   /** Do a full copy of all layers, only allowed if source has same number of elements. */
   CD_DUPLICATE = 4,
+  /**
+   * Share the data of the source layers, which is only freed once no layer uses it anymore.
+   * Writers must get their own copy with #CustomData_duplicate_referenced_layer first,
+   * or #CustomData_duplicate_shared_layers for all layers at once.
+   * Only valid for copy/merge, referenced source layers stay referenced.
+   */
+  CD_SHARE = 5,
 } eCDAllocType;
 
 #define CD_TYPE_AS_MASK(_type) (CustomDataMask)((CustomDataMask)1 << (CustomDataMask)(_type))
@@ -104,10 +111,15 @@ bool CustomData_has_interp(const struct CustomData *data);
 bool CustomData_bmesh_has_free(const struct CustomData *data);
 
 /**
- * Checks if any of the customdata layers is referenced.
+ * Checks if any of the customdata layers is referenced (or shared with other users).
  */
 bool CustomData_has_referenced(const struct CustomData *data);
 
+/**
+ * Size in bytes of the layers which are neither referenced nor shared with other users.
+ */
+size_t CustomData_get_owned_data_size(const struct CustomData *data, int totelem);
+
 /* copies the "value" (e.g. mloopuv uv or mloopcol colors) from one block to
  * another, while not overwriting anything else (e.g. flags).  probably only
  * implemented for mloopuv/mloopcol, for now.*/
@@ -218,6 +230,7 @@ int CustomData_number_of_layers(const struct CustomData *data, int type);
 int CustomData_number_of_layers_typemask(const struct CustomData *data, CustomDataMask mask);
 
 /* duplicate data of a layer with flag NOFREE, and remove that flag.
+ * layers sharing their data with other users get their own copy too.
  * returns the layer data */
 void *CustomData_duplicate_referenced_layer(struct CustomData *data,
                                             const int type,
@@ -232,6 +245,11 @@ void *CustomData_duplicate_referenced_layer_named(struct CustomData *data,
                                                   const int totelem);
 bool CustomData_is_referenced_layer(struct CustomData *data, int type);
 
+/* give all layers sharing their data with other users their own copy,
+ * referenced layers are left as they are.
+ * returns true when any layer data moved */
+bool CustomData_duplicate_shared_layers(struct CustomData *data, int totelem);
+
 /* set the CD_FLAG_NOCOPY flag in custom data layers where the mask is
  * zero for the layer type, so only layer types specified by the mask
  * will be copied
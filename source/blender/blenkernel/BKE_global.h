@@ -183,6 +183,9 @@ enum {
   /** On write, restore paths after editing them (G_FILE_RELATIVE_REMAP) */
   G_FILE_SAVE_COPY = (1 << 27),
   /* #define G_FILE_GLSL_NO_ENV_LIGHTING (1 << 28) */ /* deprecated */
+  /** With #G_FILE_COMPRESS, write frames which are compressed on multiple threads
+   * and can be decompressed independently, see #BLEND_CHUNKED_MAGIC. */
+  G_FILE_COMPRESS_CHUNKED = (1 << 29),
 };
 
 /** Don't overwrite these flags when reading a file. */
@@ -191,9 +191,30 @@ typedef struct Subdiv {
     /* Indexed by base face index, element indicates total number of ptex
      * faces created for preceding base faces. */
     int *face_ptex_offset;
+    /* Number of coarse elements this descriptor was created for, together with the settings
+     * these are the key of the topology cache. */
+    int num_vertices;
+    int num_edges;
+    int num_faces;
+    /* Estimated memory used by the topology refiner and evaluator, charged to the topology
+     * cache while the descriptor is stored there. */
+    size_t memory_size;
   } cache_;
 } Subdiv;
 
+/* Counters of the process-wide topology cache. */
+typedef struct SubdivTopologyCacheStats {
+  /* Descriptors currently stored in the cache. */
+  int num_items;
+  /* Estimated memory used by the stored descriptors, in bytes. */
+  size_t memory_size;
+  /* Least recently used descriptors are freed above this memory, in bytes. */
+  size_t memory_limit;
+  int num_hits;
+  int num_misses;
+  int num_evictions;
+} SubdivTopologyCacheStats;
+
 /* ========================== CONVERSION HELPERS ============================ */
 
 /* NOTE: uv_smooth is eSubsurfUVSmooth. */
@@ -239,8 +260,46 @@ Subdiv *BKE_subdiv_update_from_mesh(Subdiv *subdiv,
                                     const SubdivSettings *settings,
                                     const struct Mesh *mesh);
 
+/* Release the descriptor.
+ *
+ * NOTE: Descriptors with a topology refiner are moved to the topology cache instead of being
+ * destroyed, so they can be re-used by the next BKE_subdiv_new_from_FOO() for the same topology
+ * and settings. */
 void BKE_subdiv_free(Subdiv *subdiv);
 
+/* ============================= TOPOLOGY CACHE ============================= */
+
+/* Descriptors released with BKE_subdiv_free() keep their topology refiner and evaluator (with
+ * its stencil and patch tables) in a process-wide cache. This avoids the expensive creation of
+ * those when a new descriptor is requested for a topology seen before: after undo, or when both
+ * viewport and final render evaluate the same mesh. The cache is cleared when a file is loaded.
+ *
+ * Cached descriptors are owned exclusively by whoever acquires them, so the cache never shares
+ * an evaluator between concurrent evaluations. */
+
+/* Take the most recently released descriptor created for the given settings and number of
+ * elements out of the cache. topology_equal() tells whether a candidate actually has the
+ * requested topology. Returns NULL if there is no such descriptor. */
+Subdiv *BKE_subdiv_topology_cache_acquire(const SubdivSettings *settings,
+                                          const int num_vertices,
+                                          const int num_edges,
+                                          const int num_faces,
+                                          bool (*topology_equal)(const Subdiv *subdiv,
+                                                                 void *user_data),
+                                          void *user_data);
+/* Store the descriptor in the cache, freeing the least recently used ones above the memory
+ * limit. */
+void BKE_subdiv_topology_cache_release(Subdiv *subdiv);
+
+/* Set the memory limit of the cache, in bytes. Zero disables the cache. */
+void BKE_subdiv_topology_cache_limit_set(const size_t memory_limit);
+
+void BKE_subdiv_topology_cache_stats_get(SubdivTopologyCacheStats *r_stats);
+void BKE_subdiv_topology_cache_stats_print(void);
+
+/* Free all cached descriptors. */
+void BKE_subdiv_topology_cache_clear(void);
+
 /* ============================ DISPLACEMENT API ============================ */
 
 void BKE_subdiv_displacement_attach_from_multires(Subdiv *subdiv,
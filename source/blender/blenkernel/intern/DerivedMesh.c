@@ -27,17 +27,21 @@
 #include "MEM_guardedalloc.h"
 
 #include "DNA_cloth_types.h"
+#include "DNA_color_types.h"
+#include "DNA_curveprofile_types.h"
 #include "DNA_customdata_types.h"
 #include "DNA_key_types.h"
 #include "DNA_material_types.h"
 #include "DNA_mesh_types.h"
 #include "DNA_meshdata_types.h"
+#include "DNA_modifier_types.h"
 #include "DNA_object_types.h"
 #include "DNA_scene_types.h"
 
 #include "BLI_array.h"
 #include "BLI_blenlib.h"
 #include "BLI_bitmap.h"
+#include "BLI_hash_mm2a.h"
 #include "BLI_math.h"
 #include "BLI_utildefines.h"
 #include "BLI_linklist.h"
@@ -846,6 +850,27 @@ static void mesh_calc_modifier_final_normals(const Mesh *mesh_input,
   }
 }
 
+/* Final mesh of a stack which only deformed the input: the deform mesh already holds the
+ * deformed coordinates, so share them (and every other layer) instead of copying the input mesh
+ * and applying the coordinates a second time. Vertex normals are computed once, on the deform
+ * mesh which owns its coordinates. */
+static Mesh *mesh_calc_modifier_final_from_deform(const Mesh *mesh_input,
+                                                  const CustomData_MeshMasks *final_datamask,
+                                                  Mesh *mesh_deform)
+{
+  BKE_mesh_ensure_normals(mesh_deform);
+  Mesh *mesh_final = BKE_mesh_copy_for_eval(mesh_deform, true);
+
+  /* Loop and poly normals computation writes vertex normals as well, see
+   * #mesh_calc_modifier_final_normals. */
+  if ((mesh_input->flag & ME_AUTOSMOOTH) != 0 || (final_datamask->lmask & CD_MASK_NORMAL) != 0 ||
+      (final_datamask->pmask & CD_MASK_NORMAL) != 0) {
+    mesh_final->mvert = CustomData_duplicate_referenced_layer(
+        &mesh_final->vdata, CD_MVERT, mesh_final->totvert);
+  }
+  return mesh_final;
+}
+
 /* Does final touches to the final evaluated mesh, making sure it is perfectly usable.
  *
  * This is needed because certain information is not passed along intermediate meshes allocated
@@ -860,6 +885,350 @@ static void mesh_calc_finalize(const Mesh *mesh_input, Mesh *mesh_eval)
   mesh_eval->edit_mesh = mesh_input->edit_mesh;
 }
 
+/* -------------------------------------------------------------------- */
+/** \name Modifier Stack Cache
+ *
+ * The leading part of the modifier stack which only depends on the input mesh and on the
+ * settings of its modifiers is kept on the evaluated object across evaluations. It is keyed by a
+ * hash of those, so when only modifiers further down the stack change (an animated deform
+ * modifier on top of an array or bevel for example), evaluation continues from the cached mesh.
+ * \{ */
+
+typedef struct ModifierStackCache {
+  /** Hash of the input mesh and of the cached modifiers, see #modifier_stack_cache_find_end. */
+  uint32_t key[2];
+  /** Number of modifiers (including disabled ones) in the cached part of the stack. */
+  int modifiers_num;
+  /** Result of the cached part of the stack, and of the deform modifiers it starts with. */
+  Mesh *mesh;
+  Mesh *mesh_deform;
+  /** Number of evaluations which continued from the cached mesh. */
+  int hits;
+} ModifierStackCache;
+
+/* Two independently seeded hashes, a false match would silently give wrong results. */
+typedef struct ModifierStackCacheHash {
+  BLI_HashMurmur2A mm2[2];
+} ModifierStackCacheHash;
+
+static void stack_cache_hash_add(ModifierStackCacheHash *hash, const void *data, size_t len)
+{
+  BLI_hash_mm2a_add(&hash->mm2[0], data, len);
+  BLI_hash_mm2a_add(&hash->mm2[1], data, len);
+}
+
+static void stack_cache_hash_add_int(ModifierStackCacheHash *hash, int data)
+{
+  BLI_hash_mm2a_add_int(&hash->mm2[0], data);
+  BLI_hash_mm2a_add_int(&hash->mm2[1], data);
+}
+
+static void stack_cache_hash_add_customdata(ModifierStackCacheHash *hash,
+                                            const CustomData *data,
+                                            const int totelem)
+{
+  for (int i = 0; i < data->totlayer; i++) {
+    const CustomDataLayer *layer = &data->layers[i];
+    stack_cache_hash_add_int(hash, layer->type);
+    stack_cache_hash_add_int(hash, layer->active);
+    stack_cache_hash_add_int(hash, layer->active_rnd);
+    stack_cache_hash_add_int(hash, layer->active_clone);
+    stack_cache_hash_add_int(hash, layer->active_mask);
+    stack_cache_hash_add(hash, layer->name, strlen(layer->name));
+    if (layer->data == NULL) {
+      continue;
+    }
+    if (layer->type == CD_MDEFORMVERT) {
+      /* Weights are stored out of the layer array. */
+      const MDeformVert *dvert = layer->data;
+      for (int j = 0; j < totelem; j++) {
+        stack_cache_hash_add_int(hash, dvert[j].totweight);
+        if (dvert[j].dw) {
+          stack_cache_hash_add(hash, dvert[j].dw, sizeof(*dvert[j].dw) * dvert[j].totweight);
+        }
+      }
+    }
+    else {
+      stack_cache_hash_add(hash, layer->data, (size_t)CustomData_sizeof(layer->type) * totelem);
+    }
+  }
+}
+
+static void stack_cache_hash_add_input(ModifierStackCacheHash *hash,
+                                       const Object *ob,
+                                       const Mesh *mesh)
+{
+  LISTBASE_FOREACH (const bDeformGroup *, dg, &ob->defbase) {
+    stack_cache_hash_add(hash, dg->name, strlen(dg->name));
+  }
+  stack_cache_hash_add_int(hash, ob->totcol);
+  stack_cache_hash_add_int(hash, mesh->totcol);
+  stack_cache_hash_add_int(hash, mesh->flag);
+  stack_cache_hash_add(hash, &mesh->smoothresh, sizeof(mesh->smoothresh));
+  stack_cache_hash_add_int(hash, mesh->totvert);
+  stack_cache_hash_add_int(hash, mesh->totedge);
+  stack_cache_hash_add_int(hash, mesh->totloop);
+  stack_cache_hash_add_int(hash, mesh->totpoly);
+  stack_cache_hash_add_customdata(hash, &mesh->vdata, mesh->totvert);
+  stack_cache_hash_add_customdata(hash, &mesh->edata, mesh->totedge);
+  stack_cache_hash_add_customdata(hash, &mesh->ldata, mesh->totloop);
+  stack_cache_hash_add_customdata(hash, &mesh->pdata, mesh->totpoly);
+}
+
+static void stack_cache_hash_add_curvemapping(ModifierStackCacheHash *hash,
+                                             const CurveMapping *cumap)
+{
+  if (cumap == NULL) {
+    return;
+  }
+  stack_cache_hash_add_int(hash, cumap->flag);
+  stack_cache_hash_add_int(hash, cumap->preset);
+  stack_cache_hash_add(hash, &cumap->clipr, sizeof(cumap->clipr));
+  for (int i = 0; i < CM_TOT; i++) {
+    const CurveMap *cuma = &cumap->cm[i];
+    stack_cache_hash_add_int(hash, cuma->totpoint);
+    if (cuma->curve) {
+      stack_cache_hash_add(hash, cuma->curve, sizeof(*cuma->curve) * cuma->totpoint);
+    }
+  }
+}
+
+/**
+ * Settings of the modifier. The struct is hashed as is: modifier data is allocated cleared and
+ * copied with #memcpy, so padding is deterministic. Settings held by pointer are added by type,
+ * the pointers themselves only invalidate the cache when the data is re-allocated.
+ */
+static void stack_cache_hash_add_modifier(ModifierStackCacheHash *hash,
+                                          const ModifierData *md,
+                                          const ModifierTypeInfo *mti)
+{
+  stack_cache_hash_add(hash, md + 1, mti->structSize - sizeof(ModifierData));
+
+  switch ((ModifierType)md->type) {
+    case eModifierType_Bevel: {
+      const BevelModifierData *bmd = (const BevelModifierData *)md;
+      const CurveProfile *profile = bmd->custom_profile;
+      if (profile != NULL) {
+        stack_cache_hash_add_int(hash, profile->flag);
+        stack_cache_hash_add_int(hash, profile->path_len);
+        stack_cache_hash_add(hash, profile->path, sizeof(*profile->path) * profile->path_len);
+      }
+      break;
+    }
+    case eModifierType_Warp: {
+      stack_cache_hash_add_curvemapping(hash, ((const WarpModifierData *)md)->curfalloff);
+      break;
+    }
+    case eModifierType_WeightVGEdit: {
+      stack_cache_hash_add_curvemapping(hash, ((const WeightVGEditModifierData *)md)->cmap_curve);
+      break;
+    }
+    default:
+      break;
+  }
+}
+
+static void stack_cache_id_link_cb(void *userData,
+                                   Object *UNUSED(ob),
+                                   ID **idpoin,
+                                   int UNUSED(cb_flag))
+{
+  if (*idpoin != NULL) {
+    *((bool *)userData) = true;
+  }
+}
+
+/* Whether the result of the modifier only depends on its own settings and on its input mesh. */
+static bool modifier_stack_cache_supports(Object *ob, ModifierData *md)
+{
+  const ModifierTypeInfo *mti = modifierType_getInfo(md->type);
+
+  if (mti->dependsOnTime && mti->dependsOnTime(md)) {
+    return false;
+  }
+  if (mti->flags & eModifierTypeFlag_UsesPointCache) {
+    return false;
+  }
+  switch ((ModifierType)md->type) {
+    /* Evaluates baked frames or the simulation at the current frame. */
+    case eModifierType_Ocean:
+    /* Bind data, vertex indices or particles which are not part of the settings hash. */
+    case eModifierType_Hook:
+    case eModifierType_MeshDeform:
+    case eModifierType_SurfaceDeform:
+    case eModifierType_LaplacianDeform:
+    case eModifierType_CorrectiveSmooth:
+    case eModifierType_ParticleSystem:
+    case eModifierType_Explode:
+      return false;
+    default:
+      break;
+  }
+
+  /* Other objects, textures or images. */
+  bool has_id_link = false;
+  if (mti->foreachIDLink) {
+    mti->foreachIDLink(md, ob, stack_cache_id_link_cb, &has_id_link);
+  }
+  else if (mti->foreachObjectLink) {
+    mti->foreachObjectLink(md, ob, (ObjectWalkFunc)stack_cache_id_link_cb, &has_id_link);
+  }
+  return !has_id_link;
+}
+
+/**
+ * Find the leading part of the stack which can be cached, returning its last constructive
+ * modifier (the cache holds the mesh right after it), or NULL when nothing can be cached.
+ * The modifiers in that part must be supported by the cache and must not need orco data,
+ * which is evaluated in parallel to the stack.
+ */
+static ModifierData *modifier_stack_cache_find_end(Scene *scene,
+                                                   Object *ob,
+                                                   ModifierData *firstmd,
+                                                   CDMaskLink *datamasks,
+                                                   const CustomData_MeshMasks *final_datamask,
+                                                   const int required_mode,
+                                                   const bool need_mapping,
+                                                   CDMaskLink **r_datamask,
+                                                   int *r_modifiers_num,
+                                                   uint32_t r_key[2])
+{
+  /* Virtual modifiers (shape keys, parent deform) depend on other datablocks. */
+  if (firstmd != ob->modifiers.first) {
+    return NULL;
+  }
+  Mesh *mesh_input = ob->data;
+  if (CustomData_has_layer(&mesh_input->ldata, CD_MDISPS) ||
+      CustomData_has_layer(&mesh_input->ldata, CD_GRID_PAINT_MASK)) {
+    return NULL;
+  }
+
+  const CustomDataMask orco_mask = CD_MASK_ORCO | CD_MASK_CLOTH_ORCO;
+  ModifierStackCacheHash hash, hash_end;
+  ModifierData *md_end = NULL;
+  CDMaskLink *md_datamask = datamasks;
+  bool have_non_onlydeform_modifiers = false;
+  int modifiers_num = 0;
+
+  BLI_hash_mm2a_init(&hash.mm2[0], 0);
+  BLI_hash_mm2a_init(&hash.mm2[1], 1);
+  stack_cache_hash_add_int(&hash, need_mapping);
+  stack_cache_hash_add_int(&hash, required_mode);
+  /* Subdivision levels are limited by the scene. */
+  stack_cache_hash_add_int(&hash, scene->r.mode & R_SIMPLIFY);
+  stack_cache_hash_add_int(&hash, scene->r.simplify_subsurf);
+  stack_cache_hash_add_int(&hash, scene->r.simplify_subsurf_render);
+
+  for (ModifierData *md = firstmd; md; md = md->next, md_datamask = md_datamask->next) {
+    const ModifierTypeInfo *mti = modifierType_getInfo(md->type);
+    const bool is_enabled = modifier_isEnabled(scene, md, required_mode);
+
+    stack_cache_hash_add_int(&hash, md->type);
+    stack_cache_hash_add_int(&hash, is_enabled);
+    if (!is_enabled) {
+      modifiers_num++;
+      continue;
+    }
+
+    if (!modifier_stack_cache_supports(ob, md) || (md_datamask->mask.vmask & orco_mask) ||
+        ((mti->flags & eModifierTypeFlag_RequiresOriginalData) &&
+         have_non_onlydeform_modifiers)) {
+      break;
+    }
+
+    stack_cache_hash_add(&hash, &md_datamask->mask, sizeof(md_datamask->mask));
+    stack_cache_hash_add_modifier(&hash, md, mti);
+    modifiers_num++;
+
+    if (need_mapping && !modifier_supportsMapping(md)) {
+      /* Skipped by the stack, but still part of the hash since leading deform modifiers are
+       * applied regardless. */
+      continue;
+    }
+
+    if (mti->type != eModifierTypeType_OnlyDeform) {
+      /* Layers of the result also depend on what the following modifiers need. */
+      const CustomData_MeshMasks *nextmask = md_datamask->next ? &md_datamask->next->mask :
+                                                                 final_datamask;
+      if (nextmask->vmask & orco_mask) {
+        break;
+      }
+      hash_end = hash;
+      stack_cache_hash_add(&hash_end, nextmask, sizeof(*nextmask));
+      md_end = md;
+      *r_datamask = md_datamask;
+      *r_modifiers_num = modifiers_num;
+      have_non_onlydeform_modifiers = true;
+    }
+  }
+
+  if (md_end == NULL) {
+    return NULL;
+  }
+
+  stack_cache_hash_add_input(&hash_end, ob, mesh_input);
+  r_key[0] = BLI_hash_mm2a_end(&hash_end.mm2[0]);
+  r_key[1] = BLI_hash_mm2a_end(&hash_end.mm2[1]);
+  return md_end;
+}
+
+static bool modifier_stack_cache_is_valid(const ModifierStackCache *cache,
+                                          const int modifiers_num,
+                                          const uint32_t key[2])
+{
+  return (cache != NULL && cache->modifiers_num == modifiers_num && cache->key[0] == key[0] &&
+          cache->key[1] == key[1]);
+}
+
+static void modifier_stack_cache_store(Object *ob,
+                                       ModifierData *md_end,
+                                       const int modifiers_num,
+                                       const uint32_t key[2],
+                                       Mesh *mesh,
+                                       Mesh *mesh_deform)
+{
+  mesh_modifier_stack_cache_free(ob);
+
+  /* Errors are only reported when modifiers are evaluated. */
+  for (ModifierData *md = ob->modifiers.first; md; md = md->next) {
+    if (md->error) {
+      return;
+    }
+    if (md == md_end) {
+      break;
+    }
+  }
+
+  ModifierStackCache *cache = MEM_callocN(sizeof(*cache), __func__);
+  cache->key[0] = key[0];
+  cache->key[1] = key[1];
+  cache->modifiers_num = modifiers_num;
+  /* Layers are shared with the evaluated meshes, so this does not duplicate their data. */
+  cache->mesh = BKE_mesh_copy_for_eval(mesh, true);
+  cache->mesh_deform = BKE_mesh_copy_for_eval(mesh_deform, true);
+  ob->runtime.modifier_stack_cache = cache;
+}
+
+void mesh_modifier_stack_cache_free(Object *ob)
+{
+  ModifierStackCache *cache = ob->runtime.modifier_stack_cache;
+  if (cache == NULL) {
+    return;
+  }
+  BKE_id_free(NULL, cache->mesh);
+  BKE_id_free(NULL, cache->mesh_deform);
+  MEM_freeN(cache);
+  ob->runtime.modifier_stack_cache = NULL;
+}
+
+int mesh_modifier_stack_cache_hits_get(const Object *ob)
+{
+  const ModifierStackCache *cache = ob->runtime.modifier_stack_cache;
+  return (cache != NULL) ? cache->hits : -1;
+}
+
+/** \} */
+
 static void mesh_calc_modifiers(struct Depsgraph *depsgraph,
                                 Scene *scene,
                                 Object *ob,
@@ -881,6 +1250,10 @@ static void mesh_calc_modifiers(struct Depsgraph *depsgraph,
   Mesh *mesh_deform = NULL;
   BLI_assert((mesh_input->id.tag & LIB_TAG_COPIED_ON_WRITE_EVAL_RESULT) == 0);
 
+  /* The deform mesh has the final coordinates, as long as no modifier is applied after the
+   * leading deform modifiers. */
+  bool is_deform_final = false;
+
   /* Deformed vertex locations array. Deform only modifier need this type of
    * float array rather than MVert*. Tracked along with mesh_final as an
    * optimization to avoid copying coordinates back and forth if there are
@@ -946,8 +1319,43 @@ static void mesh_calc_modifiers(struct Depsgraph *depsgraph,
   /* Clear errors before evaluation. */
   modifiers_clearErrors(ob);
 
+  /* Leading part of the stack which can be reused across evaluations. */
+  ModifierData *cache_end_md = NULL;
+  CDMaskLink *cache_end_datamask = NULL;
+  int cache_modifiers_num = 0;
+  uint32_t cache_key[2] = {0, 0};
+  bool is_cache_used = false;
+  if (use_cache && useDeform == 1 && index == -1 && r_deform != NULL && !sculpt_mode) {
+    cache_end_md = modifier_stack_cache_find_end(scene,
+                                                 ob,
+                                                 firstmd,
+                                                 datamasks,
+                                                 &final_datamask,
+                                                 required_mode,
+                                                 need_mapping,
+                                                 &cache_end_datamask,
+                                                 &cache_modifiers_num,
+                                                 cache_key);
+    if (cache_end_md == NULL) {
+      mesh_modifier_stack_cache_free(ob);
+    }
+  }
+  if (cache_end_md != NULL &&
+      modifier_stack_cache_is_valid(
+          ob->runtime.modifier_stack_cache, cache_modifiers_num, cache_key)) {
+    ModifierStackCache *cache = ob->runtime.modifier_stack_cache;
+    mesh_final = BKE_mesh_copy_for_eval(cache->mesh, true);
+    mesh_deform = BKE_mesh_copy_for_eval(cache->mesh_deform, true);
+    cache->hits++;
+    md = cache_end_md->next;
+    md_datamask = cache_end_datamask->next;
+    /* Nothing left to store. */
+    cache_end_md = NULL;
+    is_cache_used = true;
+  }
+
   /* Apply all leading deform modifiers. */
-  if (useDeform) {
+  if (useDeform && !is_cache_used) {
     for (; md; md = md->next, md_datamask = md_datamask->next) {
       const ModifierTypeInfo *mti = modifierType_getInfo(md->type);
 
@@ -993,12 +1401,13 @@ static void mesh_calc_modifiers(struct Depsgraph *depsgraph,
 
       if (deformed_verts) {
         BKE_mesh_vert_coords_apply(mesh_deform, deformed_verts);
+        is_deform_final = true;
       }
     }
   }
 
   /* Apply all remaining constructive and deforming modifiers. */
-  bool have_non_onlydeform_modifiers_appled = false;
+  bool have_non_onlydeform_modifiers_appled = is_cache_used;
   for (; md; md = md->next, md_datamask = md_datamask->next) {
     const ModifierTypeInfo *mti = modifierType_getInfo(md->type);
 
@@ -1071,6 +1480,7 @@ static void mesh_calc_modifiers(struct Depsgraph *depsgraph,
     /* How to apply modifier depends on (a) what we already have as
      * a result of previous modifiers (could be a Mesh or just
      * deformed vertices) and (b) what type the modifier is. */
+    is_deform_final = false;
     if (mti->type == eModifierTypeType_OnlyDeform) {
       /* No existing verts to deform, need to build them. */
       if (!deformed_verts) {
@@ -1258,6 +1668,11 @@ static void mesh_calc_modifiers(struct Depsgraph *depsgraph,
       }
 
       mesh_final->runtime.deformed_only = false;
+
+      if (md == cache_end_md && deformed_verts == NULL) {
+        modifier_stack_cache_store(
+            ob, md, cache_modifiers_num, cache_key, mesh_final, mesh_deform);
+      }
     }
 
     isPrevDeform = (mti->type == eModifierTypeType_OnlyDeform);
@@ -1290,6 +1705,11 @@ static void mesh_calc_modifiers(struct Depsgraph *depsgraph,
         (final_datamask.pmask & CD_MASK_NORMAL) == 0) {
       mesh_final = mesh_input;
     }
+    else if (is_deform_final) {
+      mesh_final = mesh_calc_modifier_final_from_deform(mesh_input, &final_datamask, mesh_deform);
+      MEM_freeN(deformed_verts);
+      deformed_verts = NULL;
+    }
     else {
       mesh_final = BKE_mesh_copy_for_eval(mesh_input, true);
     }
@@ -1736,6 +2156,59 @@ static void mesh_runtime_check_normals_valid(const Mesh *mesh)
   BLI_assert(!(mesh->runtime.cd_dirty_poly & CD_MASK_NORMAL));
 }
 
+/* Detach the evaluated mesh of the object when its draw cache could be taken over by the next
+ * evaluation, see #mesh_batch_cache_take_deformed. */
+static Mesh *mesh_build_data_detach_prev(Object *ob)
+{
+  if (ob->runtime.data_eval == NULL || !ob->runtime.is_data_eval_owned ||
+      GS(ob->runtime.data_eval->name) != ID_ME) {
+    return NULL;
+  }
+  Mesh *mesh_prev = (Mesh *)ob->runtime.data_eval;
+  if (mesh_prev->runtime.batch_cache == NULL || !mesh_prev->runtime.deformed_only ||
+      mesh_prev->runtime.subdiv_ccg != NULL || (ob->mode & OB_MODE_ALL_SCULPT)) {
+    return NULL;
+  }
+  ob->runtime.data_eval = NULL;
+  ob->runtime.is_data_eval_owned = false;
+  return mesh_prev;
+}
+
+/**
+ * When both meshes are only deformed from the same input their topology and custom-data layers
+ * are shared with it, only vertex coordinates and normals differ. In that case keep the draw
+ * cache and only refresh the coordinate dependent buffers instead of rebuilding all of them.
+ *
+ * Shared layers keep their data alive as long as \a mesh_prev uses them, so comparing arrays
+ * is enough to detect a changed input mesh.
+ */
+static void mesh_batch_cache_take_deformed(const Mesh *mesh_input,
+                                           Mesh *mesh_prev,
+                                           Mesh *mesh_eval)
+{
+  /* Any update of the input mesh itself may have changed more than coordinates. */
+  if (mesh_input->id.recalc != 0) {
+    return;
+  }
+  if (!mesh_eval->runtime.deformed_only || mesh_eval->runtime.batch_cache != NULL) {
+    return;
+  }
+  if (mesh_prev->totvert != mesh_eval->totvert || mesh_prev->totedge != mesh_eval->totedge ||
+      mesh_prev->totloop != mesh_eval->totloop || mesh_prev->totpoly != mesh_eval->totpoly ||
+      mesh_prev->totcol != mesh_eval->totcol) {
+    return;
+  }
+  if (mesh_prev->medge != mesh_eval->medge || mesh_prev->mloop != mesh_eval->mloop ||
+      mesh_prev->mpoly != mesh_eval->mpoly) {
+    return;
+  }
+
+  mesh_eval->runtime.batch_cache = mesh_prev->runtime.batch_cache;
+  mesh_prev->runtime.batch_cache = NULL;
+  BKE_mesh_batch_cache_dirty_tag(mesh_eval, BKE_MESH_BATCH_DIRTY_DEFORM);
+  mesh_eval->runtime.is_batch_cache_deformed = true;
+}
+
 static void mesh_build_data(struct Depsgraph *depsgraph,
                             Scene *scene,
                             Object *ob,
@@ -1748,6 +2221,7 @@ static void mesh_build_data(struct Depsgraph *depsgraph,
    * they aren't cleaned up properly on mode switch, causing crashes, e.g T58150. */
   BLI_assert(ob->id.tag & LIB_TAG_COPIED_ON_WRITE);
 
+  Mesh *mesh_prev = mesh_build_data_detach_prev(ob);
   BKE_object_free_derived_caches(ob);
   if (DEG_is_active(depsgraph)) {
     BKE_sculpt_update_object_before_eval(ob);
@@ -1785,6 +2259,13 @@ static void mesh_build_data(struct Depsgraph *depsgraph,
   const bool is_mesh_eval_owned = (mesh_eval != mesh->runtime.mesh_eval);
   BKE_object_eval_assign_data(ob, &mesh_eval->id, is_mesh_eval_owned);
 
+  if (mesh_prev != NULL) {
+    if (is_mesh_eval_owned) {
+      mesh_batch_cache_take_deformed(mesh, mesh_prev, mesh_eval);
+    }
+    BKE_mesh_eval_delete(mesh_prev);
+  }
+
   ob->runtime.mesh_deform_eval = mesh_deform_eval;
   ob->runtime.last_data_mask = *dataMask;
   ob->runtime.last_need_mapping = need_mapping;
@@ -55,6 +55,7 @@
 #include "BKE_screen.h"
 #include "BKE_sequencer.h"
 #include "BKE_studiolight.h"
+#include "BKE_subdiv.h"
 
 #include "DEG_depsgraph.h"
 
@@ -81,6 +82,9 @@ void BKE_blender_free(void)
   BKE_main_free(G_MAIN);
   G_MAIN = NULL;
 
+  /* After free main, evaluated modifiers release their subdivision descriptors to the cache. */
+  BKE_subdiv_topology_cache_clear();
+
   if (G.log.file != NULL) {
     fclose(G.log.file);
   }
@@ -119,6 +119,22 @@ MemFileUndoData *BKE_memfile_undo_encode(Main *bmain, MemFileUndoData *mfu_prev)
     MemFile *prevfile = (mfu_prev) ? &(mfu_prev->memfile) : NULL;
     /* success = */ /* UNUSED */ BLO_write_file_mem(bmain, prevfile, &mfu->memfile, G.fileflags);
     mfu->undo_size = mfu->memfile.size;
+
+    if (G.debug & G_DEBUG_IO) {
+      const MemFileStats *stats = &mfu->memfile.stats;
+      size_t shared_size;
+      int shared_buffers_len;
+      BLO_memfile_shared_size_get(&shared_size, &shared_buffers_len);
+      printf("Undo push: %.3f ms, %zu/%zu bytes new, %d/%d chunks shared, %d/%d ID's changed\n",
+             stats->time_write * 1000.0,
+             mfu->memfile.size,
+             stats->size_total,
+             stats->chunks_shared_len,
+             stats->chunks_len,
+             stats->ids_changed_len,
+             stats->ids_len);
+      printf("Undo memory: %zu bytes in %d buffers\n", shared_size, shared_buffers_len);
+    }
   }
 
   bmain->is_memfile_undo_written = true;
@@ -137,6 +137,42 @@ BVHTree *bvhtree_build_from_mvert(const MVert *mvert,
   return tree;
 }
 
+typedef struct BVHTreeUpdateFromMVertData {
+  const MVert *mvert;
+  const MVert *mvert_moving;
+  const MVertTri *tri;
+  int tri_num;
+} BVHTreeUpdateFromMVertData;
+
+static void bvhtree_update_from_mvert_cb(void *userdata, BVHTree *bvhtree, int index)
+{
+  const BVHTreeUpdateFromMVertData *data = userdata;
+  const MVertTri *vt = &data->tri[index];
+  float co[3][3];
+
+  if (index >= data->tri_num) {
+    return;
+  }
+
+  copy_v3_v3(co[0], data->mvert[vt->tri[0]].co);
+  copy_v3_v3(co[1], data->mvert[vt->tri[1]].co);
+  copy_v3_v3(co[2], data->mvert[vt->tri[2]].co);
+
+  /* copy new locations into array */
+  if (data->mvert_moving) {
+    float co_moving[3][3];
+    /* update moving positions */
+    copy_v3_v3(co_moving[0], data->mvert_moving[vt->tri[0]].co);
+    copy_v3_v3(co_moving[1], data->mvert_moving[vt->tri[1]].co);
+    copy_v3_v3(co_moving[2], data->mvert_moving[vt->tri[2]].co);
+
+    BLI_bvhtree_update_node(bvhtree, index, &co[0][0], &co_moving[0][0], 3);
+  }
+  else {
+    BLI_bvhtree_update_node(bvhtree, index, &co[0][0], NULL, 3);
+  }
+}
+
 void bvhtree_update_from_mvert(BVHTree *bvhtree,
                                const MVert *mvert,
                                const MVert *mvert_moving,
@@ -144,46 +180,19 @@ void bvhtree_update_from_mvert(BVHTree *bvhtree,
                                int tri_num,
                                bool moving)
 {
-  const MVertTri *vt;
-  int i;
-
   if ((bvhtree == NULL) || (mvert == NULL)) {
     return;
   }
 
-  if (mvert_moving == NULL) {
-    moving = false;
-  }
-
-  for (i = 0, vt = tri; i < tri_num; i++, vt++) {
-    float co[3][3];
-    bool ret;
-
-    copy_v3_v3(co[0], mvert[vt->tri[0]].co);
-    copy_v3_v3(co[1], mvert[vt->tri[1]].co);
-    copy_v3_v3(co[2], mvert[vt->tri[2]].co);
-
-    /* copy new locations into array */
-    if (moving) {
-      float co_moving[3][3];
-      /* update moving positions */
-      copy_v3_v3(co_moving[0], mvert_moving[vt->tri[0]].co);
-      copy_v3_v3(co_moving[1], mvert_moving[vt->tri[1]].co);
-      copy_v3_v3(co_moving[2], mvert_moving[vt->tri[2]].co);
-
-      ret = BLI_bvhtree_update_node(bvhtree, i, &co[0][0], &co_moving[0][0], 3);
-    }
-    else {
-      ret = BLI_bvhtree_update_node(bvhtree, i, &co[0][0], NULL, 3);
-    }
-
-    /* check if tree is already full */
-    if (ret == false) {
-      break;
-    }
-  }
+  BVHTreeUpdateFromMVertData data = {
+      .mvert = mvert,
+      .mvert_moving = moving ? mvert_moving : NULL,
+      .tri = tri,
+      .tri_num = tri_num,
+  };
 
-  BLI_bvhtree_update_tree(bvhtree);
+  /* Leafs beyond `tri_num` are left untouched, as are triangles the tree has no room for. */
+  BLI_bvhtree_refit(bvhtree, bvhtree_update_from_mvert_cb, &data);
 }
 
 /* ***************************
@@ -26,6 +26,8 @@
 
 #include "MEM_guardedalloc.h"
 
+#include "atomic_ops.h"
+
 /* Since we have versioning code here (CustomData_verify_versions()). */
 #define DNA_DEPRECATED_ALLOW
 
@@ -1848,6 +1850,89 @@ static bool customdata_typemap_is_valid(const CustomData *data)
 }
 #endif
 
+/********************* Shared layers *********************/
+
+/* Layers copied with CD_SHARE use the data array of their source, the layers using it keep
+ * a common user count and the last one to go frees the data.
+ * While shared, the data is treated like referenced data: elements aren't freed individually
+ * and writers get their own copy with CustomData_duplicate_referenced_layer. */
+
+typedef struct CustomDataSharingInfo {
+  /* Number of layers using the data, only modified atomically. */
+  int32_t users;
+} CustomDataSharingInfo;
+
+static bool customData_layer_can_share(const CustomDataLayer *layer)
+{
+  /* External data may be (re)loaded in place. */
+  return layer->data && !(layer->flag & (CD_FLAG_NOFREE | CD_FLAG_EXTERNAL));
+}
+
+static bool customData_layer_is_shared(const CustomDataLayer *layer)
+{
+  return layer->sharing_info && (layer->sharing_info->users > 1);
+}
+
+/* Add a user to the data of layer, returns the sharing info for the new user. */
+static CustomDataSharingInfo *customData_layer_share(CustomDataLayer *layer)
+{
+  CustomDataSharingInfo *info = layer->sharing_info;
+
+  if (info == NULL) {
+    /* Several copies of the same source may be made concurrently. */
+    CustomDataSharingInfo *info_new = MEM_mallocN(sizeof(*info_new), __func__);
+    info_new->users = 1;
+    info = atomic_cas_ptr((void **)&layer->sharing_info, NULL, info_new);
+    if (info == NULL) {
+      info = info_new;
+    }
+    else {
+      MEM_freeN(info_new);
+    }
+  }
+
+  atomic_add_and_fetch_int32(&info->users, 1);
+  return info;
+}
+
+/* Remove layer from the users of its data, returns true when it was the last one,
+ * in which case the layer owns the data again. */
+static bool customData_layer_release(CustomDataLayer *layer)
+{
+  CustomDataSharingInfo *info = layer->sharing_info;
+
+  layer->sharing_info = NULL;
+  if (atomic_sub_and_fetch_int32(&info->users, 1) == 0) {
+    MEM_freeN(info);
+    return true;
+  }
+  return false;
+}
+
+/* Make sure the layer owns its data exclusively, copying it when used by other layers. */
+static void customData_layer_ensure_unshared(CustomDataLayer *layer, const int totelem)
+{
+  const LayerTypeInfo *typeInfo = layerType_getInfo(layer->type);
+  void *data = layer->data;
+
+  if (layer->sharing_info->users > 1) {
+    if (typeInfo->copy) {
+      layer->data = MEM_malloc_arrayN((size_t)totelem, typeInfo->size, "CD unshare layer");
+      typeInfo->copy(data, layer->data, totelem);
+    }
+    else {
+      layer->data = MEM_dupallocN(data);
+    }
+  }
+  /* Other users may have gone in the meantime, making this the last one. */
+  if (customData_layer_release(layer) && (layer->data != data)) {
+    if (typeInfo->free) {
+      typeInfo->free(data, totelem, typeInfo->size);
+    }
+    MEM_freeN(data);
+  }
+}
+
 bool CustomData_merge(const struct CustomData *source,
                       struct CustomData *dest,
                       CustomDataMask mask,
@@ -1899,6 +1984,7 @@ bool CustomData_merge(const struct CustomData *source,
       case CD_ASSIGN:
       case CD_REFERENCE:
       case CD_DUPLICATE:
+      case CD_SHARE:
         data = layer->data;
         break;
       default:
@@ -1910,10 +1996,30 @@ bool CustomData_merge(const struct CustomData *source,
       newlayer = customData_add_layer__internal(
           dest, type, CD_REFERENCE, data, totelem, layer->name);
     }
+    else if ((alloctype == CD_SHARE) && !customData_layer_can_share(layer)) {
+      newlayer = customData_add_layer__internal(dest,
+                                                type,
+                                                (flag & CD_FLAG_NOFREE) ? CD_REFERENCE :
+                                                                          CD_DUPLICATE,
+                                                data,
+                                                totelem,
+                                                layer->name);
+    }
     else {
       newlayer = customData_add_layer__internal(dest, type, alloctype, data, totelem, layer->name);
     }
 
+    if (newlayer && data && (newlayer->data == data)) {
+      if ((alloctype == CD_SHARE) && customData_layer_can_share(layer)) {
+        /* The source stays a user of the data too, which makes it non-const here. */
+        newlayer->sharing_info = customData_layer_share((CustomDataLayer *)layer);
+      }
+      else if (alloctype == CD_ASSIGN) {
+        /* Ownership moves to the new layer, including its part of shared data. */
+        newlayer->sharing_info = layer->sharing_info;
+      }
+    }
+
     if (newlayer) {
       newlayer->uid = layer->uid;
 
@@ -1941,6 +2047,10 @@ void CustomData_realloc(CustomData *data, int totelem)
       continue;
     }
     typeInfo = layerType_getInfo(layer->type);
+    if (layer->sharing_info) {
+      /* Can't resize data used by others in place. */
+      customData_layer_ensure_unshared(layer, (int)(MEM_allocN_len(layer->data) / typeInfo->size));
+    }
     layer->data = MEM_reallocN(layer->data, (size_t)totelem * typeInfo->size);
   }
 }
@@ -1964,6 +2074,11 @@ static void customData_free_layer__internal(CustomDataLayer *layer, int totelem)
 {
   const LayerTypeInfo *typeInfo;
 
+  if (layer->sharing_info && !customData_layer_release(layer)) {
+    /* Still used by other layers. */
+    return;
+  }
+
   if (!(layer->flag & CD_FLAG_NOFREE) && layer->data) {
     typeInfo = layerType_getInfo(layer->type);
 
@@ -2304,13 +2419,13 @@ static CustomDataLayer *customData_add_layer__internal(CustomData *data,
   /* Passing a layer-data to copy from with an alloctype that won't copy is
    * most likely a bug */
   BLI_assert(!layerdata || (alloctype == CD_ASSIGN) || (alloctype == CD_DUPLICATE) ||
-             (alloctype == CD_REFERENCE));
+             (alloctype == CD_REFERENCE) || (alloctype == CD_SHARE));
 
   if (!typeInfo->defaultname && CustomData_has_layer(data, type)) {
     return &data->layers[CustomData_get_layer_index(data, type)];
   }
 
-  if ((alloctype == CD_ASSIGN) || (alloctype == CD_REFERENCE)) {
+  if (ELEM(alloctype, CD_ASSIGN, CD_REFERENCE, CD_SHARE)) {
     newlayerdata = layerdata;
   }
   else if (totelem > 0 && typeInfo->size > 0) {
@@ -2362,6 +2477,7 @@ static CustomDataLayer *customData_add_layer__internal(CustomData *data,
   data->layers[index].type = type;
   data->layers[index].flag = flag;
   data->layers[index].data = newlayerdata;
+  data->layers[index].sharing_info = NULL;
 
   /* Set default name if none exists. Note we only call DATA_()  once
    * we know there is a default name, to avoid overhead of locale lookups
@@ -2547,7 +2663,10 @@ static void *customData_duplicate_referenced_layer_index(CustomData *data,
 
   layer = &data->layers[layer_index];
 
-  if (layer->flag & CD_FLAG_NOFREE) {
+  if (layer->sharing_info) {
+    customData_layer_ensure_unshared(layer, totelem);
+  }
+  else if (layer->flag & CD_FLAG_NOFREE) {
     /* MEM_dupallocN won't work in case of complex layers, like e.g.
      * CD_MDEFORMVERT, which has pointers to allocated data...
      * So in case a custom copy function is defined, use it!
@@ -2619,7 +2738,23 @@ bool CustomData_is_referenced_layer(struct CustomData *data, int type)
 
   layer = &data->layers[layer_index];
 
-  return (layer->flag & CD_FLAG_NOFREE) != 0;
+  return (layer->flag & CD_FLAG_NOFREE) || customData_layer_is_shared(layer);
+}
+
+bool CustomData_duplicate_shared_layers(CustomData *data, int totelem)
+{
+  bool changed = false;
+
+  for (int i = 0; i < data->totlayer; i++) {
+    CustomDataLayer *layer = &data->layers[i];
+    if (layer->sharing_info) {
+      const void *data_prev = layer->data;
+      customData_layer_ensure_unshared(layer, totelem);
+      changed |= (layer->data != data_prev);
+    }
+  }
+
+  return changed;
 }
 
 void CustomData_free_temporary(CustomData *data, int totelem)
@@ -2801,7 +2936,8 @@ void CustomData_free_elem(CustomData *data, int index, int count)
   const LayerTypeInfo *typeInfo;
 
   for (i = 0; i < data->totlayer; i++) {
-    if (!(data->layers[i].flag & CD_FLAG_NOFREE)) {
+    if (!(data->layers[i].flag & CD_FLAG_NOFREE) &&
+        !customData_layer_is_shared(&data->layers[i])) {
       typeInfo = layerType_getInfo(data->layers[i].type);
 
       if (typeInfo->free) {
@@ -3683,13 +3819,30 @@ bool CustomData_has_referenced(const struct CustomData *data)
 {
   int i;
   for (i = 0; i < data->totlayer; i++) {
-    if (data->layers[i].flag & CD_FLAG_NOFREE) {
+    if ((data->layers[i].flag & CD_FLAG_NOFREE) ||
+        customData_layer_is_shared(&data->layers[i])) {
       return true;
     }
   }
   return false;
 }
 
+/* Memory used by the layers which are owned by this custom data only (neither referenced nor
+ * shared), e.g. what a copy of custom data has actually allocated. */
+size_t CustomData_get_owned_data_size(const struct CustomData *data, int totelem)
+{
+  size_t size = 0;
+  for (int i = 0; i < data->totlayer; i++) {
+    const CustomDataLayer *layer = &data->layers[i];
+    if (layer->data == NULL || (layer->flag & CD_FLAG_NOFREE) ||
+        customData_layer_is_shared(layer)) {
+      continue;
+    }
+    size += (size_t)layerType_getInfo(layer->type)->size * (size_t)totelem;
+  }
+  return size;
+}
+
 /* copies the "value" (e.g. mloopuv uv or mloopcol colors) from one block to
  * another, while not overwriting anything else (e.g. flags)*/
 void CustomData_data_copy_value(int type, const void *source, void *dest)
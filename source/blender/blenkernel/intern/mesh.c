@@ -468,6 +468,28 @@ void BKE_mesh_update_customdata_pointers(Mesh *me, const bool do_ensure_tess_cd)
   me->mloopuv = CustomData_get_layer(&me->ldata, CD_MLOOPUV);
 }
 
+/**
+ * Make \a me the only user of its custom data, for code writing into the arrays in place over
+ * a longer time than until the next evaluation, which would otherwise see the changes in the
+ * evaluated copies sharing them (see #CD_SHARE).
+ *
+ * \return true when any array moved, pointers into the old ones need to be updated.
+ */
+bool BKE_mesh_duplicate_shared_layers(Mesh *me)
+{
+  bool changed = false;
+  changed |= CustomData_duplicate_shared_layers(&me->vdata, me->totvert);
+  changed |= CustomData_duplicate_shared_layers(&me->edata, me->totedge);
+  changed |= CustomData_duplicate_shared_layers(&me->fdata, me->totface);
+  changed |= CustomData_duplicate_shared_layers(&me->ldata, me->totloop);
+  changed |= CustomData_duplicate_shared_layers(&me->pdata, me->totpoly);
+
+  if (changed) {
+    BKE_mesh_update_customdata_pointers(me, false);
+  }
+  return changed;
+}
+
 bool BKE_mesh_has_custom_loop_normals(Mesh *me)
 {
   if (me->edit_mesh) {
@@ -587,7 +609,13 @@ void BKE_mesh_copy_data(Main *bmain, Mesh *me_dst, const Mesh *me_src, const int
 
   me_dst->mat = MEM_dupallocN(me_src->mat);
 
-  const eCDAllocType alloc_type = (flag & LIB_ID_COPY_CD_REFERENCE) ? CD_REFERENCE : CD_DUPLICATE;
+  eCDAllocType alloc_type = CD_DUPLICATE;
+  if (flag & LIB_ID_COPY_CD_REFERENCE) {
+    alloc_type = CD_REFERENCE;
+  }
+  else if (flag & LIB_ID_COPY_CD_SHARE) {
+    alloc_type = CD_SHARE;
+  }
   CustomData_copy(&me_src->vdata, &me_dst->vdata, mask.vmask, alloc_type, me_dst->totvert);
   CustomData_copy(&me_src->edata, &me_dst->edata, mask.emask, alloc_type, me_dst->totedge);
   CustomData_copy(&me_src->ldata, &me_dst->ldata, mask.lmask, alloc_type, me_dst->totloop);
@@ -752,7 +780,8 @@ Mesh *BKE_mesh_copy_for_eval(struct Mesh *source, bool reference)
   int flags = LIB_ID_COPY_LOCALIZE;
 
   if (reference) {
-    flags |= LIB_ID_COPY_CD_REFERENCE;
+    /* Sharing rather than referencing, so the copy doesn't depend on the lifetime of source. */
+    flags |= LIB_ID_COPY_CD_SHARE;
   }
 
   Mesh *result;
@@ -48,6 +48,7 @@
 #include "BKE_customdata.h"
 #include "BKE_global.h"
 #include "BKE_mesh.h"
+#include "BKE_mesh_mapping.h"
 #include "BKE_multires.h"
 #include "BKE_report.h"
 
@@ -215,6 +216,7 @@ typedef struct MeshCalcNormalsData {
   MVert *mverts;
   float (*pnors)[3];
   float (*lnors_weighted)[3];
+  const MeshElemMap *vert_to_loop;
   float (*vnors)[3];
 } MeshCalcNormalsData;
 
@@ -228,21 +230,17 @@ static void mesh_calc_normals_poly_cb(void *__restrict userdata,
   BKE_mesh_calc_poly_normal(mp, data->mloop + mp->loopstart, data->mverts, data->pnors[pidx]);
 }
 
-static void mesh_calc_normals_poly_prepare_cb(void *__restrict userdata,
-                                              const int pidx,
-                                              const TaskParallelTLS *__restrict UNUSED(tls))
+/**
+ * Compute poly normal of a polygon and its angle weighted normal for each of its loops,
+ * \a nverts is a constant for triangles and quads, so the compiler can unroll the loops.
+ */
+BLI_INLINE void mesh_calc_normals_poly_prepare_do(const MLoop *ml,
+                                                  const MVert *mverts,
+                                                  float pnor[3],
+                                                  float (*lnors_weighted)[3],
+                                                  const int nverts,
+                                                  float (*edgevecbuf)[3])
 {
-  MeshCalcNormalsData *data = userdata;
-  const MPoly *mp = &data->mpolys[pidx];
-  const MLoop *ml = &data->mloop[mp->loopstart];
-  const MVert *mverts = data->mverts;
-
-  float pnor_temp[3];
-  float *pnor = data->pnors ? data->pnors[pidx] : pnor_temp;
-  float(*lnors_weighted)[3] = data->lnors_weighted;
-
-  const int nverts = mp->totloop;
-  float(*edgevecbuf)[3] = BLI_array_alloca(edgevecbuf, (size_t)nverts);
   int i;
 
   /* Polygon Normal and edge-vector */
@@ -272,12 +270,11 @@ static void mesh_calc_normals_poly_prepare_cb(void *__restrict userdata,
 
   /* accumulate angle weighted face normal */
   /* inline version of #accumulate_vertex_normals_poly_v3,
-   * split between this threaded callback and #mesh_calc_normals_poly_accum_cb. */
+   * split between this threaded callback and #mesh_calc_normals_poly_finalize_cb. */
   {
     const float *prev_edge = edgevecbuf[nverts - 1];
 
     for (i = 0; i < nverts; i++) {
-      const int lidx = mp->loopstart + i;
       const float *cur_edge = edgevecbuf[i];
 
       /* calculate angle between the two poly edges incident on
@@ -285,21 +282,64 @@ static void mesh_calc_normals_poly_prepare_cb(void *__restrict userdata,
       const float fac = saacos(-dot_v3v3(cur_edge, prev_edge));
 
       /* Store for later accumulation */
-      mul_v3_v3fl(lnors_weighted[lidx], pnor, fac);
+      mul_v3_v3fl(lnors_weighted[i], pnor, fac);
 
       prev_edge = cur_edge;
     }
   }
 }
 
+static void mesh_calc_normals_poly_prepare_cb(void *__restrict userdata,
+                                              const int pidx,
+                                              const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  MeshCalcNormalsData *data = userdata;
+  const MPoly *mp = &data->mpolys[pidx];
+  const MLoop *ml = &data->mloop[mp->loopstart];
+  const MVert *mverts = data->mverts;
+
+  float pnor_temp[3];
+  float *pnor = data->pnors ? data->pnors[pidx] : pnor_temp;
+  float(*lnors_weighted)[3] = &data->lnors_weighted[mp->loopstart];
+
+  /* Fixed size versions for the common triangle and quad cases. */
+  switch (mp->totloop) {
+    case 3: {
+      float edgevecbuf[3][3];
+      mesh_calc_normals_poly_prepare_do(ml, mverts, pnor, lnors_weighted, 3, edgevecbuf);
+      break;
+    }
+    case 4: {
+      float edgevecbuf[4][3];
+      mesh_calc_normals_poly_prepare_do(ml, mverts, pnor, lnors_weighted, 4, edgevecbuf);
+      break;
+    }
+    default: {
+      const int nverts = mp->totloop;
+      float(*edgevecbuf)[3] = BLI_array_alloca(edgevecbuf, (size_t)nverts);
+      mesh_calc_normals_poly_prepare_do(ml, mverts, pnor, lnors_weighted, nverts, edgevecbuf);
+      break;
+    }
+  }
+}
+
 static void mesh_calc_normals_poly_finalize_cb(void *__restrict userdata,
                                                const int vidx,
                                                const TaskParallelTLS *__restrict UNUSED(tls))
 {
   MeshCalcNormalsData *data = userdata;
+  const MeshElemMap *loops = &data->vert_to_loop[vidx];
 
   MVert *mv = &data->mverts[vidx];
-  float *no = data->vnors[vidx];
+  float no_temp[3];
+  float *no = data->vnors ? data->vnors[vidx] : no_temp;
+
+  /* Gather the weighted normals of the loops using the vertex, always in the same order,
+   * so the result doesn't depend on threading. */
+  zero_v3(no);
+  for (int i = 0; i < loops->count; i++) {
+    add_v3_v3(no, data->lnors_weighted[loops->indices[i]]);
+  }
 
   if (UNLIKELY(normalize_v3(no) == 0.0f)) {
     /* following Mesh convention; we use vertex coordinate itself for normal in this case */
@@ -340,19 +380,15 @@ void BKE_mesh_calc_normals_poly(MVert *mverts,
     return;
   }
 
-  float(*vnors)[3] = r_vertnors;
   float(*lnors_weighted)[3] = MEM_malloc_arrayN(
       (size_t)numLoops, sizeof(*lnors_weighted), __func__);
-  bool free_vnors = false;
+  MeshElemMap *vert_to_loop;
+  int *vert_to_loop_mem;
 
-  /* first go through and calculate normals for all the polys */
-  if (vnors == NULL) {
-    vnors = MEM_calloc_arrayN((size_t)numVerts, sizeof(*vnors), __func__);
-    free_vnors = true;
-  }
-  else {
-    memset(vnors, 0, sizeof(*vnors) * (size_t)numVerts);
-  }
+  /* Vertices are shared between polygons of different tasks, instead of accumulating into them
+   * from there, each vertex gathers the normals of its loops. */
+  BKE_mesh_vert_loop_map_create(
+      &vert_to_loop, &vert_to_loop_mem, mpolys, mloop, numVerts, numPolys, numLoops);
 
   MeshCalcNormalsData data = {
       .mpolys = mpolys,
@@ -360,26 +396,18 @@ void BKE_mesh_calc_normals_poly(MVert *mverts,
       .mverts = mverts,
       .pnors = pnors,
       .lnors_weighted = lnors_weighted,
-      .vnors = vnors,
+      .vert_to_loop = vert_to_loop,
+      .vnors = r_vertnors,
   };
 
   /* Compute poly normals, and prepare weighted loop normals. */
   BLI_task_parallel_range(0, numPolys, &data, mesh_calc_normals_poly_prepare_cb, &settings);
 
-  /* Actually accumulate weighted loop normals into vertex ones. */
-  /* Unfortunately, not possible to thread that
-   * (not in a reasonable, totally lock- and barrier-free fashion),
-   * since several loops will point to the same vertex... */
-  for (int lidx = 0; lidx < numLoops; lidx++) {
-    add_v3_v3(vnors[mloop[lidx].v], data.lnors_weighted[lidx]);
-  }
-
-  /* Normalize and validate computed vertex normals. */
+  /* Accumulate weighted loop normals into vertex ones, normalize and validate them. */
   BLI_task_parallel_range(0, numVerts, &data, mesh_calc_normals_poly_finalize_cb, &settings);
 
-  if (free_vnors) {
-    MEM_freeN(vnors);
-  }
+  MEM_freeN(vert_to_loop);
+  MEM_freeN(vert_to_loop_mem);
   MEM_freeN(lnors_weighted);
 }
 
@@ -763,7 +791,6 @@ void BKE_lnor_space_custom_normal_to_data(MLoopNorSpace *lnor_space,
 typedef struct LoopSplitTaskData {
   /* Specific to each instance (each task). */
 
-  /** We have to create those outside of tasks, since afaik memarena is not threadsafe. */
   MLoopNorSpace *lnor_space;
   float (*lnor)[3];
   const MLoop *ml_curr;
@@ -774,11 +801,9 @@ typedef struct LoopSplitTaskData {
   const int *e2l_prev;
   int mp_index;
 
-  /** This one is special, it's owned and managed by worker tasks,
+  /** This one is special, it's owned and managed by worker threads,
    * avoid to have to create it for each fan! */
   BLI_Stack *edge_vectors;
-
-  char pad_c;
 } LoopSplitTaskData;
 
 typedef struct LoopSplitTaskDataCommon {
@@ -788,6 +813,11 @@ typedef struct LoopSplitTaskDataCommon {
   MLoopNorSpaceArray *lnors_spacearr;
   float (*loopnors)[3];
   short (*clnors_data)[2];
+  /** Type of each loop, see #LOOP_SPLIT_SKIP... */
+  char *loop_types;
+  /** Index (plus one) of the loop walking the smooth fan of each loop when looking for the entry
+   * point of cyclic smooth fans, see #loop_split_cyclic_smooth_fan_elect. */
+  int *loop_owners;
 
   /* Read-only. */
   const MVert *mverts;
@@ -803,6 +833,22 @@ typedef struct LoopSplitTaskDataCommon {
   int numPolys;
 } LoopSplitTaskDataCommon;
 
+/* Per thread data of loop split tasks. */
+typedef struct LoopSplitTaskTLS {
+  /** Temp edge vectors stack, only used when computing lnor spacearr. */
+  BLI_Stack *edge_vectors;
+} LoopSplitTaskTLS;
+
+/**
+ * Loop types: only the loops starting a smooth fan (or a single sharp loop)
+ * are processed, all other loops get their normal from the fan they belong to.
+ */
+enum {
+  LOOP_SPLIT_SKIP = 0,
+  LOOP_SPLIT_SINGLE = 1,
+  LOOP_SPLIT_FAN = 2,
+};
+
 #define INDEX_UNSET INT_MIN
 #define INDEX_INVALID -1
 /* See comment about edge_to_loops below. */
@@ -1300,84 +1346,57 @@ static void loop_split_worker_do(LoopSplitTaskDataCommon *common_data,
   }
 }
 
-static void loop_split_worker(TaskPool *__restrict pool, void *taskdata, int UNUSED(threadid))
-{
-  LoopSplitTaskDataCommon *common_data = BLI_task_pool_userdata(pool);
-  LoopSplitTaskData *data = taskdata;
-
-  /* Temp edge vectors stack, only used when computing lnor spacearr. */
-  BLI_Stack *edge_vectors = common_data->lnors_spacearr ?
-                                BLI_stack_new(sizeof(float[3]), __func__) :
-                                NULL;
-
-#ifdef DEBUG_TIME
-  TIMEIT_START_AVERAGED(loop_split_worker);
-#endif
-
-  for (int i = 0; i < LOOP_SPLIT_TASK_BLOCK_SIZE; i++, data++) {
-    /* A NULL ml_curr is used to tag ended data! */
-    if (data->ml_curr == NULL) {
-      break;
-    }
-
-    loop_split_worker_do(common_data, data, edge_vectors);
-  }
-
-  if (edge_vectors) {
-    BLI_stack_free(edge_vectors);
-  }
-
-#ifdef DEBUG_TIME
-  TIMEIT_END_AVERAGED(loop_split_worker);
-#endif
-}
-
 /**
- * Check whether given loop is part of an unknown-so-far cyclic smooth fan, or not.
+ * Find the entry point of the cyclic smooth fan of given loop, i.e. the loop with the lowest index
+ * in that fan, and tag it as #LOOP_SPLIT_FAN.
  * Needed because cyclic smooth fans have no obvious 'entry point',
  * and yet we need to walk them once, and only once.
+ *
+ * Only one loop of each fan walks it: loops are claimed with the index of the walking loop,
+ * a walk stops on loops claimed by a lower index and takes over loops claimed by a higher one.
+ * The walk getting back to its starting loop then owns the whole fan.
  */
-static bool loop_split_generator_check_cyclic_smooth_fan(const MLoop *mloops,
-                                                         const MPoly *mpolys,
-                                                         const int (*edge_to_loops)[2],
-                                                         const int *loop_to_poly,
-                                                         const int *e2l_prev,
-                                                         BLI_bitmap *skip_loops,
-                                                         const MLoop *ml_curr,
-                                                         const MLoop *ml_prev,
-                                                         const int ml_curr_index,
-                                                         const int ml_prev_index,
-                                                         const int mp_curr_index)
+static void loop_split_cyclic_smooth_fan_elect(LoopSplitTaskDataCommon *common_data,
+                                               const int *e2l_prev,
+                                               const MLoop *ml_prev,
+                                               const int ml_curr_index,
+                                               const int ml_prev_index,
+                                               const int mp_curr_index)
 {
-  const unsigned int mv_pivot_index = ml_curr->v; /* The vertex we are "fanning" around! */
-  const int *e2lfan_curr;
-  const MLoop *mlfan_curr;
-  /* mlfan_vert_index: the loop of our current edge might not be the loop of our current vertex! */
-  int mlfan_curr_index, mlfan_vert_index, mpfan_curr_index;
+  const MLoop *mloops = common_data->mloops;
+  const int(*edge_to_loops)[2] = (const int(*)[2])common_data->edge_to_loops;
+  int *loop_owners = common_data->loop_owners;
+  const int owner = ml_curr_index + 1;
 
-  e2lfan_curr = e2l_prev;
-  if (IS_EDGE_SHARP(e2lfan_curr)) {
+  if (IS_EDGE_SHARP(e2l_prev)) {
     /* Sharp loop, so not a cyclic smooth fan... */
-    return false;
+    return;
+  }
+  if (atomic_cas_int32(&loop_owners[ml_curr_index], 0, owner) != 0) {
+    /* Already walked from another loop of the fan. */
+    return;
   }
 
-  mlfan_curr = ml_prev;
-  mlfan_curr_index = ml_prev_index;
-  mlfan_vert_index = ml_curr_index;
-  mpfan_curr_index = mp_curr_index;
-
-  BLI_assert(mlfan_curr_index >= 0);
-  BLI_assert(mlfan_vert_index >= 0);
-  BLI_assert(mpfan_curr_index >= 0);
+  /* The vertex we are "fanning" around! */
+  const unsigned int mv_pivot_index = mloops[ml_curr_index].v;
+  const int *e2lfan_curr = e2l_prev;
+  const MLoop *mlfan_curr = ml_prev;
+  /* mlfan_vert_index: the loop of our current edge might not be the loop of our current vertex! */
+  int mlfan_curr_index = ml_prev_index;
+  int mlfan_vert_index = ml_curr_index;
+  int mpfan_curr_index = mp_curr_index;
 
-  BLI_assert(!BLI_BITMAP_TEST(skip_loops, mlfan_vert_index));
-  BLI_BITMAP_ENABLE(skip_loops, mlfan_vert_index);
+  /* Loop closing the fan, and lowest loop index found so far. */
+  int mlfan_cycle_index = ml_curr_index;
+  int mlfan_entry_index = ml_curr_index;
 
-  while (true) {
+  /* Invalid geometry may lead to a cycle which does not contain the initial loop,
+   * which cannot be longer than the whole mesh anyway. */
+  for (int i = 0; i < common_data->numLoops; i++) {
     /* Find next loop of the smooth fan. */
     BKE_mesh_loop_manifold_fan_around_vert_next(mloops,
-                                                mpolys,
-                                                loop_to_poly,
+                                                common_data->mpolys,
+                                                common_data->loop_to_poly,
                                                 e2lfan_curr,
                                                 mv_pivot_index,
                                                 &mlfan_curr,
@@ -1389,199 +1408,208 @@ static bool loop_split_generator_check_cyclic_smooth_fan(const MLoop *mloops,
 
     if (IS_EDGE_SHARP(e2lfan_curr)) {
       /* Sharp loop/edge, so not a cyclic smooth fan... */
-      return false;
+      return;
+    }
+    if (mlfan_vert_index == mlfan_cycle_index) {
+      /* We walked around a whole cyclic smooth fan. */
+      common_data->loop_types[mlfan_entry_index] = LOOP_SPLIT_FAN;
+      return;
     }
-    /* Smooth loop/edge... */
-    else if (BLI_BITMAP_TEST(skip_loops, mlfan_vert_index)) {
-      if (mlfan_vert_index == ml_curr_index) {
-        /* We walked around a whole cyclic smooth fan without finding any already-processed loop,
-         * means we can use initial ml_curr/ml_prev edge as start for this smooth fan. */
-        return true;
+    if (mlfan_cycle_index == ml_curr_index) {
+      int mlfan_owner = loop_owners[mlfan_vert_index];
+      while (mlfan_owner != owner) {
+        if (mlfan_owner != 0 && mlfan_owner < owner) {
+          /* Walked from a lower loop index, which is closer to the entry point. */
+          return;
+        }
+        const int mlfan_owner_prev = atomic_cas_int32(
+            &loop_owners[mlfan_vert_index], mlfan_owner, owner);
+        if (mlfan_owner_prev == mlfan_owner) {
+          break;
+        }
+        mlfan_owner = mlfan_owner_prev;
       }
-      /* ... already checked in some previous looping, we can abort. */
-      return false;
+      if (mlfan_owner == owner) {
+        /* Walked into a cycle which does not contain the initial loop, elect its entry point
+         * instead, since walks from its own loops stop at our claims. */
+        mlfan_cycle_index = mlfan_entry_index = mlfan_vert_index;
+        i = 0;
+        continue;
+      }
+    }
+    mlfan_entry_index = min_ii(mlfan_entry_index, mlfan_vert_index);
+  }
+}
+
+static void loop_split_loop_types_task(void *__restrict userdata,
+                                       const int mp_index,
+                                       const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  LoopSplitTaskDataCommon *common_data = userdata;
+  const MLoop *mloops = common_data->mloops;
+  const int(*edge_to_loops)[2] = (const int(*)[2])common_data->edge_to_loops;
+  const MPoly *mp = &common_data->mpolys[mp_index];
+  const int ml_last_index = (mp->loopstart + mp->totloop) - 1;
+  int ml_prev_index = ml_last_index;
+
+  for (int ml_curr_index = mp->loopstart; ml_curr_index <= ml_last_index; ml_curr_index++) {
+    const MLoop *ml_prev = &mloops[ml_prev_index];
+    const int *e2l_curr = edge_to_loops[mloops[ml_curr_index].e];
+    const int *e2l_prev = edge_to_loops[ml_prev->e];
+
+    if (IS_EDGE_SHARP(e2l_curr)) {
+      /* We *do not need* to check/tag loops as already computed!
+       * Due to the fact a loop only links to one of its two edges,
+       * a same fan *will never be walked more than once!*
+       * Since we consider edges having neighbor polys with inverted
+       * (flipped) normals as sharp, we are sure that no fan will be skipped,
+       * even only considering the case (sharp curr_edge, smooth prev_edge),
+       * and not the alternative (smooth curr_edge, sharp prev_edge).
+       * All this due/thanks to link between normals and loop ordering (i.e. winding).
+       */
+      common_data->loop_types[ml_curr_index] = IS_EDGE_SHARP(e2l_prev) ? LOOP_SPLIT_SINGLE :
+                                                                         LOOP_SPLIT_FAN;
     }
     else {
-      /* ... we can skip it in future, and keep checking the smooth fan. */
-      BLI_BITMAP_ENABLE(skip_loops, mlfan_vert_index);
+      /* A smooth edge, we have to check for cyclic smooth fan case.
+       * Other loops of the fan are left as #LOOP_SPLIT_SKIP. */
+      loop_split_cyclic_smooth_fan_elect(
+          common_data, e2l_prev, ml_prev, ml_curr_index, ml_prev_index, mp_index);
     }
+    ml_prev_index = ml_curr_index;
   }
 }
 
-static void loop_split_generator(TaskPool *pool, LoopSplitTaskDataCommon *common_data)
+/**
+ * Allocate all lnor spaces at once, and assign them to the loops starting each fan.
+ * Other loops get their space when their fan is computed.
+ */
+static void loop_split_spaces_assign(LoopSplitTaskDataCommon *common_data)
 {
   MLoopNorSpaceArray *lnors_spacearr = common_data->lnors_spacearr;
-  float(*loopnors)[3] = common_data->loopnors;
-
-  const MLoop *mloops = common_data->mloops;
-  const MPoly *mpolys = common_data->mpolys;
-  const int *loop_to_poly = common_data->loop_to_poly;
-  const int(*edge_to_loops)[2] = common_data->edge_to_loops;
+  const char *loop_types = common_data->loop_types;
   const int numLoops = common_data->numLoops;
-  const int numPolys = common_data->numPolys;
-
-  const MPoly *mp;
-  int mp_index;
-
-  const MLoop *ml_curr;
-  const MLoop *ml_prev;
-  int ml_curr_index;
-  int ml_prev_index;
-
-  BLI_bitmap *skip_loops = BLI_BITMAP_NEW(numLoops, __func__);
-
-  LoopSplitTaskData *data_buff = NULL;
-  int data_idx = 0;
+  int num_spaces = 0;
 
-  /* Temp edge vectors stack, only used when computing lnor spacearr
-   * (and we are not multi-threading). */
-  BLI_Stack *edge_vectors = NULL;
-
-#ifdef DEBUG_TIME
-  TIMEIT_START_AVERAGED(loop_split_generator);
-#endif
-
-  if (!pool) {
-    if (lnors_spacearr) {
-      edge_vectors = BLI_stack_new(sizeof(float[3]), __func__);
+  for (int ml_index = 0; ml_index < numLoops; ml_index++) {
+    if (loop_types[ml_index] != LOOP_SPLIT_SKIP) {
+      num_spaces++;
     }
   }
+  if (num_spaces == 0) {
+    return;
+  }
 
-  /* We now know edges that can be smoothed (with their vector, and their two loops),
-   * and edges that will be hard! Now, time to generate the normals.
-   */
-  for (mp = mpolys, mp_index = 0; mp_index < numPolys; mp++, mp_index++) {
-    float(*lnors)[3];
-    const int ml_last_index = (mp->loopstart + mp->totloop) - 1;
-    ml_curr_index = mp->loopstart;
-    ml_prev_index = ml_last_index;
-
-    ml_curr = &mloops[ml_curr_index];
-    ml_prev = &mloops[ml_prev_index];
-    lnors = &loopnors[ml_curr_index];
-
-    for (; ml_curr_index <= ml_last_index; ml_curr++, ml_curr_index++, lnors++) {
-      const int *e2l_curr = edge_to_loops[ml_curr->e];
-      const int *e2l_prev = edge_to_loops[ml_prev->e];
+  MLoopNorSpace *lnor_space = BLI_memarena_calloc(lnors_spacearr->mem,
+                                                  sizeof(*lnor_space) * (size_t)num_spaces);
+  lnors_spacearr->num_spaces += num_spaces;
 
-#if 0
-      printf("Checking loop %d / edge %u / vert %u (sharp edge: %d, skiploop: %d)...",
-             ml_curr_index,
-             ml_curr->e,
-             ml_curr->v,
-             IS_EDGE_SHARP(e2l_curr),
-             BLI_BITMAP_TEST_BOOL(skip_loops, ml_curr_index));
-#endif
+  for (int ml_index = 0; ml_index < numLoops; ml_index++) {
+    if (loop_types[ml_index] != LOOP_SPLIT_SKIP) {
+      lnors_spacearr->lspacearr[ml_index] = lnor_space++;
+    }
+  }
+}
 
-      /* A smooth edge, we have to check for cyclic smooth fan case.
-       * If we find a new, never-processed cyclic smooth fan, we can do it now using that loop/edge
-       * as 'entry point', otherwise we can skip it. */
-
-      /* Note: In theory, we could make loop_split_generator_check_cyclic_smooth_fan() store
-       * mlfan_vert_index'es and edge indexes in two stacks, to avoid having to fan again around
-       * the vert during actual computation of clnor & clnorspace. However, this would complicate
-       * the code, add more memory usage, and despite its logical complexity,
-       * loop_manifold_fan_around_vert_next() is quite cheap in term of CPU cycles,
-       * so really think it's not worth it. */
-      if (!IS_EDGE_SHARP(e2l_curr) && (BLI_BITMAP_TEST(skip_loops, ml_curr_index) ||
-                                       !loop_split_generator_check_cyclic_smooth_fan(mloops,
-                                                                                     mpolys,
-                                                                                     edge_to_loops,
-                                                                                     loop_to_poly,
-                                                                                     e2l_prev,
-                                                                                     skip_loops,
-                                                                                     ml_curr,
-                                                                                     ml_prev,
-                                                                                     ml_curr_index,
-                                                                                     ml_prev_index,
-                                                                                     mp_index))) {
-        //              printf("SKIPPING!\n");
+static void loop_split_task(void *__restrict userdata,
+                            const int mp_index,
+                            const TaskParallelTLS *__restrict tls)
+{
+  LoopSplitTaskDataCommon *common_data = userdata;
+  LoopSplitTaskTLS *tls_data = tls->userdata_chunk;
+  MLoopNorSpaceArray *lnors_spacearr = common_data->lnors_spacearr;
+  const MLoop *mloops = common_data->mloops;
+  const MPoly *mp = &common_data->mpolys[mp_index];
+  const int ml_last_index = (mp->loopstart + mp->totloop) - 1;
+  int ml_prev_index = ml_last_index;
+
+  for (int ml_curr_index = mp->loopstart; ml_curr_index <= ml_last_index; ml_curr_index++) {
+    const char loop_type = common_data->loop_types[ml_curr_index];
+
+    if (loop_type != LOOP_SPLIT_SKIP) {
+      LoopSplitTaskData data = {
+          .ml_curr = &mloops[ml_curr_index],
+          .ml_prev = &mloops[ml_prev_index],
+          .ml_curr_index = ml_curr_index,
+          .mp_index = mp_index,
+      };
+
+      if (loop_type == LOOP_SPLIT_SINGLE) {
+        data.lnor = &common_data->loopnors[ml_curr_index];
       }
       else {
-        LoopSplitTaskData *data, data_local;
-
-        //              printf("PROCESSING!\n");
-
-        if (pool) {
-          if (data_idx == 0) {
-            data_buff = MEM_calloc_arrayN(
-                LOOP_SPLIT_TASK_BLOCK_SIZE, sizeof(*data_buff), __func__);
-          }
-          data = &data_buff[data_idx];
-        }
-        else {
-          data = &data_local;
-          memset(data, 0, sizeof(*data));
-        }
-
-        if (IS_EDGE_SHARP(e2l_curr) && IS_EDGE_SHARP(e2l_prev)) {
-          data->lnor = lnors;
-          data->ml_curr = ml_curr;
-          data->ml_prev = ml_prev;
-          data->ml_curr_index = ml_curr_index;
-#if 0 /* Not needed for 'single' loop. */
-          data->ml_prev_index = ml_prev_index;
-          data->e2l_prev = NULL; /* Tag as 'single' task. */
-#endif
-          data->mp_index = mp_index;
-          if (lnors_spacearr) {
-            data->lnor_space = BKE_lnor_space_create(lnors_spacearr);
-          }
-        }
-        /* We *do not need* to check/tag loops as already computed!
-         * Due to the fact a loop only links to one of its two edges,
-         * a same fan *will never be walked more than once!*
-         * Since we consider edges having neighbor polys with inverted
-         * (flipped) normals as sharp, we are sure that no fan will be skipped,
-         * even only considering the case (sharp curr_edge, smooth prev_edge),
-         * and not the alternative (smooth curr_edge, sharp prev_edge).
-         * All this due/thanks to link between normals and loop ordering (i.e. winding).
-         */
-        else {
-#if 0 /* Not needed for 'fan' loops. */
-          data->lnor = lnors;
-#endif
-          data->ml_curr = ml_curr;
-          data->ml_prev = ml_prev;
-          data->ml_curr_index = ml_curr_index;
-          data->ml_prev_index = ml_prev_index;
-          data->e2l_prev = e2l_prev; /* Also tag as 'fan' task. */
-          data->mp_index = mp_index;
-          if (lnors_spacearr) {
-            data->lnor_space = BKE_lnor_space_create(lnors_spacearr);
-          }
-        }
+        data.ml_prev_index = ml_prev_index;
+        data.e2l_prev = common_data->edge_to_loops[mloops[ml_prev_index].e];
+      }
 
-        if (pool) {
-          data_idx++;
-          if (data_idx == LOOP_SPLIT_TASK_BLOCK_SIZE) {
-            BLI_task_pool_push(pool, loop_split_worker, data_buff, true, TASK_PRIORITY_LOW);
-            data_idx = 0;
-          }
-        }
-        else {
-          loop_split_worker_do(common_data, data, edge_vectors);
+      if (lnors_spacearr) {
+        /* Only this fan ever accesses the space of its first loop. */
+        data.lnor_space = lnors_spacearr->lspacearr[ml_curr_index];
+        if (tls_data->edge_vectors == NULL) {
+          tls_data->edge_vectors = BLI_stack_new(sizeof(float[3]), __func__);
         }
       }
 
-      ml_prev = ml_curr;
-      ml_prev_index = ml_curr_index;
+      loop_split_worker_do(common_data, &data, tls_data->edge_vectors);
     }
-  }
 
-  /* Last block of data... Since it is calloc'ed and we use first NULL item as stopper,
-   * everything is fine. */
-  if (pool && data_idx) {
-    BLI_task_pool_push(pool, loop_split_worker, data_buff, true, TASK_PRIORITY_LOW);
+    ml_prev_index = ml_curr_index;
   }
+}
 
-  if (edge_vectors) {
-    BLI_stack_free(edge_vectors);
+static void loop_split_task_finalize(void *__restrict UNUSED(userdata), void *__restrict tls_v)
+{
+  LoopSplitTaskTLS *tls_data = tls_v;
+  if (tls_data->edge_vectors) {
+    BLI_stack_free(tls_data->edge_vectors);
   }
-  MEM_freeN(skip_loops);
+}
+
+/**
+ * Compute normals of all smooth fans. Each fan is processed from its first loop,
+ * which can be found without walking other fans, so all polygons are handled in parallel.
+ */
+static void loop_split_compute(LoopSplitTaskDataCommon *common_data)
+{
+  const int numLoops = common_data->numLoops;
+  const int numPolys = common_data->numPolys;
+
+#ifdef DEBUG_TIME
+  TIMEIT_START_AVERAGED(loop_split_compute);
+#endif
+
+  TaskParallelSettings settings;
+  BLI_parallel_range_settings_defaults(&settings);
+  /* Not enough loops to be worth the whole threading overhead... */
+  settings.use_threading = (numLoops >= LOOP_SPLIT_TASK_BLOCK_SIZE * 8);
+  settings.min_iter_per_thread = LOOP_SPLIT_TASK_BLOCK_SIZE;
+
+  /* Finding entry points of cyclic smooth fans needs all other loops of their fan to be known,
+   * and lnor spaces are allocated in a single block, which requires to know how many fans there
+   * are before computing them. */
+  common_data->loop_types = MEM_calloc_arrayN(
+      (size_t)numLoops, sizeof(*common_data->loop_types), __func__);
+  common_data->loop_owners = MEM_calloc_arrayN(
+      (size_t)numLoops, sizeof(*common_data->loop_owners), __func__);
+  BLI_task_parallel_range(0, numPolys, common_data, loop_split_loop_types_task, &settings);
+  MEM_freeN(common_data->loop_owners);
+  common_data->loop_owners = NULL;
+
+  if (common_data->lnors_spacearr) {
+    loop_split_spaces_assign(common_data);
+  }
+
+  LoopSplitTaskTLS tls_data = {NULL};
+  settings.userdata_chunk = &tls_data;
+  settings.userdata_chunk_size = sizeof(tls_data);
+  settings.func_finalize = loop_split_task_finalize;
+  BLI_task_parallel_range(0, numPolys, common_data, loop_split_task, &settings);
+
+  MEM_freeN(common_data->loop_types);
+  common_data->loop_types = NULL;
 
 #ifdef DEBUG_TIME
-  TIMEIT_END_AVERAGED(loop_split_generator);
+  TIMEIT_END_AVERAGED(loop_split_compute);
 #endif
 }
 
@@ -1699,23 +1727,7 @@ void BKE_mesh_normals_loop_split(const MVert *mverts,
   /* This first loop check which edges are actually smooth, and compute edge vectors. */
   mesh_edges_sharp_tag(&common_data, check_angle, split_angle, false);
 
-  if (numLoops < LOOP_SPLIT_TASK_BLOCK_SIZE * 8) {
-    /* Not enough loops to be worth the whole threading overhead... */
-    loop_split_generator(NULL, &common_data);
-  }
-  else {
-    TaskScheduler *task_scheduler;
-    TaskPool *task_pool;
-
-    task_scheduler = BLI_task_scheduler_get();
-    task_pool = BLI_task_pool_create(task_scheduler, &common_data);
-
-    loop_split_generator(task_pool, &common_data);
-
-    BLI_task_pool_work_and_wait(task_pool);
-
-    BLI_task_pool_free(task_pool);
-  }
+  loop_split_compute(&common_data);
 
   MEM_freeN(edge_to_loops);
   if (!r_loop_to_poly) {
@@ -3222,134 +3234,259 @@ int BKE_mesh_tessface_calc_ex(CustomData *fdata,
 #undef ML_TO_MF_QUAD
 }
 
-/**
- * Calculate tessellation into #MLoopTri which exist only for this purpose.
- */
-void BKE_mesh_recalc_looptri(const MLoop *mloop,
-                             const MPoly *mpoly,
-                             const MVert *mvert,
-                             int totloop,
-                             int totpoly,
-                             MLoopTri *mlooptri)
-{
-  /* use this to avoid locking pthread for _every_ polygon
-   * and calling the fill function */
-
+/* use this to avoid locking pthread for _every_ polygon
+ * and calling the fill function */
 #define USE_TESSFACE_SPEEDUP
 
-  const MPoly *mp;
+/* Tessellate a polygon with more than 4 corners. */
+static unsigned int mesh_recalc_looptri__ngon(const MLoop *mloop,
+                                              const MPoly *mp,
+                                              const MVert *mvert,
+                                              const unsigned int poly_index,
+                                              MLoopTri *mlooptri,
+                                              MemArena **r_arena)
+{
+  const unsigned int mp_loopstart = (unsigned int)mp->loopstart;
+  const unsigned int mp_totloop = (unsigned int)mp->totloop;
   const MLoop *ml;
   MLoopTri *mlt;
-  MemArena *arena = NULL;
-  int poly_index, mlooptri_index;
+  unsigned int l1, l2, l3;
   unsigned int j;
 
-  mlooptri_index = 0;
-  mp = mpoly;
-  for (poly_index = 0; poly_index < totpoly; poly_index++, mp++) {
-    const unsigned int mp_loopstart = (unsigned int)mp->loopstart;
-    const unsigned int mp_totloop = (unsigned int)mp->totloop;
-    unsigned int l1, l2, l3;
-    if (mp_totloop < 3) {
-      /* do nothing */
-    }
+  const float *co_curr, *co_prev;
+
+  float normal[3];
+
+  float axis_mat[3][3];
+  float(*projverts)[2];
+  unsigned int(*tris)[3];
+
+  const unsigned int totfilltri = mp_totloop - 2;
+
+  if (UNLIKELY(*r_arena == NULL)) {
+    *r_arena = BLI_memarena_new(BLI_MEMARENA_STD_BUFSIZE, __func__);
+  }
+  MemArena *arena = *r_arena;
+
+  tris = BLI_memarena_alloc(arena, sizeof(*tris) * (size_t)totfilltri);
+  projverts = BLI_memarena_alloc(arena, sizeof(*projverts) * (size_t)mp_totloop);
+
+  zero_v3(normal);
+
+  /* calc normal, flipped: to get a positive 2d cross product */
+  ml = mloop + mp_loopstart;
+  co_prev = mvert[ml[mp_totloop - 1].v].co;
+  for (j = 0; j < mp_totloop; j++, ml++) {
+    co_curr = mvert[ml->v].co;
+    add_newell_cross_v3_v3v3(normal, co_prev, co_curr);
+    co_prev = co_curr;
+  }
+  if (UNLIKELY(normalize_v3(normal) == 0.0f)) {
+    normal[2] = 1.0f;
+  }
+
+  /* project verts to 2d */
+  axis_dominant_v3_to_m3_negate(axis_mat, normal);
+
+  ml = mloop + mp_loopstart;
+  for (j = 0; j < mp_totloop; j++, ml++) {
+    mul_v2_m3v3(projverts[j], axis_mat, mvert[ml->v].co);
+  }
+
+  BLI_polyfill_calc_arena(projverts, mp_totloop, 1, tris, arena);
+
+  /* apply fill */
+  for (j = 0; j < totfilltri; j++) {
+    unsigned int *tri = tris[j];
+
+    mlt = &mlooptri[j];
+
+    /* set loop indices, transformed to vert indices later */
+    l1 = mp_loopstart + tri[0];
+    l2 = mp_loopstart + tri[1];
+    l3 = mp_loopstart + tri[2];
+
+    ARRAY_SET_ITEMS(mlt->tri, l1, l2, l3);
+    mlt->poly = poly_index;
+  }
+
+  BLI_memarena_clear(arena);
+
+  return totfilltri;
+}
+
+/**
+ * Tessellate a single polygon into \a mlooptri, returns the number of triangles.
+ * \a r_arena is only created when needed (for n-gons) and is left cleared.
+ */
+BLI_INLINE unsigned int mesh_recalc_looptri__single_poly(const MLoop *mloop,
+                                                         const MPoly *mp,
+                                                         const MVert *mvert,
+                                                         const unsigned int poly_index,
+                                                         MLoopTri *mlooptri,
+                                                         MemArena **r_arena)
+{
+  const unsigned int mp_loopstart = (unsigned int)mp->loopstart;
+  const unsigned int mp_totloop = (unsigned int)mp->totloop;
+  MLoopTri *mlt;
+  unsigned int l1, l2, l3;
+
+  if (mp_totloop < 3) {
+    /* do nothing */
+    return 0;
+  }
 
 #ifdef USE_TESSFACE_SPEEDUP
 
-#  define ML_TO_MLT(i1, i2, i3) \
+#  define ML_TO_MLT(mlt_index, i1, i2, i3) \
     { \
-      mlt = &mlooptri[mlooptri_index]; \
+      mlt = &mlooptri[mlt_index]; \
       l1 = mp_loopstart + i1; \
       l2 = mp_loopstart + i2; \
       l3 = mp_loopstart + i3; \
       ARRAY_SET_ITEMS(mlt->tri, l1, l2, l3); \
-      mlt->poly = (unsigned int)poly_index; \
+      mlt->poly = poly_index; \
     } \
     ((void)0)
 
-    else if (mp_totloop == 3) {
-      ML_TO_MLT(0, 1, 2);
-      mlooptri_index++;
-    }
-    else if (mp_totloop == 4) {
-      ML_TO_MLT(0, 1, 2);
-      MLoopTri *mlt_a = mlt;
-      mlooptri_index++;
-      ML_TO_MLT(0, 2, 3);
-      MLoopTri *mlt_b = mlt;
-      mlooptri_index++;
-
-      if (UNLIKELY(is_quad_flip_v3_first_third_fast(mvert[mloop[mlt_a->tri[0]].v].co,
-                                                    mvert[mloop[mlt_a->tri[1]].v].co,
-                                                    mvert[mloop[mlt_a->tri[2]].v].co,
-                                                    mvert[mloop[mlt_b->tri[2]].v].co))) {
-        /* flip out of degenerate 0-2 state. */
-        mlt_a->tri[2] = mlt_b->tri[2];
-        mlt_b->tri[0] = mlt_a->tri[1];
-      }
+  if (mp_totloop == 3) {
+    ML_TO_MLT(0, 0, 1, 2);
+    return 1;
+  }
+  if (mp_totloop == 4) {
+    ML_TO_MLT(0, 0, 1, 2);
+    MLoopTri *mlt_a = mlt;
+    ML_TO_MLT(1, 0, 2, 3);
+    MLoopTri *mlt_b = mlt;
+
+    if (UNLIKELY(is_quad_flip_v3_first_third_fast(mvert[mloop[mlt_a->tri[0]].v].co,
+                                                  mvert[mloop[mlt_a->tri[1]].v].co,
+                                                  mvert[mloop[mlt_a->tri[2]].v].co,
+                                                  mvert[mloop[mlt_b->tri[2]].v].co))) {
+      /* flip out of degenerate 0-2 state. */
+      mlt_a->tri[2] = mlt_b->tri[2];
+      mlt_b->tri[0] = mlt_a->tri[1];
     }
-#endif /* USE_TESSFACE_SPEEDUP */
-    else {
-      const float *co_curr, *co_prev;
-
-      float normal[3];
+    return 2;
+  }
 
-      float axis_mat[3][3];
-      float(*projverts)[2];
-      unsigned int(*tris)[3];
+#  undef ML_TO_MLT
 
-      const unsigned int totfilltri = mp_totloop - 2;
+#endif /* USE_TESSFACE_SPEEDUP */
 
-      if (UNLIKELY(arena == NULL)) {
-        arena = BLI_memarena_new(BLI_MEMARENA_STD_BUFSIZE, __func__);
-      }
+  return mesh_recalc_looptri__ngon(mloop, mp, mvert, poly_index, mlooptri, r_arena);
+}
 
-      tris = BLI_memarena_alloc(arena, sizeof(*tris) * (size_t)totfilltri);
-      projverts = BLI_memarena_alloc(arena, sizeof(*projverts) * (size_t)mp_totloop);
+#undef USE_TESSFACE_SPEEDUP
 
-      zero_v3(normal);
+/* Below this, polygons are tessellated from a single thread. */
+#define MESH_LOOPTRI_THREADED_POLYS_MIN 4096
+/* Number of polygons handled by each iteration of the threaded loop. */
+#define MESH_LOOPTRI_POLYS_CHUNK_SIZE 256
 
-      /* calc normal, flipped: to get a positive 2d cross product */
-      ml = mloop + mp_loopstart;
-      co_prev = mvert[ml[mp_totloop - 1].v].co;
-      for (j = 0; j < mp_totloop; j++, ml++) {
-        co_curr = mvert[ml->v].co;
-        add_newell_cross_v3_v3v3(normal, co_prev, co_curr);
-        co_prev = co_curr;
-      }
-      if (UNLIKELY(normalize_v3(normal) == 0.0f)) {
-        normal[2] = 1.0f;
-      }
-
-      /* project verts to 2d */
-      axis_dominant_v3_to_m3_negate(axis_mat, normal);
+typedef struct MeshRecalcLoopTriData {
+  const MLoop *mloop;
+  const MPoly *mpoly;
+  const MVert *mvert;
+  MLoopTri *mlooptri;
+  int totpoly;
+} MeshRecalcLoopTriData;
 
-      ml = mloop + mp_loopstart;
-      for (j = 0; j < mp_totloop; j++, ml++) {
-        mul_v2_m3v3(projverts[j], axis_mat, mvert[ml->v].co);
-      }
+typedef struct MeshRecalcLoopTriTLS {
+  MemArena *arena;
+} MeshRecalcLoopTriTLS;
 
-      BLI_polyfill_calc_arena(projverts, mp_totloop, 1, tris, arena);
+static void mesh_recalc_looptri_cb(void *__restrict userdata,
+                                   const int chunk_index,
+                                   const TaskParallelTLS *__restrict tls)
+{
+  const MeshRecalcLoopTriData *data = userdata;
+  MeshRecalcLoopTriTLS *tls_data = tls->userdata_chunk;
+  const int poly_start = chunk_index * MESH_LOOPTRI_POLYS_CHUNK_SIZE;
+  const int poly_end = min_ii(poly_start + MESH_LOOPTRI_POLYS_CHUNK_SIZE, data->totpoly);
+
+  for (int poly_index = poly_start; poly_index < poly_end; poly_index++) {
+    const MPoly *mp = &data->mpoly[poly_index];
+    /* Only valid because #mesh_looptri_polys_are_contiguous passed. */
+    const int mlooptri_index = poly_to_tri_count(poly_index, mp->loopstart);
+
+    mesh_recalc_looptri__single_poly(data->mloop,
+                                     mp,
+                                     data->mvert,
+                                     (unsigned int)poly_index,
+                                     &data->mlooptri[mlooptri_index],
+                                     &tls_data->arena);
+  }
+}
 
-      /* apply fill */
-      for (j = 0; j < totfilltri; j++) {
-        unsigned int *tri = tris[j];
+static void mesh_recalc_looptri_finalize(void *__restrict UNUSED(userdata),
+                                         void *__restrict tls_v)
+{
+  MeshRecalcLoopTriTLS *tls_data = tls_v;
+  if (tls_data->arena) {
+    BLI_memarena_free(tls_data->arena);
+  }
+}
 
-        mlt = &mlooptri[mlooptri_index];
+/**
+ * Whether loops of all polygons are stored in order, without any gap,
+ * and no polygon has less than 3 loops.
+ * The first triangle of each polygon can then be found from its own index and loop start.
+ */
+static bool mesh_looptri_polys_are_contiguous(const MPoly *mpoly, const int totpoly)
+{
+  int loopstart = 0;
+  for (int poly_index = 0; poly_index < totpoly; poly_index++) {
+    if (mpoly[poly_index].loopstart != loopstart || mpoly[poly_index].totloop < 3) {
+      return false;
+    }
+    loopstart += mpoly[poly_index].totloop;
+  }
+  return true;
+}
 
-        /* set loop indices, transformed to vert indices later */
-        l1 = mp_loopstart + tri[0];
-        l2 = mp_loopstart + tri[1];
-        l3 = mp_loopstart + tri[2];
+/**
+ * Calculate tessellation into #MLoopTri which exist only for this purpose.
+ */
+void BKE_mesh_recalc_looptri(const MLoop *mloop,
+                             const MPoly *mpoly,
+                             const MVert *mvert,
+                             int totloop,
+                             int totpoly,
+                             MLoopTri *mlooptri)
+{
+  if (totpoly >= MESH_LOOPTRI_THREADED_POLYS_MIN &&
+      mesh_looptri_polys_are_contiguous(mpoly, totpoly)) {
+    MeshRecalcLoopTriData data = {
+        .mloop = mloop,
+        .mpoly = mpoly,
+        .mvert = mvert,
+        .mlooptri = mlooptri,
+        .totpoly = totpoly,
+    };
+    MeshRecalcLoopTriTLS tls_data = {NULL};
 
-        ARRAY_SET_ITEMS(mlt->tri, l1, l2, l3);
-        mlt->poly = (unsigned int)poly_index;
+    TaskParallelSettings settings;
+    BLI_parallel_range_settings_defaults(&settings);
+    settings.userdata_chunk = &tls_data;
+    settings.userdata_chunk_size = sizeof(tls_data);
+    settings.func_finalize = mesh_recalc_looptri_finalize;
 
-        mlooptri_index++;
-      }
+    const int chunks_num = (totpoly + MESH_LOOPTRI_POLYS_CHUNK_SIZE - 1) /
+                           MESH_LOOPTRI_POLYS_CHUNK_SIZE;
+    BLI_task_parallel_range(0, chunks_num, &data, mesh_recalc_looptri_cb, &settings);
+    return;
+  }
 
-      BLI_memarena_clear(arena);
-    }
+  MemArena *arena = NULL;
+  unsigned int mlooptri_index = 0;
+  for (int poly_index = 0; poly_index < totpoly; poly_index++) {
+    mlooptri_index += mesh_recalc_looptri__single_poly(mloop,
+                                                       &mpoly[poly_index],
+                                                       mvert,
+                                                       (unsigned int)poly_index,
+                                                       &mlooptri[mlooptri_index],
+                                                       &arena);
   }
 
   if (arena) {
@@ -3357,11 +3494,8 @@ void BKE_mesh_recalc_looptri(const MLoop *mloop,
     arena = NULL;
   }
 
-  BLI_assert(mlooptri_index == poly_to_tri_count(totpoly, totloop));
+  BLI_assert(mlooptri_index == (unsigned int)poly_to_tri_count(totpoly, totloop));
   UNUSED_VARS_NDEBUG(totloop);
-
-#undef USE_TESSFACE_SPEEDUP
-#undef ML_TO_MLT
 }
 
 static void bm_corners_to_loops_ex(ID *id,
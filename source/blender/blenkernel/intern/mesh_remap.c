@@ -525,26 +525,47 @@ void BKE_mesh_remap_calc_verts_from_mesh(const int mode,
     float tmp_co[3], tmp_no[3];
 
     if (mode == MREMAP_MODE_VERT_NEAREST) {
+      float(*vcos_dst)[3] = MEM_mallocN(sizeof(*vcos_dst) * (size_t)numverts_dst, __func__);
+      BVHTreeNearest *nearest_dst = MEM_mallocN(sizeof(*nearest_dst) * (size_t)numverts_dst,
+                                                __func__);
+
       BKE_bvhtree_from_mesh_get(&treedata, me_src, BVHTREE_FROM_VERTS, 2);
-      nearest.index = -1;
 
       for (i = 0; i < numverts_dst; i++) {
-        copy_v3_v3(tmp_co, verts_dst[i].co);
+        copy_v3_v3(vcos_dst[i], verts_dst[i].co);
 
         /* Convert the vertex to tree coordinates, if needed. */
         if (space_transform) {
-          BLI_space_transform_apply(space_transform, tmp_co);
+          BLI_space_transform_apply(space_transform, vcos_dst[i]);
         }
 
-        if (mesh_remap_bvhtree_query_nearest(
-                &treedata, &nearest, tmp_co, max_dist_sq, &hit_dist)) {
-          mesh_remap_item_define(r_map, i, hit_dist, 0, 1, &nearest.index, &full_weight);
+        nearest_dst[i].index = -1;
+        nearest_dst[i].dist_sq = max_dist_sq;
+      }
+
+      /* Query all vertices at once, using the same local proximity heuristics as
+       * #mesh_remap_bvhtree_query_nearest. */
+      BLI_bvhtree_find_nearest_batch(treedata.tree,
+                                     (const float(*)[3])vcos_dst,
+                                     numverts_dst,
+                                     nearest_dst,
+                                     treedata.nearest_callback,
+                                     &treedata,
+                                     BVH_NEAREST_USE_PREVIOUS);
+
+      for (i = 0; i < numverts_dst; i++) {
+        if ((nearest_dst[i].index != -1) && (nearest_dst[i].dist_sq <= max_dist_sq)) {
+          hit_dist = sqrtf(nearest_dst[i].dist_sq);
+          mesh_remap_item_define(r_map, i, hit_dist, 0, 1, &nearest_dst[i].index, &full_weight);
         }
         else {
           /* No source for this dest vertex! */
           BKE_mesh_remap_item_define_invalid(r_map, i);
         }
       }
+
+      MEM_freeN(vcos_dst);
+      MEM_freeN(nearest_dst);
     }
     else if (ELEM(mode, MREMAP_MODE_VERT_EDGE_NEAREST, MREMAP_MODE_VERT_EDGEINTERP_NEAREST)) {
       MEdge *edges_src = me_src->medge;
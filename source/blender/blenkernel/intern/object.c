@@ -527,6 +527,7 @@ void BKE_object_free_caches(Object *object)
    */
   if ((object->base_flag & BASE_FROM_DUPLI) == 0) {
     BKE_object_free_derived_caches(object);
+    mesh_modifier_stack_cache_free(object);
     update_flag |= ID_RECALC_GEOMETRY;
   }
 
@@ -554,6 +555,7 @@ void BKE_object_free(Object *ob)
   MEM_SAFE_FREE(ob->matbits);
   MEM_SAFE_FREE(ob->iuser);
   MEM_SAFE_FREE(ob->runtime.bb);
+  mesh_modifier_stack_cache_free(ob);
 
   BLI_freelistN(&ob->defbase);
   BLI_freelistN(&ob->fmaps);
@@ -3948,6 +3950,7 @@ void BKE_object_runtime_reset_on_copy(Object *object, const int UNUSED(flag))
   Object_Runtime *runtime = &object->runtime;
   runtime->data_eval = NULL;
   runtime->mesh_deform_eval = NULL;
+  runtime->modifier_stack_cache = NULL;
   runtime->curve_cache = NULL;
   runtime->gpencil_cache = NULL;
 }
@@ -1228,6 +1228,13 @@ static void sculpt_update_object(
     }
   }
 
+  /* Painting writes into the arrays in place, without replacing the evaluated copies which may
+   * share them (depending on the tags, not even once the stroke is done). */
+  if (ss->bm == NULL && BKE_mesh_duplicate_shared_layers(me) && ss->pbvh) {
+    /* Built on the arrays now only used by the evaluated mesh. */
+    sculptsession_free_pbvh(ob);
+  }
+
   /* tessfaces aren't used and will become invalid */
   BKE_mesh_tessface_clear(me);
 
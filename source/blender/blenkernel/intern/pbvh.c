@@ -173,7 +173,8 @@ static bool grid_materials_match(const DMFlagMat *f1, const DMFlagMat *f2)
 
 /* Adapted from BLI_kdopbvh.c */
 /* Returns the index of the first element on the right of the partition */
-static int partition_indices(int *prim_indices, int lo, int hi, int axis, float mid, BBC *prim_bbc)
+static int partition_indices(
+    int *prim_indices, int lo, int hi, int axis, float mid, const BBC *prim_bbc)
 {
   int i = lo, j = hi;
   for (;;) {
@@ -250,43 +251,117 @@ void pbvh_grow_nodes(PBVH *bvh, int totnode)
   bvh->totnode = totnode;
 }
 
-/* Add a vertex to the map, with a positive value for unique vertices and
- * a negative value for additional vertices */
-static int map_insert_vert(
-    PBVH *bvh, GHash *map, unsigned int *face_verts, unsigned int *uniq_verts, int vertex)
-{
-  void *key, **value_p;
+/* Node of the tree while it is being built, the final nodes are only stored in #PBVH.nodes once
+ * the whole tree is known, see #build_store_nodes. */
+typedef struct PBVHBuildNode {
+  /* Range of primitives in #PBVH.prim_indices. */
+  int offset, count;
+  /* Index of the first of the two children in the build nodes, -1 for leaves. */
+  int children;
+  /* Start of the range of the second child, set when splitting the node. */
+  int split;
+} PBVHBuildNode;
 
-  key = POINTER_FROM_INT(vertex);
-  if (!BLI_ghash_ensure_p(map, key, &value_p)) {
-    int value_i;
-    if (BLI_BITMAP_TEST(bvh->vert_bitmap, vertex) == 0) {
-      BLI_BITMAP_ENABLE(bvh->vert_bitmap, vertex);
-      value_i = *uniq_verts;
-      (*uniq_verts)++;
-    }
-    else {
-      value_i = ~(*face_verts);
-      (*face_verts)++;
+typedef struct PBVHBuildData {
+  PBVH *bvh;
+  /* Bounding box of the primitive centroids. */
+  BB *cb;
+  BBC *prim_bbc;
+
+  PBVHBuildNode *build_nodes;
+  /* First build node of the level of the tree being split. */
+  int level_start;
+  /* PBVH node index of the leaves, in build order. */
+  int *leaves;
+} PBVHBuildData;
+
+/* Claim the vertices used by the faces of a leaf, a vertex is unique to the first leaf in build
+ * order which uses it, like when leaves are built one after the other. */
+static void build_mesh_leaf_vert_owner_task_cb(void *__restrict userdata,
+                                               const int n,
+                                               const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  PBVHBuildData *data = userdata;
+  PBVH *bvh = data->bvh;
+  const PBVHNode *node = &bvh->nodes[data->leaves[n]];
+  int *vert_owner = bvh->vert_owner;
+
+  for (int i = 0; i < node->totprim; i++) {
+    const MLoopTri *lt = &bvh->looptri[node->prim_indices[i]];
+    for (int j = 0; j < 3; j++) {
+      int *owner = &vert_owner[bvh->mloop[lt->tri[j]].v];
+      int owner_prev = *owner;
+      while (n < owner_prev) {
+        const int owner_cas = atomic_cas_int32(owner, owner_prev, n);
+        if (owner_cas == owner_prev) {
+          break;
+        }
+        owner_prev = owner_cas;
+      }
     }
-    *value_p = POINTER_FROM_INT(value_i);
-    return value_i;
+  }
+}
+
+/* Add a vertex to the map, with a positive value for unique vertices and
+ * a negative value for additional vertices.
+ *
+ * The map is a flat open addressing table, with a size which is a power of two larger than
+ * the number of face corners of the node. */
+static int map_insert_vert(PBVH *bvh,
+                           int *map_keys,
+                           int *map_values,
+                           const uint map_mask,
+                           const int leaf_index,
+                           int *node_verts,
+                           int node_verts_len,
+                           unsigned int *face_verts,
+                           unsigned int *uniq_verts,
+                           int vertex)
+{
+  uint slot = ((uint)vertex * 2654435761u) & map_mask;
+  while (map_keys[slot] != -1) {
+    if (map_keys[slot] == vertex) {
+      return map_values[slot];
+    }
+    slot = (slot + 1) & map_mask;
+  }
+
+  int value_i;
+  if (bvh->vert_owner[vertex] == leaf_index) {
+    /* Unique vertices are stored from the start of the node vertices. */
+    node_verts[*uniq_verts] = vertex;
+    value_i = *uniq_verts;
+    (*uniq_verts)++;
   }
   else {
-    return POINTER_AS_INT(*value_p);
+    /* Additional vertices are stored from the end, in reverse order. */
+    node_verts[node_verts_len - 1 - *face_verts] = vertex;
+    value_i = ~(*face_verts);
+    (*face_verts)++;
   }
+  map_keys[slot] = vertex;
+  map_values[slot] = value_i;
+  return value_i;
 }
 
 /* Find vertices used by the faces in this node and update the draw buffers */
-static void build_mesh_leaf_node(PBVH *bvh, PBVHNode *node)
+static void build_mesh_leaf_node(PBVH *bvh, PBVHNode *node, const int leaf_index)
 {
   bool has_visible = false;
 
   node->uniq_verts = node->face_verts = 0;
   const int totface = node->totprim;
+  const int totcorner = totface * 3;
+
+  /* Keep the table at most half full. */
+  const int map_size = power_of_2_max_i(totcorner * 2);
+  int *map_keys = MEM_malloc_arrayN((size_t)map_size, sizeof(int), "build_mesh_leaf_node keys");
+  int *map_values = MEM_malloc_arrayN(
+      (size_t)map_size, sizeof(int), "build_mesh_leaf_node values");
+  copy_vn_i(map_keys, map_size, -1);
 
-  /* reserve size is rough guess */
-  GHash *map = BLI_ghash_int_new_ex("build_mesh_leaf_node gh", 2 * totface);
+  int *node_verts = MEM_malloc_arrayN(
+      (size_t)totcorner, sizeof(int), "build_mesh_leaf_node verts");
 
   int(*face_vert_indices)[3] = MEM_mallocN(sizeof(int[3]) * totface, "bvh node face vert indices");
 
@@ -295,8 +370,16 @@ static void build_mesh_leaf_node(PBVH *bvh, PBVHNode *node)
   for (int i = 0; i < totface; i++) {
     const MLoopTri *lt = &bvh->looptri[node->prim_indices[i]];
     for (int j = 0; j < 3; j++) {
-      face_vert_indices[i][j] = map_insert_vert(
-          bvh, map, &node->face_verts, &node->uniq_verts, bvh->mloop[lt->tri[j]].v);
+      face_vert_indices[i][j] = map_insert_vert(bvh,
+                                                map_keys,
+                                                map_values,
+                                                (uint)map_size - 1,
+                                                leaf_index,
+                                                node_verts,
+                                                totcorner,
+                                                &node->face_verts,
+                                                &node->uniq_verts,
+                                                bvh->mloop[lt->tri[j]].v);
     }
 
     if (!paint_is_face_hidden(lt, bvh->verts, bvh->mloop)) {
@@ -304,21 +387,14 @@ static void build_mesh_leaf_node(PBVH *bvh, PBVHNode *node)
     }
   }
 
-  int *vert_indices = MEM_callocN(sizeof(int) * (node->uniq_verts + node->face_verts),
-                                  "bvh node vert indices");
+  int *vert_indices = MEM_malloc_arrayN(
+      node->uniq_verts + node->face_verts, sizeof(int), "bvh node vert indices");
   node->vert_indices = vert_indices;
 
   /* Build the vertex list, unique verts first */
-  GHashIterator gh_iter;
-  GHASH_ITER (gh_iter, map) {
-    void *value = BLI_ghashIterator_getValue(&gh_iter);
-    int ndx = POINTER_AS_INT(value);
-
-    if (ndx < 0) {
-      ndx = -ndx + node->uniq_verts - 1;
-    }
-
-    vert_indices[ndx] = POINTER_AS_INT(BLI_ghashIterator_getKey(&gh_iter));
+  memcpy(vert_indices, node_verts, sizeof(int) * node->uniq_verts);
+  for (int i = 0; i < node->face_verts; i++) {
+    vert_indices[node->uniq_verts + i] = node_verts[totcorner - 1 - i];
   }
 
   for (int i = 0; i < totface; i++) {
@@ -335,7 +411,9 @@ static void build_mesh_leaf_node(PBVH *bvh, PBVHNode *node)
 
   BKE_pbvh_node_fully_hidden_set(node, !has_visible);
 
-  BLI_ghash_free(map, NULL, NULL);
+  MEM_freeN(node_verts);
+  MEM_freeN(map_keys);
+  MEM_freeN(map_values);
 }
 
 static void update_vb(PBVH *bvh, PBVHNode *node, BBC *prim_bbc, int offset, int count)
@@ -388,24 +466,6 @@ static void build_grid_leaf_node(PBVH *bvh, PBVHNode *node)
   BKE_pbvh_node_mark_rebuild_draw(node);
 }
 
-static void build_leaf(PBVH *bvh, int node_index, BBC *prim_bbc, int offset, int count)
-{
-  bvh->nodes[node_index].flag |= PBVH_Leaf;
-
-  bvh->nodes[node_index].prim_indices = bvh->prim_indices + offset;
-  bvh->nodes[node_index].totprim = count;
-
-  /* Still need vb for searches */
-  update_vb(bvh, &bvh->nodes[node_index], prim_bbc, offset, count);
-
-  if (bvh->looptri) {
-    build_mesh_leaf_node(bvh, bvh->nodes + node_index);
-  }
-  else {
-    build_grid_leaf_node(bvh, bvh->nodes + node_index);
-  }
-}
-
 /* Return zero if all primitives in the node can be drawn with the
  * same material (including flat/smooth shading), non-zero otherwise */
 static bool leaf_needs_material_split(PBVH *bvh, int offset, int count)
@@ -440,66 +500,194 @@ static bool leaf_needs_material_split(PBVH *bvh, int offset, int count)
   return false;
 }
 
-/* Recursively build a node in the tree
- *
- * vb is the voxel box around all of the primitives contained in
- * this node.
- *
- * cb is the bounding box around all the centroids of the primitives
- * contained in this node
- *
- * offset and start indicate a range in the array of primitive indices
- */
-
-static void build_sub(PBVH *bvh, int node_index, BB *cb, BBC *prim_bbc, int offset, int count)
+/* Decide whether a node is a leaf, otherwise partition its primitives. All nodes of a level of the
+ * tree cover different ranges of primitives, so they are split in parallel. */
+static void build_split_task_cb(void *__restrict userdata,
+                                const int n,
+                                const TaskParallelTLS *__restrict UNUSED(tls))
 {
-  int end;
+  PBVHBuildData *data = userdata;
+  PBVH *bvh = data->bvh;
+  const BBC *prim_bbc = data->prim_bbc;
+  PBVHBuildNode *build_node = &data->build_nodes[data->level_start + n];
+  const int offset = build_node->offset;
+  const int count = build_node->count;
   BB cb_backing;
+  const BB *cb = data->cb;
 
   /* Decide whether this is a leaf or not */
   const bool below_leaf_limit = count <= bvh->leaf_limit;
   if (below_leaf_limit) {
     if (!leaf_needs_material_split(bvh, offset, count)) {
-      build_leaf(bvh, node_index, prim_bbc, offset, count);
+      build_node->split = -1;
       return;
     }
   }
 
-  /* Add two child nodes */
-  bvh->nodes[node_index].children_offset = bvh->totnode;
-  pbvh_grow_nodes(bvh, bvh->totnode + 2);
-
-  /* Update parent node bounding box */
-  update_vb(bvh, &bvh->nodes[node_index], prim_bbc, offset, count);
-
   if (!below_leaf_limit) {
-    /* Find axis with widest range of primitive centroids */
-    if (!cb) {
+    /* Find axis with widest range of primitive centroids, the bounds are given for the root. */
+    if (data->level_start != 0) {
       cb = &cb_backing;
-      BB_reset(cb);
+      BB_reset(&cb_backing);
       for (int i = offset + count - 1; i >= offset; i--) {
-        BB_expand(cb, prim_bbc[bvh->prim_indices[i]].bcentroid);
+        BB_expand(&cb_backing, prim_bbc[bvh->prim_indices[i]].bcentroid);
       }
     }
     const int axis = BB_widest_axis(cb);
 
     /* Partition primitives along that axis */
-    end = partition_indices(bvh->prim_indices,
-                            offset,
-                            offset + count - 1,
-                            axis,
-                            (cb->bmax[axis] + cb->bmin[axis]) * 0.5f,
-                            prim_bbc);
+    build_node->split = partition_indices(bvh->prim_indices,
+                                          offset,
+                                          offset + count - 1,
+                                          axis,
+                                          (cb->bmax[axis] + cb->bmin[axis]) * 0.5f,
+                                          prim_bbc);
   }
   else {
     /* Partition primitives by material */
-    end = partition_indices_material(bvh, offset, offset + count - 1);
+    build_node->split = partition_indices_material(bvh, offset, offset + count - 1);
   }
+}
+
+/* Store the built nodes in the PBVH, numbered as when nodes were added depth first by a recursive
+ * build, and gather the leaves in that order. */
+static void build_store_nodes(PBVH *bvh,
+                              const PBVHBuildNode *build_nodes,
+                              const int build_index,
+                              const int node_index,
+                              int *leaves,
+                              int *leaves_len)
+{
+  const PBVHBuildNode *build_node = &build_nodes[build_index];
+
+  if (build_node->children == -1) {
+    PBVHNode *node = &bvh->nodes[node_index];
+    node->flag |= PBVH_Leaf;
+    node->prim_indices = bvh->prim_indices + build_node->offset;
+    node->totprim = build_node->count;
+    leaves[(*leaves_len)++] = node_index;
+    return;
+  }
+
+  /* Add two child nodes */
+  const int children_offset = bvh->totnode;
+  bvh->nodes[node_index].children_offset = children_offset;
+  pbvh_grow_nodes(bvh, bvh->totnode + 2);
 
-  /* Build children */
-  build_sub(bvh, bvh->nodes[node_index].children_offset, NULL, prim_bbc, offset, end - offset);
-  build_sub(
-      bvh, bvh->nodes[node_index].children_offset + 1, NULL, prim_bbc, end, offset + count - end);
+  build_store_nodes(bvh, build_nodes, build_node->children, children_offset, leaves, leaves_len);
+  build_store_nodes(
+      bvh, build_nodes, build_node->children + 1, children_offset + 1, leaves, leaves_len);
+}
+
+/* Bounding boxes of the inner nodes, from the ones of the leaves. */
+static void build_update_inner_vb(PBVH *bvh,
+                                  const PBVHBuildNode *build_nodes,
+                                  const int build_index,
+                                  const int node_index)
+{
+  const PBVHBuildNode *build_node = &build_nodes[build_index];
+  if (build_node->children == -1) {
+    return;
+  }
+
+  PBVHNode *node = &bvh->nodes[node_index];
+  build_update_inner_vb(bvh, build_nodes, build_node->children, node->children_offset);
+  build_update_inner_vb(bvh, build_nodes, build_node->children + 1, node->children_offset + 1);
+
+  BB_reset(&node->vb);
+  BB_expand_with_bb(&node->vb, &bvh->nodes[node->children_offset].vb);
+  BB_expand_with_bb(&node->vb, &bvh->nodes[node->children_offset + 1].vb);
+  node->orig_vb = node->vb;
+}
+
+static void build_leaf_task_cb(void *__restrict userdata,
+                               const int n,
+                               const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  PBVHBuildData *data = userdata;
+  PBVH *bvh = data->bvh;
+  PBVHNode *node = &bvh->nodes[data->leaves[n]];
+
+  /* Still need vb for searches */
+  const int offset = (int)(node->prim_indices - bvh->prim_indices);
+  update_vb(bvh, node, data->prim_bbc, offset, node->totprim);
+
+  if (bvh->looptri) {
+    build_mesh_leaf_node(bvh, node, n);
+  }
+  else {
+    build_grid_leaf_node(bvh, node);
+  }
+}
+
+/* Build the tree one level at a time, splitting the nodes of each level in parallel, and then
+ * the leaves in parallel. The resulting tree is the same as the one of a recursive build. */
+static void build_tree(PBVH *bvh, BB *cb, BBC *prim_bbc, int totprim)
+{
+  PBVHBuildData data = {
+      .bvh = bvh,
+      .cb = cb,
+      .prim_bbc = prim_bbc,
+  };
+
+  int build_nodes_len = 1;
+  int build_nodes_mem = 64;
+  data.build_nodes = MEM_malloc_arrayN(build_nodes_mem, sizeof(PBVHBuildNode), __func__);
+  data.build_nodes[0].offset = 0;
+  data.build_nodes[0].count = totprim;
+
+  int leaves_num = 0;
+  for (int level_start = 0; level_start < build_nodes_len;) {
+    const int level_end = build_nodes_len;
+    data.level_start = level_start;
+
+    PBVHParallelSettings settings;
+    BKE_pbvh_parallel_range_settings(&settings, true, level_end - level_start);
+    BKE_pbvh_parallel_range(0, level_end - level_start, &data, build_split_task_cb, &settings);
+
+    for (int i = level_start; i < level_end; i++) {
+      if (data.build_nodes[i].split == -1) {
+        data.build_nodes[i].children = -1;
+        leaves_num++;
+        continue;
+      }
+      if (build_nodes_len + 2 > build_nodes_mem) {
+        build_nodes_mem *= 2;
+        data.build_nodes = MEM_reallocN(data.build_nodes,
+                                        sizeof(PBVHBuildNode) * (size_t)build_nodes_mem);
+      }
+      PBVHBuildNode *build_node = &data.build_nodes[i];
+      PBVHBuildNode *children = &data.build_nodes[build_nodes_len];
+      children[0].offset = build_node->offset;
+      children[0].count = build_node->split - build_node->offset;
+      children[1].offset = build_node->split;
+      children[1].count = build_node->offset + build_node->count - build_node->split;
+      build_node->children = build_nodes_len;
+      build_nodes_len += 2;
+    }
+    level_start = level_end;
+  }
+
+  data.leaves = MEM_malloc_arrayN(leaves_num, sizeof(int), __func__);
+  int leaves_len = 0;
+  bvh->totnode = 1;
+  build_store_nodes(bvh, data.build_nodes, 0, 0, data.leaves, &leaves_len);
+  BLI_assert(leaves_len == leaves_num);
+
+  PBVHParallelSettings settings;
+  BKE_pbvh_parallel_range_settings(&settings, true, leaves_num);
+  if (bvh->looptri) {
+    bvh->vert_owner = MEM_malloc_arrayN(bvh->totvert, sizeof(int), __func__);
+    copy_vn_i(bvh->vert_owner, bvh->totvert, INT_MAX);
+    BKE_pbvh_parallel_range(0, leaves_num, &data, build_mesh_leaf_vert_owner_task_cb, &settings);
+  }
+  BKE_pbvh_parallel_range(0, leaves_num, &data, build_leaf_task_cb, &settings);
+  MEM_SAFE_FREE(bvh->vert_owner);
+
+  build_update_inner_vb(bvh, data.build_nodes, 0, 0);
+
+  MEM_freeN(data.leaves);
+  MEM_freeN(data.build_nodes);
 }
 
 static void pbvh_build(PBVH *bvh, BB *cb, BBC *prim_bbc, int totprim)
@@ -523,8 +711,56 @@ static void pbvh_build(PBVH *bvh, BB *cb, BBC *prim_bbc, int totprim)
     }
   }
 
-  bvh->totnode = 1;
-  build_sub(bvh, 0, cb, prim_bbc, 0, totprim);
+  build_tree(bvh, cb, prim_bbc, totprim);
+}
+
+static void pbvh_build_mesh_prim_bbc_task_cb(void *__restrict userdata,
+                                             const int i,
+                                             const TaskParallelTLS *__restrict tls)
+{
+  PBVHBuildData *data = userdata;
+  PBVH *bvh = data->bvh;
+  const MLoopTri *lt = &bvh->looptri[i];
+  const int sides = 3;
+  BBC *bbc = data->prim_bbc + i;
+
+  BB_reset((BB *)bbc);
+
+  for (int j = 0; j < sides; j++) {
+    BB_expand((BB *)bbc, bvh->verts[bvh->mloop[lt->tri[j]].v].co);
+  }
+
+  BBC_update_centroid(bbc);
+
+  BB_expand(tls->userdata_chunk, bbc->bcentroid);
+}
+
+static void pbvh_build_grids_prim_bbc_task_cb(void *__restrict userdata,
+                                              const int i,
+                                              const TaskParallelTLS *__restrict tls)
+{
+  PBVHBuildData *data = userdata;
+  PBVH *bvh = data->bvh;
+  const CCGKey *key = &bvh->gridkey;
+  CCGElem *grid = bvh->grids[i];
+  BBC *bbc = data->prim_bbc + i;
+
+  BB_reset((BB *)bbc);
+
+  for (int j = 0; j < key->grid_size * key->grid_size; j++) {
+    BB_expand((BB *)bbc, CCG_elem_offset_co(key, grid, j));
+  }
+
+  BBC_update_centroid(bbc);
+
+  BB_expand(tls->userdata_chunk, bbc->bcentroid);
+}
+
+static void pbvh_build_prim_bbc_reduce(const void *__restrict UNUSED(userdata),
+                                       void *__restrict chunk_join,
+                                       void *__restrict chunk)
+{
+  BB_expand_with_bb(chunk_join, chunk);
 }
 
 /**
@@ -553,7 +789,6 @@ void BKE_pbvh_build_mesh(PBVH *bvh,
   bvh->mloop = mloop;
   bvh->looptri = looptri;
   bvh->verts = verts;
-  bvh->vert_bitmap = BLI_BITMAP_NEW(totvert, "bvh->vert_bitmap");
   bvh->totvert = totvert;
   bvh->leaf_limit = LEAF_LIMIT;
   bvh->vdata = vdata;
@@ -564,28 +799,22 @@ void BKE_pbvh_build_mesh(PBVH *bvh,
   /* For each face, store the AABB and the AABB centroid */
   prim_bbc = MEM_mallocN(sizeof(BBC) * looptri_num, "prim_bbc");
 
-  for (int i = 0; i < looptri_num; i++) {
-    const MLoopTri *lt = &looptri[i];
-    const int sides = 3;
-    BBC *bbc = prim_bbc + i;
-
-    BB_reset((BB *)bbc);
-
-    for (int j = 0; j < sides; j++) {
-      BB_expand((BB *)bbc, verts[bvh->mloop[lt->tri[j]].v].co);
-    }
-
-    BBC_update_centroid(bbc);
-
-    BB_expand(&cb, bbc->bcentroid);
-  }
+  PBVHBuildData data = {
+      .bvh = bvh,
+      .prim_bbc = prim_bbc,
+  };
+  PBVHParallelSettings settings;
+  BKE_pbvh_parallel_range_settings(&settings, true, looptri_num);
+  settings.userdata_chunk = &cb;
+  settings.userdata_chunk_size = sizeof(cb);
+  settings.func_reduce = pbvh_build_prim_bbc_reduce;
+  BKE_pbvh_parallel_range(0, looptri_num, &data, pbvh_build_mesh_prim_bbc_task_cb, &settings);
 
   if (looptri_num) {
     pbvh_build(bvh, &cb, prim_bbc, looptri_num);
   }
 
   MEM_freeN(prim_bbc);
-  MEM_freeN(bvh->vert_bitmap);
 }
 
 /* Do a full rebuild with on Grids data structure */
@@ -614,20 +843,16 @@ void BKE_pbvh_build_grids(PBVH *bvh,
   /* For each grid, store the AABB and the AABB centroid */
   BBC *prim_bbc = MEM_mallocN(sizeof(BBC) * totgrid, "prim_bbc");
 
-  for (int i = 0; i < totgrid; i++) {
-    CCGElem *grid = grids[i];
-    BBC *bbc = prim_bbc + i;
-
-    BB_reset((BB *)bbc);
-
-    for (int j = 0; j < gridsize * gridsize; j++) {
-      BB_expand((BB *)bbc, CCG_elem_offset_co(key, grid, j));
-    }
-
-    BBC_update_centroid(bbc);
-
-    BB_expand(&cb, bbc->bcentroid);
-  }
+  PBVHBuildData data = {
+      .bvh = bvh,
+      .prim_bbc = prim_bbc,
+  };
+  PBVHParallelSettings settings;
+  BKE_pbvh_parallel_range_settings(&settings, true, totgrid);
+  settings.userdata_chunk = &cb;
+  settings.userdata_chunk_size = sizeof(cb);
+  settings.func_reduce = pbvh_build_prim_bbc_reduce;
+  BKE_pbvh_parallel_range(0, totgrid, &data, pbvh_build_grids_prim_bbc_task_cb, &settings);
 
   if (totgrid) {
     pbvh_build(bvh, &cb, prim_bbc, totgrid);
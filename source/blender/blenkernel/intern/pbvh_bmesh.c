@@ -26,6 +26,8 @@
 #include "BLI_heap_simple.h"
 #include "BLI_math.h"
 #include "BLI_memarena.h"
+#include "BLI_ohash.h"
+#include "BLI_task.h"
 
 #include "BKE_ccg.h"
 #include "BKE_DerivedMesh.h"
@@ -176,10 +178,10 @@ static BMFace *bm_face_exists_tri_from_loop_vert(BMLoop *l_radial_first, BMVert
  * Uses a map of vertices to lookup the final target.
  * References can't point to previous items (would cause infinite loop).
  */
-static BMVert *bm_vert_hash_lookup_chain(GHash *deleted_verts, BMVert *v)
+static BMVert *bm_vert_hash_lookup_chain(OHash *deleted_verts, BMVert *v)
 {
   while (true) {
-    BMVert **v_next_p = (BMVert **)BLI_ghash_lookup_p(deleted_verts, v);
+    BMVert **v_next_p = (BMVert **)BLI_ohash_lookup_p(deleted_verts, v);
     if (v_next_p == NULL) {
       /* not remapped*/
       return v;
@@ -745,6 +747,17 @@ typedef struct EdgeQueue {
 #endif
 } EdgeQueue;
 
+/* Edge found while creating the queue, before it is inserted. */
+typedef struct EdgeQueueItem {
+  BMEdge *e;
+  float priority;
+} EdgeQueueItem;
+
+typedef struct EdgeQueueItems {
+  EdgeQueueItem *items;
+  int items_len, items_alloc;
+} EdgeQueueItems;
+
 typedef struct {
   EdgeQueue *q;
   BLI_mempool *pool;
@@ -752,6 +765,9 @@ typedef struct {
   int cd_vert_mask_offset;
   int cd_vert_node_offset;
   int cd_face_node_offset;
+  /* When set, edges are gathered here instead of being inserted in the queue,
+   * see #edge_queue_create_from_nodes. */
+  EdgeQueueItems *items;
 } EdgeQueueContext;
 
 /* only tag'd edges are in the queue */
@@ -844,6 +860,16 @@ static void edge_queue_insert(EdgeQueueContext *eq_ctx, BMEdge *e, float priorit
        (check_mask(eq_ctx, e->v1) || check_mask(eq_ctx, e->v2))) &&
       !(BM_elem_flag_test_bool(e->v1, BM_ELEM_HIDDEN) ||
         BM_elem_flag_test_bool(e->v2, BM_ELEM_HIDDEN))) {
+    EdgeQueueItems *items = eq_ctx->items;
+    if (items != NULL) {
+      if (UNLIKELY(items->items_len == items->items_alloc)) {
+        items->items_alloc = max_ii(items->items_alloc * 2, 64);
+        items->items = MEM_reallocN(items->items, sizeof(*items->items) * items->items_alloc);
+      }
+      items->items[items->items_len++] = (EdgeQueueItem){e, priority};
+      return;
+    }
+
     BMVert **pair = BLI_mempool_alloc(eq_ctx->pool);
     pair[0] = e->v1;
     pair[1] = e->v2;
@@ -989,6 +1015,98 @@ static void short_edge_queue_face_add(EdgeQueueContext *eq_ctx, BMFace *f)
   }
 }
 
+typedef struct EdgeQueueCreateData {
+  PBVH *bvh;
+  const EdgeQueueContext *eq_ctx;
+  void (*face_add)(EdgeQueueContext *eq_ctx, BMFace *f);
+  int *node_indices;
+  EdgeQueueItems *node_items;
+} EdgeQueueCreateData;
+
+static void edge_queue_create_task_cb(void *__restrict userdata,
+                                      const int n,
+                                      const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  EdgeQueueCreateData *data = userdata;
+  PBVHNode *node = &data->bvh->nodes[data->node_indices[n]];
+  EdgeQueueContext eq_ctx = *data->eq_ctx;
+  eq_ctx.items = &data->node_items[n];
+
+  GSetIterator gs_iter;
+
+  /* Check each face */
+  GSET_ITER (gs_iter, node->bm_faces) {
+    BMFace *f = BLI_gsetIterator_getKey(&gs_iter);
+
+    data->face_add(&eq_ctx, f);
+  }
+}
+
+/* Add the edges of the faces of the leaf nodes marked for topology update to the queue.
+ *
+ * Nodes are checked in parallel, only reading the mesh. The edges found are then inserted in
+ * the order of the nodes, the same order as when checking them one after the other, so the
+ * result doesn't depend on the number of threads.
+ *
+ * Only building the queue is threaded. Splitting and collapsing the queued edges stays serial,
+ * doing it in parallel is not implemented. It would need:
+ * - Sets of nodes sharing no vertex, since each step rewires the disk cycles of the vertices
+ *   around the edge, with the edges reaching other nodes left for a serial pass.
+ * - BMesh elements created and freed from thread-local pools.
+ * - Per-thread BMLog entries, merged in a fixed order so undo replays the same steps whatever
+ *   the number of threads. */
+static void edge_queue_create_from_nodes(EdgeQueueContext *eq_ctx,
+                                         PBVH *bvh,
+                                         void (*face_add)(EdgeQueueContext *eq_ctx, BMFace *f))
+{
+  int *node_indices = MEM_malloc_arrayN(bvh->totnode, sizeof(*node_indices), __func__);
+  int totnode = 0;
+
+  for (int n = 0; n < bvh->totnode; n++) {
+    PBVHNode *node = &bvh->nodes[n];
+
+    /* Check leaf nodes marked for topology update */
+    if ((node->flag & PBVH_Leaf) && (node->flag & PBVH_UpdateTopology) &&
+        !(node->flag & PBVH_FullyHidden)) {
+      node_indices[totnode++] = n;
+    }
+  }
+
+  EdgeQueueCreateData data = {
+      .bvh = bvh,
+      .eq_ctx = eq_ctx,
+      .face_add = face_add,
+      .node_indices = node_indices,
+      .node_items = MEM_calloc_arrayN(max_ii(totnode, 1), sizeof(EdgeQueueItems), __func__),
+  };
+
+  PBVHParallelSettings settings;
+  BKE_pbvh_parallel_range_settings(&settings, true, totnode);
+  BKE_pbvh_parallel_range(0, totnode, &data, edge_queue_create_task_cb, &settings);
+
+  for (int n = 0; n < totnode; n++) {
+    EdgeQueueItems *items = &data.node_items[n];
+    for (int i = 0; i < items->items_len; i++) {
+      BMEdge *e = items->items[i].e;
+#ifdef USE_EDGEQUEUE_TAG
+      /* Edges shared by several faces are found more than once. */
+      if (EDGE_QUEUE_TEST(e)) {
+        continue;
+      }
+      EDGE_QUEUE_ENABLE(e);
+#endif
+      BMVert **pair = BLI_mempool_alloc(eq_ctx->pool);
+      pair[0] = e->v1;
+      pair[1] = e->v2;
+      BLI_heapsimple_insert(eq_ctx->q->heap, items->items[i].priority, pair);
+    }
+    MEM_SAFE_FREE(items->items);
+  }
+
+  MEM_freeN(data.node_items);
+  MEM_freeN(node_indices);
+}
+
 /* Create a priority queue containing vertex pairs connected by a long
  * edge as defined by PBVH.bm_max_edge_len.
  *
@@ -1034,22 +1152,7 @@ static void long_edge_queue_create(EdgeQueueContext *eq_ctx,
   pbvh_bmesh_edge_tag_verify(bvh);
 #endif
 
-  for (int n = 0; n < bvh->totnode; n++) {
-    PBVHNode *node = &bvh->nodes[n];
-
-    /* Check leaf nodes marked for topology update */
-    if ((node->flag & PBVH_Leaf) && (node->flag & PBVH_UpdateTopology) &&
-        !(node->flag & PBVH_FullyHidden)) {
-      GSetIterator gs_iter;
-
-      /* Check each face */
-      GSET_ITER (gs_iter, node->bm_faces) {
-        BMFace *f = BLI_gsetIterator_getKey(&gs_iter);
-
-        long_edge_queue_face_add(eq_ctx, f);
-      }
-    }
-  }
+  edge_queue_create_from_nodes(eq_ctx, bvh, long_edge_queue_face_add);
 }
 
 /* Create a priority queue containing vertex pairs connected by a
@@ -1093,22 +1196,7 @@ static void short_edge_queue_create(EdgeQueueContext *eq_ctx,
     eq_ctx->q->edge_queue_tri_in_range = edge_queue_tri_in_sphere;
   }
 
-  for (int n = 0; n < bvh->totnode; n++) {
-    PBVHNode *node = &bvh->nodes[n];
-
-    /* Check leaf nodes marked for topology update */
-    if ((node->flag & PBVH_Leaf) && (node->flag & PBVH_UpdateTopology) &&
-        !(node->flag & PBVH_FullyHidden)) {
-      GSetIterator gs_iter;
-
-      /* Check each face */
-      GSET_ITER (gs_iter, node->bm_faces) {
-        BMFace *f = BLI_gsetIterator_getKey(&gs_iter);
-
-        short_edge_queue_face_add(eq_ctx, f);
-      }
-    }
-  }
+  edge_queue_create_from_nodes(eq_ctx, bvh, short_edge_queue_face_add);
 }
 
 /*************************** Topology update **************************/
@@ -1288,7 +1376,7 @@ static void pbvh_bmesh_collapse_edge(PBVH *bvh,
                                      BMEdge *e,
                                      BMVert *v1,
                                      BMVert *v2,
-                                     GHash *deleted_verts,
+                                     OHash *deleted_verts,
                                      BLI_Buffer *deleted_faces,
                                      EdgeQueueContext *eq_ctx)
 {
@@ -1420,7 +1508,7 @@ static void pbvh_bmesh_collapse_edge(PBVH *bvh,
         if (v_tri[j] == v_conn) {
           v_conn = NULL;
         }
-        BLI_ghash_insert(deleted_verts, v_tri[j], NULL);
+        BLI_ohash_insert(deleted_verts, v_tri[j], NULL);
         BM_vert_kill(bvh->bm, v_tri[j]);
       }
     }
@@ -1447,7 +1535,7 @@ static void pbvh_bmesh_collapse_edge(PBVH *bvh,
   BLI_assert(!BM_vert_face_check(v_del));
   BM_log_vert_removed(bvh->bm_log, v_del, eq_ctx->cd_vert_mask_offset);
   /* v_conn == NULL is OK */
-  BLI_ghash_insert(deleted_verts, v_del, v_conn);
+  BLI_ohash_insert(deleted_verts, v_del, v_conn);
   BM_vert_kill(bvh->bm, v_del);
 }
 
@@ -1458,7 +1546,7 @@ static bool pbvh_bmesh_collapse_short_edges(EdgeQueueContext *eq_ctx,
   const float min_len_squared = bvh->bm_min_edge_len * bvh->bm_min_edge_len;
   bool any_collapsed = false;
   /* deleted verts point to vertices they were merged into, or NULL when removed. */
-  GHash *deleted_verts = BLI_ghash_ptr_new("deleted_verts");
+  OHash *deleted_verts = BLI_ohash_ptr_new("deleted_verts");
 
   while (!BLI_heapsimple_is_empty(eq_ctx->q->heap)) {
     BMVert **pair = BLI_heapsimple_pop_min(eq_ctx->q->heap);
@@ -1499,7 +1587,7 @@ static bool pbvh_bmesh_collapse_short_edges(EdgeQueueContext *eq_ctx,
     pbvh_bmesh_collapse_edge(bvh, e, v1, v2, deleted_verts, deleted_faces, eq_ctx);
   }
 
-  BLI_ghash_free(deleted_verts, NULL, NULL);
+  BLI_ohash_free(deleted_verts, NULL, NULL);
 
   return any_collapsed;
 }
@@ -143,9 +143,9 @@ struct PBVH {
   int totgrid;
   BLI_bitmap **grid_hidden;
 
-  /* Only used during BVH build and update,
-   * don't need to remain valid after */
-  BLI_bitmap *vert_bitmap;
+  /* Only used during BVH build: index of the first leaf in build order using each vertex,
+   * which stores it as a unique vertex. */
+  int *vert_owner;
 
 #ifdef PERFCNTRS
   int perf_modified;
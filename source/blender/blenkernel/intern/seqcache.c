@@ -21,21 +21,35 @@
  */
 
 #include <stddef.h>
+#include <stdio.h>
 #include <memory.h>
+#include <time.h>
+
+#include "zlib.h"
 
 #include "MEM_guardedalloc.h"
 
 #include "DNA_sequence_types.h"
 #include "DNA_scene_types.h"
+#include "DNA_userdef_types.h"
 
+#include "IMB_colormanagement.h"
 #include "IMB_imbuf.h"
 #include "IMB_imbuf_types.h"
 
+#include "BLI_fileops.h"
+#include "BLI_fileops_types.h"
 #include "BLI_mempool.h"
+#include "BLI_path_util.h"
+#include "BLI_string.h"
+#include "BLI_task.h"
 #include "BLI_threads.h"
 #include "BLI_listbase.h"
 #include "BLI_ghash.h"
 
+#include "atomic_ops.h"
+
+#include "BKE_global.h"
 #include "BKE_sequencer.h"
 #include "BKE_scene.h"
 #include "BKE_main.h"
@@ -63,6 +77,10 @@
  * entries one by one in reverse order to their creation.
  *
  * User can exclude caching of some images. Such entries will have is_temp_cache set.
+ *
+ * Disk cache: when enabled (#SEQ_CACHE_DISK_CACHE_ENABLE), permanent entries are also written
+ * to files below #UserDef.sequencer_disk_cache_dir. Images missing in memory are looked up there
+ * before they are rendered again, so they survive recycling and reloading the blend-file.
  */
 
 typedef struct SeqCache {
@@ -72,6 +90,7 @@ typedef struct SeqCache {
   struct BLI_mempool *items_pool;
   struct SeqCacheKey *last_key;
   size_t memory_used;
+  struct SeqDiskCache *disk_cache;
 } SeqCache;
 
 typedef struct SeqCacheItem {
@@ -140,6 +159,556 @@ static bool seq_cache_hashcmp(const void *a_, const void *b_)
           seq_cmp_render_data(&a->context, &b->context));
 }
 
+/* -------------------------------------------------------------------- */
+/** \name Disk Cache
+ *
+ * Files are stored in:
+ * `<cache dir>/<blend-file name>_seq_cache/<scene name>/<strip name>-<render hash>/`
+ * and named `<cache type>-<frame>.dcf`. Each file holds a #DiskCacheHeader followed by the
+ * (optionally zlib compressed) pixels of one image.
+ *
+ * - Files are written by a background task pool, so rendering doesn't wait for compression.
+ * - All files below the cache directory are tracked in one list ordered by last use,
+ *   the least recently used ones are removed once the size limit is exceeded.
+ * - Invalidated strips have their files removed, the disk cache is opened for that when it
+ *   isn't in use yet. Without a cache directory to look in, #Editing.disk_cache_timestamp is
+ *   set so files written before are ignored.
+ * \{ */
+
+#define DCACHE_FILE_EXT ".dcf"
+#define DCACHE_MAGIC "BSEQDC01"
+/* Queued writes keep their image alive, skip writing when too many are pending. */
+#define DCACHE_WRITES_PENDING_MAX 32
+
+typedef struct DiskCacheHeader {
+  char magic[8];
+  /** Time the image was queued for writing, see #Editing.disk_cache_timestamp. */
+  int64_t timestamp;
+  float nfra;
+  int type;
+  int x, y;
+  int planes;
+  int channels;
+  int is_float;
+  /** zlib compression level, zero when the pixels are stored uncompressed. */
+  int compression_level;
+  uint64_t size_raw;
+  uint64_t size_stored;
+  char colorspace[64];
+} DiskCacheHeader;
+
+typedef struct DiskCacheFile {
+  struct DiskCacheFile *next, *prev;
+  char path[FILE_MAX];
+  size_t size;
+  int64_t mtime;
+  int type;
+  int cfra;
+} DiskCacheFile;
+
+/* Per scene cache. */
+typedef struct SeqDiskCache {
+  /** `<cache dir>/<blend-file name>_seq_cache/<scene name>` */
+  char dir[FILE_MAX];
+  TaskPool *write_pool;
+  int writes_pending;
+  /** Incremented when files are invalidated, so pending writes of stale images are dropped. */
+  int invalidate_count;
+} SeqDiskCache;
+
+/* Files of all disk caches, shared since the size limit applies to the whole cache directory. */
+static struct {
+  ThreadMutex lock;
+  /** Cache directory the files were scanned from. */
+  char root[FILE_MAX];
+  /** #DiskCacheFile, least recently used first. */
+  ListBase files;
+  GHash *files_hash;
+  size_t size_total;
+  /** Number of #SeqDiskCache using the list, it's freed when the last one is. */
+  int users;
+} g_disk_cache = {BLI_MUTEX_INITIALIZER};
+
+/* Files of the blend-file can be located, even when the disk cache is disabled. */
+static bool seq_disk_cache_has_dir(Main *bmain)
+{
+  return (U.sequencer_disk_cache_dir[0] != '\0') && (bmain->name[0] != '\0');
+}
+
+static bool seq_disk_cache_is_enabled(Main *bmain, Scene *scene)
+{
+  return seq_disk_cache_has_dir(bmain) && (scene->ed->cache_flag & SEQ_CACHE_DISK_CACHE_ENABLE);
+}
+
+static size_t seq_disk_cache_size_limit(void)
+{
+  return (size_t)U.sequencer_disk_cache_size_limit * (1024 * 1024 * 1024);
+}
+
+static bool seq_disk_cache_filename_parse(const char *path, int *r_type, int *r_cfra)
+{
+  const char *filename = BLI_path_basename(path);
+  if (!BLI_path_extension_check(filename, DCACHE_FILE_EXT)) {
+    return false;
+  }
+  return sscanf(filename, "%d-%d", r_type, r_cfra) == 2;
+}
+
+static void seq_disk_cache_file_remove_locked(DiskCacheFile *file)
+{
+  BLI_delete(file->path, false, false);
+  g_disk_cache.size_total -= file->size;
+  BLI_ghash_remove(g_disk_cache.files_hash, file->path, NULL, NULL);
+  BLI_freelinkN(&g_disk_cache.files, file);
+}
+
+/* Add or update the file at \a path, it becomes the most recently used one. */
+static void seq_disk_cache_file_add_locked(const char *path, size_t size, int64_t mtime)
+{
+  int type, cfra;
+  if (!seq_disk_cache_filename_parse(path, &type, &cfra)) {
+    return;
+  }
+
+  DiskCacheFile *file = BLI_ghash_lookup(g_disk_cache.files_hash, path);
+  if (file != NULL) {
+    g_disk_cache.size_total -= file->size;
+    BLI_remlink(&g_disk_cache.files, file);
+  }
+  else {
+    file = MEM_callocN(sizeof(*file), __func__);
+    BLI_strncpy(file->path, path, sizeof(file->path));
+    file->type = type;
+    file->cfra = cfra;
+    BLI_ghash_insert(g_disk_cache.files_hash, file->path, file);
+  }
+  file->size = size;
+  file->mtime = mtime;
+  g_disk_cache.size_total += size;
+  BLI_addtail(&g_disk_cache.files, file);
+}
+
+static void seq_disk_cache_file_touch_locked(const char *path)
+{
+  DiskCacheFile *file = BLI_ghash_lookup(g_disk_cache.files_hash, path);
+  if (file != NULL) {
+    BLI_remlink(&g_disk_cache.files, file);
+    BLI_addtail(&g_disk_cache.files, file);
+  }
+}
+
+static void seq_disk_cache_enforce_limit_locked(void)
+{
+  const size_t size_limit = seq_disk_cache_size_limit();
+  while (g_disk_cache.size_total > size_limit && g_disk_cache.files.first) {
+    seq_disk_cache_file_remove_locked(g_disk_cache.files.first);
+  }
+}
+
+static void seq_disk_cache_scan_dir_locked(const char *dir)
+{
+  struct direntry *entries;
+  const uint entries_len = BLI_filelist_dir_contents(dir, &entries);
+
+  for (uint i = 0; i < entries_len; i++) {
+    const struct direntry *entry = &entries[i];
+    if (FILENAME_IS_CURRPAR(entry->relname)) {
+      continue;
+    }
+    if (S_ISDIR(entry->type)) {
+      seq_disk_cache_scan_dir_locked(entry->path);
+    }
+    else {
+      seq_disk_cache_file_add_locked(entry->path, (size_t)entry->s.st_size, entry->s.st_mtime);
+    }
+  }
+
+  BLI_filelist_free(entries, entries_len);
+}
+
+static int seq_disk_cache_file_cmp_mtime(const void *a, const void *b)
+{
+  const DiskCacheFile *file_a = a;
+  const DiskCacheFile *file_b = b;
+  return (file_a->mtime > file_b->mtime);
+}
+
+static void seq_disk_cache_files_free_locked(void)
+{
+  BLI_freelistN(&g_disk_cache.files);
+  if (g_disk_cache.files_hash != NULL) {
+    BLI_ghash_free(g_disk_cache.files_hash, NULL, NULL);
+    g_disk_cache.files_hash = NULL;
+  }
+  g_disk_cache.size_total = 0;
+  g_disk_cache.root[0] = '\0';
+}
+
+static SeqDiskCache *seq_disk_cache_create(Main *bmain, Scene *scene)
+{
+  SeqDiskCache *disk_cache = MEM_callocN(sizeof(*disk_cache), "SeqDiskCache");
+
+  char blendfile_name[FILE_MAX];
+  char scene_name[MAX_ID_NAME];
+  BLI_strncpy(blendfile_name, BLI_path_basename(bmain->name), sizeof(blendfile_name));
+  BLI_path_extension_replace(blendfile_name, sizeof(blendfile_name), "_seq_cache");
+  BLI_strncpy(scene_name, scene->id.name + 2, sizeof(scene_name));
+  BLI_filename_make_safe(scene_name);
+  BLI_path_join(disk_cache->dir,
+                sizeof(disk_cache->dir),
+                U.sequencer_disk_cache_dir,
+                blendfile_name,
+                scene_name,
+                NULL);
+  BLI_path_abs(disk_cache->dir, BKE_main_blendfile_path(bmain));
+
+  disk_cache->write_pool = BLI_task_pool_create_background(BLI_task_scheduler_get(), disk_cache);
+
+  BLI_mutex_lock(&g_disk_cache.lock);
+  if (!STREQ(g_disk_cache.root, U.sequencer_disk_cache_dir)) {
+    /* The cache directory has been changed, files from the previous one aren't tracked. */
+    seq_disk_cache_files_free_locked();
+    g_disk_cache.files_hash = BLI_ghash_str_new(__func__);
+    BLI_strncpy(g_disk_cache.root, U.sequencer_disk_cache_dir, sizeof(g_disk_cache.root));
+
+    char root[FILE_MAX];
+    BLI_strncpy(root, U.sequencer_disk_cache_dir, sizeof(root));
+    BLI_path_abs(root, BKE_main_blendfile_path(bmain));
+    seq_disk_cache_scan_dir_locked(root);
+    BLI_listbase_sort(&g_disk_cache.files, seq_disk_cache_file_cmp_mtime);
+    seq_disk_cache_enforce_limit_locked();
+  }
+  g_disk_cache.users++;
+  BLI_mutex_unlock(&g_disk_cache.lock);
+
+  return disk_cache;
+}
+
+static void seq_disk_cache_free(SeqDiskCache *disk_cache)
+{
+  BLI_task_pool_work_and_wait(disk_cache->write_pool);
+  BLI_task_pool_free(disk_cache->write_pool);
+
+  BLI_mutex_lock(&g_disk_cache.lock);
+  if (--g_disk_cache.users == 0) {
+    seq_disk_cache_files_free_locked();
+  }
+  BLI_mutex_unlock(&g_disk_cache.lock);
+
+  MEM_freeN(disk_cache);
+}
+
+/* Hash of the render settings affecting the image, stable between sessions. */
+static uint seq_disk_cache_render_hash(const SeqRenderData *context)
+{
+  uint hash = (uint)context->rectx;
+  hash = hash * 37 + (uint)context->recty;
+  hash = hash * 37 + (uint)context->preview_render_size;
+  hash = hash * 37 + (uint)context->motion_blur_samples;
+  hash = hash * 37 + (uint)(context->motion_blur_shutter * 100.0f);
+  hash = hash * 37 + (uint)((context->scene->r.views_format * 2) + context->view_id);
+  /* Color management, so files written with other settings are not read back. */
+  const Scene *scene = context->scene;
+  const ColorManagedViewSettings *view_settings = &scene->view_settings;
+  hash = hash * 37 + BLI_ghashutil_strhash_p(view_settings->view_transform);
+  hash = hash * 37 + BLI_ghashutil_strhash_p(view_settings->look);
+  hash = hash * 37 + (uint)(view_settings->exposure * 1000.0f);
+  hash = hash * 37 + (uint)(view_settings->gamma * 1000.0f);
+  if ((view_settings->flag & COLORMANAGE_VIEW_USE_CURVES) && view_settings->curve_mapping) {
+    hash = hash * 37 + (uint)view_settings->curve_mapping->changed_timestamp;
+  }
+  hash = hash * 37 + BLI_ghashutil_strhash_p(scene->display_settings.display_device);
+  hash = hash * 37 + BLI_ghashutil_strhash_p(scene->sequencer_colorspace_settings.name);
+  return hash;
+}
+
+static void seq_disk_cache_get_file_path(const SeqDiskCache *disk_cache,
+                                         const SeqRenderData *context,
+                                         const Sequence *seq,
+                                         const float cfra,
+                                         const int type,
+                                         char r_path[FILE_MAX])
+{
+  char seq_dir[FILE_MAXFILE];
+  char filename[FILE_MAXFILE];
+  BLI_snprintf(
+      seq_dir, sizeof(seq_dir), "%s-%08x", seq->name + 2, seq_disk_cache_render_hash(context));
+  BLI_filename_make_safe(seq_dir);
+  BLI_snprintf(filename, sizeof(filename), "%d-%d" DCACHE_FILE_EXT, type, (int)floorf(cfra));
+  BLI_path_join(r_path, FILE_MAX, disk_cache->dir, seq_dir, filename, NULL);
+}
+
+typedef struct DiskCacheWriteTask {
+  SeqDiskCache *disk_cache;
+  char path[FILE_MAX];
+  DiskCacheHeader header;
+  int invalidate_count;
+  ImBuf *ibuf;
+} DiskCacheWriteTask;
+
+static bool seq_disk_cache_write_file(const char *path, DiskCacheHeader *header, ImBuf *ibuf)
+{
+  const void *pixels = header->is_float ? (void *)ibuf->rect_float : (void *)ibuf->rect;
+  void *data_compressed = NULL;
+  const void *data = pixels;
+
+  header->size_stored = header->size_raw;
+  if (header->compression_level > 0) {
+    uLongf size_compressed = compressBound((uLong)header->size_raw);
+    data_compressed = MEM_mallocN(size_compressed, __func__);
+    if (compress2(data_compressed,
+                  &size_compressed,
+                  pixels,
+                  (uLong)header->size_raw,
+                  header->compression_level) == Z_OK) {
+      data = data_compressed;
+      header->size_stored = size_compressed;
+    }
+    else {
+      header->compression_level = 0;
+    }
+  }
+
+  bool ok = false;
+  if (BLI_make_existing_file(path)) {
+    FILE *file = BLI_fopen(path, "wb");
+    if (file != NULL) {
+      ok = (fwrite(header, sizeof(*header), 1, file) == 1) &&
+           (fwrite(data, header->size_stored, 1, file) == 1);
+      ok = (fclose(file) == 0) && ok;
+    }
+  }
+
+  if (data_compressed != NULL) {
+    MEM_freeN(data_compressed);
+  }
+  return ok;
+}
+
+static void seq_disk_cache_write_task(TaskPool *__restrict UNUSED(pool),
+                                      void *taskdata,
+                                      int UNUSED(threadid))
+{
+  DiskCacheWriteTask *task = taskdata;
+  SeqDiskCache *disk_cache = task->disk_cache;
+
+  /* Write to a temporary file first, readers never see partially written files. */
+  char path_temp[FILE_MAX + 4];
+  BLI_snprintf(path_temp, sizeof(path_temp), "%s.tmp", task->path);
+
+  if (seq_disk_cache_write_file(path_temp, &task->header, task->ibuf)) {
+    BLI_mutex_lock(&g_disk_cache.lock);
+    if (task->invalidate_count == disk_cache->invalidate_count &&
+        BLI_rename(path_temp, task->path) == 0) {
+      seq_disk_cache_file_add_locked(
+          task->path, sizeof(task->header) + task->header.size_stored, time(NULL));
+      seq_disk_cache_enforce_limit_locked();
+    }
+    BLI_mutex_unlock(&g_disk_cache.lock);
+  }
+
+  if (BLI_exists(path_temp)) {
+    BLI_delete(path_temp, false, false);
+  }
+
+  IMB_freeImBuf(task->ibuf);
+  atomic_sub_and_fetch_int32(&disk_cache->writes_pending, 1);
+}
+
+static void seq_disk_cache_write(SeqDiskCache *disk_cache,
+                                 const SeqRenderData *context,
+                                 Sequence *seq,
+                                 float cfra,
+                                 int type,
+                                 ImBuf *ibuf)
+{
+  const bool is_float = (ibuf->rect_float != NULL);
+  if (!is_float && ibuf->rect == NULL) {
+    return;
+  }
+
+  if (atomic_add_and_fetch_int32(&disk_cache->writes_pending, 1) > DCACHE_WRITES_PENDING_MAX) {
+    atomic_sub_and_fetch_int32(&disk_cache->writes_pending, 1);
+    return;
+  }
+
+  DiskCacheWriteTask *task = MEM_callocN(sizeof(*task), __func__);
+  task->disk_cache = disk_cache;
+  task->invalidate_count = disk_cache->invalidate_count;
+  seq_disk_cache_get_file_path(disk_cache, context, seq, cfra, type, task->path);
+
+  DiskCacheHeader *header = &task->header;
+  memcpy(header->magic, DCACHE_MAGIC, sizeof(header->magic));
+  header->timestamp = time(NULL);
+  header->nfra = cfra - seq->start;
+  header->type = type;
+  header->x = ibuf->x;
+  header->y = ibuf->y;
+  header->planes = ibuf->planes;
+  header->channels = ibuf->channels;
+  header->is_float = is_float;
+  header->size_raw = is_float ? sizeof(float) * (size_t)ibuf->channels * ibuf->x * ibuf->y :
+                                sizeof(uint) * (size_t)ibuf->x * ibuf->y;
+  switch (U.sequencer_disk_cache_compression) {
+    case USER_SEQ_DISK_CACHE_COMPRESSION_LOW:
+      header->compression_level = 1;
+      break;
+    case USER_SEQ_DISK_CACHE_COMPRESSION_HIGH:
+      header->compression_level = 9;
+      break;
+    default:
+      header->compression_level = 0;
+      break;
+  }
+  const char *colorspace = is_float ? IMB_colormanagement_get_float_colorspace(ibuf) :
+                                      IMB_colormanagement_get_rect_colorspace(ibuf);
+  if (colorspace != NULL) {
+    BLI_strncpy(header->colorspace, colorspace, sizeof(header->colorspace));
+  }
+
+  IMB_refImBuf(ibuf);
+  task->ibuf = ibuf;
+  BLI_task_pool_push(
+      disk_cache->write_pool, seq_disk_cache_write_task, task, true, TASK_PRIORITY_LOW);
+}
+
+static ImBuf *seq_disk_cache_read(SeqDiskCache *disk_cache,
+                                  const SeqRenderData *context,
+                                  Sequence *seq,
+                                  float cfra,
+                                  int type)
+{
+  char path[FILE_MAX];
+  seq_disk_cache_get_file_path(disk_cache, context, seq, cfra, type, path);
+
+  FILE *file = BLI_fopen(path, "rb");
+  if (file == NULL) {
+    return NULL;
+  }
+
+  ImBuf *ibuf = NULL;
+  void *data = NULL;
+  DiskCacheHeader header;
+  bool is_valid = (fread(&header, sizeof(header), 1, file) == 1) &&
+                  (memcmp(header.magic, DCACHE_MAGIC, sizeof(header.magic)) == 0);
+
+  if (is_valid) {
+    /* Different sub-frames share a file, a mismatch is a regular cache miss. */
+    if (header.nfra != cfra - seq->start || header.type != type) {
+      fclose(file);
+      return NULL;
+    }
+    header.colorspace[sizeof(header.colorspace) - 1] = '\0';
+    is_valid = (header.timestamp > context->scene->ed->disk_cache_timestamp) && (header.x > 0) &&
+               (header.y > 0) && (header.channels > 0) && (header.channels <= 4) &&
+               (header.size_raw == (header.is_float ? sizeof(float) * (size_t)header.channels *
+                                                          header.x * header.y :
+                                                      sizeof(uint) * (size_t)header.x * header.y));
+  }
+
+  if (is_valid) {
+    ibuf = IMB_allocImBuf(
+        header.x, header.y, header.planes, header.is_float ? IB_rectfloat : IB_rect);
+    void *pixels = header.is_float ? (void *)ibuf->rect_float : (void *)ibuf->rect;
+    if (header.compression_level == 0) {
+      is_valid = (header.size_stored == header.size_raw) &&
+                 (fread(pixels, header.size_raw, 1, file) == 1);
+    }
+    else {
+      data = MEM_mallocN(header.size_stored, __func__);
+      uLongf size_raw = (uLongf)header.size_raw;
+      is_valid = (fread(data, header.size_stored, 1, file) == 1) &&
+                 (uncompress(pixels, &size_raw, data, (uLong)header.size_stored) == Z_OK) &&
+                 (size_raw == header.size_raw);
+    }
+  }
+
+  fclose(file);
+  if (data != NULL) {
+    MEM_freeN(data);
+  }
+
+  BLI_mutex_lock(&g_disk_cache.lock);
+  if (is_valid) {
+    seq_disk_cache_file_touch_locked(path);
+  }
+  else {
+    /* Damaged or stale, don't try to read it again. */
+    DiskCacheFile *cache_file = BLI_ghash_lookup(g_disk_cache.files_hash, path);
+    if (cache_file != NULL) {
+      seq_disk_cache_file_remove_locked(cache_file);
+    }
+    else {
+      BLI_delete(path, false, false);
+    }
+  }
+  BLI_mutex_unlock(&g_disk_cache.lock);
+
+  if (!is_valid) {
+    if (ibuf != NULL) {
+      IMB_freeImBuf(ibuf);
+    }
+    return NULL;
+  }
+
+  ibuf->channels = header.channels;
+  if (header.colorspace[0] != '\0') {
+    if (header.is_float) {
+      IMB_colormanagement_assign_float_colorspace(ibuf, header.colorspace);
+    }
+    else {
+      IMB_colormanagement_assign_rect_colorspace(ibuf, header.colorspace);
+    }
+  }
+  return ibuf;
+}
+
+/* Remove files of cache types in \a composite_types between the frames
+ * and files of \a seq of \a source_types between the frames of \a seq_changed. */
+static void seq_disk_cache_invalidate(SeqDiskCache *disk_cache,
+                                      Sequence *seq,
+                                      Sequence *seq_changed,
+                                      int range_start,
+                                      int range_end,
+                                      int composite_types,
+                                      int source_types)
+{
+  char seq_dir_prefix[FILE_MAX];
+  BLI_snprintf(seq_dir_prefix, sizeof(seq_dir_prefix), "%s-", seq->name + 2);
+  BLI_filename_make_safe(seq_dir_prefix);
+  char seq_path_prefix[FILE_MAX];
+  BLI_join_dirfile(seq_path_prefix, sizeof(seq_path_prefix), disk_cache->dir, seq_dir_prefix);
+  const size_t dir_len = strlen(disk_cache->dir);
+  const size_t seq_path_prefix_len = strlen(seq_path_prefix);
+
+  BLI_mutex_lock(&g_disk_cache.lock);
+  disk_cache->invalidate_count++;
+
+  DiskCacheFile *file_next;
+  for (DiskCacheFile *file = g_disk_cache.files.first; file; file = file_next) {
+    file_next = file->next;
+
+    if (!STREQLEN(file->path, disk_cache->dir, dir_len)) {
+      continue;
+    }
+
+    if ((file->type & composite_types) && file->cfra >= range_start && file->cfra <= range_end) {
+      seq_disk_cache_file_remove_locked(file);
+    }
+    else if ((file->type & source_types) &&
+             STREQLEN(file->path, seq_path_prefix, seq_path_prefix_len) &&
+             /* Skip the render hash, so other strips starting with the same name don't match. */
+             (strlen(file->path) > seq_path_prefix_len + 8) &&
+             (file->path[seq_path_prefix_len + 8] == SEP) &&
+             file->cfra >= seq_changed->startdisp && file->cfra <= seq_changed->enddisp) {
+      seq_disk_cache_file_remove_locked(file);
+    }
+  }
+  BLI_mutex_unlock(&g_disk_cache.lock);
+}
+
+/** \} */
+
 static SeqCache *seq_cache_get_from_scene(Scene *scene)
 {
   if (scene && scene->ed && scene->ed->cache) {
@@ -478,6 +1047,10 @@ void BKE_sequencer_cache_destruct(Scene *scene)
     return;
   }
 
+  if (cache->disk_cache != NULL) {
+    seq_disk_cache_free(cache->disk_cache);
+  }
+
   BLI_ghash_free(cache->hash, seq_cache_keyfree, seq_cache_valfree);
   BLI_mempool_destroy(cache->keys_pool);
   BLI_mempool_destroy(cache->items_pool);
@@ -520,6 +1093,19 @@ void BKE_sequencer_cache_cleanup_sequence(Scene *scene,
                                           Sequence *seq_changed,
                                           int invalidate_types)
 {
+  Main *bmain = G_MAIN;
+  const bool use_disk_cache = seq_disk_cache_has_dir(bmain);
+
+  if (!use_disk_cache) {
+    /* Files can't be located, don't read the ones written before once they can be. */
+    scene->ed->disk_cache_timestamp = time(NULL);
+  }
+  else if (seq_cache_get_from_scene(scene) == NULL) {
+    /* Files outlive the cache in memory and the disk cache being enabled, so open it to remove
+     * the ones of the changed range. */
+    BKE_sequencer_cache_create(scene);
+  }
+
   SeqCache *cache = seq_cache_get_from_scene(scene);
   if (!cache) {
     return;
@@ -569,13 +1155,44 @@ void BKE_sequencer_cache_cleanup_sequence(Scene *scene,
     }
   }
   cache->last_key = NULL;
+
+  if (use_disk_cache) {
+    if (cache->disk_cache == NULL) {
+      cache->disk_cache = seq_disk_cache_create(bmain, scene);
+    }
+    seq_disk_cache_invalidate(cache->disk_cache,
+                              seq,
+                              seq_changed,
+                              range_start,
+                              range_end,
+                              invalidate_composite,
+                              invalidate_source);
+  }
+
   seq_cache_unlock(scene);
 }
 
-struct ImBuf *BKE_sequencer_cache_get(const SeqRenderData *context,
-                                      Sequence *seq,
-                                      float cfra,
-                                      int type)
+static int seq_cache_get_store_flag(Scene *scene, Sequence *seq)
+{
+  if (seq->cache_flag & SEQ_CACHE_OVERRIDE) {
+    return seq->cache_flag | (scene->ed->cache_flag & SEQ_CACHE_STORE_FINAL_OUT);
+  }
+  return scene->ed->cache_flag;
+}
+
+static void seq_cache_put_ex(const SeqRenderData *context,
+                             Sequence *seq,
+                             float cfra,
+                             int type,
+                             ImBuf *i,
+                             float cost,
+                             const bool skip_disk_cache);
+
+static ImBuf *seq_cache_get_ex(const SeqRenderData *context,
+                               Sequence *seq,
+                               float cfra,
+                               int type,
+                               const bool skip_disk_cache)
 {
   Scene *scene = context->scene;
 
@@ -593,6 +1210,7 @@ struct ImBuf *BKE_sequencer_cache_get(const SeqRenderData *context,
   seq_cache_lock(scene);
   SeqCache *cache = seq_cache_get_from_scene(scene);
   ImBuf *ibuf = NULL;
+  SeqDiskCache *disk_cache = NULL;
 
   if (cache && seq) {
     SeqCacheKey key;
@@ -603,12 +1221,36 @@ struct ImBuf *BKE_sequencer_cache_get(const SeqRenderData *context,
     key.type = type;
 
     ibuf = seq_cache_get(cache, &key);
+
+    if (ibuf == NULL && !skip_disk_cache && (seq_cache_get_store_flag(scene, seq) & type) &&
+        seq_disk_cache_is_enabled(context->bmain, scene)) {
+      if (cache->disk_cache == NULL) {
+        cache->disk_cache = seq_disk_cache_create(context->bmain, scene);
+      }
+      disk_cache = cache->disk_cache;
+    }
   }
   seq_cache_unlock(scene);
 
+  /* Read without holding the lock, the disk cache is only freed with the whole cache. */
+  if (disk_cache != NULL) {
+    ibuf = seq_disk_cache_read(disk_cache, context, seq, cfra, type);
+    if (ibuf != NULL) {
+      seq_cache_put_ex(context, seq, cfra, type, ibuf, 0.0f, true);
+    }
+  }
+
   return ibuf;
 }
 
+struct ImBuf *BKE_sequencer_cache_get(const SeqRenderData *context,
+                                      Sequence *seq,
+                                      float cfra,
+                                      int type)
+{
+  return seq_cache_get_ex(context, seq, cfra, type, false);
+}
+
 bool BKE_sequencer_cache_put_if_possible(
     const SeqRenderData *context, Sequence *seq, float cfra, int type, ImBuf *ibuf, float cost)
 {
@@ -631,8 +1273,13 @@ bool BKE_sequencer_cache_put_if_possible(
   }
 }
 
-void BKE_sequencer_cache_put(
-    const SeqRenderData *context, Sequence *seq, float cfra, int type, ImBuf *i, float cost)
+static void seq_cache_put_ex(const SeqRenderData *context,
+                             Sequence *seq,
+                             float cfra,
+                             int type,
+                             ImBuf *i,
+                             float cost,
+                             const bool skip_disk_cache)
 {
   Scene *scene = context->scene;
 
@@ -647,7 +1294,7 @@ void BKE_sequencer_cache_put(
   }
 
   /* Prevent reinserting, it breaks cache key linking */
-  ImBuf *test = BKE_sequencer_cache_get(context, seq, cfra, type);
+  ImBuf *test = seq_cache_get_ex(context, seq, cfra, type, true);
   if (test) {
     IMB_freeImBuf(test);
     return;
@@ -660,15 +1307,7 @@ void BKE_sequencer_cache_put(
   seq_cache_lock(scene);
 
   SeqCache *cache = seq_cache_get_from_scene(scene);
-  int flag;
-
-  if (seq->cache_flag & SEQ_CACHE_OVERRIDE) {
-    flag = seq->cache_flag;
-    flag |= scene->ed->cache_flag & SEQ_CACHE_STORE_FINAL_OUT;
-  }
-  else {
-    flag = scene->ed->cache_flag;
-  }
+  const int flag = seq_cache_get_store_flag(scene, seq);
 
   if (cost > SEQ_CACHE_COST_MAX) {
     cost = SEQ_CACHE_COST_MAX;
@@ -714,9 +1353,23 @@ void BKE_sequencer_cache_put(
     cache->last_key = NULL;
   }
 
+  if (!skip_disk_cache && !key->is_temp_cache &&
+      seq_disk_cache_is_enabled(context->bmain, scene)) {
+    if (cache->disk_cache == NULL) {
+      cache->disk_cache = seq_disk_cache_create(context->bmain, scene);
+    }
+    seq_disk_cache_write(cache->disk_cache, context, seq, cfra, type, i);
+  }
+
   seq_cache_unlock(scene);
 }
 
+void BKE_sequencer_cache_put(
+    const SeqRenderData *context, Sequence *seq, float cfra, int type, ImBuf *i, float cost)
+{
+  seq_cache_put_ex(context, seq, cfra, type, i, cost, false);
+}
+
 size_t BKE_sequencer_cache_get_num_items(struct Scene *scene)
 {
   SeqCache *cache = seq_cache_get_from_scene(scene);
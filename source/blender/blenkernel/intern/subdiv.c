@@ -23,10 +23,14 @@
 
 #include "BKE_subdiv.h"
 
+#include <stdio.h>
+
 #include "DNA_mesh_types.h"
 #include "DNA_meshdata_types.h"
 #include "DNA_modifier_types.h"
 
+#include "BLI_listbase.h"
+#include "BLI_threads.h"
 #include "BLI_utildefines.h"
 
 #include "MEM_guardedalloc.h"
@@ -96,17 +100,34 @@ bool BKE_subdiv_settings_equal(const SubdivSettings *settings_a, const SubdivSet
 
 /* Creation from scratch. */
 
+static bool subdiv_topology_equal_converter(const Subdiv *subdiv, void *user_data)
+{
+  return openSubdiv_topologyRefinerCompareWithConverter(subdiv->topology_refiner, user_data);
+}
+
+static size_t subdiv_memory_size_estimate(const Subdiv *subdiv);
+
 Subdiv *BKE_subdiv_new_from_converter(const SubdivSettings *settings,
                                       struct OpenSubdiv_Converter *converter)
 {
   SubdivStats stats;
   BKE_subdiv_stats_init(&stats);
   BKE_subdiv_stats_begin(&stats, SUBDIV_STATS_TOPOLOGY_REFINER_CREATION_TIME);
+  const int num_vertices = converter->getNumVertices(converter);
+  const int num_edges = converter->getNumEdges(converter);
+  const int num_faces = converter->getNumFaces(converter);
+  Subdiv *subdiv = BKE_subdiv_topology_cache_acquire(
+      settings, num_vertices, num_edges, num_faces, subdiv_topology_equal_converter, converter);
+  if (subdiv != NULL) {
+    BKE_subdiv_stats_end(&stats, SUBDIV_STATS_TOPOLOGY_REFINER_CREATION_TIME);
+    subdiv->stats = stats;
+    return subdiv;
+  }
   OpenSubdiv_TopologyRefinerSettings topology_refiner_settings;
   topology_refiner_settings.level = settings->level;
   topology_refiner_settings.is_adaptive = settings->is_adaptive;
   struct OpenSubdiv_TopologyRefiner *osd_topology_refiner = NULL;
-  if (converter->getNumVertices(converter) != 0) {
+  if (num_vertices != 0) {
     osd_topology_refiner = openSubdiv_createTopologyRefinerFromConverter(
         converter, &topology_refiner_settings);
   }
@@ -115,11 +136,15 @@ Subdiv *BKE_subdiv_new_from_converter(const SubdivSettings *settings,
      * The thing here is: OpenSubdiv can only deal with faces, but our
      * side of subdiv also deals with loose vertices and edges. */
   }
-  Subdiv *subdiv = MEM_callocN(sizeof(Subdiv), "subdiv from converetr");
+  subdiv = MEM_callocN(sizeof(Subdiv), "subdiv from converetr");
   subdiv->settings = *settings;
   subdiv->topology_refiner = osd_topology_refiner;
   subdiv->evaluator = NULL;
   subdiv->displacement_evaluator = NULL;
+  subdiv->cache_.num_vertices = num_vertices;
+  subdiv->cache_.num_edges = num_edges;
+  subdiv->cache_.num_faces = num_faces;
+  subdiv->cache_.memory_size = subdiv_memory_size_estimate(subdiv);
   BKE_subdiv_stats_end(&stats, SUBDIV_STATS_TOPOLOGY_REFINER_CREATION_TIME);
   subdiv->stats = stats;
   return subdiv;
@@ -182,7 +207,7 @@ Subdiv *BKE_subdiv_update_from_mesh(Subdiv *subdiv,
 
 /* Memory release. */
 
-void BKE_subdiv_free(Subdiv *subdiv)
+static void subdiv_free_data(Subdiv *subdiv)
 {
   if (subdiv->evaluator != NULL) {
     openSubdiv_deleteEvaluator(subdiv->evaluator);
@@ -197,6 +222,211 @@ void BKE_subdiv_free(Subdiv *subdiv)
   MEM_freeN(subdiv);
 }
 
+void BKE_subdiv_free(Subdiv *subdiv)
+{
+  if (subdiv->topology_refiner != NULL) {
+    BKE_subdiv_topology_cache_release(subdiv);
+    return;
+  }
+  subdiv_free_data(subdiv);
+}
+
+/* ============================= TOPOLOGY CACHE ============================= */
+
+/* Descriptors are kept in least recently used order: the most recently released one is the
+ * last in the list, eviction happens from the beginning of the list. */
+
+/* Same default as MEM_CacheLimiter, the actual limit comes from the memory cache limit of the
+ * user preferences. */
+#define SUBDIV_TOPOLOGY_CACHE_DEFAULT_LIMIT (32 * 1024 * 1024)
+
+/* Rough estimate of the memory used by the refiner and by the stencil and patch tables of an
+ * evaluator, per refined face. */
+#define SUBDIV_TOPOLOGY_CACHE_REFINED_FACE_SIZE 256
+
+static struct {
+  ListBase items; /* LinkData, data is Subdiv. */
+  int num_items;
+  size_t memory_size;
+  size_t memory_limit;
+  int num_hits;
+  int num_misses;
+  int num_evictions;
+} topology_cache = {{NULL, NULL}, 0, 0, SUBDIV_TOPOLOGY_CACHE_DEFAULT_LIMIT, 0, 0, 0};
+
+static ThreadMutex topology_cache_lock = BLI_MUTEX_INITIALIZER;
+
+/* OpenSubdiv has no query for the memory it uses, so it is estimated from the number of faces
+ * refinement creates. Adaptive refinement only isolates extraordinary features, adding about
+ * the same amount of faces at each level, uniform refinement quadruples them at each level. */
+static size_t subdiv_memory_size_estimate(const Subdiv *subdiv)
+{
+  const OpenSubdiv_TopologyRefiner *topology_refiner = subdiv->topology_refiner;
+  if (topology_refiner == NULL) {
+    return sizeof(Subdiv);
+  }
+  const size_t num_ptex_faces = (size_t)topology_refiner->getNumPtexFaces(topology_refiner);
+  const int level = subdiv->settings.level;
+  const size_t num_refined_faces = subdiv->settings.is_adaptive ?
+                                       num_ptex_faces * (size_t)level :
+                                       num_ptex_faces << (2 * level);
+  return sizeof(Subdiv) + sizeof(int) * (size_t)subdiv->cache_.num_faces +
+         num_refined_faces * SUBDIV_TOPOLOGY_CACHE_REFINED_FACE_SIZE;
+}
+
+/* Remove a cached descriptor matching the key from the cache, most recently used first. */
+static Subdiv *subdiv_topology_cache_pop(const SubdivSettings *settings,
+                                         const int num_vertices,
+                                         const int num_edges,
+                                         const int num_faces)
+{
+  LISTBASE_FOREACH_BACKWARD (LinkData *, link, &topology_cache.items) {
+    Subdiv *subdiv = link->data;
+    if (subdiv->cache_.num_vertices == num_vertices && subdiv->cache_.num_edges == num_edges &&
+        subdiv->cache_.num_faces == num_faces &&
+        BKE_subdiv_settings_equal(&subdiv->settings, settings)) {
+      BLI_freelinkN(&topology_cache.items, link);
+      topology_cache.num_items--;
+      topology_cache.memory_size -= subdiv->cache_.memory_size;
+      return subdiv;
+    }
+  }
+  return NULL;
+}
+
+static void subdiv_topology_cache_push(Subdiv *subdiv)
+{
+  BLI_addtail(&topology_cache.items, BLI_genericNodeN(subdiv));
+  topology_cache.num_items++;
+  topology_cache.memory_size += subdiv->cache_.memory_size;
+}
+
+/* Pop the least recently used descriptors above the memory limit into r_evicted, to be freed
+ * outside of the lock. */
+static void subdiv_topology_cache_evict(ListBase *r_evicted)
+{
+  while (topology_cache.memory_size > topology_cache.memory_limit) {
+    LinkData *link = BLI_pophead(&topology_cache.items);
+    Subdiv *subdiv = link->data;
+    BLI_addtail(r_evicted, link);
+    topology_cache.num_items--;
+    topology_cache.memory_size -= subdiv->cache_.memory_size;
+    topology_cache.num_evictions++;
+  }
+}
+
+static void subdiv_topology_cache_free_evicted(ListBase *evicted)
+{
+  LISTBASE_FOREACH_MUTABLE (LinkData *, link, evicted) {
+    subdiv_free_data(link->data);
+    MEM_freeN(link);
+  }
+  BLI_listbase_clear(evicted);
+}
+
+Subdiv *BKE_subdiv_topology_cache_acquire(const SubdivSettings *settings,
+                                          const int num_vertices,
+                                          const int num_edges,
+                                          const int num_faces,
+                                          bool (*topology_equal)(const Subdiv *subdiv,
+                                                                 void *user_data),
+                                          void *user_data)
+{
+  /* Candidates are compared outside of the lock, since it goes over the whole topology. Those
+   * with another topology are put back once the lookup is over. */
+  ListBase mismatches = {NULL, NULL};
+  Subdiv *subdiv = NULL;
+  while (true) {
+    BLI_mutex_lock(&topology_cache_lock);
+    Subdiv *candidate = subdiv_topology_cache_pop(settings, num_vertices, num_edges, num_faces);
+    BLI_mutex_unlock(&topology_cache_lock);
+    if (candidate == NULL) {
+      break;
+    }
+    if (topology_equal(candidate, user_data)) {
+      subdiv = candidate;
+      break;
+    }
+    BLI_addtail(&mismatches, BLI_genericNodeN(candidate));
+  }
+  ListBase evicted = {NULL, NULL};
+  BLI_mutex_lock(&topology_cache_lock);
+  LISTBASE_FOREACH_MUTABLE (LinkData *, link, &mismatches) {
+    subdiv_topology_cache_push(link->data);
+    MEM_freeN(link);
+  }
+  subdiv_topology_cache_evict(&evicted);
+  if (subdiv != NULL) {
+    topology_cache.num_hits++;
+  }
+  else {
+    topology_cache.num_misses++;
+  }
+  BLI_mutex_unlock(&topology_cache_lock);
+  subdiv_topology_cache_free_evicted(&evicted);
+  return subdiv;
+}
+
+void BKE_subdiv_topology_cache_release(Subdiv *subdiv)
+{
+  /* Displacement references data of the mesh it was attached for. */
+  BKE_subdiv_displacement_detach(subdiv);
+  ListBase evicted = {NULL, NULL};
+  BLI_mutex_lock(&topology_cache_lock);
+  subdiv_topology_cache_push(subdiv);
+  subdiv_topology_cache_evict(&evicted);
+  BLI_mutex_unlock(&topology_cache_lock);
+  subdiv_topology_cache_free_evicted(&evicted);
+}
+
+void BKE_subdiv_topology_cache_limit_set(const size_t memory_limit)
+{
+  ListBase evicted = {NULL, NULL};
+  BLI_mutex_lock(&topology_cache_lock);
+  topology_cache.memory_limit = memory_limit;
+  subdiv_topology_cache_evict(&evicted);
+  BLI_mutex_unlock(&topology_cache_lock);
+  subdiv_topology_cache_free_evicted(&evicted);
+}
+
+void BKE_subdiv_topology_cache_stats_get(SubdivTopologyCacheStats *r_stats)
+{
+  BLI_mutex_lock(&topology_cache_lock);
+  r_stats->num_items = topology_cache.num_items;
+  r_stats->memory_size = topology_cache.memory_size;
+  r_stats->memory_limit = topology_cache.memory_limit;
+  r_stats->num_hits = topology_cache.num_hits;
+  r_stats->num_misses = topology_cache.num_misses;
+  r_stats->num_evictions = topology_cache.num_evictions;
+  BLI_mutex_unlock(&topology_cache_lock);
+}
+
+void BKE_subdiv_topology_cache_stats_print(void)
+{
+  SubdivTopologyCacheStats stats;
+  BKE_subdiv_topology_cache_stats_get(&stats);
+  printf("Subdivision surface topology cache:\n");
+  printf("  Items: %d, memory: %.2f MB (limit %.2f MB)\n",
+         stats.num_items,
+         (double)stats.memory_size / (1024.0 * 1024.0),
+         (double)stats.memory_limit / (1024.0 * 1024.0));
+  printf("  Hits: %d, misses: %d, evictions: %d\n",
+         stats.num_hits,
+         stats.num_misses,
+         stats.num_evictions);
+}
+
+void BKE_subdiv_topology_cache_clear(void)
+{
+  ListBase evicted = {NULL, NULL};
+  BLI_mutex_lock(&topology_cache_lock);
+  BLI_movelisttolist(&evicted, &topology_cache.items);
+  topology_cache.num_items = 0;
+  topology_cache.memory_size = 0;
+  BLI_mutex_unlock(&topology_cache_lock);
+  subdiv_topology_cache_free_evicted(&evicted);
+}
+
 /* =========================== PTEX FACES AND GRIDS ========================= */
 
 int *BKE_subdiv_face_ptex_offset_get(Subdiv *subdiv)
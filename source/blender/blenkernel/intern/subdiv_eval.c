@@ -35,6 +35,7 @@
 
 #include "MEM_guardedalloc.h"
 
+#include "opensubdiv_capi_type.h"
 #include "opensubdiv_evaluator_capi.h"
 #include "opensubdiv_topology_refiner_capi.h"
 
@@ -266,6 +267,40 @@ void BKE_subdiv_eval_final_point(
   }
 }
 
+/* ============================ Batched queries ============================= */
+
+void BKE_subdiv_eval_limit_points(Subdiv *subdiv,
+                                  const OpenSubdiv_PatchCoord *patch_coords,
+                                  const int num_patch_coords,
+                                  float (*r_P)[3],
+                                  float (*r_dPdu)[3],
+                                  float (*r_dPdv)[3])
+{
+  subdiv->evaluator->evaluatePatchesLimit(subdiv->evaluator,
+                                          patch_coords,
+                                          num_patch_coords,
+                                          (float *)r_P,
+                                          (float *)r_dPdu,
+                                          (float *)r_dPdv);
+  if (r_dPdu == NULL || r_dPdv == NULL) {
+    return;
+  }
+  /* Same workaround for zero derivatives as in BKE_subdiv_eval_limit_point_and_derivatives(),
+   * such points are rare enough to be evaluated one by one. */
+  for (int i = 0; i < num_patch_coords; i++) {
+    if (is_zero_v3(r_dPdu[i]) || is_zero_v3(r_dPdv[i])) {
+      const OpenSubdiv_PatchCoord *patch_coord = &patch_coords[i];
+      subdiv->evaluator->evaluateLimit(subdiv->evaluator,
+                                       patch_coord->ptex_face,
+                                       patch_coord->u * 0.999f + 0.0005f,
+                                       patch_coord->v * 0.999f + 0.0005f,
+                                       r_P[i],
+                                       r_dPdu[i],
+                                       r_dPdv[i]);
+    }
+  }
+}
+
 /* ===================  Patch queries at given resolution =================== */
 
 /* Move buffer forward by a given number of bytes. */
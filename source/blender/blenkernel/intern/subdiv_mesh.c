@@ -41,6 +41,8 @@
 
 #include "MEM_guardedalloc.h"
 
+#include "opensubdiv_capi_type.h"
+
 /* =============================================================================
  * Subdivision context.
  */
@@ -417,7 +419,20 @@ static void loop_interpolation_end(LoopsForInterpolation *loop_interpolation)
  * TLS.
  */
 
+/* Inner vertices are gathered and evaluated in batches, which is cheaper than evaluating them one
+ * by one: evaluator is only set up once per batch. */
+#define SUBDIV_MESH_EVAL_BATCH_SIZE 128
+
+typedef struct SubdivMeshEvalBatch {
+  OpenSubdiv_PatchCoord patch_coords[SUBDIV_MESH_EVAL_BATCH_SIZE];
+  int subdiv_vertex_indices[SUBDIV_MESH_EVAL_BATCH_SIZE];
+  int num_points;
+} SubdivMeshEvalBatch;
+
 typedef struct SubdivMeshTLS {
+  const SubdivMeshContext *ctx;
+  SubdivMeshEvalBatch eval_batch;
+
   bool vertex_interpolation_initialized;
   VerticesForInterpolation vertex_interpolation;
   const MPoly *vertex_interpolation_coarse_poly;
@@ -429,9 +444,14 @@ typedef struct SubdivMeshTLS {
   int loop_interpolation_coarse_corner;
 } SubdivMeshTLS;
 
+static void subdiv_mesh_eval_batch_flush(const SubdivMeshContext *ctx,
+                                         SubdivMeshEvalBatch *batch);
+
 static void subdiv_mesh_tls_free(void *tls_v)
 {
   SubdivMeshTLS *tls = tls_v;
+  /* Evaluate vertices remaining from the traversal done by this thread. */
+  subdiv_mesh_eval_batch_flush(tls->ctx, &tls->eval_batch);
   if (tls->vertex_interpolation_initialized) {
     vertex_interpolation_end(&tls->vertex_interpolation);
   }
@@ -444,18 +464,52 @@ static void subdiv_mesh_tls_free(void *tls_v)
  * Evaluation helper functions.
  */
 
-static void eval_final_point_and_vertex_normal(Subdiv *subdiv,
-                                               const int ptex_face_index,
-                                               const float u,
-                                               const float v,
-                                               float r_P[3],
-                                               short r_N[3])
+static void subdiv_mesh_eval_batch_flush(const SubdivMeshContext *ctx,
+                                         SubdivMeshEvalBatch *batch)
 {
-  if (subdiv->displacement_evaluator == NULL) {
-    BKE_subdiv_eval_limit_point_and_short_normal(subdiv, ptex_face_index, u, v, r_P, r_N);
+  if (batch->num_points == 0) {
+    return;
   }
-  else {
-    BKE_subdiv_eval_final_point(subdiv, ptex_face_index, u, v, r_P);
+  Subdiv *subdiv = ctx->subdiv;
+  MVert *subdiv_mvert = ctx->subdiv_mesh->mvert;
+  float P[SUBDIV_MESH_EVAL_BATCH_SIZE][3];
+  float dPdu[SUBDIV_MESH_EVAL_BATCH_SIZE][3], dPdv[SUBDIV_MESH_EVAL_BATCH_SIZE][3];
+  BKE_subdiv_eval_limit_points(subdiv, batch->patch_coords, batch->num_points, P, dPdu, dPdv);
+  for (int i = 0; i < batch->num_points; i++) {
+    MVert *subdiv_vert = &subdiv_mvert[batch->subdiv_vertex_indices[i]];
+    copy_v3_v3(subdiv_vert->co, P[i]);
+    /* Normals can not be evaluated from the limit surface when displacement is used. */
+    if (ctx->have_displacement) {
+      const OpenSubdiv_PatchCoord *patch_coord = &batch->patch_coords[i];
+      float D[3];
+      BKE_subdiv_eval_displacement(
+          subdiv, patch_coord->ptex_face, patch_coord->u, patch_coord->v, dPdu[i], dPdv[i], D);
+      add_v3_v3(subdiv_vert->co, D);
+    }
+    else {
+      float N[3];
+      cross_v3_v3v3(N, dPdu[i], dPdv[i]);
+      normalize_v3(N);
+      normal_float_to_short_v3(subdiv_vert->no, N);
+    }
+  }
+  batch->num_points = 0;
+}
+
+static void subdiv_mesh_eval_batch_add(const SubdivMeshContext *ctx,
+                                       SubdivMeshEvalBatch *batch,
+                                       const int ptex_face_index,
+                                       const float u,
+                                       const float v,
+                                       const int subdiv_vertex_index)
+{
+  OpenSubdiv_PatchCoord *patch_coord = &batch->patch_coords[batch->num_points];
+  patch_coord->ptex_face = ptex_face_index;
+  patch_coord->u = u;
+  patch_coord->v = v;
+  batch->subdiv_vertex_indices[batch->num_points] = subdiv_vertex_index;
+  if (++batch->num_points == SUBDIV_MESH_EVAL_BATCH_SIZE) {
+    subdiv_mesh_eval_batch_flush(ctx, batch);
   }
 }
 
@@ -764,7 +818,6 @@ static void subdiv_mesh_vertex_inner(const SubdivForeachContext *foreach_context
 {
   SubdivMeshContext *ctx = foreach_context->user_data;
   SubdivMeshTLS *tls = tls_v;
-  Subdiv *subdiv = ctx->subdiv;
   const Mesh *coarse_mesh = ctx->coarse_mesh;
   const MPoly *coarse_mpoly = coarse_mesh->mpoly;
   const MPoly *coarse_poly = &coarse_mpoly[coarse_poly_index];
@@ -773,8 +826,9 @@ static void subdiv_mesh_vertex_inner(const SubdivForeachContext *foreach_context
   MVert *subdiv_vert = &subdiv_mvert[subdiv_vertex_index];
   subdiv_mesh_ensure_vertex_interpolation(ctx, tls, coarse_poly, coarse_corner);
   subdiv_vertex_data_interpolate(ctx, subdiv_vert, &tls->vertex_interpolation, u, v);
-  eval_final_point_and_vertex_normal(
-      subdiv, ptex_face_index, u, v, subdiv_vert->co, subdiv_vert->no);
+  /* Coordinate and normal are written when the batch is evaluated, nothing reads them during
+   * traversal. */
+  subdiv_mesh_eval_batch_add(ctx, &tls->eval_batch, ptex_face_index, u, v, subdiv_vertex_index);
   subdiv_mesh_tag_center_vertex(coarse_poly, subdiv_vert, u, v);
 }
 
@@ -1188,6 +1242,7 @@ Mesh *BKE_subdiv_to_mesh(Subdiv *subdiv,
   SubdivForeachContext foreach_context;
   setup_foreach_callbacks(&subdiv_context, &foreach_context);
   SubdivMeshTLS tls = {0};
+  tls.ctx = &subdiv_context;
   foreach_context.user_data = &subdiv_context;
   foreach_context.user_data_tls_size = sizeof(SubdivMeshTLS);
   foreach_context.user_data_tls = &tls;
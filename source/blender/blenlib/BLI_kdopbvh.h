@@ -97,6 +97,9 @@ enum {
 enum {
   /* Use a priority queue to process nodes in the optimal order (for slow callbacks) */
   BVH_NEAREST_OPTIMAL_ORDER = (1 << 0),
+  /* Batch queries: bound each search by the distance to the previous result
+   * (for spatially coherent points, the callback must set BVHTreeNearest.co) */
+  BVH_NEAREST_USE_PREVIOUS = (1 << 1),
 };
 enum {
   /* calculate IsectRayPrecalc data */
@@ -120,6 +123,10 @@ typedef void (*BVHTree_RayCastCallback)(void *userdata,
 /* callback to check if 2 nodes overlap (use thread if intersection results need to be stored) */
 typedef bool (*BVHTree_OverlapCallback)(void *userdata, int index_a, int index_b, int thread);
 
+/* callback to BLI_bvhtree_refit, must call BLI_bvhtree_update_node for the given leaf
+ * (runs from multiple threads) */
+typedef void (*BVHTree_RefitLeafCallback)(void *userdata, BVHTree *tree, int index);
+
 /* callback to range search query */
 typedef void (*BVHTree_RangeQuery)(void *userdata, int index, const float co[3], float dist_sq);
 
@@ -154,6 +161,8 @@ void BLI_bvhtree_balance(BVHTree *tree);
 bool BLI_bvhtree_update_node(
     BVHTree *tree, int index, const float co[3], const float co_moving[3], int numpoints);
 void BLI_bvhtree_update_tree(BVHTree *tree);
+/* threaded update of all leafs followed by update_tree */
+void BLI_bvhtree_refit(BVHTree *tree, BVHTree_RefitLeafCallback refit_leaf_cb, void *userdata);
 
 int BLI_bvhtree_overlap_thread_num(const BVHTree *tree);
 
@@ -193,6 +202,15 @@ int BLI_bvhtree_find_nearest(BVHTree *tree,
                              BVHTree_NearestPointCallback callback,
                              void *userdata);
 
+/* batched find_nearest (threaded), r_nearest is read & written like the nearest argument */
+void BLI_bvhtree_find_nearest_batch(BVHTree *tree,
+                                    const float (*co)[3],
+                                    int co_num,
+                                    BVHTreeNearest *r_nearest,
+                                    BVHTree_NearestPointCallback callback,
+                                    void *userdata,
+                                    int flag);
+
 int BLI_bvhtree_find_nearest_first(BVHTree *tree,
                                    const float co[3],
                                    const float dist_sq,
@@ -215,6 +233,15 @@ int BLI_bvhtree_ray_cast(BVHTree *tree,
                          BVHTree_RayCastCallback callback,
                          void *userdata);
 
+/* batched ray_cast (packets of rays, threaded), r_hit is read & written like the hit argument */
+void BLI_bvhtree_ray_cast_batch(BVHTree *tree,
+                                const BVHTreeRay *rays,
+                                int rays_num,
+                                BVHTreeRayHit *r_hit,
+                                BVHTree_RayCastCallback callback,
+                                void *userdata,
+                                int flag);
+
 void BLI_bvhtree_ray_cast_all_ex(BVHTree *tree,
                                  const float co[3],
                                  const float dir[3],
@@ -49,6 +49,13 @@ int BLI_mempool_len(BLI_mempool *pool) ATTR_NONNULL(1);
 void *BLI_mempool_findelem(BLI_mempool *pool, unsigned int index) ATTR_WARN_UNUSED_RESULT
     ATTR_NONNULL(1);
 
+void *BLI_mempool_alloc_threaded(BLI_mempool *pool, const int thread_id) ATTR_MALLOC
+    ATTR_WARN_UNUSED_RESULT ATTR_NONNULL(1);
+void *BLI_mempool_calloc_threaded(BLI_mempool *pool, const int thread_id) ATTR_MALLOC
+    ATTR_WARN_UNUSED_RESULT ATTR_NONNULL(1);
+void BLI_mempool_free_threaded(BLI_mempool *pool, void *addr, const int thread_id)
+    ATTR_NONNULL(1, 2);
+
 void BLI_mempool_as_table(BLI_mempool *pool, void **data) ATTR_NONNULL(1, 2);
 void **BLI_mempool_as_tableN(BLI_mempool *pool,
                              const char *allocstr) ATTR_MALLOC ATTR_WARN_UNUSED_RESULT
@@ -83,6 +90,15 @@ enum {
    * order of allocation when no chunks have been freed.
    */
   BLI_MEMPOOL_ALLOW_ITER = (1 << 0),
+  /** Allow allocating & freeing from multiple threads at once,
+   * using #BLI_mempool_alloc_threaded & #BLI_mempool_free_threaded.
+   *
+   * \note Each thread keeps its own free list (indexed by the task scheduler's thread ID),
+   * the non-threaded functions use the list of thread 0 (the main thread).
+   * \note Other operations (iteration, clearing...) must not run
+   * while elements are being allocated or freed.
+   */
+  BLI_MEMPOOL_ALLOW_THREADED = (1 << 1),
 };
 
 void BLI_mempool_iternew(BLI_mempool *pool, BLI_mempool_iter *iter) ATTR_NONNULL();
@@ -0,0 +1,262 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#ifndef __BLI_OHASH_H__
+#define __BLI_OHASH_H__
+
+/** \file
+ * \ingroup bli
+ *
+ * OHash is an open-addressing hash-map (unordered key, value pairs),
+ * OSet is the matching 'set' (unordered collection of unique elements).
+ *
+ * Key/value pairs are stored densely in a single array,
+ * a separate slot array maps hashes to indices into it.
+ * Each slot also stores the full hash, so most probes never touch the key.
+ *
+ * Migrating from GHash/GSet
+ * =========================
+ *
+ * The API intentionally mirrors #GHash & #GSet: the same callbacks (#GHashHashFP, #GHashCmpFP,
+ * the ``BLI_ghashutil_`` functions...) are used and functions take the same arguments,
+ * so in most cases switching is a matter of replacing ``ghash`` by ``ohash``.
+ * There are some differences to keep in mind:
+ *
+ * - Pointers returned by #BLI_ohash_lookup_p, #BLI_ohash_ensure_p, ...
+ *   are only valid until the next insertion or removal
+ *   (GHash entries are individually allocated and never move).
+ * - Removing an item moves the last item into its place,
+ *   so items must not be removed while iterating, use #BLI_ohash_pop instead.
+ */
+
+#include "BLI_compiler_attrs.h"
+#include "BLI_ghash.h"
+#include "BLI_sys_types.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct OHash OHash;
+
+struct _OHash_Entry {
+  void *key, *val;
+};
+
+typedef struct OHashIterator {
+  struct _OHash_Entry *entries;
+  unsigned int length;
+  unsigned int index;
+} OHashIterator;
+
+typedef struct OHashIterState {
+  unsigned int index;
+} OHashIterState;
+
+/** \name OHash API
+ *
+ * Defined in ``BLI_ohash.c``
+ * \{ */
+
+OHash *BLI_ohash_new_ex(GHashHashFP hashfp,
+                        GHashCmpFP cmpfp,
+                        const char *info,
+                        const unsigned int nentries_reserve) ATTR_MALLOC ATTR_WARN_UNUSED_RESULT;
+OHash *BLI_ohash_new(GHashHashFP hashfp,
+                     GHashCmpFP cmpfp,
+                     const char *info) ATTR_MALLOC ATTR_WARN_UNUSED_RESULT;
+void BLI_ohash_free(OHash *oh, GHashKeyFreeFP keyfreefp, GHashValFreeFP valfreefp);
+void BLI_ohash_reserve(OHash *oh, const unsigned int nentries_reserve);
+void BLI_ohash_insert(OHash *oh, void *key, void *val);
+bool BLI_ohash_reinsert(
+    OHash *oh, void *key, void *val, GHashKeyFreeFP keyfreefp, GHashValFreeFP valfreefp);
+void *BLI_ohash_replace_key(OHash *oh, void *key);
+void *BLI_ohash_lookup(OHash *oh, const void *key) ATTR_WARN_UNUSED_RESULT;
+void *BLI_ohash_lookup_default(OHash *oh,
+                               const void *key,
+                               void *val_default) ATTR_WARN_UNUSED_RESULT;
+void **BLI_ohash_lookup_p(OHash *oh, const void *key) ATTR_WARN_UNUSED_RESULT;
+bool BLI_ohash_ensure_p(OHash *oh, void *key, void ***r_val) ATTR_WARN_UNUSED_RESULT;
+bool BLI_ohash_ensure_p_ex(OHash *oh, const void *key, void ***r_key, void ***r_val)
+    ATTR_WARN_UNUSED_RESULT;
+bool BLI_ohash_remove(OHash *oh,
+                      const void *key,
+                      GHashKeyFreeFP keyfreefp,
+                      GHashValFreeFP valfreefp);
+void BLI_ohash_clear(OHash *oh, GHashKeyFreeFP keyfreefp, GHashValFreeFP valfreefp);
+void BLI_ohash_clear_ex(OHash *oh,
+                        GHashKeyFreeFP keyfreefp,
+                        GHashValFreeFP valfreefp,
+                        const unsigned int nentries_reserve);
+void *BLI_ohash_popkey(OHash *oh,
+                       const void *key,
+                       GHashKeyFreeFP keyfreefp) ATTR_WARN_UNUSED_RESULT;
+bool BLI_ohash_haskey(OHash *oh, const void *key) ATTR_WARN_UNUSED_RESULT;
+bool BLI_ohash_pop(OHash *oh, OHashIterState *state, void **r_key, void **r_val)
+    ATTR_WARN_UNUSED_RESULT;
+unsigned int BLI_ohash_len(OHash *oh) ATTR_WARN_UNUSED_RESULT;
+
+/** \} */
+
+/** \name OHash Iterator
+ *
+ * Iteration walks the dense entry array, the hash must not be modified while iterating.
+ * \{ */
+
+OHashIterator *BLI_ohashIterator_new(OHash *oh) ATTR_MALLOC ATTR_WARN_UNUSED_RESULT;
+void BLI_ohashIterator_init(OHashIterator *ohi, OHash *oh);
+void BLI_ohashIterator_free(OHashIterator *ohi);
+
+BLI_INLINE void BLI_ohashIterator_step(OHashIterator *ohi)
+{
+  ohi->index++;
+}
+BLI_INLINE bool BLI_ohashIterator_done(OHashIterator *ohi)
+{
+  return ohi->index >= ohi->length;
+}
+BLI_INLINE void *BLI_ohashIterator_getKey(OHashIterator *ohi)
+{
+  return ohi->entries[ohi->index].key;
+}
+BLI_INLINE void *BLI_ohashIterator_getValue(OHashIterator *ohi)
+{
+  return ohi->entries[ohi->index].val;
+}
+BLI_INLINE void **BLI_ohashIterator_getValue_p(OHashIterator *ohi)
+{
+  return &ohi->entries[ohi->index].val;
+}
+
+#define OHASH_ITER(oh_iter_, ohash_) \
+  for (BLI_ohashIterator_init(&oh_iter_, ohash_); BLI_ohashIterator_done(&oh_iter_) == false; \
+       BLI_ohashIterator_step(&oh_iter_))
+
+#define OHASH_ITER_INDEX(oh_iter_, ohash_, i_) \
+  for (BLI_ohashIterator_init(&oh_iter_, ohash_), i_ = 0; \
+       BLI_ohashIterator_done(&oh_iter_) == false; \
+       BLI_ohashIterator_step(&oh_iter_), i_++)
+
+/** \} */
+
+/** \name OSet API
+ *
+ * Internally this is an #OHash whose values are always NULL.
+ * \{ */
+
+typedef struct OSet OSet;
+
+typedef OHashIterator OSetIterator;
+typedef OHashIterState OSetIterState;
+
+OSet *BLI_oset_new_ex(GSetHashFP hashfp,
+                      GSetCmpFP cmpfp,
+                      const char *info,
+                      const unsigned int nentries_reserve) ATTR_MALLOC ATTR_WARN_UNUSED_RESULT;
+OSet *BLI_oset_new(GSetHashFP hashfp,
+                   GSetCmpFP cmpfp,
+                   const char *info) ATTR_MALLOC ATTR_WARN_UNUSED_RESULT;
+void BLI_oset_free(OSet *os, GSetKeyFreeFP keyfreefp);
+void BLI_oset_reserve(OSet *os, const unsigned int nentries_reserve);
+unsigned int BLI_oset_len(OSet *os) ATTR_WARN_UNUSED_RESULT;
+void BLI_oset_insert(OSet *os, void *key);
+bool BLI_oset_add(OSet *os, void *key);
+bool BLI_oset_ensure_p_ex(OSet *os, const void *key, void ***r_key);
+bool BLI_oset_reinsert(OSet *os, void *key, GSetKeyFreeFP keyfreefp);
+void *BLI_oset_replace_key(OSet *os, void *key);
+bool BLI_oset_haskey(OSet *os, const void *key) ATTR_WARN_UNUSED_RESULT;
+void *BLI_oset_lookup(OSet *os, const void *key) ATTR_WARN_UNUSED_RESULT;
+bool BLI_oset_remove(OSet *os, const void *key, GSetKeyFreeFP keyfreefp);
+void *BLI_oset_pop_key(OSet *os, const void *key) ATTR_WARN_UNUSED_RESULT;
+bool BLI_oset_pop(OSet *os, OSetIterState *state, void **r_key) ATTR_WARN_UNUSED_RESULT;
+void BLI_oset_clear(OSet *os, GSetKeyFreeFP keyfreefp);
+void BLI_oset_clear_ex(OSet *os, GSetKeyFreeFP keyfreefp, const unsigned int nentries_reserve);
+
+/* rely on inline api for now */
+BLI_INLINE OSetIterator *BLI_osetIterator_new(OSet *os)
+{
+  return (OSetIterator *)BLI_ohashIterator_new((OHash *)os);
+}
+BLI_INLINE void BLI_osetIterator_init(OSetIterator *osi, OSet *os)
+{
+  BLI_ohashIterator_init((OHashIterator *)osi, (OHash *)os);
+}
+BLI_INLINE void BLI_osetIterator_free(OSetIterator *osi)
+{
+  BLI_ohashIterator_free((OHashIterator *)osi);
+}
+BLI_INLINE void *BLI_osetIterator_getKey(OSetIterator *osi)
+{
+  return BLI_ohashIterator_getKey((OHashIterator *)osi);
+}
+BLI_INLINE void BLI_osetIterator_step(OSetIterator *osi)
+{
+  BLI_ohashIterator_step((OHashIterator *)osi);
+}
+BLI_INLINE bool BLI_osetIterator_done(OSetIterator *osi)
+{
+  return BLI_ohashIterator_done((OHashIterator *)osi);
+}
+
+#define OSET_ITER(os_iter_, oset_) \
+  for (BLI_osetIterator_init(&os_iter_, oset_); BLI_osetIterator_done(&os_iter_) == false; \
+       BLI_osetIterator_step(&os_iter_))
+
+#define OSET_ITER_INDEX(os_iter_, oset_, i_) \
+  for (BLI_osetIterator_init(&os_iter_, oset_), i_ = 0; \
+       BLI_osetIterator_done(&os_iter_) == false; \
+       BLI_osetIterator_step(&os_iter_), i_++)
+
+/** \} */
+
+/** \name OHash/OSet Debugging API's
+ * \{ */
+
+double BLI_ohash_calc_probe_length(OHash *oh, int *r_probe_max);
+double BLI_oset_calc_probe_length(OSet *os, int *r_probe_max);
+
+/** \} */
+
+/** \name Wrapper OHash/OSet Creation Functions
+ * \{ */
+
+OHash *BLI_ohash_ptr_new_ex(const char *info, const unsigned int nentries_reserve)
+    ATTR_MALLOC ATTR_WARN_UNUSED_RESULT;
+OHash *BLI_ohash_ptr_new(const char *info) ATTR_MALLOC ATTR_WARN_UNUSED_RESULT;
+OHash *BLI_ohash_str_new_ex(const char *info, const unsigned int nentries_reserve)
+    ATTR_MALLOC ATTR_WARN_UNUSED_RESULT;
+OHash *BLI_ohash_str_new(const char *info) ATTR_MALLOC ATTR_WARN_UNUSED_RESULT;
+OHash *BLI_ohash_int_new_ex(const char *info, const unsigned int nentries_reserve)
+    ATTR_MALLOC ATTR_WARN_UNUSED_RESULT;
+OHash *BLI_ohash_int_new(const char *info) ATTR_MALLOC ATTR_WARN_UNUSED_RESULT;
+
+OSet *BLI_oset_ptr_new_ex(const char *info, const unsigned int nentries_reserve)
+    ATTR_MALLOC ATTR_WARN_UNUSED_RESULT;
+OSet *BLI_oset_ptr_new(const char *info) ATTR_MALLOC ATTR_WARN_UNUSED_RESULT;
+OSet *BLI_oset_str_new_ex(const char *info, const unsigned int nentries_reserve)
+    ATTR_MALLOC ATTR_WARN_UNUSED_RESULT;
+OSet *BLI_oset_str_new(const char *info) ATTR_MALLOC ATTR_WARN_UNUSED_RESULT;
+OSet *BLI_oset_int_new_ex(const char *info, const unsigned int nentries_reserve)
+    ATTR_MALLOC ATTR_WARN_UNUSED_RESULT;
+OSet *BLI_oset_int_new(const char *info) ATTR_MALLOC ATTR_WARN_UNUSED_RESULT;
+
+/** \} */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __BLI_OHASH_H__ */
@@ -47,6 +47,7 @@
 #include "BLI_stack.h"
 #include "BLI_kdopbvh.h"
 #include "BLI_math.h"
+#include "BLI_math_bits.h"
 #include "BLI_task.h"
 #include "BLI_heap_simple.h"
 
@@ -72,6 +73,17 @@
 #  define KDOPBVH_THREAD_LEAF_THRESHOLD 1024
 #endif
 
+/* Branches with more leafs than this are partitioned and refit using multiple threads,
+ * the top levels of the tree don't have enough branches to keep all threads busy otherwise.
+ * Not lowered for debug builds since it changes the layout of the resulting tree. */
+#define KDOPBVH_THREAD_PARTITION_THRESHOLD (1 << 16)
+
+/* Number of leafs handled by each task of a threaded partition/refit,
+ * a fixed size keeps the resulting tree independent of the number of threads. */
+#define KDOPBVH_PARTITION_CHUNK_SIZE 4096
+/* Number of bins used to narrow down the median in a threaded partition. */
+#define KDOPBVH_PARTITION_BIN_NUM 256
+
 /* -------------------------------------------------------------------- */
 /** \name Struct Definitions
  * \{ */
@@ -657,6 +669,288 @@ static int implicit_needed_branches(int tree_type, int leafs)
   return max_ii(1, (leafs + tree_type - 3) / (tree_type - 1));
 }
 
+/* -------------------------------------------------------------------- */
+/** \name Threaded Partition & Refit
+ *
+ * Branches near the root cover most of the leafs, but there are too few of them
+ * to keep all threads busy when threading over the branches of a level.
+ * Instead, these branches split their own range of leafs into fixed size chunks.
+ *
+ * Partitioning uses a binned selection: a histogram of the split axis values finds the bin
+ * holding the nth element, leafs are scattered to the ranges before, inside and after that bin,
+ * then only the range inside the bin needs to be partitioned further.
+ * \{ */
+
+typedef struct BVHThreadPartition {
+  const BVHTree *tree;
+  BVHNode **leafs_array;
+  /** Scatter destination, as long as `leafs_array`. */
+  BVHNode **leafs_tmp;
+
+  /** Range of leafs being processed. */
+  int begin, end;
+  int axis;
+
+  /** Per chunk data, allocated for the whole `leafs_array`. */
+  float (*chunk_range)[2];
+  int (*chunk_bins)[KDOPBVH_PARTITION_BIN_NUM];
+  int (*chunk_offset)[3];
+  float *chunk_bv;
+
+  float bin_min, bin_scale;
+  /** Bin containing the nth element. */
+  int bin_nth;
+} BVHThreadPartition;
+
+static int bvh_thread_partition_chunk_num(const int begin, const int end)
+{
+  return (end - begin + KDOPBVH_PARTITION_CHUNK_SIZE - 1) / KDOPBVH_PARTITION_CHUNK_SIZE;
+}
+
+static void bvh_thread_partition_init(BVHThreadPartition *data,
+                                      const BVHTree *tree,
+                                      BVHNode **leafs_array,
+                                      const int leafs_num)
+{
+  const size_t chunks_num = (size_t)bvh_thread_partition_chunk_num(0, leafs_num);
+
+  memset(data, 0, sizeof(*data));
+  data->tree = tree;
+  data->leafs_array = leafs_array;
+  data->leafs_tmp = MEM_mallocN(sizeof(*data->leafs_tmp) * (size_t)leafs_num, __func__);
+  data->chunk_range = MEM_mallocN(sizeof(*data->chunk_range) * chunks_num, __func__);
+  data->chunk_bins = MEM_mallocN(sizeof(*data->chunk_bins) * chunks_num, __func__);
+  data->chunk_offset = MEM_mallocN(sizeof(*data->chunk_offset) * chunks_num, __func__);
+  data->chunk_bv = MEM_mallocN(sizeof(*data->chunk_bv) * (size_t)tree->axis * chunks_num,
+                               __func__);
+}
+
+static void bvh_thread_partition_free(BVHThreadPartition *data)
+{
+  MEM_freeN(data->leafs_tmp);
+  MEM_freeN(data->chunk_range);
+  MEM_freeN(data->chunk_bins);
+  MEM_freeN(data->chunk_offset);
+  MEM_freeN(data->chunk_bv);
+}
+
+BLI_INLINE void bvh_thread_partition_chunk(const BVHThreadPartition *data,
+                                           const int chunk,
+                                           int *r_begin,
+                                           int *r_end)
+{
+  *r_begin = data->begin + chunk * KDOPBVH_PARTITION_CHUNK_SIZE;
+  *r_end = min_ii(*r_begin + KDOPBVH_PARTITION_CHUNK_SIZE, data->end);
+}
+
+BLI_INLINE int bvh_thread_partition_bin(const BVHThreadPartition *data, const float value)
+{
+  const float f = (value - data->bin_min) * data->bin_scale;
+  /* Written so NAN ends up in the last bin. */
+  return (f < (float)(KDOPBVH_PARTITION_BIN_NUM - 1)) ? ((f > 0.0f) ? (int)f : 0) :
+                                                        (KDOPBVH_PARTITION_BIN_NUM - 1);
+}
+
+static void bvh_thread_partition_run(BVHThreadPartition *data, TaskParallelRangeFunc func)
+{
+  TaskParallelSettings settings;
+  BLI_parallel_range_settings_defaults(&settings);
+  settings.min_iter_per_thread = 1;
+  BLI_task_parallel_range(
+      0, bvh_thread_partition_chunk_num(data->begin, data->end), data, func, &settings);
+}
+
+static void bvh_thread_partition_range_cb(void *__restrict userdata,
+                                          const int chunk,
+                                          const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  BVHThreadPartition *data = userdata;
+  int begin, end;
+  float min = FLT_MAX, max = -FLT_MAX;
+
+  bvh_thread_partition_chunk(data, chunk, &begin, &end);
+  for (int i = begin; i < end; i++) {
+    const float value = data->leafs_array[i]->bv[data->axis];
+    if (value < min) {
+      min = value;
+    }
+    if (value > max) {
+      max = value;
+    }
+  }
+  data->chunk_range[chunk][0] = min;
+  data->chunk_range[chunk][1] = max;
+}
+
+static void bvh_thread_partition_bins_cb(void *__restrict userdata,
+                                         const int chunk,
+                                         const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  BVHThreadPartition *data = userdata;
+  int *bins = data->chunk_bins[chunk];
+  int begin, end;
+
+  bvh_thread_partition_chunk(data, chunk, &begin, &end);
+  memset(bins, 0, sizeof(*data->chunk_bins));
+  for (int i = begin; i < end; i++) {
+    bins[bvh_thread_partition_bin(data, data->leafs_array[i]->bv[data->axis])]++;
+  }
+}
+
+static void bvh_thread_partition_scatter_cb(void *__restrict userdata,
+                                            const int chunk,
+                                            const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  BVHThreadPartition *data = userdata;
+  int offset[3];
+  int begin, end;
+
+  copy_v3_v3_int(offset, data->chunk_offset[chunk]);
+  bvh_thread_partition_chunk(data, chunk, &begin, &end);
+  for (int i = begin; i < end; i++) {
+    const int bin = bvh_thread_partition_bin(data, data->leafs_array[i]->bv[data->axis]);
+    const int side = (bin < data->bin_nth) ? 0 : ((bin == data->bin_nth) ? 1 : 2);
+    data->leafs_tmp[offset[side]++] = data->leafs_array[i];
+  }
+}
+
+static void bvh_thread_partition_copy_cb(void *__restrict userdata,
+                                         const int chunk,
+                                         const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  BVHThreadPartition *data = userdata;
+  int begin, end;
+
+  bvh_thread_partition_chunk(data, chunk, &begin, &end);
+  memcpy(&data->leafs_array[begin],
+         &data->leafs_tmp[begin],
+         sizeof(*data->leafs_array) * (size_t)(end - begin));
+}
+
+/**
+ * Threaded version of #partition_nth_element, with the same guarantees.
+ * Only the range around \a n is narrowed down using threads,
+ * the remaining range is handed to #partition_nth_element.
+ */
+static void partition_nth_element_threaded(
+    BVHThreadPartition *data, int begin, int end, const int n, const int axis)
+{
+  if (n >= end) {
+    return;
+  }
+
+  data->axis = axis;
+
+  while (end - begin > KDOPBVH_THREAD_PARTITION_THRESHOLD) {
+    int bins_total[KDOPBVH_PARTITION_BIN_NUM] = {0};
+    float min = FLT_MAX, max = -FLT_MAX;
+    int chunk, chunks_num, bin_nth, len_before, len_nth;
+
+    data->begin = begin;
+    data->end = end;
+    chunks_num = bvh_thread_partition_chunk_num(begin, end);
+
+    bvh_thread_partition_run(data, bvh_thread_partition_range_cb);
+    for (chunk = 0; chunk < chunks_num; chunk++) {
+      min = min_ff(min, data->chunk_range[chunk][0]);
+      max = max_ff(max, data->chunk_range[chunk][1]);
+    }
+    if (!(min < max)) {
+      /* All values are equal, any order is partitioned. */
+      return;
+    }
+
+    data->bin_min = min;
+    data->bin_scale = (float)KDOPBVH_PARTITION_BIN_NUM / (max - min);
+    bvh_thread_partition_run(data, bvh_thread_partition_bins_cb);
+
+    for (chunk = 0; chunk < chunks_num; chunk++) {
+      for (int bin = 0; bin < KDOPBVH_PARTITION_BIN_NUM; bin++) {
+        bins_total[bin] += data->chunk_bins[chunk][bin];
+      }
+    }
+
+    /* Find the bin containing the nth element. */
+    len_before = 0;
+    for (bin_nth = 0; bin_nth < KDOPBVH_PARTITION_BIN_NUM - 1; bin_nth++) {
+      if (begin + len_before + bins_total[bin_nth] > n) {
+        break;
+      }
+      len_before += bins_total[bin_nth];
+    }
+    len_nth = bins_total[bin_nth];
+
+    if (len_nth == end - begin) {
+      /* The bins can't tell the values apart (range exceeding float precision). */
+      break;
+    }
+
+    /* Each chunk writes its leafs after the ones written by the chunks before it,
+     * keeping the result independent of the number of threads. */
+    {
+      int offset[3] = {begin, begin + len_before, begin + len_before + len_nth};
+      data->bin_nth = bin_nth;
+      for (chunk = 0; chunk < chunks_num; chunk++) {
+        const int *bins = data->chunk_bins[chunk];
+        copy_v3_v3_int(data->chunk_offset[chunk], offset);
+        for (int bin = 0; bin < KDOPBVH_PARTITION_BIN_NUM; bin++) {
+          offset[(bin < bin_nth) ? 0 : ((bin == bin_nth) ? 1 : 2)] += bins[bin];
+        }
+      }
+    }
+
+    bvh_thread_partition_run(data, bvh_thread_partition_scatter_cb);
+    bvh_thread_partition_run(data, bvh_thread_partition_copy_cb);
+
+    begin += len_before;
+    end = begin + len_nth;
+  }
+
+  partition_nth_element(data->leafs_array, begin, end, n, axis);
+}
+
+static void bvh_thread_refit_cb(void *__restrict userdata,
+                                const int chunk,
+                                const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  BVHThreadPartition *data = userdata;
+  BVHNode node_chunk = {NULL};
+  int begin, end;
+
+  node_chunk.bv = &data->chunk_bv[chunk * data->tree->axis];
+  bvh_thread_partition_chunk(data, chunk, &begin, &end);
+  refit_kdop_hull(data->tree, &node_chunk, begin, end);
+}
+
+/**
+ * Threaded version of #refit_kdop_hull.
+ */
+static void refit_kdop_hull_threaded(BVHThreadPartition *data,
+                                     BVHNode *node,
+                                     const int start,
+                                     const int end)
+{
+  const BVHTree *tree = data->tree;
+  float *__restrict bv = node->bv;
+  axis_t axis_iter;
+
+  data->begin = start;
+  data->end = end;
+  bvh_thread_partition_run(data, bvh_thread_refit_cb);
+
+  node_minmax_init(tree, node);
+
+  for (int chunk = bvh_thread_partition_chunk_num(start, end); chunk--;) {
+    const float *__restrict chunk_bv = &data->chunk_bv[chunk * tree->axis];
+    for (axis_iter = tree->start_axis; axis_iter < tree->stop_axis; axis_iter++) {
+      bv[(2 * axis_iter)] = min_ff(bv[(2 * axis_iter)], chunk_bv[(2 * axis_iter)]);
+      bv[(2 * axis_iter) + 1] = max_ff(bv[(2 * axis_iter) + 1], chunk_bv[(2 * axis_iter) + 1]);
+    }
+  }
+}
+
+/** \} */
+
 /**
  * This function handles the problem of "sorting" the leafs (along the split_axis).
  *
@@ -667,12 +961,15 @@ static int implicit_needed_branches(int tree_type, int leafs)
  *
  * partition P is described as the elements in the range ( nth[P], nth[P+1] ]
  *
+ * \param thread_data: When non-NULL, partition using multiple threads.
+ *
  * TODO: This can be optimized a bit by doing a specialized nth_element instead of K nth_elements
  */
 static void split_leafs(BVHNode **leafs_array,
                         const int nth[],
                         const int partitions,
-                        const int split_axis)
+                        const int split_axis,
+                        BVHThreadPartition *thread_data)
 {
   int i;
   for (i = 0; i < partitions - 1; i++) {
@@ -680,7 +977,13 @@ static void split_leafs(BVHNode **leafs_array,
       break;
     }
 
-    partition_nth_element(leafs_array, nth[i], nth[partitions], nth[i + 1], split_axis);
+    if (thread_data) {
+      partition_nth_element_threaded(
+          thread_data, nth[i], nth[partitions], nth[i + 1], split_axis);
+    }
+    else {
+      partition_nth_element(leafs_array, nth[i], nth[partitions], nth[i + 1], split_axis);
+    }
   }
 }
 
@@ -693,6 +996,8 @@ typedef struct BVHDivNodesData {
   int tree_offset;
 
   const BVHBuildHelper *data;
+  /** Set for levels with few large branches, see #partition_nth_element_threaded. */
+  BVHThreadPartition *thread_data;
 
   int depth;
   int i;
@@ -714,9 +1019,19 @@ static void non_recursive_bvh_div_nodes_task_cb(void *__restrict userdata,
   int parent_leafs_begin = implicit_leafs_index(data->data, data->depth, parent_level_index);
   int parent_leafs_end = implicit_leafs_index(data->data, data->depth, parent_level_index + 1);
 
+  BVHThreadPartition *thread_data = (data->thread_data && (parent_leafs_end - parent_leafs_begin >
+                                                           KDOPBVH_THREAD_PARTITION_THRESHOLD)) ?
+                                        data->thread_data :
+                                        NULL;
+
   /* This calculates the bounding box of this branch
    * and chooses the largest axis as the axis to divide leafs */
-  refit_kdop_hull(data->tree, parent, parent_leafs_begin, parent_leafs_end);
+  if (thread_data) {
+    refit_kdop_hull_threaded(thread_data, parent, parent_leafs_begin, parent_leafs_end);
+  }
+  else {
+    refit_kdop_hull(data->tree, parent, parent_leafs_begin, parent_leafs_end);
+  }
   split_axis = get_largest_axis(parent->bv);
 
   /* Save split axis (this can be used on raytracing to speedup the query time) */
@@ -735,7 +1050,7 @@ static void non_recursive_bvh_div_nodes_task_cb(void *__restrict userdata,
     nth_positions[k] = implicit_leafs_index(data->data, data->depth + 1, child_level_index);
   }
 
-  split_leafs(data->leafs_array, nth_positions, data->tree_type, split_axis);
+  split_leafs(data->leafs_array, nth_positions, data->tree_type, split_axis, thread_data);
 
   /* Setup children and totnode counters
    * Not really needed but currently most of BVH code
@@ -797,6 +1112,8 @@ static void non_recursive_bvh_div_nodes(const BVHTree *tree,
   const int num_branches = implicit_needed_branches(tree_type, num_leafs);
 
   BVHBuildHelper data;
+  BVHThreadPartition thread_data;
+  const bool use_thread_partition = (num_leafs > KDOPBVH_THREAD_PARTITION_THRESHOLD);
   int depth;
 
   {
@@ -818,6 +1135,10 @@ static void non_recursive_bvh_div_nodes(const BVHTree *tree,
 
   build_implicit_tree_helper(tree, &data);
 
+  if (use_thread_partition) {
+    bvh_thread_partition_init(&thread_data, tree, leafs_array, num_leafs);
+  }
+
   BVHDivNodesData cb_data = {
       .tree = tree,
       .branches_array = branches_array,
@@ -825,6 +1146,7 @@ static void non_recursive_bvh_div_nodes(const BVHTree *tree,
       .tree_type = tree_type,
       .tree_offset = tree_offset,
       .data = &data,
+      .thread_data = NULL,
       .first_of_next_level = 0,
       .depth = 0,
       .i = 0,
@@ -840,21 +1162,29 @@ static void non_recursive_bvh_div_nodes(const BVHTree *tree,
     cb_data.first_of_next_level = first_of_next_level;
     cb_data.i = i;
     cb_data.depth = depth;
+    cb_data.thread_data = (use_thread_partition &&
+                           data.leafs_per_child[depth - 1] > KDOPBVH_THREAD_PARTITION_THRESHOLD) ?
+                              &thread_data :
+                              NULL;
 
-    if (true) {
+    if (cb_data.thread_data == NULL) {
       TaskParallelSettings settings;
       BLI_parallel_range_settings_defaults(&settings);
       settings.use_threading = (num_leafs > KDOPBVH_THREAD_LEAF_THRESHOLD);
       BLI_task_parallel_range(i, i_stop, &cb_data, non_recursive_bvh_div_nodes_task_cb, &settings);
     }
     else {
-      /* Less hassle for debugging. */
+      /* Only a few large branches on this level, each one uses threads for its own leafs. */
       TaskParallelTLS tls = {0};
       for (int i_task = i; i_task < i_stop; i_task++) {
         non_recursive_bvh_div_nodes_task_cb(&cb_data, i_task, &tls);
       }
     }
   }
+
+  if (use_thread_partition) {
+    bvh_thread_partition_free(&thread_data);
+  }
 }
 
 /** \} */
@@ -1032,6 +1362,15 @@ bool BLI_bvhtree_update_node(
   return true;
 }
 
+static void bvhtree_update_tree_level_cb(void *__restrict userdata,
+                                         const int j,
+                                         const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  BVHTree *tree = userdata;
+  /* Branch `j` of the implicit tree, see #BLI_bvhtree_balance. */
+  node_join(tree, tree->nodes[tree->totleaf + j - 1]);
+}
+
 /* call BLI_bvhtree_update_node() first for every node/point/triangle */
 void BLI_bvhtree_update_tree(BVHTree *tree)
 {
@@ -1039,13 +1378,71 @@ void BLI_bvhtree_update_tree(BVHTree *tree)
    * TRICKY: the way we build the tree all the childs have an index greater than the parent
    * This allows us todo a bottom up update by starting on the bigger numbered branch */
 
-  BVHNode **root = tree->nodes + tree->totleaf;
-  BVHNode **index = tree->nodes + tree->totleaf + tree->totbranch - 1;
+  if (tree->totbranch <= KDOPBVH_THREAD_LEAF_THRESHOLD) {
+    BVHNode **root = tree->nodes + tree->totleaf;
+    BVHNode **index = tree->nodes + tree->totleaf + tree->totbranch - 1;
+
+    for (; index >= root; index--) {
+      node_join(tree, *index);
+    }
+  }
+  else {
+    /* The children of a branch are always on the next level of the implicit tree,
+     * so all branches of a level can be joined at once, starting from the deepest level. */
+    const int tree_offset = 2 - tree->tree_type;
+    int level_first[32];
+    int levels_num = 0;
+
+    for (int i = 1; i <= tree->totbranch; i = i * tree->tree_type + tree_offset) {
+      level_first[levels_num++] = i;
+    }
+
+    TaskParallelSettings settings;
+    BLI_parallel_range_settings_defaults(&settings);
 
-  for (; index >= root; index--) {
-    node_join(tree, *index);
+    for (int level = levels_num - 1; level >= 0; level--) {
+      const int i_stop = (level + 1 < levels_num) ? level_first[level + 1] : tree->totbranch + 1;
+      BLI_task_parallel_range(
+          level_first[level], i_stop, tree, bvhtree_update_tree_level_cb, &settings);
+    }
   }
 }
+
+typedef struct BVHRefitData {
+  BVHTree *tree;
+  BVHTree_RefitLeafCallback refit_leaf_cb;
+  void *userdata;
+} BVHRefitData;
+
+static void bvhtree_refit_leaf_cb(void *__restrict userdata,
+                                  const int index,
+                                  const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  BVHRefitData *data = userdata;
+  data->refit_leaf_cb(data->userdata, data->tree, index);
+}
+
+/**
+ * Update the bounds of all leafs and refit the tree in-place, using multiple threads.
+ *
+ * \param refit_leaf_cb: Called once for every leaf (by insertion order),
+ * it must call #BLI_bvhtree_update_node for this leaf only.
+ */
+void BLI_bvhtree_refit(BVHTree *tree, BVHTree_RefitLeafCallback refit_leaf_cb, void *userdata)
+{
+  BVHRefitData data = {
+      .tree = tree,
+      .refit_leaf_cb = refit_leaf_cb,
+      .userdata = userdata,
+  };
+
+  TaskParallelSettings settings;
+  BLI_parallel_range_settings_defaults(&settings);
+  settings.use_threading = (tree->totleaf > KDOPBVH_THREAD_LEAF_THRESHOLD);
+  BLI_task_parallel_range(0, tree->totleaf, &data, bvhtree_refit_leaf_cb, &settings);
+
+  BLI_bvhtree_update_tree(tree);
+}
 /**
  * Number of times #BLI_bvhtree_insert has been called.
  * mainly useful for asserts functions to check we added the correct number.
@@ -1568,6 +1965,82 @@ int BLI_bvhtree_find_nearest(BVHTree *tree,
   return BLI_bvhtree_find_nearest_ex(tree, co, nearest, callback, userdata, 0);
 }
 
+typedef struct BVHNearestBatchData {
+  BVHTree *tree;
+  const float (*co)[3];
+  BVHTreeNearest *nearest;
+  BVHTree_NearestPointCallback callback;
+  void *userdata;
+  int flag;
+} BVHNearestBatchData;
+
+typedef struct BVHNearestBatchTLS {
+  /** Result of the previous query on this thread, see #BVH_NEAREST_USE_PREVIOUS. */
+  float co_prev[3];
+  bool use_prev;
+} BVHNearestBatchTLS;
+
+static void bvhtree_find_nearest_batch_cb(void *__restrict userdata,
+                                          const int i,
+                                          const TaskParallelTLS *__restrict tls)
+{
+  BVHNearestBatchData *data = userdata;
+  BVHNearestBatchTLS *data_tls = tls->userdata_chunk;
+  BVHTreeNearest *nearest = &data->nearest[i];
+  const float dist_sq_orig = nearest->dist_sq;
+
+  if (data_tls->use_prev) {
+    /* The previous result lies on the geometry, so the nearest point can't be further away.
+     * Pad the distance so rounding can't skip a result at exactly this distance. */
+    const float dist_sq_prev = len_squared_v3v3(data->co[i], data_tls->co_prev);
+    nearest->dist_sq = min_ff(nearest->dist_sq, dist_sq_prev * 1.0001f + FLT_EPSILON);
+  }
+
+  BLI_bvhtree_find_nearest_ex(
+      data->tree, data->co[i], nearest, data->callback, data->userdata, data->flag);
+
+  if (nearest->index == -1) {
+    nearest->dist_sq = dist_sq_orig;
+  }
+  else if (data->flag & BVH_NEAREST_USE_PREVIOUS) {
+    copy_v3_v3(data_tls->co_prev, nearest->co);
+    data_tls->use_prev = true;
+  }
+}
+
+/**
+ * Run #BLI_bvhtree_find_nearest_ex for many points at once, using multiple threads.
+ *
+ * \param r_nearest: Array of \a co_num items, read and written like the `nearest` argument
+ * of #BLI_bvhtree_find_nearest_ex (initialize `index` and `dist_sq` before calling).
+ * \param callback: Must be thread-safe.
+ */
+void BLI_bvhtree_find_nearest_batch(BVHTree *tree,
+                                    const float (*co)[3],
+                                    const int co_num,
+                                    BVHTreeNearest *r_nearest,
+                                    BVHTree_NearestPointCallback callback,
+                                    void *userdata,
+                                    const int flag)
+{
+  BVHNearestBatchData data = {
+      .tree = tree,
+      .co = co,
+      .nearest = r_nearest,
+      .callback = callback,
+      .userdata = userdata,
+      .flag = flag,
+  };
+  BVHNearestBatchTLS data_tls = {{0.0f}};
+
+  TaskParallelSettings settings;
+  BLI_parallel_range_settings_defaults(&settings);
+  settings.use_threading = (co_num > KDOPBVH_THREAD_LEAF_THRESHOLD);
+  settings.userdata_chunk = &data_tls;
+  settings.userdata_chunk_size = sizeof(data_tls);
+  BLI_task_parallel_range(0, co_num, &data, bvhtree_find_nearest_batch_cb, &settings);
+}
+
 /** \} */
 
 /* -------------------------------------------------------------------- */
@@ -1737,6 +2210,18 @@ static float fast_ray_nearest_hit(const BVHRayCastData *data, const BVHNode *nod
   }
 }
 
+static void raycast_leaf(BVHRayCastData *data, const BVHNode *node, const float dist)
+{
+  if (data->callback) {
+    data->callback(data->userdata, node->index, &data->ray, &data->hit);
+  }
+  else {
+    data->hit.index = node->index;
+    data->hit.dist = dist;
+    madd_v3_v3v3fl(data->hit.co, data->ray.origin, data->ray.direction, dist);
+  }
+}
+
 static void dfs_raycast(BVHRayCastData *data, BVHNode *node)
 {
   int i;
@@ -1751,14 +2236,7 @@ static void dfs_raycast(BVHRayCastData *data, BVHNode *node)
   }
 
   if (node->totnode == 0) {
-    if (data->callback) {
-      data->callback(data->userdata, node->index, &data->ray, &data->hit);
-    }
-    else {
-      data->hit.index = node->index;
-      data->hit.dist = dist;
-      madd_v3_v3v3fl(data->hit.co, data->ray.origin, data->ray.direction, dist);
-    }
+    raycast_leaf(data, node, dist);
   }
   else {
     /* pick loop direction to dive into the tree (based on ray direction and split axis) */
@@ -1989,6 +2467,210 @@ void BLI_bvhtree_ray_cast_all(BVHTree *tree,
 
 /** \} */
 
+/* -------------------------------------------------------------------- */
+/** \name BLI_bvhtree_ray_cast_batch
+ *
+ * Rays are traversed in packets: a node is visited once for all the rays of a packet
+ * that still reach it, testing the bounds of all these rays at once.
+ * The packet is stored as a structure of arrays so the compiler can vectorize this test,
+ * leafs use the same tests as #dfs_raycast so results match #BLI_bvhtree_ray_cast_ex.
+ *
+ * \{ */
+
+/* Number of rays traversed together, also limited by the bits of the lane mask. */
+#define BVH_RAY_PACKET_SIZE 8
+
+typedef struct BVHRayPacket {
+  /* Per ray values used by the bounds test, indexed by lane. */
+  float origin[3][BVH_RAY_PACKET_SIZE];
+  float idot_axis[3][BVH_RAY_PACKET_SIZE];
+  float radius[BVH_RAY_PACKET_SIZE];
+  /** Copy of `data[lane].hit.dist`. */
+  float dist[BVH_RAY_PACKET_SIZE];
+
+  BVHRayCastData data[BVH_RAY_PACKET_SIZE];
+  int rays_num;
+} BVHRayPacket;
+
+/**
+ * Return the lanes of \a mask whose ray may hit the bounding volume \a bv.
+ * Conservative compared to #fast_ray_nearest_hit & #ray_nearest_hit (only used to cull branches).
+ */
+static uint ray_packet_test(const BVHRayPacket *packet, const float *bv, const uint mask)
+{
+  float t_near[BVH_RAY_PACKET_SIZE], t_far[BVH_RAY_PACKET_SIZE];
+  uint result = 0;
+  int lane;
+
+  for (lane = 0; lane < BVH_RAY_PACKET_SIZE; lane++) {
+    t_near[lane] = -FLT_MAX;
+    t_far[lane] = FLT_MAX;
+  }
+
+  for (int i = 0; i < 3; i++) {
+    const float bv_min = bv[2 * i], bv_max = bv[2 * i + 1];
+    for (lane = 0; lane < BVH_RAY_PACKET_SIZE; lane++) {
+      const float t1 = (bv_min - packet->radius[lane] - packet->origin[i][lane]) *
+                       packet->idot_axis[i][lane];
+      const float t2 = (bv_max + packet->radius[lane] - packet->origin[i][lane]) *
+                       packet->idot_axis[i][lane];
+      t_near[lane] = max_ff(t_near[lane], min_ff(t1, t2));
+      t_far[lane] = min_ff(t_far[lane], max_ff(t1, t2));
+    }
+  }
+
+  for (lane = 0; lane < BVH_RAY_PACKET_SIZE; lane++) {
+    if ((t_near[lane] <= t_far[lane]) && (t_far[lane] >= 0.0f) &&
+        (t_near[lane] < packet->dist[lane])) {
+      result |= 1u << lane;
+    }
+  }
+  return result & mask;
+}
+
+static void dfs_raycast_packet(BVHRayPacket *packet, const BVHNode *node, uint mask)
+{
+  int i;
+
+  mask = ray_packet_test(packet, node->bv, mask);
+  if (mask == 0) {
+    return;
+  }
+
+  if (node->totnode == 0) {
+    for (int lane = 0; lane < packet->rays_num; lane++) {
+      if (mask & (1u << lane)) {
+        BVHRayCastData *data = &packet->data[lane];
+        const float dist = (data->ray.radius == 0.0f) ? fast_ray_nearest_hit(data, node) :
+                                                        ray_nearest_hit(data, node->bv);
+        if (dist < data->hit.dist) {
+          raycast_leaf(data, node, dist);
+          packet->dist[lane] = data->hit.dist;
+        }
+      }
+    }
+  }
+  else {
+    /* pick loop direction to dive into the tree (based on the first ray still active) */
+    const BVHRayCastData *data = &packet->data[bitscan_forward_uint(mask)];
+    if (data->ray_dot_axis[node->main_axis] > 0.0f) {
+      for (i = 0; i != node->totnode; i++) {
+        dfs_raycast_packet(packet, node->children[i], mask);
+      }
+    }
+    else {
+      for (i = node->totnode - 1; i >= 0; i--) {
+        dfs_raycast_packet(packet, node->children[i], mask);
+      }
+    }
+  }
+}
+
+typedef struct BVHRayCastBatchData {
+  BVHTree *tree;
+  const BVHTreeRay *rays;
+  int rays_num;
+  BVHTreeRayHit *hit;
+  BVHTree_RayCastCallback callback;
+  void *userdata;
+  int flag;
+} BVHRayCastBatchData;
+
+static void bvhtree_ray_cast_batch_cb(void *__restrict userdata,
+                                      const int packet_index,
+                                      const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  const BVHRayCastBatchData *batch = userdata;
+  const int ray_first = packet_index * BVH_RAY_PACKET_SIZE;
+  BVHRayPacket packet;
+  int lane;
+
+  packet.rays_num = min_ii(BVH_RAY_PACKET_SIZE, batch->rays_num - ray_first);
+
+  for (lane = 0; lane < BVH_RAY_PACKET_SIZE; lane++) {
+    if (lane < packet.rays_num) {
+      const BVHTreeRay *ray = &batch->rays[ray_first + lane];
+      BVHRayCastData *data = &packet.data[lane];
+
+      BLI_ASSERT_UNIT_V3(ray->direction);
+
+      data->tree = batch->tree;
+      data->callback = batch->callback;
+      data->userdata = batch->userdata;
+      copy_v3_v3(data->ray.origin, ray->origin);
+      copy_v3_v3(data->ray.direction, ray->direction);
+      data->ray.radius = ray->radius;
+      bvhtree_ray_cast_data_precalc(data, batch->flag);
+      data->hit = batch->hit[ray_first + lane];
+
+      for (int i = 0; i < 3; i++) {
+        packet.origin[i][lane] = ray->origin[i];
+        packet.idot_axis[i][lane] = data->idot_axis[i];
+      }
+      packet.radius[lane] = ray->radius;
+      packet.dist[lane] = data->hit.dist;
+    }
+    else {
+      /* Unused lanes are masked out, only keep the values valid. */
+      for (int i = 0; i < 3; i++) {
+        packet.origin[i][lane] = 0.0f;
+        packet.idot_axis[i][lane] = 0.0f;
+      }
+      packet.radius[lane] = 0.0f;
+      packet.dist[lane] = 0.0f;
+    }
+  }
+
+  dfs_raycast_packet(
+      &packet, batch->tree->nodes[batch->tree->totleaf], (1u << packet.rays_num) - 1);
+
+  for (lane = 0; lane < packet.rays_num; lane++) {
+    batch->hit[ray_first + lane] = packet.data[lane].hit;
+  }
+}
+
+/**
+ * Run #BLI_bvhtree_ray_cast_ex for many rays at once, using packets of rays and multiple threads.
+ * Neighboring rays should be coherent (similar origin & direction) to benefit from packets.
+ *
+ * \param r_hit: Array of \a rays_num items, read and written like the `hit` argument
+ * of #BLI_bvhtree_ray_cast_ex (initialize `index` and `dist` before calling).
+ * \param callback: Must be thread-safe.
+ */
+void BLI_bvhtree_ray_cast_batch(BVHTree *tree,
+                                const BVHTreeRay *rays,
+                                const int rays_num,
+                                BVHTreeRayHit *r_hit,
+                                BVHTree_RayCastCallback callback,
+                                void *userdata,
+                                const int flag)
+{
+  BVHRayCastBatchData batch = {
+      .tree = tree,
+      .rays = rays,
+      .rays_num = rays_num,
+      .hit = r_hit,
+      .callback = callback,
+      .userdata = userdata,
+      .flag = flag,
+  };
+
+  if (tree->nodes[tree->totleaf] == NULL) {
+    return;
+  }
+
+  TaskParallelSettings settings;
+  BLI_parallel_range_settings_defaults(&settings);
+  settings.use_threading = (rays_num > KDOPBVH_THREAD_LEAF_THRESHOLD);
+  BLI_task_parallel_range(0,
+                          (rays_num + BVH_RAY_PACKET_SIZE - 1) / BVH_RAY_PACKET_SIZE,
+                          &batch,
+                          bvhtree_ray_cast_batch_cb,
+                          &settings);
+}
+
+/** \} */
+
 /* -------------------------------------------------------------------- */
 /** \name BLI_bvhtree_range_query
  *
@@ -27,6 +27,8 @@
  * - Freeing chunks.
  * - Iterating over allocated chunks
  *   (optionally when using the #BLI_MEMPOOL_ALLOW_ITER flag).
+ * - Allocating & freeing from multiple threads
+ *   (optionally when using the #BLI_MEMPOOL_ALLOW_THREADED flag).
  */
 
 #include <string.h>
@@ -37,6 +39,7 @@
 #include "BLI_utildefines.h"
 
 #include "BLI_mempool.h" /* own include */
+#include "BLI_threads.h" /* For #BLENDER_MAX_THREADS only. */
 
 #include "MEM_guardedalloc.h"
 
@@ -106,6 +109,23 @@ typedef struct BLI_mempool_chunk {
   struct BLI_mempool_chunk *next;
 } BLI_mempool_chunk;
 
+/**
+ * Per-thread state for pools using #BLI_MEMPOOL_ALLOW_THREADED.
+ *
+ * Each thread allocates from and frees into its own list,
+ * only exchanging batches of elements with #BLI_mempool.free when running out or
+ * holding too many, so the common case needs neither locks nor atomic operations.
+ */
+typedef struct BLI_mempool_thread {
+  /** Free element list, private to this thread. */
+  BLI_freenode *free;
+  uint free_len;
+  /** Elements allocated minus elements freed by this thread (may be negative). */
+  int totused;
+  /** Avoid false sharing between threads. */
+  char _pad[64 - sizeof(BLI_freenode *) - sizeof(uint) - sizeof(int)];
+} BLI_mempool_thread;
+
 /**
  * The mempool, stores and tracks memory \a chunks and elements within those chunks \a free.
  */
@@ -135,6 +155,19 @@ struct BLI_mempool {
   /** Number of elements allocated in total. */
   uint totalloc;
 #endif
+
+  /**
+   * Only for #BLI_MEMPOOL_ALLOW_THREADED, indexed by thread ID,
+   * each thread's state is allocated on first use.
+   */
+  BLI_mempool_thread **threads;
+  /** One more than the highest thread ID in use. */
+  uint threads_len;
+  /**
+   * Spin lock protecting #BLI_mempool.free and the chunk list for threaded pools.
+   * Not a #SpinLock as `makesdna` builds this file without the rest of BLI.
+   */
+  uint32_t threads_lock;
 };
 
 #define MEMPOOL_ELEM_SIZE_MIN (sizeof(void *) * 2)
@@ -184,6 +217,40 @@ static BLI_mempool_chunk *mempool_chunk_alloc(BLI_mempool *pool)
   return MEM_mallocN(sizeof(BLI_mempool_chunk) + (size_t)pool->csize, "BLI_Mempool Chunk");
 }
 
+/**
+ * Link all elements of \a mpchunk into a free list.
+ *
+ * \return The last element of the list (its next pointer is NULL).
+ */
+static BLI_freenode *mempool_chunk_init_nodes(BLI_mempool *pool, BLI_mempool_chunk *mpchunk)
+{
+  const uint esize = pool->esize;
+  BLI_freenode *curnode = CHUNK_DATA(mpchunk);
+  uint j;
+
+  /* loop through the allocated data, building the pointer structures */
+  j = pool->pchunk;
+  if (pool->flag & BLI_MEMPOOL_ALLOW_ITER) {
+    while (j--) {
+      curnode->next = NODE_STEP_NEXT(curnode);
+      curnode->freeword = FREEWORD;
+      curnode = curnode->next;
+    }
+  }
+  else {
+    while (j--) {
+      curnode->next = NODE_STEP_NEXT(curnode);
+      curnode = curnode->next;
+    }
+  }
+
+  /* terminate the list (rewind one) */
+  curnode = NODE_STEP_PREV(curnode);
+  curnode->next = NULL;
+
+  return curnode;
+}
+
 /**
  * Initialize a chunk and add into \a pool->chunks
  *
@@ -197,9 +264,7 @@ static BLI_freenode *mempool_chunk_add(BLI_mempool *pool,
                                        BLI_mempool_chunk *mpchunk,
                                        BLI_freenode *last_tail)
 {
-  const uint esize = pool->esize;
   BLI_freenode *curnode = CHUNK_DATA(mpchunk);
-  uint j;
 
   /* append */
   if (pool->chunk_tail) {
@@ -217,26 +282,8 @@ static BLI_freenode *mempool_chunk_add(BLI_mempool *pool,
     pool->free = curnode;
   }
 
-  /* loop through the allocated data, building the pointer structures */
-  j = pool->pchunk;
-  if (pool->flag & BLI_MEMPOOL_ALLOW_ITER) {
-    while (j--) {
-      curnode->next = NODE_STEP_NEXT(curnode);
-      curnode->freeword = FREEWORD;
-      curnode = curnode->next;
-    }
-  }
-  else {
-    while (j--) {
-      curnode->next = NODE_STEP_NEXT(curnode);
-      curnode = curnode->next;
-    }
-  }
-
-  /* terminate the list (rewind one)
-   * will be overwritten if 'curnode' gets passed in again as 'last_tail' */
-  curnode = NODE_STEP_PREV(curnode);
-  curnode->next = NULL;
+  /* Will be overwritten if 'curnode' gets passed in again as 'last_tail'. */
+  curnode = mempool_chunk_init_nodes(pool, mpchunk);
 
 #ifdef USE_TOTALLOC
   pool->totalloc += pool->pchunk;
@@ -265,6 +312,33 @@ static void mempool_chunk_free_all(BLI_mempool_chunk *mpchunk)
   }
 }
 
+static void mempool_threads_reset(BLI_mempool *pool)
+{
+  for (uint i = 0; i < pool->threads_len; i++) {
+    if (pool->threads[i]) {
+      memset(pool->threads[i], 0, sizeof(*pool->threads[i]));
+    }
+  }
+}
+
+/**
+ * Number of elements in use, including the ones counted by each thread.
+ */
+static uint mempool_totused(const BLI_mempool *pool)
+{
+  if (pool->threads == NULL) {
+    return pool->totused;
+  }
+  int totused = (int)pool->totused;
+  for (uint i = 0; i < pool->threads_len; i++) {
+    if (pool->threads[i]) {
+      totused += pool->threads[i]->totused;
+    }
+  }
+  BLI_assert(totused >= 0);
+  return (uint)totused;
+}
+
 BLI_mempool *BLI_mempool_create(uint esize, uint totelem, uint pchunk, uint flag)
 {
   BLI_mempool *pool;
@@ -316,6 +390,15 @@ BLI_mempool *BLI_mempool_create(uint esize, uint totelem, uint pchunk, uint flag
 #endif
   pool->totused = 0;
 
+  pool->threads = NULL;
+  pool->threads_len = 0;
+  pool->threads_lock = 0;
+  if (flag & BLI_MEMPOOL_ALLOW_THREADED) {
+    /* Thread ID's used by the task scheduler (the main thread is 0). */
+    pool->threads = MEM_callocN(sizeof(*pool->threads) * BLENDER_MAX_THREADS,
+                                "BLI_Mempool threads");
+  }
+
   if (totelem) {
     /* Allocate the actual chunks. */
     for (i = 0; i < maxchunks; i++) {
@@ -335,6 +418,10 @@ void *BLI_mempool_alloc(BLI_mempool *pool)
 {
   BLI_freenode *free_pop;
 
+  if (pool->threads) {
+    return BLI_mempool_alloc_threaded(pool, 0);
+  }
+
   if (UNLIKELY(pool->free == NULL)) {
     /* Need to allocate a new chunk. */
     BLI_mempool_chunk *mpchunk = mempool_chunk_alloc(pool);
@@ -375,6 +462,11 @@ void BLI_mempool_free(BLI_mempool *pool, void *addr)
 {
   BLI_freenode *newhead = addr;
 
+  if (pool->threads) {
+    BLI_mempool_free_threaded(pool, addr, 0);
+    return;
+  }
+
 #ifndef NDEBUG
   {
     BLI_mempool_chunk *chunk;
@@ -451,16 +543,227 @@ void BLI_mempool_free(BLI_mempool *pool, void *addr)
   }
 }
 
+/* -------------------------------------------------------------------- */
+/** \name Threaded Allocation
+ *
+ * For pools created with #BLI_MEMPOOL_ALLOW_THREADED.
+ * \{ */
+
+BLI_INLINE void mempool_threads_lock(BLI_mempool *pool)
+{
+  while (atomic_cas_uint32(&pool->threads_lock, 0, 1) != 0) {
+    /* pass */
+  }
+}
+
+BLI_INLINE void mempool_threads_unlock(BLI_mempool *pool)
+{
+  atomic_cas_uint32(&pool->threads_lock, 1, 0);
+}
+
+static BLI_mempool_thread *mempool_thread_add(BLI_mempool *pool, const int thread_id)
+{
+  BLI_mempool_thread *mpthread = MEM_mallocN_aligned(sizeof(*mpthread), 64, __func__);
+  memset(mpthread, 0, sizeof(*mpthread));
+
+  mempool_threads_lock(pool);
+  pool->threads[thread_id] = mpthread;
+  pool->threads_len = MAX2(pool->threads_len, (uint)thread_id + 1);
+  mempool_threads_unlock(pool);
+
+  return mpthread;
+}
+
+BLI_INLINE BLI_mempool_thread *mempool_thread_get(BLI_mempool *pool, const int thread_id)
+{
+  BLI_assert(pool->flag & BLI_MEMPOOL_ALLOW_THREADED);
+  BLI_assert(thread_id >= 0 && thread_id < BLENDER_MAX_THREADS);
+  BLI_mempool_thread *mpthread = pool->threads[thread_id];
+  if (UNLIKELY(mpthread == NULL)) {
+    mpthread = mempool_thread_add(pool, thread_id);
+  }
+  return mpthread;
+}
+
+/**
+ * Give \a mpthread free elements, taking them from the shared free list when possible,
+ * otherwise allocating a new chunk.
+ */
+static void mempool_thread_refill(BLI_mempool *pool, BLI_mempool_thread *mpthread)
+{
+  BLI_assert(mpthread->free == NULL);
+
+  mempool_threads_lock(pool);
+  if (pool->free != NULL) {
+    BLI_freenode *head = pool->free;
+    BLI_freenode *tail = head;
+    uint len = 1;
+    while ((len < pool->pchunk) && tail->next) {
+      tail = tail->next;
+      len++;
+    }
+    pool->free = tail->next;
+    mempool_threads_unlock(pool);
+
+    tail->next = NULL;
+    mpthread->free = head;
+    mpthread->free_len = len;
+    return;
+  }
+  mempool_threads_unlock(pool);
+
+  /* Allocate and initialize outside the lock, only linking the chunk needs to be protected. */
+  BLI_mempool_chunk *mpchunk = mempool_chunk_alloc(pool);
+  mempool_chunk_init_nodes(pool, mpchunk);
+  mpchunk->next = NULL;
+
+  mempool_threads_lock(pool);
+  if (pool->chunk_tail) {
+    pool->chunk_tail->next = mpchunk;
+  }
+  else {
+    BLI_assert(pool->chunks == NULL);
+    pool->chunks = mpchunk;
+  }
+  pool->chunk_tail = mpchunk;
+#ifdef USE_TOTALLOC
+  pool->totalloc += pool->pchunk;
+#endif
+  mempool_threads_unlock(pool);
+
+  mpthread->free = CHUNK_DATA(mpchunk);
+  mpthread->free_len = pool->pchunk;
+}
+
+/**
+ * Return a chunk worth of elements to the shared free list,
+ * so elements freed by one thread can be re-used by others.
+ */
+static void mempool_thread_release(BLI_mempool *pool, BLI_mempool_thread *mpthread)
+{
+  BLI_freenode *head = mpthread->free;
+  BLI_freenode *tail = head;
+  for (uint i = 1; i < pool->pchunk; i++) {
+    tail = tail->next;
+  }
+  mpthread->free = tail->next;
+  mpthread->free_len -= pool->pchunk;
+
+  mempool_threads_lock(pool);
+  tail->next = pool->free;
+  pool->free = head;
+  mempool_threads_unlock(pool);
+}
+
+/**
+ * Allocate an element, may be called from multiple threads at once.
+ *
+ * \param thread_id: Unique for each thread using the pool at the same time,
+ * typically #TaskParallelTLS.thread_id (the main thread uses 0).
+ *
+ * \note The pool must not be iterated over while elements are being allocated from it.
+ */
+void *BLI_mempool_alloc_threaded(BLI_mempool *pool, const int thread_id)
+{
+  BLI_mempool_thread *mpthread = mempool_thread_get(pool, thread_id);
+  BLI_freenode *free_pop;
+
+  if (UNLIKELY(mpthread->free == NULL)) {
+    mempool_thread_refill(pool, mpthread);
+  }
+
+  free_pop = mpthread->free;
+
+  if (pool->flag & BLI_MEMPOOL_ALLOW_ITER) {
+    free_pop->freeword = USEDWORD;
+  }
+
+  mpthread->free = free_pop->next;
+  mpthread->free_len--;
+  mpthread->totused++;
+
+#ifdef WITH_MEM_VALGRIND
+  VALGRIND_MEMPOOL_ALLOC(pool, free_pop, pool->esize);
+#endif
+
+  return (void *)free_pop;
+}
+
+void *BLI_mempool_calloc_threaded(BLI_mempool *pool, const int thread_id)
+{
+  void *retval = BLI_mempool_alloc_threaded(pool, thread_id);
+  memset(retval, 0, (size_t)pool->esize);
+  return retval;
+}
+
+/**
+ * Free an element, may be called from multiple threads at once.
+ * The element doesn't need to be allocated by the same thread.
+ *
+ * \note Unlike #BLI_mempool_free, chunks are kept allocated when the pool becomes empty.
+ */
+void BLI_mempool_free_threaded(BLI_mempool *pool, void *addr, const int thread_id)
+{
+  BLI_mempool_thread *mpthread = mempool_thread_get(pool, thread_id);
+  BLI_freenode *newhead = addr;
+
+#ifndef NDEBUG
+  {
+    BLI_mempool_chunk *chunk;
+    bool found = false;
+    mempool_threads_lock(pool);
+    for (chunk = pool->chunks; chunk; chunk = chunk->next) {
+      if (ARRAY_HAS_ITEM((char *)addr, (char *)CHUNK_DATA(chunk), pool->csize)) {
+        found = true;
+        break;
+      }
+    }
+    mempool_threads_unlock(pool);
+    if (!found) {
+      BLI_assert(!"Attempt to free data which is not in pool.\n");
+    }
+  }
+
+  /* Enable for debugging. */
+  if (UNLIKELY(mempool_debug_memset)) {
+    memset(addr, 255, pool->esize);
+  }
+#endif
+
+  if (pool->flag & BLI_MEMPOOL_ALLOW_ITER) {
+#ifndef NDEBUG
+    /* This will detect double free's. */
+    BLI_assert(newhead->freeword != FREEWORD);
+#endif
+    newhead->freeword = FREEWORD;
+  }
+
+  newhead->next = mpthread->free;
+  mpthread->free = newhead;
+  mpthread->free_len++;
+  mpthread->totused--;
+
+#ifdef WITH_MEM_VALGRIND
+  VALGRIND_MEMPOOL_FREE(pool, addr);
+#endif
+
+  if (UNLIKELY(mpthread->free_len >= pool->pchunk * 2)) {
+    mempool_thread_release(pool, mpthread);
+  }
+}
+
+/** \} */
+
 int BLI_mempool_len(BLI_mempool *pool)
 {
-  return (int)pool->totused;
+  return (int)mempool_totused(pool);
 }
 
 void *BLI_mempool_findelem(BLI_mempool *pool, uint index)
 {
   BLI_assert(pool->flag & BLI_MEMPOOL_ALLOW_ITER);
 
-  if (index < pool->totused) {
+  if (index < mempool_totused(pool)) {
     /* We could have some faster mem chunk stepping code inline. */
     BLI_mempool_iter iter;
     void *elem;
@@ -491,7 +794,7 @@ void BLI_mempool_as_table(BLI_mempool *pool, void **data)
   while ((elem = BLI_mempool_iterstep(&iter))) {
     *p++ = elem;
   }
-  BLI_assert((uint)(p - data) == pool->totused);
+  BLI_assert((uint)(p - data) == mempool_totused(pool));
 }
 
 /**
@@ -499,7 +802,7 @@ void BLI_mempool_as_table(BLI_mempool *pool, void **data)
  */
 void **BLI_mempool_as_tableN(BLI_mempool *pool, const char *allocstr)
 {
-  void **data = MEM_mallocN((size_t)pool->totused * sizeof(void *), allocstr);
+  void **data = MEM_mallocN((size_t)mempool_totused(pool) * sizeof(void *), allocstr);
   BLI_mempool_as_table(pool, data);
   return data;
 }
@@ -518,7 +821,7 @@ void BLI_mempool_as_array(BLI_mempool *pool, void *data)
     memcpy(p, elem, (size_t)esize);
     p = NODE_STEP_NEXT(p);
   }
-  BLI_assert((uint)(p - (char *)data) == pool->totused * esize);
+  BLI_assert((uint)(p - (char *)data) == mempool_totused(pool) * esize);
 }
 
 /**
@@ -526,7 +829,7 @@ void BLI_mempool_as_array(BLI_mempool *pool, void *data)
  */
 void *BLI_mempool_as_arrayN(BLI_mempool *pool, const char *allocstr)
 {
-  char *data = MEM_mallocN((size_t)(pool->totused * pool->esize), allocstr);
+  char *data = MEM_mallocN((size_t)(mempool_totused(pool) * pool->esize), allocstr);
   BLI_mempool_as_array(pool, data);
   return data;
 }
@@ -729,6 +1032,9 @@ void BLI_mempool_clear_ex(BLI_mempool *pool, const int totelem_reserve)
   /* re-initialize */
   pool->free = NULL;
   pool->totused = 0;
+  if (pool->threads) {
+    mempool_threads_reset(pool);
+  }
 #ifdef USE_TOTALLOC
   pool->totalloc = 0;
 #endif
@@ -758,6 +1064,15 @@ void BLI_mempool_destroy(BLI_mempool *pool)
 {
   mempool_chunk_free_all(pool->chunks);
 
+  if (pool->threads) {
+    for (uint i = 0; i < pool->threads_len; i++) {
+      if (pool->threads[i]) {
+        MEM_freeN(pool->threads[i]);
+      }
+    }
+    MEM_freeN(pool->threads);
+  }
+
 #ifdef WITH_MEM_VALGRIND
   VALGRIND_DESTROY_MEMPOOL(pool);
 #endif
@@ -0,0 +1,230 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+/** \file
+ * \ingroup bli
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "MEM_guardedalloc.h"
+
+#include "BLI_fileops.h"
+#include "BLI_listbase.h"
+#include "BLI_mmap.h"
+
+#ifndef WIN32
+#  include <signal.h>
+#  include <sys/mman.h>
+#else
+#  include <io.h>
+#  include <windows.h>
+#endif
+
+struct BLI_mmap_file {
+  /* The address to which the file was mapped. */
+  char *memory;
+
+  /* The length of the file (and therefore the mapped region). */
+  size_t length;
+
+  /* Set when an IO error occurred while accessing the mapping, the data read since then is
+   * zeros and must not be used. */
+  volatile bool io_error;
+
+#ifdef WIN32
+  /* Handle of the file mapping object, needed to close it again. */
+  HANDLE handle;
+#endif
+};
+
+#ifndef WIN32
+/* When the mapped file gets truncated, or its storage goes away (network or removable drives),
+ * accessing the mapping raises SIGBUS instead of returning a read error. Handle it by replacing
+ * the mapping with zeros and flagging the file, so readers can fail gracefully. */
+
+static struct {
+  /* LinkData, data is BLI_mmap_file. */
+  ListBase open_mmaps;
+  bool configured;
+  void (*next_handler)(int, siginfo_t *, void *);
+} sigbus_error_handler = {{NULL, NULL}, false, NULL};
+
+static void sigbus_handler(int sig, siginfo_t *siginfo, void *ptr)
+{
+  char *error_addr = (char *)siginfo->si_addr;
+  LISTBASE_FOREACH (LinkData *, link, &sigbus_error_handler.open_mmaps) {
+    BLI_mmap_file *file = link->data;
+    if (error_addr >= file->memory && error_addr < file->memory + file->length) {
+      file->io_error = true;
+      /* Replace the mapped memory with zeros, the faulting access is retried on return. */
+      if (mmap(file->memory,
+               file->length,
+               PROT_READ,
+               MAP_FIXED | MAP_PRIVATE | MAP_ANONYMOUS,
+               -1,
+               0) == MAP_FAILED) {
+        fprintf(stderr, "SIGBUS handler: error replacing mapped file with zeros\n");
+        abort();
+      }
+      return;
+    }
+  }
+  /* The error does not belong to a mapped file, fall back to the previous handler. */
+  if (sigbus_error_handler.next_handler != NULL) {
+    sigbus_error_handler.next_handler(sig, siginfo, ptr);
+  }
+  else {
+    fprintf(stderr, "Unhandled SIGBUS caught\n");
+    abort();
+  }
+}
+
+static bool sigbus_handler_setup(void)
+{
+  if (!sigbus_error_handler.configured) {
+    struct sigaction newact = {{0}}, oldact = {{0}};
+    newact.sa_sigaction = sigbus_handler;
+    newact.sa_flags = SA_SIGINFO;
+    if (sigaction(SIGBUS, &newact, &oldact) != 0) {
+      return false;
+    }
+    if (oldact.sa_flags & SA_SIGINFO) {
+      sigbus_error_handler.next_handler = oldact.sa_sigaction;
+    }
+    sigbus_error_handler.configured = true;
+  }
+  return true;
+}
+
+static void sigbus_handler_add(BLI_mmap_file *file)
+{
+  BLI_addtail(&sigbus_error_handler.open_mmaps, BLI_genericNodeN(file));
+}
+
+static void sigbus_handler_remove(BLI_mmap_file *file)
+{
+  LinkData *link = BLI_findptr(&sigbus_error_handler.open_mmaps, file, offsetof(LinkData, data));
+  BLI_freelinkN(&sigbus_error_handler.open_mmaps, link);
+}
+#endif
+
+BLI_mmap_file *BLI_mmap_open(int fd)
+{
+  const size_t length = BLI_file_descriptor_size(fd);
+  void *memory;
+
+  /* Mapping an empty file fails, and a (size_t)-1 size means the size is unknown. */
+  if (length == 0 || length == (size_t)-1) {
+    return NULL;
+  }
+
+#ifndef WIN32
+  /* Without the handler an IO error would crash, rather use regular reads then. */
+  if (!sigbus_handler_setup()) {
+    return NULL;
+  }
+
+  memory = mmap(NULL, length, PROT_READ, MAP_PRIVATE, fd, 0);
+  if (memory == MAP_FAILED) {
+    return NULL;
+  }
+#else
+  HANDLE file_handle = (HANDLE)_get_osfhandle(fd);
+  if (file_handle == INVALID_HANDLE_VALUE) {
+    return NULL;
+  }
+  HANDLE handle = CreateFileMapping(file_handle, NULL, PAGE_READONLY, 0, 0, NULL);
+  if (handle == NULL) {
+    return NULL;
+  }
+  memory = MapViewOfFile(handle, FILE_MAP_READ, 0, 0, 0);
+  if (memory == NULL) {
+    CloseHandle(handle);
+    return NULL;
+  }
+#endif
+
+  BLI_mmap_file *file = MEM_callocN(sizeof(BLI_mmap_file), __func__);
+  file->memory = memory;
+  file->length = length;
+#ifdef WIN32
+  file->handle = handle;
+#else
+  sigbus_handler_add(file);
+#endif
+
+  return file;
+}
+
+bool BLI_mmap_read(BLI_mmap_file *file, void *dest, size_t offset, size_t length)
+{
+  /* If the requested range goes beyond the end of the file, fail. */
+  if (offset > file->length || length > file->length - offset) {
+    return false;
+  }
+
+#ifndef WIN32
+  /* If an error occurred in this file, don't even try to read further. */
+  if (file->io_error) {
+    return false;
+  }
+  memcpy(dest, file->memory + offset, length);
+#else
+  /* On Windows, IO errors on mapped memory raise an exception which can be caught here. */
+  __try {
+    memcpy(dest, file->memory + offset, length);
+  }
+  __except (GetExceptionCode() == EXCEPTION_IN_PAGE_ERROR ? EXCEPTION_EXECUTE_HANDLER :
+                                                            EXCEPTION_CONTINUE_SEARCH) {
+    file->io_error = true;
+    return false;
+  }
+#endif
+
+  /* The data copied after an error is zeros, not the file contents. */
+  return !file->io_error;
+}
+
+bool BLI_mmap_any_io_error(const BLI_mmap_file *file)
+{
+  return file->io_error;
+}
+
+const void *BLI_mmap_get_pointer(const BLI_mmap_file *file)
+{
+  return file->memory;
+}
+
+size_t BLI_mmap_get_length(const BLI_mmap_file *file)
+{
+  return file->length;
+}
+
+void BLI_mmap_free(BLI_mmap_file *file)
+{
+#ifndef WIN32
+  munmap((void *)file->memory, file->length);
+  sigbus_handler_remove(file);
+#else
+  UnmapViewOfFile(file->memory);
+  CloseHandle(file->handle);
+#endif
+
+  MEM_freeN(file);
+}
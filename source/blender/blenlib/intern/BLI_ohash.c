@@ -0,0 +1,943 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+/** \file
+ * \ingroup bli
+ *
+ * An open-addressing (key -> value) hash table.
+ *
+ * Layout:
+ * - Entries (key/value pairs) are stored densely in insertion order,
+ *   so iterating is a linear walk over a single array.
+ * - Slots hold the full hash and an index into the entries,
+ *   there are always at least twice as many slots as entries (load factor <= 0.5).
+ *   At 8 bytes per slot, a cache line holds 8 consecutive slots,
+ *   linear probing with the stored hash means a lookup typically reads a single cache line
+ *   and only compares the key (calling #GHashCmpFP) when the full hash matches.
+ * - The slot is found from the high bits of the hash multiplied by the golden ratio
+ *   (fibonacci hashing), which spreads the weak pointer/integer hashes used in Blender
+ *   and avoids the clustering linear probing would otherwise suffer from.
+ * - Removal uses backward-shift deletion, so there are no tombstones
+ *   and lookups never degrade after many removals.
+ *
+ * \note The API matches BLI_ghash.c, but the implementation is different.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "MEM_guardedalloc.h"
+
+#include "BLI_utildefines.h"
+
+#include "BLI_ohash.h"
+
+#include "BLI_strict_flags.h"
+
+typedef struct _OHash_Entry OHashEntry;
+
+typedef struct OHashSlot {
+  uint32_t hash;
+  /** Index into #OHash.entries or #SLOT_EMPTY. */
+  int32_t index;
+} OHashSlot;
+
+struct OHash {
+  GHashHashFP hashfp;
+  GHashCmpFP cmpfp;
+
+  OHashEntry *entries;
+  OHashSlot *slots;
+
+  uint slot_mask;
+  /** Shift applied to the mixed hash to get the home slot. */
+  uint slot_shift;
+  /** The entries capacity is `1 << capacity_exp`, the slots capacity twice that. */
+  uint capacity_exp;
+  uint length;
+};
+
+/* -------------------------------------------------------------------- */
+/** \name Internal Helper Macros & Defines
+ * \{ */
+
+#define ENTRIES_CAPACITY(oh) (uint)(1u << (oh)->capacity_exp)
+#define SLOTS_CAPACITY(oh) (uint)(1u << ((oh)->capacity_exp + 1))
+#define CLEAR_SLOTS(oh) memset((oh)->slots, 0xFF, sizeof(OHashSlot) * SLOTS_CAPACITY(oh))
+
+#define SLOT_EMPTY -1
+
+#define CAPACITY_EXP_DEFAULT 3
+/* Keep the slot shift well defined (the slot count can't exceed 2^31). */
+#define CAPACITY_EXP_MAX 30u
+
+/** Iterate over all slots starting at the home slot of \a HASH. */
+#define ITER_SLOTS(OH, HASH, SLOT) \
+  for (uint SLOT = ohash_slot_home(OH, HASH);; SLOT = (SLOT + 1) & (OH)->slot_mask)
+
+/** \} */
+
+/* -------------------------------------------------------------------- */
+/** \name Internal Utility API
+ * \{ */
+
+BLI_INLINE uint ohash_slot_home(const OHash *oh, const uint hash)
+{
+  /* Knuth's multiplicative hash, the high bits are best mixed. */
+  return (hash * 2654435769u) >> oh->slot_shift;
+}
+
+BLI_INLINE uint ohash_keyhash(const OHash *oh, const void *key)
+{
+  return oh->hashfp(key);
+}
+
+static uint calc_capacity_exp_for_reserve(uint reserve)
+{
+  uint result = 1;
+  while (reserve >>= 1) {
+    result++;
+  }
+  return MIN2(result, CAPACITY_EXP_MAX);
+}
+
+static void ohash_capacity_exp_set(OHash *oh, const uint capacity_exp)
+{
+  oh->capacity_exp = capacity_exp;
+  oh->slot_mask = SLOTS_CAPACITY(oh) - 1;
+  oh->slot_shift = 32 - (capacity_exp + 1);
+}
+
+static void ohash_buffers_alloc(OHash *oh)
+{
+  oh->entries = MEM_malloc_arrayN(ENTRIES_CAPACITY(oh), sizeof(*oh->entries), "OHash entries");
+  oh->slots = MEM_malloc_arrayN(SLOTS_CAPACITY(oh), sizeof(*oh->slots), "OHash slots");
+  CLEAR_SLOTS(oh);
+}
+
+static void ohash_buffers_free(OHash *oh)
+{
+  MEM_freeN(oh->entries);
+  MEM_freeN(oh->slots);
+}
+
+static void ohash_free_entries(OHash *oh, GHashKeyFreeFP keyfreefp, GHashValFreeFP valfreefp)
+{
+  if (keyfreefp || valfreefp) {
+    for (uint i = 0; i < oh->length; i++) {
+      if (keyfreefp) {
+        keyfreefp(oh->entries[i].key);
+      }
+      if (valfreefp) {
+        valfreefp(oh->entries[i].val);
+      }
+    }
+  }
+}
+
+/**
+ * Resize so `1 << capacity_exp` entries fit.
+ * Slots are re-distributed using the stored hashes, keys are not hashed again.
+ */
+static void ohash_resize(OHash *oh, const uint capacity_exp)
+{
+  OHashSlot *slots_old = oh->slots;
+  const uint slots_len_old = SLOTS_CAPACITY(oh);
+
+  ohash_capacity_exp_set(oh, capacity_exp);
+  BLI_assert(oh->length <= ENTRIES_CAPACITY(oh));
+
+  oh->entries = MEM_reallocN(oh->entries, sizeof(*oh->entries) * ENTRIES_CAPACITY(oh));
+  oh->slots = MEM_malloc_arrayN(SLOTS_CAPACITY(oh), sizeof(*oh->slots), "OHash slots");
+  CLEAR_SLOTS(oh);
+
+  for (uint i = 0; i < slots_len_old; i++) {
+    const OHashSlot slot_old = slots_old[i];
+    if (slot_old.index != SLOT_EMPTY) {
+      ITER_SLOTS (oh, slot_old.hash, slot) {
+        if (oh->slots[slot].index == SLOT_EMPTY) {
+          oh->slots[slot] = slot_old;
+          break;
+        }
+      }
+    }
+  }
+  MEM_freeN(slots_old);
+}
+
+BLI_INLINE void ohash_ensure_can_insert(OHash *oh)
+{
+  if (UNLIKELY(oh->length == ENTRIES_CAPACITY(oh))) {
+    BLI_assert(oh->capacity_exp < CAPACITY_EXP_MAX);
+    ohash_resize(oh, oh->capacity_exp + 1);
+  }
+}
+
+/**
+ * \return the slot holding \a key, or the empty slot where it would be inserted.
+ */
+BLI_INLINE uint ohash_lookup_slot(const OHash *oh,
+                                  const void *key,
+                                  const uint hash,
+                                  bool *r_found)
+{
+  ITER_SLOTS (oh, hash, slot) {
+    const OHashSlot *s = &oh->slots[slot];
+    if (s->index == SLOT_EMPTY) {
+      *r_found = false;
+      return slot;
+    }
+    if (s->hash == hash && !oh->cmpfp(key, oh->entries[s->index].key)) {
+      *r_found = true;
+      return slot;
+    }
+  }
+}
+
+BLI_INLINE OHashEntry *ohash_lookup_entry(const OHash *oh, const void *key)
+{
+  const uint hash = ohash_keyhash(oh, key);
+  bool found;
+  const uint slot = ohash_lookup_slot(oh, key, hash, &found);
+  return found ? &oh->entries[oh->slots[slot].index] : NULL;
+}
+
+/**
+ * Find the slot referencing entry \a index, without comparing keys.
+ */
+BLI_INLINE uint ohash_lookup_slot_from_index(const OHash *oh, const uint hash, const uint index)
+{
+  ITER_SLOTS (oh, hash, slot) {
+    BLI_assert(oh->slots[slot].index != SLOT_EMPTY);
+    if (oh->slots[slot].index == (int32_t)index) {
+      return slot;
+    }
+  }
+}
+
+/**
+ * Insert into an empty \a slot (as returned by #ohash_lookup_slot).
+ */
+BLI_INLINE OHashEntry *ohash_insert_at_slot(
+    OHash *oh, const uint slot, const uint hash, void *key, void *val)
+{
+  BLI_assert(oh->slots[slot].index == SLOT_EMPTY);
+  BLI_assert(oh->length < ENTRIES_CAPACITY(oh));
+  OHashEntry *e = &oh->entries[oh->length];
+  e->key = key;
+  e->val = val;
+  oh->slots[slot].hash = hash;
+  oh->slots[slot].index = (int32_t)oh->length;
+  oh->length++;
+  return e;
+}
+
+/**
+ * Lookup \a key, inserting it when not found.
+ * \return true when the key was already in the hash.
+ */
+BLI_INLINE bool ohash_ensure(OHash *oh, const void *key, OHashEntry **r_entry)
+{
+  const uint hash = ohash_keyhash(oh, key);
+  bool found;
+  uint slot = ohash_lookup_slot(oh, key, hash, &found);
+  if (found) {
+    *r_entry = &oh->entries[oh->slots[slot].index];
+    return true;
+  }
+  if (UNLIKELY(oh->length == ENTRIES_CAPACITY(oh))) {
+    ohash_ensure_can_insert(oh);
+    slot = ohash_lookup_slot(oh, key, hash, &found);
+  }
+  *r_entry = ohash_insert_at_slot(oh, slot, hash, (void *)key, NULL);
+  return false;
+}
+
+/**
+ * Backward-shift deletion: move following entries of the cluster into the hole
+ * unless that would place them before their home slot.
+ */
+static void ohash_slot_remove(OHash *oh, uint slot_hole)
+{
+  const uint mask = oh->slot_mask;
+  uint slot = slot_hole;
+  for (;;) {
+    slot = (slot + 1) & mask;
+    const OHashSlot s = oh->slots[slot];
+    if (s.index == SLOT_EMPTY) {
+      break;
+    }
+    const uint home = ohash_slot_home(oh, s.hash);
+    if (((slot - home) & mask) >= ((slot - slot_hole) & mask)) {
+      oh->slots[slot_hole] = s;
+      slot_hole = slot;
+    }
+  }
+  oh->slots[slot_hole].index = SLOT_EMPTY;
+  oh->slots[slot_hole].hash = UINT32_MAX;
+}
+
+/**
+ * Remove the entry referenced by \a slot, filling its place with the last entry.
+ */
+static void ohash_remove_at_slot(OHash *oh, const uint slot)
+{
+  const uint index = (uint)oh->slots[slot].index;
+  const uint index_last = oh->length - 1;
+
+  ohash_slot_remove(oh, slot);
+
+  if (index != index_last) {
+    const uint hash_last = ohash_keyhash(oh, oh->entries[index_last].key);
+    const uint slot_last = ohash_lookup_slot_from_index(oh, hash_last, index_last);
+    oh->slots[slot_last].index = (int32_t)index;
+    oh->entries[index] = oh->entries[index_last];
+  }
+  oh->length--;
+}
+
+static bool ohash_remove(OHash *oh,
+                         const void *key,
+                         GHashKeyFreeFP keyfreefp,
+                         GHashValFreeFP valfreefp,
+                         OHashEntry *r_entry)
+{
+  const uint hash = ohash_keyhash(oh, key);
+  bool found;
+  const uint slot = ohash_lookup_slot(oh, key, hash, &found);
+  if (!found) {
+    return false;
+  }
+  OHashEntry *e = &oh->entries[oh->slots[slot].index];
+  if (keyfreefp) {
+    keyfreefp(e->key);
+  }
+  if (valfreefp) {
+    valfreefp(e->val);
+  }
+  if (r_entry) {
+    *r_entry = *e;
+  }
+  ohash_remove_at_slot(oh, slot);
+  return true;
+}
+
+/**
+ * Remove the last entry (no other entries need to be moved).
+ */
+static bool ohash_pop(OHash *oh, OHashEntry *r_entry)
+{
+  if (oh->length == 0) {
+    return false;
+  }
+  const uint index = oh->length - 1;
+  *r_entry = oh->entries[index];
+  const uint hash = ohash_keyhash(oh, r_entry->key);
+  ohash_slot_remove(oh, ohash_lookup_slot_from_index(oh, hash, index));
+  oh->length--;
+  return true;
+}
+
+static void ohash_clear(OHash *oh, const uint nentries_reserve)
+{
+  const uint capacity_exp = calc_capacity_exp_for_reserve(
+      MAX2(nentries_reserve, 1u << CAPACITY_EXP_DEFAULT));
+  oh->length = 0;
+  if (capacity_exp != oh->capacity_exp) {
+    ohash_buffers_free(oh);
+    ohash_capacity_exp_set(oh, capacity_exp);
+    ohash_buffers_alloc(oh);
+  }
+  else {
+    CLEAR_SLOTS(oh);
+  }
+}
+
+/** \} */
+
+/* -------------------------------------------------------------------- */
+/** \name OHash Public API
+ * \{ */
+
+/**
+ * Creates a new, empty OHash.
+ *
+ * \param hashfp: Hash callback.
+ * \param cmpfp: Comparison callback.
+ * \param info: Identifier string for the OHash.
+ * \param nentries_reserve: Optionally reserve the number of members that the hash will hold.
+ * Use this to avoid resizing buckets if the size is known or can be closely approximated.
+ * \return  An empty OHash.
+ */
+OHash *BLI_ohash_new_ex(GHashHashFP hashfp,
+                        GHashCmpFP cmpfp,
+                        const char *info,
+                        const uint nentries_reserve)
+{
+  OHash *oh = MEM_mallocN(sizeof(*oh), info);
+  oh->hashfp = hashfp;
+  oh->cmpfp = cmpfp;
+  oh->length = 0;
+  ohash_capacity_exp_set(
+      oh, calc_capacity_exp_for_reserve(MAX2(nentries_reserve, 1u << CAPACITY_EXP_DEFAULT)));
+  ohash_buffers_alloc(oh);
+  return oh;
+}
+
+/**
+ * Wraps #BLI_ohash_new_ex with zero entries reserved.
+ */
+OHash *BLI_ohash_new(GHashHashFP hashfp, GHashCmpFP cmpfp, const char *info)
+{
+  return BLI_ohash_new_ex(hashfp, cmpfp, info, 0);
+}
+
+/**
+ * Frees the OHash and its members.
+ *
+ * \param oh: The OHash to free.
+ * \param keyfreefp: Optional callback to free the key.
+ * \param valfreefp: Optional callback to free the value.
+ */
+void BLI_ohash_free(OHash *oh, GHashKeyFreeFP keyfreefp, GHashValFreeFP valfreefp)
+{
+  ohash_free_entries(oh, keyfreefp, valfreefp);
+  ohash_buffers_free(oh);
+  MEM_freeN(oh);
+}
+
+/**
+ * Reserve given amount of entries (resize \a oh accordingly if needed).
+ */
+void BLI_ohash_reserve(OHash *oh, const uint nentries_reserve)
+{
+  const uint capacity_exp = calc_capacity_exp_for_reserve(nentries_reserve);
+  if (capacity_exp > oh->capacity_exp) {
+    ohash_resize(oh, capacity_exp);
+  }
+}
+
+/**
+ * \return size of the OHash.
+ */
+uint BLI_ohash_len(OHash *oh)
+{
+  return oh->length;
+}
+
+/**
+ * Insert a key/value pair into the \a oh.
+ *
+ * \note Duplicates are not checked,
+ * the caller is expected to ensure elements are unique.
+ */
+void BLI_ohash_insert(OHash *oh, void *key, void *val)
+{
+  BLI_assert(!BLI_ohash_haskey(oh, key));
+  ohash_ensure_can_insert(oh);
+  const uint hash = ohash_keyhash(oh, key);
+  ITER_SLOTS (oh, hash, slot) {
+    if (oh->slots[slot].index == SLOT_EMPTY) {
+      ohash_insert_at_slot(oh, slot, hash, key, val);
+      break;
+    }
+  }
+}
+
+/**
+ * Inserts a new value to a key that may already be in ohash.
+ *
+ * Avoids #BLI_ohash_remove, #BLI_ohash_insert calls (double lookups)
+ *
+ * \returns true if a new key has been added.
+ */
+bool BLI_ohash_reinsert(
+    OHash *oh, void *key, void *val, GHashKeyFreeFP keyfreefp, GHashValFreeFP valfreefp)
+{
+  OHashEntry *e;
+  if (ohash_ensure(oh, key, &e)) {
+    if (keyfreefp) {
+      keyfreefp(e->key);
+    }
+    if (valfreefp) {
+      valfreefp(e->val);
+    }
+    e->key = key;
+    e->val = val;
+    return false;
+  }
+  e->val = val;
+  return true;
+}
+
+/**
+ * Replaces the key of an item in the \a oh.
+ *
+ * Use when a key is re-allocated or it's memory location is changed.
+ *
+ * \returns The previous key or NULL if not found, the caller may free if it's needed.
+ */
+void *BLI_ohash_replace_key(OHash *oh, void *key)
+{
+  OHashEntry *e = ohash_lookup_entry(oh, key);
+  if (e != NULL) {
+    void *key_prev = e->key;
+    e->key = key;
+    return key_prev;
+  }
+  return NULL;
+}
+
+/**
+ * Lookup the value of \a key in \a oh.
+ *
+ * \param key: The key to lookup.
+ * \returns the value for \a key or NULL.
+ *
+ * \note When NULL is a valid value, use #BLI_ohash_lookup_p to differentiate a missing key
+ * from a key with a NULL value. (Avoids calling #BLI_ohash_haskey before #BLI_ohash_lookup)
+ */
+void *BLI_ohash_lookup(OHash *oh, const void *key)
+{
+  OHashEntry *e = ohash_lookup_entry(oh, key);
+  return e ? e->val : NULL;
+}
+
+/**
+ * A version of #BLI_ohash_lookup which accepts a fallback argument.
+ */
+void *BLI_ohash_lookup_default(OHash *oh, const void *key, void *val_default)
+{
+  OHashEntry *e = ohash_lookup_entry(oh, key);
+  return e ? e->val : val_default;
+}
+
+/**
+ * Lookup a pointer to the value of \a key in \a oh.
+ *
+ * \param key: The key to lookup.
+ * \returns the pointer to value for \a key or NULL.
+ *
+ * \note The pointer is only valid until \a oh is modified.
+ */
+void **BLI_ohash_lookup_p(OHash *oh, const void *key)
+{
+  OHashEntry *e = ohash_lookup_entry(oh, key);
+  return e ? &e->val : NULL;
+}
+
+/**
+ * Ensure \a key is exists in \a oh.
+ *
+ * This handles the common situation where the caller needs ensure a key is added to \a oh,
+ * constructing a new value in the case the key isn't found.
+ * Otherwise use the existing value.
+ *
+ * \returns true when the value didn't need to be added.
+ * (when false, the caller _must_ initialize the value).
+ */
+bool BLI_ohash_ensure_p(OHash *oh, void *key, void ***r_val)
+{
+  OHashEntry *e;
+  const bool haskey = ohash_ensure(oh, key, &e);
+  *r_val = &e->val;
+  return haskey;
+}
+
+/**
+ * A version of #BLI_ohash_ensure_p that allows caller to re-assign the key.
+ * Typically used when the key is to be duplicated.
+ *
+ * \warning Caller _must_ write to \a r_key when returning false.
+ */
+bool BLI_ohash_ensure_p_ex(OHash *oh, const void *key, void ***r_key, void ***r_val)
+{
+  OHashEntry *e;
+  const bool haskey = ohash_ensure(oh, key, &e);
+  if (!haskey) {
+    e->key = NULL; /* caller must re-assign */
+  }
+  *r_key = &e->key;
+  *r_val = &e->val;
+  return haskey;
+}
+
+/**
+ * Remove \a key from \a oh, or return false if the key wasn't found.
+ *
+ * \param key: The key to remove.
+ * \param keyfreefp: Optional callback to free the key.
+ * \param valfreefp: Optional callback to free the value.
+ * \return true if \a key was removed from \a oh.
+ */
+bool BLI_ohash_remove(OHash *oh,
+                      const void *key,
+                      GHashKeyFreeFP keyfreefp,
+                      GHashValFreeFP valfreefp)
+{
+  return ohash_remove(oh, key, keyfreefp, valfreefp, NULL);
+}
+
+/**
+ * Remove \a key from \a oh, returning the value or NULL if the key wasn't found.
+ *
+ * \param key: The key to remove.
+ * \param keyfreefp: Optional callback to free the key.
+ * \return the value of \a key int \a oh or NULL.
+ */
+void *BLI_ohash_popkey(OHash *oh, const void *key, GHashKeyFreeFP keyfreefp)
+{
+  OHashEntry e;
+  if (ohash_remove(oh, key, keyfreefp, NULL, &e)) {
+    return e.val;
+  }
+  return NULL;
+}
+
+/**
+ * \return true if the \a key is in \a oh.
+ */
+bool BLI_ohash_haskey(OHash *oh, const void *key)
+{
+  return (ohash_lookup_entry(oh, key) != NULL);
+}
+
+/**
+ * Remove an entry from \a oh, returning true
+ * if a key/value pair could be removed, false otherwise.
+ *
+ * \param r_key: The removed key.
+ * \param r_val: The removed value.
+ * \param state: Kept for compatibility with #BLI_ghash_pop,
+ * the last entry is always removed as this doesn't need to move any other entries.
+ * \return true if there was something to pop, false if ohash was already empty.
+ */
+bool BLI_ohash_pop(OHash *oh, OHashIterState *UNUSED(state), void **r_key, void **r_val)
+{
+  OHashEntry e;
+  if (ohash_pop(oh, &e)) {
+    *r_key = e.key;
+    *r_val = e.val;
+    return true;
+  }
+  *r_key = *r_val = NULL;
+  return false;
+}
+
+/**
+ * Reset \a oh clearing all entries.
+ *
+ * \param keyfreefp: Optional callback to free the key.
+ * \param valfreefp: Optional callback to free the value.
+ * \param nentries_reserve: Optionally reserve the number of members that the hash will hold.
+ */
+void BLI_ohash_clear_ex(OHash *oh,
+                        GHashKeyFreeFP keyfreefp,
+                        GHashValFreeFP valfreefp,
+                        const uint nentries_reserve)
+{
+  ohash_free_entries(oh, keyfreefp, valfreefp);
+  ohash_clear(oh, nentries_reserve);
+}
+
+/**
+ * Wraps #BLI_ohash_clear_ex with zero entries reserved.
+ */
+void BLI_ohash_clear(OHash *oh, GHashKeyFreeFP keyfreefp, GHashValFreeFP valfreefp)
+{
+  BLI_ohash_clear_ex(oh, keyfreefp, valfreefp, 0);
+}
+
+/** \} */
+
+/* -------------------------------------------------------------------- */
+/** \name OHash Iterator API
+ * \{ */
+
+/**
+ * Create a new OHashIterator. The hash table must not be mutated
+ * while the iterator is in use, and the iterator will step exactly
+ * #BLI_ohash_len(oh) times before becoming done.
+ */
+OHashIterator *BLI_ohashIterator_new(OHash *oh)
+{
+  OHashIterator *ohi = MEM_mallocN(sizeof(*ohi), __func__);
+  BLI_ohashIterator_init(ohi, oh);
+  return ohi;
+}
+
+/**
+ * Init an already allocated OHashIterator. The hash table must not
+ * be mutated while the iterator is in use, and the iterator will
+ * step exactly #BLI_ohash_len(oh) times before becoming done.
+ */
+void BLI_ohashIterator_init(OHashIterator *ohi, OHash *oh)
+{
+  ohi->entries = oh->entries;
+  ohi->length = oh->length;
+  ohi->index = 0;
+}
+
+/**
+ * Free an OHashIterator.
+ */
+void BLI_ohashIterator_free(OHashIterator *ohi)
+{
+  MEM_freeN(ohi);
+}
+
+/** \} */
+
+/* -------------------------------------------------------------------- */
+/** \name OSet Public API
+ *
+ * Use ohash API to give 'set' functionality.
+ * \{ */
+
+OSet *BLI_oset_new_ex(GSetHashFP hashfp,
+                      GSetCmpFP cmpfp,
+                      const char *info,
+                      const uint nentries_reserve)
+{
+  return (OSet *)BLI_ohash_new_ex(hashfp, cmpfp, info, nentries_reserve);
+}
+
+OSet *BLI_oset_new(GSetHashFP hashfp, GSetCmpFP cmpfp, const char *info)
+{
+  return BLI_oset_new_ex(hashfp, cmpfp, info, 0);
+}
+
+void BLI_oset_free(OSet *os, GSetKeyFreeFP keyfreefp)
+{
+  BLI_ohash_free((OHash *)os, keyfreefp, NULL);
+}
+
+void BLI_oset_reserve(OSet *os, const uint nentries_reserve)
+{
+  BLI_ohash_reserve((OHash *)os, nentries_reserve);
+}
+
+uint BLI_oset_len(OSet *os)
+{
+  return ((OHash *)os)->length;
+}
+
+/**
+ * Adds the key to the set (no checks for unique keys!).
+ * Matching #BLI_ohash_insert
+ */
+void BLI_oset_insert(OSet *os, void *key)
+{
+  BLI_ohash_insert((OHash *)os, key, NULL);
+}
+
+/**
+ * A version of BLI_oset_insert which checks first if the key is in the set.
+ * \returns true if a new key has been added.
+ */
+bool BLI_oset_add(OSet *os, void *key)
+{
+  OHashEntry *e;
+  return !ohash_ensure((OHash *)os, key, &e);
+}
+
+/**
+ * Set counterpart to #BLI_ohash_ensure_p_ex.
+ * similar to BLI_oset_add, except it returns the key pointer.
+ *
+ * \warning Caller _must_ write to \a r_key when returning false.
+ */
+bool BLI_oset_ensure_p_ex(OSet *os, const void *key, void ***r_key)
+{
+  void **val_dummy;
+  return BLI_ohash_ensure_p_ex((OHash *)os, key, r_key, &val_dummy);
+}
+
+/**
+ * Adds the key to the set (duplicates are managed).
+ * Matching #BLI_ohash_reinsert
+ *
+ * \returns true if a new key has been added.
+ */
+bool BLI_oset_reinsert(OSet *os, void *key, GSetKeyFreeFP keyfreefp)
+{
+  return BLI_ohash_reinsert((OHash *)os, key, NULL, keyfreefp, NULL);
+}
+
+/**
+ * Replaces the key to the set if it's found.
+ * Matching #BLI_ohash_replace_key
+ *
+ * \returns The old key or NULL if not found.
+ */
+void *BLI_oset_replace_key(OSet *os, void *key)
+{
+  return BLI_ohash_replace_key((OHash *)os, key);
+}
+
+bool BLI_oset_remove(OSet *os, const void *key, GSetKeyFreeFP keyfreefp)
+{
+  return BLI_ohash_remove((OHash *)os, key, keyfreefp, NULL);
+}
+
+bool BLI_oset_haskey(OSet *os, const void *key)
+{
+  return BLI_ohash_haskey((OHash *)os, key);
+}
+
+/**
+ * Returns the pointer to the key if it's found.
+ */
+void *BLI_oset_lookup(OSet *os, const void *key)
+{
+  OHashEntry *e = ohash_lookup_entry((OHash *)os, key);
+  return e ? e->key : NULL;
+}
+
+/**
+ * Returns the pointer to the key if it's found, removing it from the OSet.
+ * \note Caller must handle freeing.
+ */
+void *BLI_oset_pop_key(OSet *os, const void *key)
+{
+  OHashEntry e;
+  if (ohash_remove((OHash *)os, key, NULL, NULL, &e)) {
+    return e.key;
+  }
+  return NULL;
+}
+
+/**
+ * Remove an entry from \a os, returning true if a key could be removed, false otherwise.
+ *
+ * \param r_key: The removed key.
+ * \param state: Kept for compatibility with #BLI_gset_pop.
+ * \return true if there was something to pop, false if oset was already empty.
+ */
+bool BLI_oset_pop(OSet *os, OSetIterState *state, void **r_key)
+{
+  void *val_dummy;
+  return BLI_ohash_pop((OHash *)os, state, r_key, &val_dummy);
+}
+
+void BLI_oset_clear_ex(OSet *os, GSetKeyFreeFP keyfreefp, const uint nentries_reserve)
+{
+  BLI_ohash_clear_ex((OHash *)os, keyfreefp, NULL, nentries_reserve);
+}
+
+void BLI_oset_clear(OSet *os, GSetKeyFreeFP keyfreefp)
+{
+  BLI_ohash_clear((OHash *)os, keyfreefp, NULL);
+}
+
+/** \} */
+
+/* -------------------------------------------------------------------- */
+/** \name Debugging & Introspection
+ * \{ */
+
+/**
+ * Measure how well the hash function performs,
+ * a lookup of an existing key needs this many slots to be visited on average.
+ *
+ * \param r_probe_max: The longest probe sequence (optional).
+ * \return the average probe length (1.0 is perfect, 0.0 when empty).
+ */
+double BLI_ohash_calc_probe_length(OHash *oh, int *r_probe_max)
+{
+  uint64_t probe_total = 0;
+  uint probe_max = 0;
+  for (uint slot = 0; slot < SLOTS_CAPACITY(oh); slot++) {
+    const OHashSlot *s = &oh->slots[slot];
+    if (s->index != SLOT_EMPTY) {
+      const uint probe = ((slot - ohash_slot_home(oh, s->hash)) & oh->slot_mask) + 1;
+      probe_total += probe;
+      probe_max = MAX2(probe_max, probe);
+    }
+  }
+  if (r_probe_max) {
+    *r_probe_max = (int)probe_max;
+  }
+  return oh->length ? (double)probe_total / (double)oh->length : 0.0;
+}
+
+double BLI_oset_calc_probe_length(OSet *os, int *r_probe_max)
+{
+  return BLI_ohash_calc_probe_length((OHash *)os, r_probe_max);
+}
+
+/** \} */
+
+/* -------------------------------------------------------------------- */
+/** \name Convenience OHash/OSet Creation Functions
+ * \{ */
+
+OHash *BLI_ohash_ptr_new_ex(const char *info, const uint nentries_reserve)
+{
+  return BLI_ohash_new_ex(BLI_ghashutil_ptrhash, BLI_ghashutil_ptrcmp, info, nentries_reserve);
+}
+OHash *BLI_ohash_ptr_new(const char *info)
+{
+  return BLI_ohash_ptr_new_ex(info, 0);
+}
+
+OHash *BLI_ohash_str_new_ex(const char *info, const uint nentries_reserve)
+{
+  return BLI_ohash_new_ex(BLI_ghashutil_strhash_p, BLI_ghashutil_strcmp, info, nentries_reserve);
+}
+OHash *BLI_ohash_str_new(const char *info)
+{
+  return BLI_ohash_str_new_ex(info, 0);
+}
+
+OHash *BLI_ohash_int_new_ex(const char *info, const uint nentries_reserve)
+{
+  return BLI_ohash_new_ex(BLI_ghashutil_inthash_p, BLI_ghashutil_intcmp, info, nentries_reserve);
+}
+OHash *BLI_ohash_int_new(const char *info)
+{
+  return BLI_ohash_int_new_ex(info, 0);
+}
+
+OSet *BLI_oset_ptr_new_ex(const char *info, const uint nentries_reserve)
+{
+  return BLI_oset_new_ex(BLI_ghashutil_ptrhash, BLI_ghashutil_ptrcmp, info, nentries_reserve);
+}
+OSet *BLI_oset_ptr_new(const char *info)
+{
+  return BLI_oset_ptr_new_ex(info, 0);
+}
+
+OSet *BLI_oset_str_new_ex(const char *info, const uint nentries_reserve)
+{
+  return BLI_oset_new_ex(BLI_ghashutil_strhash_p, BLI_ghashutil_strcmp, info, nentries_reserve);
+}
+OSet *BLI_oset_str_new(const char *info)
+{
+  return BLI_oset_str_new_ex(info, 0);
+}
+
+OSet *BLI_oset_int_new_ex(const char *info, const uint nentries_reserve)
+{
+  return BLI_oset_new_ex(BLI_ghashutil_inthash_p, BLI_ghashutil_intcmp, info, nentries_reserve);
+}
+OSet *BLI_oset_int_new(const char *info)
+{
+  return BLI_oset_int_new_ex(info, 0);
+}
+
+/** \} */
@@ -45,19 +45,6 @@
  */
 #define MEMPOOL_SIZE 256
 
-/* Number of tasks which are pushed directly to local thread queue.
- *
- * This allows thread to fetch next task without locking the whole queue.
- */
-#define LOCAL_QUEUE_SIZE 1
-
-/* Number of tasks which are allowed to be scheduled in a delayed manner.
- *
- * This allows to use less locks per graph node children schedule. More details
- * could be found at TaskThreadLocalStorage::do_delayed_push.
- */
-#define DELAYED_QUEUE_SIZE 4096
-
 #ifndef NDEBUG
 #  define ASSERT_THREAD_ID(scheduler, thread_id) \
     do { \
@@ -138,25 +125,33 @@ typedef struct TaskThreadLocalStorage {
    */
   TaskMemPool task_mempool;
 
-  /* Local queue keeps thread alive by keeping small amount of tasks ready
-   * to be picked up without causing global thread locks for synchronization.
-   */
-  int num_local_queue;
-  Task *local_queue[LOCAL_QUEUE_SIZE];
-
   /* Thread can be marked for delayed tasks push. This is helpful when it's
    * know that lots of subsequent task pushed will happen from the same thread
    * without "interrupting" for task execution.
    *
-   * We try to accumulate as much tasks as possible in a local queue without
-   * any locks first, and then we push all of them into a scheduler's queue
-   * from within a single mutex lock.
+   * Tasks are still pushed to the thread's own queue right away, but waking up
+   * of sleeping worker threads is postponed until the delayed push ends, so a
+   * whole burst of pushes only costs a single wake-up.
    */
   bool do_delayed_push;
-  int num_delayed_queue;
-  Task *delayed_queue[DELAYED_QUEUE_SIZE];
+  int num_delayed_push;
 } TaskThreadLocalStorage;
 
+/* Double-ended queue of tasks.
+ *
+ * Every thread of the scheduler owns such a queue. The owner pushes and pops
+ * tasks at the tail (LIFO order, data of the most recently pushed task is most
+ * likely still in the cache), other threads steal tasks from the head (FIFO
+ * order, which tends to take the oldest and biggest chunks of work).
+ *
+ * The lock is per queue, so it is only contended when a thread is being
+ * stolen from, and never serializes the whole scheduler.
+ */
+typedef struct TaskQueue {
+  SpinLock lock;
+  ListBase tasks;
+} TaskQueue;
+
 struct TaskPool {
   TaskScheduler *scheduler;
 
@@ -168,7 +163,6 @@ struct TaskPool {
   ThreadMutex user_mutex;
 
   volatile bool do_cancel;
-  volatile bool do_work;
 
   volatile bool is_suspended;
   bool start_suspended;
@@ -207,7 +201,17 @@ struct TaskScheduler {
   int num_threads;
   bool background_thread_only;
 
-  ListBase queue;
+  /* Queue for tasks pushed from threads which are not known to the scheduler.
+   * Worker threads check it after their own queue, before stealing.
+   */
+  TaskQueue queue;
+
+  /* Number of queued tasks which can be picked up by worker threads, and
+   * number of worker threads sleeping on the condition because there was
+   * nothing for them to do. Both are only accessed atomically.
+   */
+  size_t num_queued;
+  int num_sleeping;
   ThreadMutex queue_mutex;
   ThreadCondition queue_cond;
 
@@ -225,6 +229,7 @@ typedef struct TaskThread {
   TaskScheduler *scheduler;
   int id;
   TaskThreadLocalStorage tls;
+  TaskQueue queue;
 } TaskThread;
 
 /* Helper */
@@ -326,6 +331,123 @@ static void task_free(TaskPool *pool, Task *task, const int thread_id)
   }
 }
 
+/* Task Queue */
+
+static void task_queue_init(TaskQueue *queue)
+{
+  BLI_spin_init(&queue->lock);
+  BLI_listbase_clear(&queue->tasks);
+}
+
+static void task_queue_end(TaskQueue *queue)
+{
+  Task *task;
+
+  /* delete leftover tasks */
+  for (task = queue->tasks.first; task; task = task->next) {
+    task_data_free(task, 0);
+  }
+  BLI_freelistN(&queue->tasks);
+
+  BLI_spin_end(&queue->lock);
+}
+
+/* Check whether the task can be picked up by a worker thread.
+ *
+ * When the scheduler only has the background fallback thread, regular pools
+ * are only ever handled by the thread which does work_and_wait() on them, so
+ * their tasks are not accounted as pending work for the worker threads.
+ */
+BLI_INLINE bool task_is_worker_runnable(const TaskScheduler *scheduler, const Task *task)
+{
+  return !scheduler->background_thread_only || task->pool->run_in_background;
+}
+
+static void task_queue_push(TaskScheduler *scheduler, TaskQueue *queue, Task *task, bool at_head)
+{
+  /* Account the task before it becomes visible to other threads, so the counter
+   * is never lower than the number of tasks which can actually be popped. */
+  if (task_is_worker_runnable(scheduler, task)) {
+    atomic_add_and_fetch_z(&scheduler->num_queued, 1);
+  }
+
+  BLI_spin_lock(&queue->lock);
+  if (at_head) {
+    BLI_addhead(&queue->tasks, task);
+  }
+  else {
+    BLI_addtail(&queue->tasks, task);
+  }
+  BLI_spin_unlock(&queue->lock);
+}
+
+/* Pop a task from the given queue.
+ *
+ * When pool is NULL any task which can be run by a worker thread is returned,
+ * otherwise only tasks which belong to the given pool are considered.
+ */
+static Task *task_queue_pop(TaskScheduler *scheduler,
+                            TaskQueue *queue,
+                            TaskPool *pool,
+                            const bool from_tail)
+{
+  Task *task;
+
+  BLI_spin_lock(&queue->lock);
+  for (task = from_tail ? queue->tasks.last : queue->tasks.first; task != NULL;
+       task = from_tail ? task->prev : task->next) {
+    if ((pool != NULL) ? (task->pool == pool) : task_is_worker_runnable(scheduler, task)) {
+      BLI_remlink(&queue->tasks, task);
+      break;
+    }
+  }
+  BLI_spin_unlock(&queue->lock);
+
+  if (task != NULL && task_is_worker_runnable(scheduler, task)) {
+    atomic_sub_and_fetch_z(&scheduler->num_queued, 1);
+  }
+
+  return task;
+}
+
+/* Remove all tasks of the given pool from the queue, returns number of removed tasks. */
+static size_t task_queue_clear(TaskScheduler *scheduler, TaskQueue *queue, TaskPool *pool)
+{
+  ListBase cleared = {NULL, NULL};
+  Task *task, *nexttask;
+  size_t done = 0, done_runnable = 0;
+
+  BLI_spin_lock(&queue->lock);
+  for (task = queue->tasks.first; task; task = nexttask) {
+    nexttask = task->next;
+
+    if (task->pool == pool) {
+      BLI_remlink(&queue->tasks, task);
+      BLI_addtail(&cleared, task);
+    }
+  }
+  BLI_spin_unlock(&queue->lock);
+
+  /* Free task data outside of the lock, it might be rather expensive. */
+  for (task = cleared.first; task; task = nexttask) {
+    nexttask = task->next;
+
+    if (task_is_worker_runnable(scheduler, task)) {
+      done_runnable++;
+    }
+    task_data_free(task, pool->thread_id);
+    MEM_freeN(task);
+
+    done++;
+  }
+
+  if (done_runnable != 0) {
+    atomic_sub_and_fetch_z(&scheduler->num_queued, done_runnable);
+  }
+
+  return done;
+}
+
 /* Task Scheduler */
 
 static void task_pool_num_decrease(TaskPool *pool, size_t done)
@@ -353,74 +475,89 @@ static void task_pool_num_increase(TaskPool *pool, size_t new)
   BLI_mutex_unlock(&pool->num_mutex);
 }
 
-static bool task_scheduler_thread_wait_pop(TaskScheduler *scheduler, Task **task)
+/* Wake up worker threads sleeping in task_scheduler_thread_wait_pop().
+ *
+ * The atomic read of the sleepers counter pairs with the atomic increment of
+ * the queued tasks counter done on push: either the pusher sees the sleeping
+ * thread, or the thread sees the new task before going to sleep.
+ */
+static void task_scheduler_wakeup(TaskScheduler *scheduler, const bool wakeup_all)
 {
-  bool found_task = false;
+  if (atomic_add_and_fetch_int32(&scheduler->num_sleeping, 0) == 0) {
+    return;
+  }
+
   BLI_mutex_lock(&scheduler->queue_mutex);
+  if (wakeup_all) {
+    BLI_condition_notify_all(&scheduler->queue_cond);
+  }
+  else {
+    BLI_condition_notify_one(&scheduler->queue_cond);
+  }
+  BLI_mutex_unlock(&scheduler->queue_mutex);
+}
+
+/* Find a task to run for the given thread.
+ *
+ * Own queue is checked first, then the queue of tasks pushed from outside of
+ * the scheduler, and then tasks are stolen from the other threads, starting
+ * from the next one to spread stealing evenly across the threads.
+ *
+ * When pool is not NULL only tasks from that pool are considered, this is what
+ * threads which wait for a pool use to help with its work: running tasks of
+ * other pools from there could deadlock when those tasks wait for something
+ * the waiting thread holds further up its stack.
+ */
+static Task *task_scheduler_find_task(TaskScheduler *scheduler,
+                                      const int thread_id,
+                                      TaskPool *pool)
+{
+  const int num_queues = scheduler->num_threads + 1;
+  Task *task;
 
-  while (!scheduler->queue.first && !scheduler->do_exit) {
-    BLI_condition_wait(&scheduler->queue_cond, &scheduler->queue_mutex);
+  task = task_queue_pop(scheduler, &scheduler->task_threads[thread_id].queue, pool, true);
+  if (task != NULL) {
+    return task;
   }
 
-  do {
-    Task *current_task;
+  task = task_queue_pop(scheduler, &scheduler->queue, pool, false);
+  if (task != NULL) {
+    return task;
+  }
 
-    /* Assuming we can only have a void queue in 'exit' case here seems logical
-     * (we should only be here after our worker thread has been woken up from a
-     * condition_wait(), which only happens after a new task was added to the queue),
-     * but it is wrong.
-     * Waiting on condition may wake up the thread even if condition is not signaled
-     * (spurious wake-ups), and some race condition may also empty the queue **after**
-     * condition has been signaled, but **before** awoken thread reaches this point...
-     * See http://stackoverflow.com/questions/8594591
-     *
-     * So we only abort here if do_exit is set.
-     */
-    if (scheduler->do_exit) {
-      BLI_mutex_unlock(&scheduler->queue_mutex);
-      return false;
+  for (int i = 1; i < num_queues; i++) {
+    const int victim_id = (thread_id + i) % num_queues;
+    task = task_queue_pop(scheduler, &scheduler->task_threads[victim_id].queue, pool, false);
+    if (task != NULL) {
+      return task;
     }
+  }
 
-    for (current_task = scheduler->queue.first; current_task != NULL;
-         current_task = current_task->next) {
-      TaskPool *pool = current_task->pool;
-
-      if (scheduler->background_thread_only && !pool->run_in_background) {
-        continue;
-      }
+  return NULL;
+}
 
-      *task = current_task;
-      found_task = true;
-      BLI_remlink(&scheduler->queue, *task);
-      break;
-    }
-    if (!found_task) {
-      BLI_condition_wait(&scheduler->queue_cond, &scheduler->queue_mutex);
+static Task *task_scheduler_thread_wait_pop(TaskScheduler *scheduler, const int thread_id)
+{
+  while (!scheduler->do_exit) {
+    Task *task = task_scheduler_find_task(scheduler, thread_id, NULL);
+    if (task != NULL) {
+      return task;
     }
-  } while (!found_task);
 
-  BLI_mutex_unlock(&scheduler->queue_mutex);
+    BLI_mutex_lock(&scheduler->queue_mutex);
+    atomic_add_and_fetch_int32(&scheduler->num_sleeping, 1);
 
-  return true;
-}
+    /* NOTE: Use loop here since waiting on condition may wake up the thread
+     * even if condition is not signaled (spurious wake-ups). */
+    while (atomic_add_and_fetch_z(&scheduler->num_queued, 0) == 0 && !scheduler->do_exit) {
+      BLI_condition_wait(&scheduler->queue_cond, &scheduler->queue_mutex);
+    }
 
-BLI_INLINE void handle_local_queue(TaskThreadLocalStorage *tls, const int thread_id)
-{
-  BLI_assert(!tls->do_delayed_push);
-  while (tls->num_local_queue > 0) {
-    /* We pop task from queue before handling it so handler of the task can
-     * push next job to the local queue.
-     */
-    tls->num_local_queue--;
-    Task *local_task = tls->local_queue[tls->num_local_queue];
-    /* TODO(sergey): Double-check work_and_wait() doesn't handle other's
-     * pool tasks.
-     */
-    TaskPool *local_pool = local_task->pool;
-    local_task->run(local_pool, local_task->taskdata, thread_id);
-    task_free(local_pool, local_task, thread_id);
+    atomic_sub_and_fetch_int32(&scheduler->num_sleeping, 1);
+    BLI_mutex_unlock(&scheduler->queue_mutex);
   }
-  BLI_assert(!tls->do_delayed_push);
+
+  return NULL;
 }
 
 static void *task_scheduler_thread_run(void *thread_p)
@@ -442,7 +579,7 @@ static void *task_scheduler_thread_run(void *thread_p)
   BLI_mutex_unlock(&scheduler->startup_mutex);
 
   /* keep popping off tasks */
-  while (task_scheduler_thread_wait_pop(scheduler, &task)) {
+  while ((task = task_scheduler_thread_wait_pop(scheduler, thread_id))) {
     TaskPool *pool = task->pool;
 
     /* run task */
@@ -453,13 +590,12 @@ static void *task_scheduler_thread_run(void *thread_p)
     /* delete task */
     task_free(pool, task, thread_id);
 
-    /* Handle all tasks from local queue. */
-    handle_local_queue(tls, thread_id);
-
     /* notify pool task was done */
     task_pool_num_decrease(pool, 1);
   }
 
+  UNUSED_VARS_NDEBUG(tls);
+
   return NULL;
 }
 
@@ -471,7 +607,9 @@ TaskScheduler *BLI_task_scheduler_create(int num_threads)
    * threads, so we keep track of the number of users. */
   scheduler->do_exit = false;
 
-  BLI_listbase_clear(&scheduler->queue);
+  task_queue_init(&scheduler->queue);
+  scheduler->num_queued = 0;
+  scheduler->num_sleeping = 0;
   BLI_mutex_init(&scheduler->queue_mutex);
   BLI_condition_init(&scheduler->queue_cond);
 
@@ -496,8 +634,11 @@ TaskScheduler *BLI_task_scheduler_create(int num_threads)
   scheduler->task_threads = MEM_mallocN(sizeof(TaskThread) * (num_threads + 1),
                                         "TaskScheduler task threads");
 
-  /* Initialize TLS for main thread. */
+  /* Initialize TLS and queue for main thread. */
+  scheduler->task_threads[0].scheduler = scheduler;
+  scheduler->task_threads[0].id = 0;
   initialize_task_tls(&scheduler->task_threads[0].tls);
+  task_queue_init(&scheduler->task_threads[0].queue);
 
   pthread_key_create(&scheduler->tls_id_key, NULL);
 
@@ -508,12 +649,17 @@ TaskScheduler *BLI_task_scheduler_create(int num_threads)
     scheduler->num_threads = num_threads;
     scheduler->threads = MEM_callocN(sizeof(pthread_t) * num_threads, "TaskScheduler threads");
 
+    /* Queues must be ready before any thread starts, since threads steal from each other. */
     for (i = 0; i < num_threads; i++) {
       TaskThread *thread = &scheduler->task_threads[i + 1];
       thread->scheduler = scheduler;
       thread->id = i + 1;
       initialize_task_tls(&thread->tls);
+      task_queue_init(&thread->queue);
+    }
 
+    for (i = 0; i < num_threads; i++) {
+      TaskThread *thread = &scheduler->task_threads[i + 1];
       if (pthread_create(&scheduler->threads[i], NULL, task_scheduler_thread_run, thread) != 0) {
         fprintf(stderr, "TaskScheduler failed to launch thread %d/%d\n", i, num_threads);
       }
@@ -536,8 +682,6 @@ TaskScheduler *BLI_task_scheduler_create(int num_threads)
 
 void BLI_task_scheduler_free(TaskScheduler *scheduler)
 {
-  Task *task;
-
   /* stop all waiting threads */
   BLI_mutex_lock(&scheduler->queue_mutex);
   scheduler->do_exit = true;
@@ -564,16 +708,13 @@ void BLI_task_scheduler_free(TaskScheduler *scheduler)
     for (int i = 0; i < scheduler->num_threads + 1; i++) {
       TaskThreadLocalStorage *tls = &scheduler->task_threads[i].tls;
       free_task_tls(tls);
+      task_queue_end(&scheduler->task_threads[i].queue);
     }
 
     MEM_freeN(scheduler->task_threads);
   }
 
-  /* delete leftover tasks */
-  for (task = scheduler->queue.first; task; task = task->next) {
-    task_data_free(task, 0);
-  }
-  BLI_freelistN(&scheduler->queue);
+  task_queue_end(&scheduler->queue);
 
   /* delete mutex/condition */
   BLI_mutex_end(&scheduler->queue_mutex);
@@ -589,66 +730,54 @@ int BLI_task_scheduler_num_threads(TaskScheduler *scheduler)
   return scheduler->num_threads + 1;
 }
 
-static void task_scheduler_push(TaskScheduler *scheduler, Task *task, TaskPriority priority)
+static void task_scheduler_push(TaskScheduler *scheduler,
+                                Task *task,
+                                TaskPriority priority,
+                                const int thread_id)
 {
-  task_pool_num_increase(task->pool, 1);
+  TaskPool *pool = task->pool;
+  TaskThread *thread = NULL;
+  TaskThreadLocalStorage *tls = NULL;
 
-  /* add task to queue */
-  BLI_mutex_lock(&scheduler->queue_mutex);
+  task_pool_num_increase(pool, 1);
 
-  if (priority == TASK_PRIORITY_HIGH) {
-    BLI_addhead(&scheduler->queue, task);
+  if (thread_id != -1) {
+    thread = &scheduler->task_threads[thread_id];
+    tls = get_task_tls(pool, thread_id);
   }
-  else {
-    BLI_addtail(&scheduler->queue, task);
+  else if (!BLI_thread_is_main()) {
+    /* Tasks pushed without thread ID from inside of other tasks still go to the
+     * worker's own queue, so nested work stays local to the thread. */
+    thread = pthread_getspecific(scheduler->tls_id_key);
   }
 
-  BLI_condition_notify_one(&scheduler->queue_cond);
-  BLI_mutex_unlock(&scheduler->queue_mutex);
-}
-
-static void task_scheduler_push_all(TaskScheduler *scheduler,
-                                    TaskPool *pool,
-                                    Task **tasks,
-                                    int num_tasks)
-{
-  if (num_tasks == 0) {
-    return;
+  if (thread != NULL) {
+    /* Owner pops from the tail, so high priority tasks are put there. */
+    task_queue_push(scheduler, &thread->queue, task, priority != TASK_PRIORITY_HIGH);
   }
-
-  task_pool_num_increase(pool, num_tasks);
-
-  BLI_mutex_lock(&scheduler->queue_mutex);
-
-  for (int i = 0; i < num_tasks; i++) {
-    BLI_addhead(&scheduler->queue, tasks[i]);
+  else {
+    /* Shared queue is popped from the head. */
+    task_queue_push(scheduler, &scheduler->queue, task, priority == TASK_PRIORITY_HIGH);
   }
 
-  BLI_condition_notify_all(&scheduler->queue_cond);
-  BLI_mutex_unlock(&scheduler->queue_mutex);
+  if (tls != NULL && tls->do_delayed_push) {
+    tls->num_delayed_push++;
+  }
+  else {
+    task_scheduler_wakeup(scheduler, false);
+  }
 }
 
 static void task_scheduler_clear(TaskScheduler *scheduler, TaskPool *pool)
 {
-  Task *task, *nexttask;
   size_t done = 0;
 
-  BLI_mutex_lock(&scheduler->queue_mutex);
-
-  /* free all tasks from this pool from the queue */
-  for (task = scheduler->queue.first; task; task = nexttask) {
-    nexttask = task->next;
-
-    if (task->pool == pool) {
-      task_data_free(task, pool->thread_id);
-      BLI_freelinkN(&scheduler->queue, task);
-
-      done++;
-    }
+  /* free all tasks from this pool from the queues */
+  done += task_queue_clear(scheduler, &scheduler->queue, pool);
+  for (int i = 0; i < scheduler->num_threads + 1; i++) {
+    done += task_queue_clear(scheduler, &scheduler->task_threads[i].queue, pool);
   }
 
-  BLI_mutex_unlock(&scheduler->queue_mutex);
-
   /* notify done */
   task_pool_num_decrease(pool, done);
 }
@@ -678,7 +807,6 @@ static TaskPool *task_pool_create_ex(TaskScheduler *scheduler,
   pool->scheduler = scheduler;
   pool->num = 0;
   pool->do_cancel = false;
-  pool->do_work = false;
   pool->is_suspended = is_suspended;
   pool->start_suspended = is_suspended;
   pool->num_suspended = 0;
@@ -796,11 +924,6 @@ void BLI_task_pool_free(TaskPool *pool)
   BLI_threaded_malloc_end();
 }
 
-BLI_INLINE bool task_can_use_local_queues(TaskPool *pool, int thread_id)
-{
-  return (thread_id != -1 && (thread_id != pool->thread_id || pool->do_work));
-}
-
 static void task_pool_push(TaskPool *pool,
                            TaskRunFunction run,
                            void *taskdata,
@@ -827,32 +950,13 @@ static void task_pool_push(TaskPool *pool,
     atomic_fetch_and_add_z(&pool->num_suspended, 1);
     return;
   }
-  /* Populate to any local queue first, this is cheapest push ever. */
-  if (task_can_use_local_queues(pool, thread_id)) {
+  if (thread_id != -1) {
     ASSERT_THREAD_ID(pool->scheduler, thread_id);
-    TaskThreadLocalStorage *tls = get_task_tls(pool, thread_id);
-    /* Try to push to a local execution queue.
-     * These tasks will be picked up next.
-     */
-    if (tls->num_local_queue < LOCAL_QUEUE_SIZE) {
-      tls->local_queue[tls->num_local_queue] = task;
-      tls->num_local_queue++;
-      return;
-    }
-    /* If we are in the delayed tasks push mode, we push tasks to a
-     * temporary local queue first without any locks, and then move them
-     * to global execution queue with a single lock.
-     */
-    if (tls->do_delayed_push && tls->num_delayed_queue < DELAYED_QUEUE_SIZE) {
-      tls->delayed_queue[tls->num_delayed_queue] = task;
-      tls->num_delayed_queue++;
-      return;
-    }
   }
-  /* Do push to a global execution pool, slowest possible method,
-   * causes quite reasonable amount of threading overhead.
+  /* Push to the queue of the calling thread, from where other threads will
+   * steal it if they run out of work.
    */
-  task_scheduler_push(pool->scheduler, task, priority);
+  task_scheduler_push(pool->scheduler, task, priority, thread_id);
 }
 
 void BLI_task_pool_push_ex(TaskPool *pool,
@@ -881,6 +985,14 @@ void BLI_task_pool_push_from_thread(TaskPool *pool,
   task_pool_push(pool, run, taskdata, free_taskdata, NULL, priority, thread_id);
 }
 
+/**
+ * Work on tasks of the pool until all of them are done.
+ *
+ * The calling thread helps with the pool's work: it runs the pool's tasks from
+ * its own queue first and steals the pool's tasks from other threads after
+ * that, so waiting from inside of another task (nested pools and nested
+ * parallel ranges) does not leave the thread idle.
+ */
 void BLI_task_pool_work_and_wait(TaskPool *pool)
 {
   TaskThreadLocalStorage *tls = get_task_tls(pool, pool->thread_id);
@@ -889,59 +1001,43 @@ void BLI_task_pool_work_and_wait(TaskPool *pool)
   if (atomic_fetch_and_and_uint8((uint8_t *)&pool->is_suspended, 0)) {
     if (pool->num_suspended) {
       task_pool_num_increase(pool, pool->num_suspended);
-      BLI_mutex_lock(&scheduler->queue_mutex);
 
-      BLI_movelisttolist(&scheduler->queue, &pool->suspended_queue);
+      /* Suspended tasks go to the queue of the waiting thread, other threads
+       * will steal them from there. */
+      TaskQueue *queue = &scheduler->task_threads[pool->thread_id].queue;
+      Task *task;
+      while ((task = BLI_pophead(&pool->suspended_queue))) {
+        task_queue_push(scheduler, queue, task, false);
+      }
 
-      BLI_condition_notify_all(&scheduler->queue_cond);
-      BLI_mutex_unlock(&scheduler->queue_mutex);
+      task_scheduler_wakeup(scheduler, true);
 
       pool->num_suspended = 0;
     }
   }
 
-  pool->do_work = true;
-
   ASSERT_THREAD_ID(pool->scheduler, pool->thread_id);
 
-  handle_local_queue(tls, pool->thread_id);
-
   BLI_mutex_lock(&pool->num_mutex);
 
   while (pool->num != 0) {
-    Task *task, *work_task = NULL;
-    bool found_task = false;
+    Task *work_task;
 
     BLI_mutex_unlock(&pool->num_mutex);
 
-    BLI_mutex_lock(&scheduler->queue_mutex);
-
     /* find task from this pool. if we get a task from another pool,
      * we can get into deadlock */
-
-    for (task = scheduler->queue.first; task; task = task->next) {
-      if (task->pool == pool) {
-        work_task = task;
-        found_task = true;
-        BLI_remlink(&scheduler->queue, task);
-        break;
-      }
-    }
-
-    BLI_mutex_unlock(&scheduler->queue_mutex);
+    work_task = task_scheduler_find_task(scheduler, pool->thread_id, pool);
 
     /* if found task, do it, otherwise wait until other tasks are done */
-    if (found_task) {
+    if (work_task != NULL) {
       /* run task */
       BLI_assert(!tls->do_delayed_push);
       work_task->run(pool, work_task->taskdata, pool->thread_id);
       BLI_assert(!tls->do_delayed_push);
 
       /* delete task */
-      task_free(pool, task, pool->thread_id);
-
-      /* Handle all tasks from local queue. */
-      handle_local_queue(tls, pool->thread_id);
+      task_free(pool, work_task, pool->thread_id);
 
       /* notify pool task was done */
       task_pool_num_decrease(pool, 1);
@@ -952,21 +1048,20 @@ void BLI_task_pool_work_and_wait(TaskPool *pool)
       break;
     }
 
-    if (!found_task) {
+    if (work_task == NULL) {
       BLI_condition_wait(&pool->num_cond, &pool->num_mutex);
     }
   }
 
   BLI_mutex_unlock(&pool->num_mutex);
 
-  BLI_assert(tls->num_local_queue == 0);
+  UNUSED_VARS_NDEBUG(tls);
 }
 
 void BLI_task_pool_work_wait_and_reset(TaskPool *pool)
 {
   BLI_task_pool_work_and_wait(pool);
 
-  pool->do_work = false;
   pool->is_suspended = pool->start_suspended;
 }
 
@@ -1003,7 +1098,7 @@ ThreadMutex *BLI_task_pool_user_mutex(TaskPool *pool)
 
 void BLI_task_pool_delayed_push_begin(TaskPool *pool, int thread_id)
 {
-  if (task_can_use_local_queues(pool, thread_id)) {
+  if (thread_id != -1) {
     ASSERT_THREAD_ID(pool->scheduler, thread_id);
     TaskThreadLocalStorage *tls = get_task_tls(pool, thread_id);
     tls->do_delayed_push = true;
@@ -1012,13 +1107,15 @@ void BLI_task_pool_delayed_push_begin(TaskPool *pool, int thread_id)
 
 void BLI_task_pool_delayed_push_end(TaskPool *pool, int thread_id)
 {
-  if (task_can_use_local_queues(pool, thread_id)) {
+  if (thread_id != -1) {
     ASSERT_THREAD_ID(pool->scheduler, thread_id);
     TaskThreadLocalStorage *tls = get_task_tls(pool, thread_id);
     BLI_assert(tls->do_delayed_push);
-    task_scheduler_push_all(pool->scheduler, pool, tls->delayed_queue, tls->num_delayed_queue);
+    if (tls->num_delayed_push != 0) {
+      task_scheduler_wakeup(pool->scheduler, tls->num_delayed_push > 1);
+    }
     tls->do_delayed_push = false;
-    tls->num_delayed_queue = 0;
+    tls->num_delayed_push = 0;
   }
 }
 
@@ -71,6 +71,21 @@ enum {
   ENDB = BLEND_MAKE_ID('E', 'N', 'D', 'B'),
 };
 
+/**
+ * Magic of the chunked compressed container a .blend file can be wrapped in:
+ * the file is split into frames which are compressed independently (so they can be
+ * compressed on multiple threads), followed by a table of the frame offsets
+ * (so any position of the file can be read without decompressing what comes before it).
+ *
+ * Layout, all integers are little endian:
+ * - The magic, followed by the uncompressed size of the frames (uint32) and padding (uint32).
+ * - Zlib compressed frames, all of them but the last one uncompress to the frame size.
+ * - Frame table, one #BlendChunkedFrame per frame.
+ * - Footer: offset of the frame table (uint64), number of frames (uint64) and the magic again.
+ */
+#define BLEND_CHUNKED_MAGIC "BLENDZC1"
+#define BLEND_CHUNKED_MAGIC_LEN 8
+
 #define BLEN_THUMB_MEMSIZE_FILE(_x, _y) (sizeof(int) * (2 + (size_t)(_x) * (size_t)(_y)))
 
 #endif /* __BLO_BLEND_DEFS_H__ */
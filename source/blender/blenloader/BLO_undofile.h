@@ -25,6 +25,7 @@
  * \ingroup blenloader
  */
 
+struct GHash;
 struct Scene;
 
 typedef struct {
@@ -32,13 +33,44 @@ typedef struct {
   const char *buf;
   /** Size in bytes. */
   unsigned int size;
-  /** When true, this chunk doesn't own the memory, it's shared with a previous #MemFileChunk */
+  /** When true, this chunk has the same content as the matching chunk of the previous #MemFile. */
   bool is_identical;
+  /** Reference counted storage of #MemFileChunk.buf, shared by all chunks with the same content
+   * (across all #MemFile's). */
+  struct MemFileBuffer *buffer;
 } MemFileChunk;
 
+/** The chunks written for one ID, used to track which ID's changed between undo steps. */
+typedef struct MemFileIDRange {
+  MemFileChunk *chunk_first;
+  int chunks_len;
+  /** True when any chunk differs from the chunks written for this ID in the previous step. */
+  bool is_changed;
+} MemFileIDRange;
+
+typedef struct MemFileStats {
+  /** Total number of bytes written, including the shared ones. */
+  size_t size_total;
+  int chunks_len;
+  /** Chunks which reuse the buffer of an existing chunk. */
+  int chunks_shared_len;
+  int ids_len;
+  int ids_changed_len;
+  /** Time spent writing, in seconds. */
+  double time_write;
+} MemFileStats;
+
 typedef struct MemFile {
   ListBase chunks;
+  /** Size of the buffers added by this #MemFile (the ones not shared with other steps). */
   size_t size;
+  /** Map ID addresses to their #MemFileIDRange. */
+  struct GHash *id_ranges;
+  /** The range chunks are added to while writing, NULL outside of ID's. */
+  MemFileIDRange *id_range_current;
+  /** Range of the same ID in the previous step while writing (may be NULL). */
+  MemFileIDRange *id_range_compare;
+  MemFileStats stats;
 } MemFile;
 
 typedef struct MemFileUndoData {
@@ -52,6 +84,11 @@ extern void memfile_chunk_add(MemFile *memfile,
                               const char *buf,
                               unsigned int size,
                               MemFileChunk **compchunk_step);
+extern void memfile_id_begin(MemFile *memfile,
+                             MemFile *compare,
+                             const void *id_key,
+                             MemFileChunk **compchunk_step);
+extern void memfile_id_end(MemFile *memfile);
 
 /* exports */
 extern void BLO_memfile_free(MemFile *memfile);
@@ -62,5 +99,6 @@ extern struct Main *BLO_memfile_main_get(struct MemFile *memfile,
                                          struct Main *bmain,
                                          struct Scene **r_scene);
 extern bool BLO_memfile_write_file(struct MemFile *memfile, const char *filename);
+extern void BLO_memfile_shared_size_get(size_t *r_size, int *r_buffers_len);
 
 #endif /* __BLO_UNDOFILE_H__ */
@@ -100,6 +100,9 @@
 #include "BLI_math.h"
 #include "BLI_threads.h"
 #include "BLI_mempool.h"
+#include "BLI_mmap.h"
+#include "BLI_bitmap.h"
+#include "BLI_task.h"
 #include "BLI_ghash.h"
 
 #include "BLT_translation.h"
@@ -150,6 +153,8 @@
 
 #include "NOD_socket.h"
 
+#include "PIL_time.h"
+
 #include "BLO_blend_defs.h"
 #include "BLO_blend_validate.h"
 #include "BLO_readfile.h"
@@ -250,6 +255,7 @@ static void expand_scene_collection(FileData *fd, Main *mainvar, SceneCollection
 #endif
 static void direct_link_animdata(FileData *fd, AnimData *adt);
 static void lib_link_animdata(FileData *fd, ID *id, AnimData *adt);
+static void lib_link_animdata_action_idroot(ID *id, AnimData *adt);
 
 typedef struct BHeadN {
   struct BHeadN *next, *prev;
@@ -311,14 +317,24 @@ typedef struct OldNew {
   int nr;
 } OldNew;
 
+/* Slot of the hash index: the full hash is stored next to the entry index so probing
+ * rarely has to touch the (much larger) entries array for keys that do not match. */
+typedef struct OldNewSlot {
+  uint32_t hash;
+  int32_t index;
+} OldNewSlot;
+
 typedef struct OldNewMap {
   /* Array that stores the actual entries. */
   OldNew *entries;
   int nentries;
   /* Hashmap that stores indices into the `entries` array. */
-  int32_t *map;
+  OldNewSlot *map;
 
   int capacity_exp;
+  /* Capacity the arrays are allocated for, kept when the map is cleared
+   * so reading many ID's does not keep re-allocating the same buffers. */
+  int capacity_exp_alloc;
 } OldNewMap;
 
 #define ENTRIES_CAPACITY(onm) (1ll << (onm)->capacity_exp)
@@ -328,21 +344,19 @@ typedef struct OldNewMap {
 #define PERTURB_SHIFT 5
 
 /* based on the probing algorithm used in Python dicts. */
-#define ITER_SLOTS(onm, KEY, SLOT_NAME, INDEX_NAME) \
-  uint32_t hash = BLI_ghashutil_ptrhash(KEY); \
+#define ITER_SLOTS(onm, KEY, SLOT_NAME, HASH_NAME) \
+  const uint32_t HASH_NAME = BLI_ghashutil_ptrhash(KEY); \
   uint32_t mask = SLOT_MASK(onm); \
-  uint perturb = hash; \
-  int SLOT_NAME = mask & hash; \
-  int INDEX_NAME = onm->map[SLOT_NAME]; \
-  for (;; SLOT_NAME = mask & ((5 * SLOT_NAME) + 1 + perturb), \
-          perturb >>= PERTURB_SHIFT, \
-          INDEX_NAME = onm->map[SLOT_NAME])
+  uint perturb = HASH_NAME; \
+  int SLOT_NAME = mask & HASH_NAME; \
+  for (;; SLOT_NAME = mask & ((5 * SLOT_NAME) + 1 + perturb), perturb >>= PERTURB_SHIFT)
 
 static void oldnewmap_insert_index_in_map(OldNewMap *onm, const void *ptr, int index)
 {
-  ITER_SLOTS (onm, ptr, slot, stored_index) {
-    if (stored_index == -1) {
-      onm->map[slot] = index;
+  ITER_SLOTS (onm, ptr, slot, hash) {
+    if (onm->map[slot].index == -1) {
+      onm->map[slot].hash = hash;
+      onm->map[slot].index = index;
       break;
     }
   }
@@ -350,14 +364,16 @@ static void oldnewmap_insert_index_in_map(OldNewMap *onm, const void *ptr, int i
 
 static void oldnewmap_insert_or_replace(OldNewMap *onm, OldNew entry)
 {
-  ITER_SLOTS (onm, entry.oldp, slot, index) {
+  ITER_SLOTS (onm, entry.oldp, slot, hash) {
+    const int index = onm->map[slot].index;
     if (index == -1) {
       onm->entries[onm->nentries] = entry;
-      onm->map[slot] = onm->nentries;
+      onm->map[slot].hash = hash;
+      onm->map[slot].index = onm->nentries;
       onm->nentries++;
       break;
     }
-    else if (onm->entries[index].oldp == entry.oldp) {
+    else if (onm->map[slot].hash == hash && onm->entries[index].oldp == entry.oldp) {
       onm->entries[index] = entry;
       break;
     }
@@ -366,11 +382,14 @@ static void oldnewmap_insert_or_replace(OldNewMap *onm, OldNew entry)
 
 static OldNew *oldnewmap_lookup_entry(const OldNewMap *onm, const void *addr)
 {
-  ITER_SLOTS (onm, addr, slot, index) {
+  ITER_SLOTS (onm, addr, slot, hash) {
+    const int index = onm->map[slot].index;
     if (index >= 0) {
-      OldNew *entry = &onm->entries[index];
-      if (entry->oldp == addr) {
-        return entry;
+      if (onm->map[slot].hash == hash) {
+        OldNew *entry = &onm->entries[index];
+        if (entry->oldp == addr) {
+          return entry;
+        }
       }
     }
     else {
@@ -387,8 +406,12 @@ static void oldnewmap_clear_map(OldNewMap *onm)
 static void oldnewmap_increase_size(OldNewMap *onm)
 {
   onm->capacity_exp++;
-  onm->entries = MEM_reallocN(onm->entries, sizeof(*onm->entries) * ENTRIES_CAPACITY(onm));
-  onm->map = MEM_reallocN(onm->map, sizeof(*onm->map) * MAP_CAPACITY(onm));
+  if (onm->capacity_exp > onm->capacity_exp_alloc) {
+    onm->capacity_exp_alloc = onm->capacity_exp;
+    onm->entries = MEM_reallocN(onm->entries, sizeof(*onm->entries) * ENTRIES_CAPACITY(onm));
+    MEM_freeN(onm->map);
+    onm->map = MEM_malloc_arrayN(MAP_CAPACITY(onm), sizeof(*onm->map), "OldNewMap.map");
+  }
   oldnewmap_clear_map(onm);
   for (int i = 0; i < onm->nentries; i++) {
     oldnewmap_insert_index_in_map(onm, onm->entries[i].oldp, i);
@@ -402,6 +425,7 @@ static OldNewMap *oldnewmap_new(void)
   OldNewMap *onm = MEM_callocN(sizeof(*onm), "OldNewMap");
 
   onm->capacity_exp = DEFAULT_SIZE_EXP;
+  onm->capacity_exp_alloc = DEFAULT_SIZE_EXP;
   onm->entries = MEM_malloc_arrayN(
       ENTRIES_CAPACITY(onm), sizeof(*onm->entries), "OldNewMap.entries");
   onm->map = MEM_malloc_arrayN(MAP_CAPACITY(onm), sizeof(*onm->map), "OldNewMap.map");
@@ -965,6 +989,11 @@ static bool blo_bhead_read_data(FileData *fd, BHead *thisblock, void *buf)
   bool success = true;
   BHeadN *new_bhead = BHEADN_FROM_BHEAD(thisblock);
   BLI_assert(new_bhead->has_data == false && new_bhead->file_offset != 0);
+  if (fd->mmap_file != NULL) {
+    /* Copy straight out of the mapping, no need to move the file position back and forth. */
+    return BLI_mmap_read(
+        fd->mmap_file, buf, (size_t)new_bhead->file_offset, (size_t)new_bhead->bhead.len);
+  }
   off64_t offset_backup = fd->file_offset;
   if (UNLIKELY(fd->seek(fd, new_bhead->file_offset, SEEK_SET) == -1)) {
     success = false;
@@ -993,6 +1022,41 @@ static BHead *blo_bhead_read_full(FileData *fd, BHead *thisblock)
   }
   return &new_bhead_data->bhead;
 }
+
+/**
+ * For memory mapped files, return the data of a block which was not read yet
+ * directly from the mapping, without copying it.
+ *
+ * The data is read-only and only valid while the file data is alive.
+ * NULL is returned when the data is not available this way.
+ */
+static const void *blo_bhead_data_view(FileData *fd, BHead *thisblock)
+{
+  BHeadN *new_bhead = BHEADN_FROM_BHEAD(thisblock);
+  BLI_assert(new_bhead->has_data == false);
+  if (fd->mmap_file == NULL) {
+    return NULL;
+  }
+  const size_t offset = (size_t)new_bhead->file_offset;
+  const size_t len = (size_t)new_bhead->bhead.len;
+  if (offset > BLI_mmap_get_length(fd->mmap_file) ||
+      len > BLI_mmap_get_length(fd->mmap_file) - offset) {
+    return NULL;
+  }
+#ifdef WIN32
+  /* IO errors on mapped memory are only caught inside of #BLI_mmap_read. */
+  return NULL;
+#else
+  const void *data = POINTER_OFFSET(BLI_mmap_get_pointer(fd->mmap_file), offset);
+  /* Block data is only 4 byte aligned in files: the file header is 12 bytes and block lengths
+   * are padded to 4 bytes. DNA reconstruction reads 8 byte members with memcpy, so this is the
+   * only alignment it needs, and in practice every block passes this test. */
+  if (((uintptr_t)data & 3) != 0) {
+    return NULL;
+  }
+  return data;
+#endif
+}
 #endif /* USE_BHEAD_READ_ON_DEMAND */
 
 /* Warning! Caller's responsibility to ensure given bhead **is** and ID one! */
@@ -1159,6 +1223,211 @@ static off64_t fd_seek_data_from_file(FileData *filedata, off64_t offset, int wh
   return filedata->file_offset;
 }
 
+/* Memory mapped file reading. */
+
+static int fd_read_from_mmap(FileData *filedata, void *buffer, uint size)
+{
+  /* don't read more bytes then there are available in the mapping */
+  const size_t length = BLI_mmap_get_length(filedata->mmap_file);
+  const size_t offset = (size_t)filedata->file_offset;
+  const uint readsize = (offset < length) ? (uint)MIN2((size_t)size, length - offset) : 0;
+
+  if (!BLI_mmap_read(filedata->mmap_file, buffer, offset, readsize)) {
+    return EOF;
+  }
+  filedata->file_offset += readsize;
+
+  return (int)readsize;
+}
+
+static off64_t fd_seek_from_mmap(FileData *filedata, off64_t offset, int whence)
+{
+  const off64_t length = (off64_t)BLI_mmap_get_length(filedata->mmap_file);
+  off64_t new_offset;
+
+  switch (whence) {
+    case SEEK_SET:
+      new_offset = offset;
+      break;
+    case SEEK_CUR:
+      new_offset = filedata->file_offset + offset;
+      break;
+    case SEEK_END:
+      new_offset = length + offset;
+      break;
+    default:
+      return -1;
+  }
+
+  if (new_offset < 0 || new_offset > length) {
+    return -1;
+  }
+
+  filedata->file_offset = new_offset;
+  return filedata->file_offset;
+}
+
+/* Chunked compressed file reading. */
+
+static bool fd_read_chunked_frame(FileData *filedata, const int frame_index)
+{
+  const BlendChunkedFrame *frame = &filedata->chunked.frames[frame_index];
+
+  if (lseek(filedata->filedes, (off64_t)frame->offset, SEEK_SET) == -1) {
+    return false;
+  }
+  if (read(filedata->filedes, filedata->chunked.compressed_buffer, frame->compressed_size) !=
+      (int)frame->compressed_size) {
+    return false;
+  }
+
+  uLongf raw_size = filedata->chunked.frame_size;
+  if (uncompress((Bytef *)filedata->chunked.buffer,
+                 &raw_size,
+                 (const Bytef *)filedata->chunked.compressed_buffer,
+                 frame->compressed_size) != Z_OK ||
+      raw_size != frame->raw_size) {
+    return false;
+  }
+
+  filedata->chunked.frame_cached = frame_index;
+  return true;
+}
+
+static int fd_read_chunked_from_file(FileData *filedata, void *buffer, uint size)
+{
+  const int64_t frame_size = filedata->chunked.frame_size;
+  const int64_t remaining = filedata->chunked.raw_size - filedata->file_offset;
+  const uint readsize = (remaining > 0) ? (uint)MIN2((int64_t)size, remaining) : 0;
+  uint totread = 0;
+
+  while (totread < readsize) {
+    const int frame_index = (int)(filedata->file_offset / frame_size);
+    const uint frame_offset = (uint)(filedata->file_offset - frame_index * frame_size);
+
+    if (frame_index != filedata->chunked.frame_cached) {
+      if (!fd_read_chunked_frame(filedata, frame_index)) {
+        return EOF;
+      }
+    }
+    if (frame_offset >= filedata->chunked.frames[frame_index].raw_size) {
+      return EOF;
+    }
+
+    const uint len = MIN2(readsize - totread,
+                          filedata->chunked.frames[frame_index].raw_size - frame_offset);
+    memcpy(POINTER_OFFSET(buffer, totread), filedata->chunked.buffer + frame_offset, len);
+    totread += len;
+    filedata->file_offset += len;
+  }
+
+  return (int)totread;
+}
+
+static off64_t fd_seek_chunked_from_file(FileData *filedata, off64_t offset, int whence)
+{
+  off64_t new_offset;
+
+  switch (whence) {
+    case SEEK_SET:
+      new_offset = offset;
+      break;
+    case SEEK_CUR:
+      new_offset = filedata->file_offset + offset;
+      break;
+    case SEEK_END:
+      new_offset = filedata->chunked.raw_size + offset;
+      break;
+    default:
+      return -1;
+  }
+
+  if (new_offset < 0 || new_offset > filedata->chunked.raw_size) {
+    return -1;
+  }
+
+  filedata->file_offset = new_offset;
+  return filedata->file_offset;
+}
+
+/**
+ * Read the frame table of a chunked compressed file, see #BLEND_CHUNKED_MAGIC.
+ */
+static bool fd_chunked_init(FileData *filedata)
+{
+  char magic[BLEND_CHUNKED_MAGIC_LEN];
+  uint32_t header[2];
+  uint64_t footer[2];
+
+  const off64_t file_size = lseek(filedata->filedes, 0, SEEK_END);
+  const off64_t footer_offset = file_size - (off64_t)(sizeof(footer) + sizeof(magic));
+  const off64_t data_offset = (off64_t)(sizeof(magic) + sizeof(header));
+  if (footer_offset < data_offset) {
+    return false;
+  }
+
+  if (lseek(filedata->filedes, footer_offset, SEEK_SET) == -1 ||
+      read(filedata->filedes, footer, sizeof(footer)) != sizeof(footer) ||
+      read(filedata->filedes, magic, sizeof(magic)) != sizeof(magic) ||
+      memcmp(magic, BLEND_CHUNKED_MAGIC, sizeof(magic)) != 0) {
+    return false;
+  }
+  if (lseek(filedata->filedes, sizeof(magic), SEEK_SET) == -1 ||
+      read(filedata->filedes, header, sizeof(header)) != sizeof(header)) {
+    return false;
+  }
+#ifdef __BIG_ENDIAN__
+  BLI_endian_switch_uint64_array(footer, ARRAY_SIZE(footer));
+  BLI_endian_switch_uint32_array(header, ARRAY_SIZE(header));
+#endif
+
+  const uint64_t table_offset = footer[0];
+  const uint64_t frames_len = footer[1];
+  const uint32_t frame_size = header[0];
+  if (frame_size == 0 || frames_len > INT_MAX || table_offset < (uint64_t)data_offset ||
+      table_offset > (uint64_t)footer_offset ||
+      frames_len * sizeof(BlendChunkedFrame) != (uint64_t)footer_offset - table_offset) {
+    return false;
+  }
+
+  const size_t table_size = sizeof(BlendChunkedFrame) * (size_t)frames_len;
+  BlendChunkedFrame *frames = MEM_mallocN(MAX2(table_size, 1), __func__);
+  if (lseek(filedata->filedes, (off64_t)table_offset, SEEK_SET) == -1 ||
+      read(filedata->filedes, frames, table_size) != (int)table_size) {
+    MEM_freeN(frames);
+    return false;
+  }
+
+  const uLong compressed_size_max = compressBound(frame_size);
+  int64_t raw_size = 0;
+  for (int i = 0; i < (int)frames_len; i++) {
+#ifdef __BIG_ENDIAN__
+    BLI_endian_switch_uint64(&frames[i].offset);
+    BLI_endian_switch_uint32(&frames[i].compressed_size);
+    BLI_endian_switch_uint32(&frames[i].raw_size);
+#endif
+    /* Only the last frame is allowed to be smaller, so positions map directly to frames. */
+    if (frames[i].raw_size > frame_size ||
+        (i != (int)frames_len - 1 && frames[i].raw_size != frame_size) ||
+        frames[i].compressed_size > compressed_size_max ||
+        frames[i].offset + frames[i].compressed_size > table_offset) {
+      MEM_freeN(frames);
+      return false;
+    }
+    raw_size += frames[i].raw_size;
+  }
+
+  filedata->chunked.frames = frames;
+  filedata->chunked.frames_len = (int)frames_len;
+  filedata->chunked.frame_size = frame_size;
+  filedata->chunked.raw_size = raw_size;
+  filedata->chunked.frame_cached = -1;
+  filedata->chunked.buffer = MEM_mallocN(frame_size, __func__);
+  filedata->chunked.compressed_buffer = MEM_mallocN(compressed_size_max, __func__);
+
+  return true;
+}
+
 /* GZip file reading. */
 
 static int fd_read_gzip_from_file(FileData *filedata, void *buffer, uint size)
@@ -1301,6 +1570,7 @@ static FileData *blo_filedata_from_file_descriptor(const char *filepath,
   FileDataSeekFn *seek_fn = NULL; /* Optional. */
 
   gzFile gzfile = (gzFile)Z_NULL;
+  BLI_mmap_file *mmap_file = NULL;
 
   char header[7];
 
@@ -1320,8 +1590,26 @@ static FileData *blo_filedata_from_file_descriptor(const char *filepath,
 
   /* Regular file. */
   if (memcmp(header, "BLENDER", sizeof(header)) == 0) {
-    read_fn = fd_read_data_from_file;
-    seek_fn = fd_seek_data_from_file;
+    /* Uncompressed files are memory mapped when possible: block headers are still
+     * scanned up-front, but data of the blocks which are read on demand is only
+     * paged in when it is actually used. */
+    mmap_file = BLI_mmap_open(file);
+    if (mmap_file != NULL) {
+      read_fn = fd_read_from_mmap;
+      seek_fn = fd_seek_from_mmap;
+    }
+    else {
+      read_fn = fd_read_data_from_file;
+      seek_fn = fd_seek_data_from_file;
+    }
+  }
+
+  /* Chunked compressed file, the frame table is read once the file data exists. */
+  bool is_chunked = false;
+  if (memcmp(header, BLEND_CHUNKED_MAGIC, sizeof(header)) == 0) {
+    read_fn = fd_read_chunked_from_file;
+    seek_fn = fd_seek_chunked_from_file;
+    is_chunked = true;
   }
 
   /* Gzip file. */
@@ -1355,10 +1643,19 @@ static FileData *blo_filedata_from_file_descriptor(const char *filepath,
 
   fd->filedes = file;
   fd->gzfiledes = gzfile;
+  fd->mmap_file = mmap_file;
 
   fd->read = read_fn;
   fd->seek = seek_fn;
 
+  if (is_chunked && !fd_chunked_init(fd)) {
+    BKE_reportf(reports, RPT_WARNING, "Invalid compressed file '%s'", filepath);
+    /* Caller closes the file. */
+    fd->filedes = -1;
+    blo_filedata_free(fd);
+    return NULL;
+  }
+
   return fd;
 }
 
@@ -1511,6 +1808,16 @@ void blo_filedata_free(FileData *fd)
       gzclose(fd->gzfiledes);
     }
 
+    if (fd->mmap_file != NULL) {
+      BLI_mmap_free(fd->mmap_file);
+    }
+
+    if (fd->chunked.frames != NULL) {
+      MEM_freeN(fd->chunked.frames);
+      MEM_freeN(fd->chunked.buffer);
+      MEM_freeN(fd->chunked.compressed_buffer);
+    }
+
     if (fd->strm.next_in) {
       if (inflateEnd(&fd->strm) != Z_OK) {
         printf("close gzip stream error\n");
@@ -2226,17 +2533,31 @@ static void *read_struct(FileData *fd, BHead *bh, const char *blockname)
 
     if (fd->compflags[bh->SDNAnr] != SDNA_CMP_REMOVED) {
       if (fd->compflags[bh->SDNAnr] == SDNA_CMP_NOT_EQUAL) {
+        const void *data = (bh + 1);
 #ifdef USE_BHEAD_READ_ON_DEMAND
         if (BHEADN_FROM_BHEAD(bh)->has_data == false) {
-          bh = blo_bhead_read_full(fd, bh);
-          if (UNLIKELY(bh == NULL)) {
-            fd->flags &= ~FD_FLAGS_FILE_OK;
-            return NULL;
+          /* Reconstruct straight from the mapped file when possible. */
+          data = blo_bhead_data_view(fd, bh);
+          if (data == NULL) {
+            bh = blo_bhead_read_full(fd, bh);
+            if (UNLIKELY(bh == NULL)) {
+              fd->flags &= ~FD_FLAGS_FILE_OK;
+              return NULL;
+            }
+            data = (bh + 1);
           }
         }
 #endif
         temp = DNA_struct_reconstruct(
-            fd->memsdna, fd->filesdna, fd->compflags, bh->SDNAnr, bh->nr, (bh + 1));
+            fd->memsdna, fd->filesdna, fd->compflags, bh->SDNAnr, bh->nr, data);
+#ifdef USE_BHEAD_READ_ON_DEMAND
+        /* The mapped file may have been truncated or gone away while reading it. */
+        if (fd->mmap_file != NULL && UNLIKELY(BLI_mmap_any_io_error(fd->mmap_file))) {
+          fd->flags &= ~FD_FLAGS_FILE_OK;
+          MEM_freeN(temp);
+          temp = NULL;
+        }
+#endif
       }
       else {
         /* SDNA_CMP_EQUAL */
@@ -2613,7 +2934,11 @@ static void lib_link_id_private_id(FileData *fd, Main *bmain, ID *id)
   }
 }
 
-static void lib_link_id(FileData *fd, Main *bmain, ID *id)
+/**
+ * \param fix_action_idroot: When false, #lib_link_animdata_action_idroot has to be called
+ * by the caller, this makes the function safe to run for different ID's in parallel.
+ */
+static void lib_link_id_ex(FileData *fd, Main *bmain, ID *id, const bool fix_action_idroot)
 {
   /* Note: WM IDProperties are never written to file, hence they should always be NULL here. */
   BLI_assert((GS(id->name) != ID_WM) || id->properties == NULL);
@@ -2622,6 +2947,9 @@ static void lib_link_id(FileData *fd, Main *bmain, ID *id)
   AnimData *adt = BKE_animdata_from_id(id);
   if (adt != NULL) {
     lib_link_animdata(fd, id, adt);
+    if (fix_action_idroot) {
+      lib_link_animdata_action_idroot(id, adt);
+    }
   }
 
   if (id->override_library) {
@@ -2632,6 +2960,11 @@ static void lib_link_id(FileData *fd, Main *bmain, ID *id)
   lib_link_id_private_id(fd, bmain, id);
 }
 
+static void lib_link_id(FileData *fd, Main *bmain, ID *id)
+{
+  lib_link_id_ex(fd, bmain, id, true);
+}
+
 static void direct_link_id_override_property_operation_cb(FileData *fd, void *data)
 {
   IDOverrideLibraryPropertyOperation *opop = data;
@@ -3157,8 +3490,15 @@ static void lib_link_nladata_strips(FileData *fd, ID *id, ListBase *list)
 
     /* reassign the counted-reference to action */
     strip->act = newlibadr(fd, id->lib, strip->act);
+  }
+}
+
+/* fix action id-root (i.e. if it comes from a pre 2.57 .blend file) */
+static void lib_link_nladata_strips_action_idroot(ID *id, ListBase *list)
+{
+  for (NlaStrip *strip = list->first; strip; strip = strip->next) {
+    lib_link_nladata_strips_action_idroot(id, &strip->strips);
 
-    /* fix action id-root (i.e. if it comes from a pre 2.57 .blend file) */
     if ((strip->act) && (strip->act->idroot == 0)) {
       strip->act->idroot = GS(id->name);
     }
@@ -3256,14 +3596,6 @@ static void lib_link_animdata(FileData *fd, ID *id, AnimData *adt)
   adt->action = newlibadr(fd, id->lib, adt->action);
   adt->tmpact = newlibadr(fd, id->lib, adt->tmpact);
 
-  /* fix action id-roots (i.e. if they come from a pre 2.57 .blend file) */
-  if ((adt->action) && (adt->action->idroot == 0)) {
-    adt->action->idroot = GS(id->name);
-  }
-  if ((adt->tmpact) && (adt->tmpact->idroot == 0)) {
-    adt->tmpact->idroot = GS(id->name);
-  }
-
   /* link drivers */
   lib_link_fcurves(fd, id, &adt->drivers);
 
@@ -3273,6 +3605,26 @@ static void lib_link_animdata(FileData *fd, ID *id, AnimData *adt)
   lib_link_nladata(fd, id, &adt->nla_tracks);
 }
 
+/**
+ * Fix action id-roots (i.e. if they come from a pre 2.57 .blend file).
+ *
+ * Kept separate from #lib_link_animdata since it writes into the (shared) actions,
+ * the first ID using an action sets its root, so this has to run in #lib_link_all order.
+ */
+static void lib_link_animdata_action_idroot(ID *id, AnimData *adt)
+{
+  if ((adt->action) && (adt->action->idroot == 0)) {
+    adt->action->idroot = GS(id->name);
+  }
+  if ((adt->tmpact) && (adt->tmpact->idroot == 0)) {
+    adt->tmpact->idroot = GS(id->name);
+  }
+
+  for (NlaTrack *nlt = adt->nla_tracks.first; nlt; nlt = nlt->next) {
+    lib_link_nladata_strips_action_idroot(id, &nlt->strips);
+  }
+}
+
 static void direct_link_animdata(FileData *fd, AnimData *adt)
 {
   /* NOTE: must have called newdataadr already before doing this... */
@@ -4806,6 +5158,7 @@ static void direct_link_customdata(FileData *fd, CustomData *data, int count)
     }
 
     layer->flag &= ~CD_FLAG_NOFREE;
+    layer->sharing_info = NULL;
 
     if (CustomData_verify_versions(data, i)) {
       layer->data = newdataadr(fd, layer->data);
@@ -9213,6 +9566,10 @@ static BHead *read_global(BlendFileData *bfd, FileData *fd, BHead *bhead)
   BLI_strncpy(bfd->main->build_hash, fg->build_hash, sizeof(bfd->main->build_hash));
 
   bfd->fileflags = fg->fileflags;
+  /* Keep saving chunked files as such, also when the stored flags don't say so. */
+  if (fd->chunked.frames != NULL) {
+    bfd->fileflags |= G_FILE_COMPRESS | G_FILE_COMPRESS_CHUNKED;
+  }
   bfd->globalf = fg->globalf;
   BLI_strncpy(bfd->filename, fg->filename, sizeof(bfd->filename));
 
@@ -9363,14 +9720,206 @@ static void do_versions_after_linking(Main *main, ReportList *reports)
 /** \name Read Library Data Block (all)
  * \{ */
 
+/**
+ * ID types whose lib-linking only remaps pointers stored in the ID itself
+ * (no access to other ID's, no Main or report changes),
+ * so they can be linked in parallel before the other ones.
+ */
+static bool lib_link_id_is_isolated(ID *id)
+{
+  switch (GS(id->name)) {
+    case ID_WO:
+    case ID_LP:
+    case ID_SPK:
+    case ID_PC:
+    case ID_SO:
+    case ID_TXT:
+    case ID_CA:
+    case ID_LA:
+    case ID_LT:
+    case ID_MB:
+    case ID_CU:
+    case ID_ME:
+    case ID_CF:
+    case ID_AR:
+    case ID_VF:
+    case ID_MA:
+    case ID_TE:
+    case ID_IM:
+    case ID_PAL:
+    case ID_KE:
+    case ID_AC:
+      /* Embedded node-trees update their nodes from the linked group trees. */
+      return ntreeFromID(id) == NULL;
+    default:
+      return false;
+  }
+}
+
+static void lib_link_id_isolated(FileData *fd, Main *bmain, ID *id)
+{
+  lib_link_id_ex(fd, bmain, id, false);
+
+  switch (GS(id->name)) {
+    case ID_WO:
+      lib_link_world(fd, bmain, (World *)id);
+      break;
+    case ID_LP:
+      lib_link_lightprobe(fd, bmain, (LightProbe *)id);
+      break;
+    case ID_SPK:
+      lib_link_speaker(fd, bmain, (Speaker *)id);
+      break;
+    case ID_PC:
+      lib_link_paint_curve(fd, bmain, (PaintCurve *)id);
+      break;
+    case ID_SO:
+      lib_link_sound(fd, bmain, (bSound *)id);
+      break;
+    case ID_TXT:
+      lib_link_text(fd, bmain, (Text *)id);
+      break;
+    case ID_CA:
+      lib_link_camera(fd, bmain, (Camera *)id);
+      break;
+    case ID_LA:
+      lib_link_light(fd, bmain, (Light *)id);
+      break;
+    case ID_LT:
+      lib_link_latt(fd, bmain, (Lattice *)id);
+      break;
+    case ID_MB:
+      lib_link_mball(fd, bmain, (MetaBall *)id);
+      break;
+    case ID_CU:
+      lib_link_curve(fd, bmain, (Curve *)id);
+      break;
+    case ID_ME:
+      lib_link_mesh(fd, bmain, (Mesh *)id);
+      break;
+    case ID_CF:
+      lib_link_cachefiles(fd, bmain, (CacheFile *)id);
+      break;
+    case ID_AR:
+      lib_link_armature(fd, bmain, (bArmature *)id);
+      break;
+    case ID_VF:
+      lib_link_vfont(fd, bmain, (VFont *)id);
+      break;
+    case ID_MA:
+      lib_link_material(fd, bmain, (Material *)id);
+      break;
+    case ID_TE:
+      lib_link_texture(fd, bmain, (Tex *)id);
+      break;
+    case ID_IM:
+      lib_link_image(fd, bmain, (Image *)id);
+      break;
+    case ID_PAL:
+      lib_link_palette(fd, bmain, (Palette *)id);
+      break;
+    case ID_KE:
+      lib_link_key(fd, bmain, (Key *)id);
+      break;
+    case ID_AC:
+      lib_link_action(fd, bmain, (bAction *)id);
+      break;
+    default:
+      BLI_assert(0);
+      break;
+  }
+}
+
+typedef struct LibLinkIsolatedData {
+  FileData *fd;
+  Main *bmain;
+  ID **ids;
+} LibLinkIsolatedData;
+
+static void lib_link_id_isolated_cb(void *__restrict userdata,
+                                    const int i,
+                                    const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  LibLinkIsolatedData *data = userdata;
+  lib_link_id_isolated(data->fd, data->bmain, data->ids[i]);
+}
+
+/* Below this amount of ID's the threading overhead is not worth it. */
+#define LIB_LINK_PARALLEL_MIN_IDS 64
+
+/**
+ * Link the isolated ID's (see #lib_link_id_is_isolated) on multiple threads.
+ * Their index in #FOREACH_MAIN_ID order is set in \a r_linked, #lib_link_all then
+ * only does the order dependent action id-root fixup for them.
+ *
+ * \return The number of ID's linked.
+ */
+static int lib_link_all_isolated(FileData *fd, Main *bmain, BLI_bitmap *r_linked, int ids_len)
+{
+  ID **ids = MEM_malloc_arrayN(ids_len, sizeof(*ids), __func__);
+  int ids_isolated_len = 0;
+  int index = 0;
+
+  ID *id;
+  FOREACH_MAIN_ID_BEGIN (bmain, id) {
+    if ((id->tag & LIB_TAG_NEED_LINK) && lib_link_id_is_isolated(id)) {
+      ids[ids_isolated_len++] = id;
+      BLI_BITMAP_ENABLE(r_linked, index);
+    }
+    index++;
+  }
+  FOREACH_MAIN_ID_END;
+
+  LibLinkIsolatedData data = {
+      .fd = fd,
+      .bmain = bmain,
+      .ids = ids,
+  };
+  TaskParallelSettings settings;
+  BLI_parallel_range_settings_defaults(&settings);
+  settings.use_threading = (ids_isolated_len >= LIB_LINK_PARALLEL_MIN_IDS);
+  settings.min_iter_per_thread = 16;
+  BLI_task_parallel_range(0, ids_isolated_len, &data, lib_link_id_isolated_cb, &settings);
+
+  MEM_freeN(ids);
+  return ids_isolated_len;
+}
+
 static void lib_link_all(FileData *fd, Main *bmain)
 {
+  const double time_start = PIL_check_seconds_timer();
+  int ids_len = 0;
+  int ids_linked_len = 0;
+
   ID *id;
+  FOREACH_MAIN_ID_BEGIN (bmain, id) {
+    ids_len++;
+  }
+  FOREACH_MAIN_ID_END;
+
+  BLI_bitmap *ids_isolated = BLI_BITMAP_NEW(max_ii(ids_len, 1), __func__);
+  const int ids_isolated_len = lib_link_all_isolated(fd, bmain, ids_isolated, ids_len);
+
+  int index = 0;
   FOREACH_MAIN_ID_BEGIN (bmain, id) {
     if ((id->tag & LIB_TAG_NEED_LINK) == 0) {
       /* This ID does not need liblink, just skip to next one. */
+      index++;
+      continue;
+    }
+
+    if (BLI_BITMAP_TEST(ids_isolated, index)) {
+      /* Already linked, only the order dependent part remains. */
+      AnimData *adt = BKE_animdata_from_id(id);
+      if (adt != NULL) {
+        lib_link_animdata_action_idroot(id, adt);
+      }
+      id->tag &= ~LIB_TAG_NEED_LINK;
+      ids_linked_len++;
+      index++;
       continue;
     }
+    index++;
 
     if (fd->memfile != NULL && GS(id->name) == ID_WM) {
       /* No load UI for undo memfiles.
@@ -9501,9 +10050,16 @@ static void lib_link_all(FileData *fd, Main *bmain)
     }
 
     id->tag &= ~LIB_TAG_NEED_LINK;
+    ids_linked_len++;
   }
   FOREACH_MAIN_ID_END;
 
+  MEM_freeN(ids_isolated);
+
+  fd->stats.ids_linked += ids_linked_len;
+  fd->stats.ids_linked_parallel += ids_isolated_len;
+  fd->stats.time_lib_link += PIL_check_seconds_timer() - time_start;
+
   /* Check for possible cycles in scenes' 'set' background property. */
   lib_link_scenes_check_set(bmain);
 
@@ -9634,6 +10190,28 @@ static BHead *read_userdef(BlendFileData *bfd, FileData *fd, BHead *bhead)
 /** \name Read File (Internal)
  * \{ */
 
+/* Returns the time since \a r_time_start and resets it to now, for timing consecutive phases. */
+static double blo_read_stats_phase_end(double *r_time_start)
+{
+  const double time = PIL_check_seconds_timer();
+  const double delta = time - *r_time_start;
+  *r_time_start = time;
+  return delta;
+}
+
+static void blo_read_stats_print(const FileData *fd, const char *filepath)
+{
+  printf("Read blend file \"%s\":\n", filepath);
+  printf("  read blocks:    %8.3f ms\n", fd->stats.time_read_blocks * 1000.0);
+  printf("  versioning:     %8.3f ms\n", fd->stats.time_versioning * 1000.0);
+  printf("  read libraries: %8.3f ms\n", fd->stats.time_read_libraries * 1000.0);
+  printf("  lib link:       %8.3f ms (%d ID's, %d in parallel)\n",
+         fd->stats.time_lib_link * 1000.0,
+         fd->stats.ids_linked,
+         fd->stats.ids_linked_parallel);
+  printf("  after linking:  %8.3f ms\n", fd->stats.time_after_linking * 1000.0);
+}
+
 BlendFileData *blo_read_file_internal(FileData *fd, const char *filepath)
 {
   BHead *bhead = blo_bhead_first(fd);
@@ -9675,6 +10253,8 @@ BlendFileData *blo_read_file_internal(FileData *fd, const char *filepath)
     }
   }
 
+  double time_phase = PIL_check_seconds_timer();
+
   while (bhead) {
     switch (bhead->code) {
       case DATA:
@@ -9726,6 +10306,8 @@ BlendFileData *blo_read_file_internal(FileData *fd, const char *filepath)
     }
   }
 
+  fd->stats.time_read_blocks += blo_read_stats_phase_end(&time_phase);
+
   /* do before read_libraries, but skip undo case */
   if (fd->memfile == NULL) {
     if ((fd->skip_flags & BLO_READ_SKIP_DATA) == 0) {
@@ -9737,13 +10319,19 @@ BlendFileData *blo_read_file_internal(FileData *fd, const char *filepath)
     }
   }
 
+  fd->stats.time_versioning += blo_read_stats_phase_end(&time_phase);
+
   if ((fd->skip_flags & BLO_READ_SKIP_DATA) == 0) {
     read_libraries(fd, &mainlist);
 
     blo_join_main(&mainlist);
 
+    fd->stats.time_read_libraries += blo_read_stats_phase_end(&time_phase);
+
     lib_link_all(fd, bfd->main);
 
+    time_phase = PIL_check_seconds_timer();
+
     /* Skip in undo case. */
     if (fd->memfile == NULL) {
       /* Note that we cannot recompute usercounts at this point in undo case, we play too much with
@@ -9789,10 +10377,16 @@ BlendFileData *blo_read_file_internal(FileData *fd, const char *filepath)
     fix_relpaths_library(fd->relabase, bfd->main);
 
     link_global(fd, bfd); /* as last */
+
+    fd->stats.time_after_linking += blo_read_stats_phase_end(&time_phase);
   }
 
   fd->mainlist = NULL; /* Safety, this is local variable, shall not be used afterward. */
 
+  if (G.debug & G_DEBUG_IO) {
+    blo_read_stats_print(fd, filepath);
+  }
+
   return bfd;
 }
 
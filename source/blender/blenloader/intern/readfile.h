@@ -30,6 +30,7 @@
 #include "DNA_space_types.h"
 #include "DNA_windowmanager_types.h" /* for ReportType */
 
+struct BLI_mmap_file;
 struct Key;
 struct MemFile;
 struct Object;
@@ -57,6 +58,17 @@ enum eFileDataFlag {
 typedef int64_t off64_t;
 #endif
 
+/** Frame table entry of the chunked compressed container, see #BLEND_CHUNKED_MAGIC. */
+typedef struct BlendChunkedFrame {
+  /** Offset of the compressed data in the file. */
+  uint64_t offset;
+  uint32_t compressed_size;
+  uint32_t raw_size;
+} BlendChunkedFrame;
+
+/** Uncompressed size of the frames written to chunked compressed files. */
+#define BLEND_CHUNKED_FRAME_SIZE (1 << 20)
+
 typedef int(FileDataReadFn)(struct FileData *filedata, void *buffer, unsigned int size);
 typedef off64_t(FileDataSeekFn)(struct FileData *filedata, off64_t offset, int whence);
 
@@ -73,6 +85,8 @@ typedef struct FileData {
 
   /** Regular file reading. */
   int filedes;
+  /** Memory mapping of #filedes, used instead of reading when available. */
+  struct BLI_mmap_file *mmap_file;
 
   /** Variables needed for reading from memory / stream. */
   const char *buffer;
@@ -84,6 +98,18 @@ typedef struct FileData {
   /** Gzip stream for memory decompression. */
   z_stream strm;
 
+  /** Chunked compressed file reading, frames are decompressed as they are accessed. */
+  struct {
+    BlendChunkedFrame *frames;
+    int frames_len;
+    uint32_t frame_size;
+    int64_t raw_size;
+    /** Index of the frame currently decompressed in #buffer, -1 when none. */
+    int frame_cached;
+    char *buffer;
+    char *compressed_buffer;
+  } chunked;
+
   /** Now only in use for library appending. */
   char relabase[FILE_MAX];
 
@@ -122,6 +148,17 @@ typedef struct FileData {
   ListBase *old_mainlist;
 
   struct ReportList *reports;
+
+  /** Timings (in seconds) and counters of the reading phases, printed with `--debug-io`. */
+  struct {
+    double time_read_blocks;
+    double time_versioning;
+    double time_read_libraries;
+    double time_lib_link;
+    double time_after_linking;
+    int ids_linked;
+    int ids_linked_parallel;
+  } stats;
 } FileData;
 
 #define SIZEOFBLENDERHEADER 12
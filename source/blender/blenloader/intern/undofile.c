@@ -41,6 +41,8 @@
 #include "DNA_listBase.h"
 
 #include "BLI_blenlib.h"
+#include "BLI_ghash.h"
+#include "BLI_hash_mm2a.h"
 
 #include "BLO_undofile.h"
 #include "BLO_readfile.h"
@@ -52,43 +54,135 @@
 
 /* **************** support for memory-write, for undo buffers *************** */
 
+/* -------------------------------------------------------------------- */
+/** \name Shared Chunk Buffers
+ *
+ * Chunk contents are stored once and reference counted, looked up by a hash of their content.
+ * This de-duplicates chunks across all undo steps, not only against the previous one,
+ * and is not confused by data moving to another position in the file.
+ *
+ * \note Undo steps are only written and freed from the main thread, no locking is done.
+ * \{ */
+
+typedef struct MemFileBuffer {
+  const char *data;
+  uint size;
+  uint hash;
+  int users;
+} MemFileBuffer;
+
+static struct {
+  /** All #MemFileBuffer in use, the set is freed once the last one is. */
+  GSet *buffers;
+  /** Total size of the buffer data. */
+  size_t size;
+} g_memfile_store = {NULL, 0};
+
+static uint memfile_buffer_hash(const void *key)
+{
+  return ((const MemFileBuffer *)key)->hash;
+}
+
+static bool memfile_buffer_cmp(const void *a, const void *b)
+{
+  const MemFileBuffer *buffer_a = a;
+  const MemFileBuffer *buffer_b = b;
+  return !((buffer_a->hash == buffer_b->hash) && (buffer_a->size == buffer_b->size) &&
+           (memcmp(buffer_a->data, buffer_b->data, buffer_a->size) == 0));
+}
+
+/**
+ * Return a buffer with the content of \a buf, creating it when it doesn't exist yet.
+ * The returned buffer has a user added.
+ *
+ * \param r_is_new: Set when the buffer had to be created.
+ */
+static MemFileBuffer *memfile_buffer_ensure(const char *buf, uint size, bool *r_is_new)
+{
+  if (g_memfile_store.buffers == NULL) {
+    g_memfile_store.buffers = BLI_gset_new(memfile_buffer_hash, memfile_buffer_cmp, __func__);
+  }
+
+  const MemFileBuffer key = {
+      .data = buf,
+      .size = size,
+      .hash = BLI_hash_mm2((const uchar *)buf, size, 0),
+  };
+
+  MemFileBuffer *buffer = BLI_gset_lookup(g_memfile_store.buffers, &key);
+  if (buffer != NULL) {
+    buffer->users++;
+    *r_is_new = false;
+    return buffer;
+  }
+
+  /* Data is stored right after the buffer. */
+  buffer = MEM_mallocN(sizeof(*buffer) + size, "MemFileBuffer");
+  char *data = (char *)(buffer + 1);
+  memcpy(data, buf, size);
+  buffer->data = data;
+  buffer->size = size;
+  buffer->hash = key.hash;
+  buffer->users = 1;
+  BLI_gset_insert(g_memfile_store.buffers, buffer);
+  g_memfile_store.size += size;
+  *r_is_new = true;
+  return buffer;
+}
+
+static void memfile_buffer_user_remove(MemFileBuffer *buffer)
+{
+  BLI_assert(buffer->users > 0);
+  if (--buffer->users != 0) {
+    return;
+  }
+
+  g_memfile_store.size -= buffer->size;
+  BLI_gset_remove(g_memfile_store.buffers, buffer, NULL);
+  MEM_freeN(buffer);
+
+  if (BLI_gset_len(g_memfile_store.buffers) == 0) {
+    BLI_gset_free(g_memfile_store.buffers, NULL);
+    g_memfile_store.buffers = NULL;
+  }
+}
+
+/**
+ * Memory used by the chunk buffers of all undo steps.
+ */
+void BLO_memfile_shared_size_get(size_t *r_size, int *r_buffers_len)
+{
+  *r_size = g_memfile_store.size;
+  *r_buffers_len = g_memfile_store.buffers ? (int)BLI_gset_len(g_memfile_store.buffers) : 0;
+}
+
+/** \} */
+
 /* not memfile itself */
 void BLO_memfile_free(MemFile *memfile)
 {
   MemFileChunk *chunk;
 
   while ((chunk = BLI_pophead(&memfile->chunks))) {
-    if (chunk->is_identical == false) {
-      MEM_freeN((void *)chunk->buf);
-    }
+    memfile_buffer_user_remove(chunk->buffer);
     MEM_freeN(chunk);
   }
+  if (memfile->id_ranges != NULL) {
+    BLI_ghash_free(memfile->id_ranges, NULL, MEM_freeN);
+    memfile->id_ranges = NULL;
+  }
+  memfile->id_range_current = NULL;
+  memfile->id_range_compare = NULL;
   memfile->size = 0;
+  memset(&memfile->stats, 0, sizeof(memfile->stats));
 }
 
 /* to keep list of memfiles consistent, 'first' is always first in list */
 /* result is that 'first' is being freed */
 void BLO_memfile_merge(MemFile *first, MemFile *second)
 {
-  MemFileChunk *fc, *sc;
-
-  fc = first->chunks.first;
-  sc = second->chunks.first;
-  while (fc || sc) {
-    if (fc && sc) {
-      if (sc->is_identical) {
-        sc->is_identical = false;
-        fc->is_identical = true;
-      }
-    }
-    if (fc) {
-      fc = fc->next;
-    }
-    if (sc) {
-      sc = sc->next;
-    }
-  }
-
+  /* Buffers are reference counted, the ones used by 'second' stay valid. */
+  UNUSED_VARS(second);
   BLO_memfile_free(first);
 }
 
@@ -98,14 +192,16 @@ void memfile_chunk_add(MemFile *memfile, const char *buf, uint size, MemFileChun
   curchunk->size = size;
   curchunk->buf = NULL;
   curchunk->is_identical = false;
+  curchunk->buffer = NULL;
   BLI_addtail(&memfile->chunks, curchunk);
 
-  /* we compare compchunk with buf */
+  /* we compare compchunk with buf, this avoids hashing the (common) unchanged chunks */
   if (*compchunk_step != NULL) {
     MemFileChunk *compchunk = *compchunk_step;
     if (compchunk->size == curchunk->size) {
       if (memcmp(compchunk->buf, buf, size) == 0) {
-        curchunk->buf = compchunk->buf;
+        curchunk->buffer = compchunk->buffer;
+        curchunk->buffer->users++;
         curchunk->is_identical = true;
       }
     }
@@ -113,12 +209,87 @@ void memfile_chunk_add(MemFile *memfile, const char *buf, uint size, MemFileChun
   }
 
   /* not equal... */
-  if (curchunk->buf == NULL) {
-    char *buf_new = MEM_mallocN(size, "Chunk buffer");
-    memcpy(buf_new, buf, size);
-    curchunk->buf = buf_new;
-    memfile->size += size;
+  if (curchunk->buffer == NULL) {
+    bool is_new;
+    curchunk->buffer = memfile_buffer_ensure(buf, size, &is_new);
+    if (is_new) {
+      memfile->size += size;
+    }
+    else {
+      memfile->stats.chunks_shared_len++;
+    }
+  }
+  else {
+    memfile->stats.chunks_shared_len++;
+  }
+  curchunk->buf = curchunk->buffer->data;
+
+  memfile->stats.chunks_len++;
+  memfile->stats.size_total += size;
+
+  MemFileIDRange *range = memfile->id_range_current;
+  if (range != NULL) {
+    if (range->chunk_first == NULL) {
+      range->chunk_first = curchunk;
+    }
+    range->chunks_len++;
+    if (!curchunk->is_identical) {
+      range->is_changed = true;
+    }
+  }
+}
+
+/**
+ * Start adding the chunks of an ID, when \a compare has chunks for the same ID,
+ * \a compchunk_step is moved to them so unchanged ID's are detected
+ * even when other data has been added or removed before them.
+ *
+ * \param id_key: Address of the ID, stable between steps as long as the ID isn't re-allocated.
+ */
+void memfile_id_begin(MemFile *memfile,
+                      MemFile *compare,
+                      const void *id_key,
+                      MemFileChunk **compchunk_step)
+{
+  BLI_assert(memfile->id_range_current == NULL);
+
+  if (memfile->id_ranges == NULL) {
+    memfile->id_ranges = BLI_ghash_ptr_new(__func__);
+  }
+
+  MemFileIDRange *range_compare = NULL;
+  if (compare != NULL && compare->id_ranges != NULL) {
+    range_compare = BLI_ghash_lookup(compare->id_ranges, id_key);
+    if (range_compare != NULL && range_compare->chunk_first != NULL) {
+      *compchunk_step = range_compare->chunk_first;
+    }
+  }
+
+  MemFileIDRange *range = MEM_callocN(sizeof(*range), __func__);
+  range->is_changed = (range_compare == NULL);
+  BLI_ghash_reinsert(memfile->id_ranges, (void *)id_key, range, NULL, MEM_freeN);
+
+  memfile->id_range_current = range;
+  memfile->id_range_compare = range_compare;
+}
+
+void memfile_id_end(MemFile *memfile)
+{
+  MemFileIDRange *range = memfile->id_range_current;
+  BLI_assert(range != NULL);
+
+  if (memfile->id_range_compare != NULL &&
+      memfile->id_range_compare->chunks_len != range->chunks_len) {
+    range->is_changed = true;
+  }
+
+  memfile->stats.ids_len++;
+  if (range->is_changed) {
+    memfile->stats.ids_changed_len++;
   }
+
+  memfile->id_range_current = NULL;
+  memfile->id_range_compare = NULL;
 }
 
 struct Main *BLO_memfile_main_get(struct MemFile *memfile,
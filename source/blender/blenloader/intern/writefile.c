@@ -144,7 +144,10 @@
 #include "MEM_guardedalloc.h"  // MEM_freeN
 #include "BLI_bitmap.h"
 #include "BLI_blenlib.h"
+#include "BLI_endian_switch.h"
+#include "BLI_math_base.h"
 #include "BLI_mempool.h"
+#include "BLI_task.h"
 
 #include "BKE_action.h"
 #include "BKE_blender_version.h"
@@ -174,6 +177,8 @@
 #include "BLO_undofile.h"
 #include "BLO_writefile.h"
 
+#include "PIL_time.h"
+
 #include "readfile.h"
 
 /* for SDNA_TYPE_FROM_STRUCT() macro */
@@ -200,6 +205,7 @@
 typedef enum {
   WW_WRAP_NONE = 1,
   WW_WRAP_ZLIB,
+  WW_WRAP_CHUNKED,
 } eWriteWrapType;
 
 typedef struct WriteWrap WriteWrap;
@@ -216,6 +222,7 @@ struct WriteWrap {
   union {
     int file_handle;
     gzFile gz_handle;
+    struct ChunkedWriter *chunked_handle;
   } _user_data;
 };
 
@@ -273,6 +280,197 @@ static size_t ww_write_zlib(WriteWrap *ww, const char *buf, size_t buf_len)
 }
 #undef FILE_HANDLE
 
+/* chunked zlib, see BLEND_CHUNKED_MAGIC */
+#define FILE_HANDLE(ww) (ww)->_user_data.chunked_handle
+
+typedef struct ChunkedWriterFrame {
+  char *raw;
+  uint raw_size;
+  void *compressed;
+  uint compressed_size;
+  bool is_ok;
+} ChunkedWriterFrame;
+
+typedef struct ChunkedWriter {
+  int file_handle;
+  uint64_t file_offset;
+
+  /* Frames are filled in order, then all of them are compressed at once
+   * on multiple threads and written out. */
+  ChunkedWriterFrame *frames;
+  int frames_len;
+  int frames_used;
+
+  /* Table of all frames written so far, written at the end of the file. */
+  BlendChunkedFrame *table;
+  int table_len;
+  int table_alloc;
+
+  bool error;
+} ChunkedWriter;
+
+static bool chunked_write_raw(ChunkedWriter *cw, const void *data, size_t data_len)
+{
+  if (cw->error) {
+    return false;
+  }
+  if ((size_t)write(cw->file_handle, data, data_len) != data_len) {
+    cw->error = true;
+    return false;
+  }
+  cw->file_offset += data_len;
+  return true;
+}
+
+static void chunked_frame_compress_cb(void *__restrict userdata,
+                                      const int index,
+                                      const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  ChunkedWriter *cw = userdata;
+  ChunkedWriterFrame *frame = &cw->frames[index];
+  uLongf compressed_size = compressBound(frame->raw_size);
+
+  if (frame->compressed == NULL) {
+    frame->compressed = MEM_mallocN(compressBound(BLEND_CHUNKED_FRAME_SIZE), __func__);
+  }
+  /* Level 1 matches the speed/size trade-off of the regular compressed files. */
+  frame->is_ok = (compress2(frame->compressed,
+                            &compressed_size,
+                            (const Bytef *)frame->raw,
+                            frame->raw_size,
+                            Z_BEST_SPEED) == Z_OK);
+  frame->compressed_size = (uint)compressed_size;
+}
+
+static void chunked_flush_frames(ChunkedWriter *cw)
+{
+  int frames_used = cw->frames_used;
+
+  /* The last frame may be partially filled (when closing). */
+  if (frames_used < cw->frames_len && cw->frames[frames_used].raw_size != 0) {
+    frames_used++;
+  }
+  if (frames_used == 0) {
+    return;
+  }
+
+  TaskParallelSettings settings;
+  BLI_parallel_range_settings_defaults(&settings);
+  settings.min_iter_per_thread = 1;
+  BLI_task_parallel_range(0, frames_used, cw, chunked_frame_compress_cb, &settings);
+
+  for (int i = 0; i < frames_used; i++) {
+    ChunkedWriterFrame *frame = &cw->frames[i];
+
+    if (cw->table_len == cw->table_alloc) {
+      cw->table_alloc = max_ii(256, cw->table_alloc * 2);
+      cw->table = MEM_reallocN(cw->table, sizeof(*cw->table) * (size_t)cw->table_alloc);
+    }
+    BlendChunkedFrame *entry = &cw->table[cw->table_len++];
+    entry->offset = cw->file_offset;
+    entry->compressed_size = frame->compressed_size;
+    entry->raw_size = frame->raw_size;
+
+    if (!frame->is_ok) {
+      cw->error = true;
+    }
+    chunked_write_raw(cw, frame->compressed, frame->compressed_size);
+
+    frame->raw_size = 0;
+  }
+
+  cw->frames_used = 0;
+}
+
+static bool ww_open_chunked(WriteWrap *ww, const char *filepath)
+{
+  int file;
+
+  file = BLI_open(filepath, O_BINARY + O_WRONLY + O_CREAT + O_TRUNC, 0666);
+
+  if (file == -1) {
+    return false;
+  }
+
+  ChunkedWriter *cw = MEM_callocN(sizeof(*cw), __func__);
+  cw->file_handle = file;
+  /* Enough frames to keep all threads busy, without holding on to too much memory. */
+  cw->frames_len = BLI_system_thread_count() * 2;
+  cw->frames = MEM_callocN(sizeof(*cw->frames) * (size_t)cw->frames_len, __func__);
+  for (int i = 0; i < cw->frames_len; i++) {
+    cw->frames[i].raw = MEM_mallocN(BLEND_CHUNKED_FRAME_SIZE, __func__);
+  }
+
+  uint32_t header[2] = {BLEND_CHUNKED_FRAME_SIZE, 0};
+#ifdef __BIG_ENDIAN__
+  BLI_endian_switch_uint32_array(header, ARRAY_SIZE(header));
+#endif
+  chunked_write_raw(cw, BLEND_CHUNKED_MAGIC, BLEND_CHUNKED_MAGIC_LEN);
+  chunked_write_raw(cw, header, sizeof(header));
+
+  FILE_HANDLE(ww) = cw;
+  return true;
+}
+static bool ww_close_chunked(WriteWrap *ww)
+{
+  ChunkedWriter *cw = FILE_HANDLE(ww);
+
+  chunked_flush_frames(cw);
+
+  uint64_t footer[2] = {cw->file_offset, (uint64_t)cw->table_len};
+#ifdef __BIG_ENDIAN__
+  for (int i = 0; i < cw->table_len; i++) {
+    BLI_endian_switch_uint64(&cw->table[i].offset);
+    BLI_endian_switch_uint32(&cw->table[i].compressed_size);
+    BLI_endian_switch_uint32(&cw->table[i].raw_size);
+  }
+  BLI_endian_switch_uint64_array(footer, ARRAY_SIZE(footer));
+#endif
+  if (cw->table_len != 0) {
+    chunked_write_raw(cw, cw->table, sizeof(*cw->table) * (size_t)cw->table_len);
+  }
+  chunked_write_raw(cw, footer, sizeof(footer));
+  chunked_write_raw(cw, BLEND_CHUNKED_MAGIC, BLEND_CHUNKED_MAGIC_LEN);
+
+  /* Close on write errors too, not to leak the file handle. */
+  const bool close_ok = (close(cw->file_handle) != -1);
+  const bool ok = !cw->error && close_ok;
+
+  for (int i = 0; i < cw->frames_len; i++) {
+    MEM_freeN(cw->frames[i].raw);
+    MEM_SAFE_FREE(cw->frames[i].compressed);
+  }
+  MEM_freeN(cw->frames);
+  MEM_SAFE_FREE(cw->table);
+  MEM_freeN(cw);
+
+  return ok;
+}
+static size_t ww_write_chunked(WriteWrap *ww, const char *buf, size_t buf_len)
+{
+  ChunkedWriter *cw = FILE_HANDLE(ww);
+  size_t written = 0;
+
+  while (written < buf_len) {
+    ChunkedWriterFrame *frame = &cw->frames[cw->frames_used];
+    const uint len = (uint)MIN2(buf_len - written, BLEND_CHUNKED_FRAME_SIZE - frame->raw_size);
+
+    memcpy(frame->raw + frame->raw_size, buf + written, len);
+    frame->raw_size += len;
+    written += len;
+
+    if (frame->raw_size == BLEND_CHUNKED_FRAME_SIZE) {
+      cw->frames_used++;
+      if (cw->frames_used == cw->frames_len) {
+        chunked_flush_frames(cw);
+      }
+    }
+  }
+
+  return cw->error ? 0 : written;
+}
+#undef FILE_HANDLE
+
 /* --- end compression types --- */
 
 static void ww_handle_init(eWriteWrapType ww_type, WriteWrap *r_ww)
@@ -287,6 +485,14 @@ static void ww_handle_init(eWriteWrapType ww_type, WriteWrap *r_ww)
       r_ww->use_buf = false;
       break;
     }
+    case WW_WRAP_CHUNKED: {
+      r_ww->open = ww_open_chunked;
+      r_ww->close = ww_close_chunked;
+      r_ww->write = ww_write_chunked;
+      /* Already buffered into frames. */
+      r_ww->use_buf = false;
+      break;
+    }
     default: {
       r_ww->open = ww_open_none;
       r_ww->close = ww_close_none;
@@ -399,6 +605,26 @@ static void mywrite_flush(WriteData *wd)
   }
 }
 
+/**
+ * Start writing an ID, for undo the ID gets its own chunks
+ * so the #MemFile can track which ID's changed since the previous step.
+ */
+static void mywrite_id_begin(WriteData *wd, ID *id)
+{
+  if (wd->use_memfile) {
+    mywrite_flush(wd);
+    memfile_id_begin(wd->mem.current, wd->mem.compare, id, &wd->mem.compare_chunk);
+  }
+}
+
+static void mywrite_id_end(WriteData *wd)
+{
+  if (wd->use_memfile) {
+    mywrite_flush(wd);
+    memfile_id_end(wd->mem.current);
+  }
+}
+
 /**
  * Low level WRITE(2) wrapper that buffers data
  * \param adr: Pointer to new chunk of data
@@ -3811,6 +4037,8 @@ static bool write_file_handle(Main *mainvar,
           BKE_lib_override_library_operations_store_start(bmain, override_storage, id);
         }
 
+        mywrite_id_begin(wd, id);
+
         switch ((ID_Type)GS(id->name)) {
           case ID_WM:
             write_windowmanager(wd, (wmWindowManager *)id);
@@ -3927,6 +4155,8 @@ static bool write_file_handle(Main *mainvar,
             break;
         }
 
+        mywrite_id_end(wd);
+
         if (do_override) {
           BKE_lib_override_library_operations_store_end(override_storage, id);
         }
@@ -4042,7 +4272,7 @@ bool BLO_write_file(Main *mainvar,
   BLI_snprintf(tempname, sizeof(tempname), "%s@", filepath);
 
   if (write_flags & G_FILE_COMPRESS) {
-    ww_type = WW_WRAP_ZLIB;
+    ww_type = (write_flags & G_FILE_COMPRESS_CHUNKED) ? WW_WRAP_CHUNKED : WW_WRAP_ZLIB;
   }
   else {
     ww_type = WW_WRAP_NONE;
@@ -4135,8 +4365,12 @@ bool BLO_write_file_mem(Main *mainvar, MemFile *compare, MemFile *current, int w
 {
   write_flags &= ~G_FILE_USERPREFS;
 
+  const double time_start = PIL_check_seconds_timer();
+
   const bool err = write_file_handle(mainvar, NULL, compare, current, write_flags, NULL);
 
+  current->stats.time_write = PIL_check_seconds_timer() - time_start;
+
   return (err == 0);
 }
 
@@ -579,13 +579,14 @@ void BM_mesh_bm_to_me(Main *bmain, BMesh *bm, Mesh *me, const struct BMeshToMesh
   if (me->key && (cd_shape_keyindex_offset != -1)) {
     /* Keep the old verts in case we are working on* a key, which is done at the end. */
 
-    /* Use the array in-place instead of duplicating the array. */
+    /* Use the array in-place instead of duplicating the array
+     * (unless it's still shared with an evaluated copy of the mesh). */
 #if 0
   oldverts = MEM_dupallocN(me->mvert);
 #else
-    oldverts = me->mvert;
-    me->mvert = NULL;
     CustomData_update_typemap(&me->vdata);
+    oldverts = CustomData_duplicate_referenced_layer(&me->vdata, CD_MVERT, me->totvert);
+    me->mvert = NULL;
     CustomData_set_layer(&me->vdata, CD_MVERT, NULL);
 #endif
   }
@@ -35,6 +35,7 @@
 
 #include "BLI_utildefines.h"
 #include "BLI_blenlib.h"
+#include "BLI_task.h"
 
 extern "C" {
 #include "DNA_action_types.h"
@@ -368,6 +369,13 @@ Relation *DepsgraphRelationBuilder::add_time_relation(TimeSourceNode *timesrc,
   return nullptr;
 }
 
+void DepsgraphRelationBuilder::add_pending_relations(const PendingRelations &relations)
+{
+  for (const PendingRelation &relation : relations) {
+    add_operation_relation(relation.from, relation.to, relation.description, relation.flags);
+  }
+}
+
 Relation *DepsgraphRelationBuilder::add_operation_relation(OperationNode *node_from,
                                                            OperationNode *node_to,
                                                            const char *description,
@@ -2508,11 +2516,30 @@ void DepsgraphRelationBuilder::build_scene_speakers(Scene * /*scene*/, ViewLayer
 
 void DepsgraphRelationBuilder::build_copy_on_write_relations()
 {
-  for (IDNode *id_node : graph_->id_nodes) {
-    build_copy_on_write_relations(id_node);
+  /* Relations of an ID are gathered from multiple threads, and added to the graph afterwards in
+   * the same order as if they were added one ID at a time. */
+  const int num_id_nodes = graph_->id_nodes.size();
+  vector<PendingRelations> id_relations(num_id_nodes);
+  CopyOnWriteRelationsData data;
+  data.builder = this;
+  data.id_relations = &id_relations;
+  TaskParallelSettings settings;
+  BLI_parallel_range_settings_defaults(&settings);
+  settings.min_iter_per_thread = 256;
+  BLI_task_parallel_range(0, num_id_nodes, &data, build_copy_on_write_relations_cb, &settings);
+  for (const PendingRelations &relations : id_relations) {
+    add_pending_relations(relations);
   }
 }
 
+void DepsgraphRelationBuilder::build_copy_on_write_relations_cb(
+    void *__restrict userdata, const int i, const TaskParallelTLS *__restrict /*tls*/)
+{
+  CopyOnWriteRelationsData *data = (CopyOnWriteRelationsData *)userdata;
+  const DepsgraphRelationBuilder *builder = data->builder;
+  builder->build_copy_on_write_relations(builder->graph_->id_nodes[i], &(*data->id_relations)[i]);
+}
+
 /* Nested datablocks (node trees, shape keys) requires special relation to
  * ensure owner's datablock remapping happens after node tree itself is ready.
  *
@@ -2543,6 +2570,14 @@ void DepsgraphRelationBuilder::build_nested_shapekey(ID *owner, Key *key)
 }
 
 void DepsgraphRelationBuilder::build_copy_on_write_relations(IDNode *id_node)
+{
+  PendingRelations relations;
+  build_copy_on_write_relations(id_node, &relations);
+  add_pending_relations(relations);
+}
+
+void DepsgraphRelationBuilder::build_copy_on_write_relations(IDNode *id_node,
+                                                             PendingRelations *relations) const
 {
   ID *id_orig = id_node->id_orig;
   const ID_Type id_type = GS(id_orig->name);
@@ -2594,8 +2629,7 @@ void DepsgraphRelationBuilder::build_copy_on_write_relations(IDNode *id_node)
      * copy of ID. */
     OperationNode *op_entry = comp_node->get_entry_operation();
     if (op_entry != nullptr) {
-      Relation *rel = graph_->add_new_relation(op_cow, op_entry, "CoW Dependency");
-      rel->flag |= rel_flag;
+      relations->push_back({op_cow, op_entry, "CoW Dependency", rel_flag});
     }
     /* All dangling operations should also be executed after copy-on-write. */
     GHASH_FOREACH_BEGIN (OperationNode *, op_node, comp_node->operations_map) {
@@ -2603,8 +2637,7 @@ void DepsgraphRelationBuilder::build_copy_on_write_relations(IDNode *id_node)
         continue;
       }
       if (op_node->inlinks.size() == 0) {
-        Relation *rel = graph_->add_new_relation(op_cow, op_node, "CoW Dependency");
-        rel->flag |= rel_flag;
+        relations->push_back({op_cow, op_node, "CoW Dependency", rel_flag});
       }
       else {
         bool has_same_comp_dependency = false;
@@ -2619,8 +2652,7 @@ void DepsgraphRelationBuilder::build_copy_on_write_relations(IDNode *id_node)
           }
         }
         if (!has_same_comp_dependency) {
-          Relation *rel = graph_->add_new_relation(op_cow, op_node, "CoW Dependency");
-          rel->flag |= rel_flag;
+          relations->push_back({op_cow, op_node, "CoW Dependency", rel_flag});
         }
       }
     }
@@ -2643,8 +2675,8 @@ void DepsgraphRelationBuilder::build_copy_on_write_relations(IDNode *id_node)
       if (deg_copy_on_write_is_needed(object_data_id)) {
         OperationKey data_copy_on_write_key(
             object_data_id, NodeType::COPY_ON_WRITE, OperationCode::COPY_ON_WRITE);
-        add_relation(
-            data_copy_on_write_key, copy_on_write_key, "Eval Order", RELATION_FLAG_GODMODE);
+        relations->push_back(
+            {find_node(data_copy_on_write_key), op_cow, "Eval Order", RELATION_FLAG_GODMODE});
       }
     }
     else {
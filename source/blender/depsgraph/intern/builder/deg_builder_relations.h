@@ -69,6 +69,7 @@ struct ParticleSettings;
 struct ParticleSystem;
 struct Scene;
 struct Speaker;
+struct TaskParallelTLS;
 struct Tex;
 struct ViewLayer;
 struct World;
@@ -327,6 +328,22 @@ class DepsgraphRelationBuilder : public DepsgraphBuilder {
                                    const char *description,
                                    int flags = 0);
 
+  /* Relation which is to be added to the graph later on. Used when relations are gathered from
+   * multiple threads, which are not allowed to modify the graph. */
+  struct PendingRelation {
+    OperationNode *from;
+    OperationNode *to;
+    const char *description;
+    int flags;
+  };
+  typedef vector<PendingRelation> PendingRelations;
+
+  void add_pending_relations(const PendingRelations &relations);
+
+  /* Gather copy-on-write relations of the given ID without modifying the graph, so it is safe to
+   * be called for different IDs from multiple threads. */
+  void build_copy_on_write_relations(IDNode *id_node, PendingRelations *relations) const;
+
   template<typename KeyType>
   DepsNodeHandle create_node_handle(const KeyType &key, const char *default_name = "");
 
@@ -357,6 +374,15 @@ class DepsgraphRelationBuilder : public DepsgraphBuilder {
 
   static void constraint_walk(bConstraint *con, ID **idpoin, bool is_reference, void *user_data);
 
+  struct CopyOnWriteRelationsData {
+    const DepsgraphRelationBuilder *builder;
+    vector<PendingRelations> *id_relations;
+  };
+
+  static void build_copy_on_write_relations_cb(void *__restrict userdata,
+                                               const int i,
+                                               const TaskParallelTLS *__restrict tls);
+
   /* State which demotes currently built entities. */
   Scene *scene_;
 
@@ -28,6 +28,7 @@
 #include "intern/node/deg_node.h"
 #include "intern/node/deg_node_component.h"
 #include "intern/node/deg_node_operation.h"
+#include "intern/node/deg_node_time.h"
 
 #include "intern/depsgraph.h"
 #include "intern/depsgraph_relation.h"
@@ -40,8 +41,14 @@ namespace DEG {
 /* Performs a transitive reduction to remove redundant relations.
  * https://en.wikipedia.org/wiki/Transitive_reduction
  *
- * XXX The current implementation is somewhat naive and has O(V*E) worst case
- * runtime.
+ * For every operation all the nodes it can be reached from are tagged, walking the graph
+ * backwards starting from its direct dependencies. A direct dependency which gets tagged is
+ * reachable through another one, so the relation to it is redundant.
+ *
+ * Tags are stored as a visit stamp, so they don't need to be cleared for every operation, and
+ * operations with a single dependency are skipped since they can not have redundant relations.
+ * This keeps the cost at the number of ancestors of operations with multiple dependencies, but
+ * is still O(V*E) in the worst case.
  * A more optimized algorithm can be implemented later, e.g.
  *
  *   http://www.sciencedirect.com/science/article/pii/0304397588900321/pdf?md5=3391e309b708b6f9cdedcd08f84f4afc&pid=1-s2.0-0304397588900321-main.pdf
@@ -50,48 +57,77 @@ namespace DEG {
  * too! (unless we can to prevent this case early on).
  */
 
-enum {
-  OP_VISITED = 1,
-  OP_REACHABLE = 2,
-};
+namespace {
+
+/* Node's custom flags store the stamp of the last visit shifted by one, and whether the node was
+ * reached from another dependency of the operation in the lowest bit. */
+const int OP_REACHABLE = 1;
+
+inline bool node_is_visited(const Node *node, int stamp)
+{
+  return (node->custom_flags >> 1) == stamp;
+}
+
+inline void node_tag_visited(Node *node, int stamp)
+{
+  node->custom_flags = stamp << 1;
+}
 
-static void deg_graph_tag_paths_recursive(Node *node)
+/* Tag all nodes from which the given node can be reached as such. */
+void deg_graph_tag_paths(Node *node, int stamp, vector<Node *> &stack)
 {
-  if (node->custom_flags & OP_VISITED) {
+  if (node_is_visited(node, stamp)) {
     return;
   }
-  node->custom_flags |= OP_VISITED;
-  for (Relation *rel : node->inlinks) {
-    deg_graph_tag_paths_recursive(rel->from);
-    /* Do this only in inlinks loop, so the target node does not get
-     * flagged. */
-    rel->from->custom_flags |= OP_REACHABLE;
+  node_tag_visited(node, stamp);
+  stack.push_back(node);
+  while (!stack.empty()) {
+    Node *current = stack.back();
+    stack.pop_back();
+    for (Relation *rel : current->inlinks) {
+      Node *from = rel->from;
+      if (!node_is_visited(from, stamp)) {
+        node_tag_visited(from, stamp);
+        stack.push_back(from);
+      }
+      /* Do this only in inlinks loop, so the starting node does not get flagged. */
+      from->custom_flags |= OP_REACHABLE;
+    }
   }
 }
 
+}  // namespace
+
 void deg_graph_transitive_reduction(Depsgraph *graph)
 {
   int num_removed_relations = 0;
+  for (OperationNode *node : graph->operations) {
+    node->custom_flags = 0;
+  }
+  if (graph->time_source != nullptr) {
+    graph->time_source->custom_flags = 0;
+  }
+  vector<Node *> stack;
+  int stamp = 0;
   for (OperationNode *target : graph->operations) {
-    /* Clear tags. */
-    for (OperationNode *node : graph->operations) {
-      node->custom_flags = 0;
+    if (target->inlinks.size() < 2) {
+      continue;
     }
+    stamp++;
     /* Mark nodes from which we can reach the target
      * start with children, so the target node and direct children are not
      * flagged. */
-    target->custom_flags |= OP_VISITED;
+    node_tag_visited(target, stamp);
     for (Relation *rel : target->inlinks) {
-      deg_graph_tag_paths_recursive(rel->from);
+      deg_graph_tag_paths(rel->from, stamp, stack);
     }
     /* Remove redundant paths to the target. */
     for (Node::Relations::const_iterator it_rel = target->inlinks.begin();
          it_rel != target->inlinks.end();) {
       Relation *rel = *it_rel;
       if (rel->from->type == NodeType::TIMESOURCE) {
-        /* HACK: time source nodes don't get "custom_flags" flag
-         * set/cleared. */
-        /* TODO: there will be other types in future, so iterators above
+        /* HACK: time source nodes are not part of the operations.
+         * TODO: there will be other types in future, so iterators above
          * need modifying. */
         ++it_rel;
       }
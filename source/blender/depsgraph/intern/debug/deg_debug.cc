@@ -35,7 +35,11 @@
 namespace DEG {
 
 DepsgraphDebug::DepsgraphDebug()
-    : flags(G.debug), is_ever_evaluated(false), graph_evaluation_start_time_(0)
+    : flags(G.debug),
+      is_ever_evaluated(false),
+      copied_bytes(0),
+      num_copied_ids(0),
+      graph_evaluation_start_time_(0)
 {
 }
 
@@ -68,6 +72,9 @@ void DepsgraphDebug::end_graph_evaluation()
   const double graph_eval_end_time = PIL_check_seconds_timer();
   printf("Depsgraph updated in %f seconds.\n", graph_eval_end_time - graph_evaluation_start_time_);
   printf("Depsgraph evaluation FPS: %f\n", 1.0f / fps_samples_.get_averaged());
+  printf("Depsgraph copy-on-write: %zu bytes copied for %d data-blocks.\n",
+         copied_bytes,
+         num_copied_ids);
 
   is_ever_evaluated = true;
 }
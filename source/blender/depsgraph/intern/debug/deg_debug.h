@@ -52,6 +52,11 @@ class DepsgraphDebug {
    * This is NOT an indication that depsgraph is at its evaluated state. */
   bool is_ever_evaluated;
 
+  /* Memory copied by copy-on-write during the last evaluation, and number of data-blocks it was
+   * copied for. Only gathered when time debug is enabled. */
+  size_t copied_bytes;
+  int num_copied_ids;
+
  protected:
   /* Maximum number of counters used to calculate frame rate of depsgraph update. */
   static const constexpr int MAX_FPS_COUNTERS = 64;
@@ -646,6 +646,14 @@ void graph_id_tag_update(
    * Allows to have more granularity than a node-factory based flags. */
   if (id_node != nullptr) {
     id_node->id_cow->recalc |= flag;
+    id_node->tagged_recalc |= flag;
+    /* Updates which are not coming from an edit of the datablock itself (relations or visibility
+     * changes) might have invalidated any part of the copy, force it to be fully re-created.
+     * This is different from an explicit copy-on-write tag, which RNA adds to every property
+     * update together with the tag of the property. */
+    if (flag == 0 || !ELEM(update_source, DEG_UPDATE_SOURCE_USER_EDIT, DEG_UPDATE_SOURCE_TIME)) {
+      id_node->tagged_recalc |= ID_RECALC_ALL;
+    }
   }
   /* When ID is tagged for update based on an user edits store the recalc flags in the original ID.
    * This way IDs in the undo steps will have this flag preserved, making it possible to restore
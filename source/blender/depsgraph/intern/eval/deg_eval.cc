@@ -32,6 +32,7 @@
 #include "BLI_task.h"
 #include "BLI_ghash.h"
 #include "BLI_gsqueue.h"
+#include "BLI_vector.h"
 
 #include "BKE_global.h"
 
@@ -69,10 +70,65 @@ void schedule_children(DepsgraphEvalState *state,
                        ScheduleFunction *schedule_function,
                        ScheduleFunctionArgs... schedule_function_args);
 
-void schedule_node_to_pool(OperationNode *node, const int thread_id, TaskPool *pool)
+/* Operations which became ready for evaluation. */
+typedef BLI::Vector<OperationNode *, 16> ReadyOperations;
+
+void schedule_node_to_ready_list(OperationNode *node,
+                                 const int /*thread_id*/,
+                                 ReadyOperations *ready_nodes)
+{
+  ready_nodes->append(node);
+}
+
+bool critical_path_time_comparator(const OperationNode *a, const OperationNode *b)
+{
+  return a->critical_path_time < b->critical_path_time;
+}
+
+/* Push operations to the pool in a way that the ones with the longest chain of operations
+ * depending on them are picked up first.
+ *
+ * From the main thread tasks are pushed to the head of the shared queue, which is where threads
+ * take tasks from. From worker threads they are pushed to the head of the thread's own queue,
+ * which is where other threads steal tasks from. */
+void push_ready_nodes_to_pool(ReadyOperations &ready_nodes, const int thread_id, TaskPool *pool)
 {
-  BLI_task_pool_push_from_thread(
-      pool, deg_task_run_func, node, false, TASK_PRIORITY_HIGH, thread_id);
+  std::sort(ready_nodes.begin(), ready_nodes.end(), critical_path_time_comparator);
+  const TaskPriority priority = (thread_id == -1) ? TASK_PRIORITY_HIGH : TASK_PRIORITY_LOW;
+  for (OperationNode *node : ready_nodes) {
+    BLI_task_pool_push_from_thread(pool, deg_task_run_func, node, false, priority, thread_id);
+  }
+}
+
+/* Choose operation which the current thread evaluates next, it is removed from the list.
+ * Operations of the same ID are preferred since their data is likely to be in the CPU cache
+ * already, among those the one on the critical path. */
+OperationNode *pop_next_ready_node(const OperationNode *evaluated_node,
+                                   ReadyOperations &ready_nodes)
+{
+  if (ready_nodes.empty()) {
+    return nullptr;
+  }
+  const IDNode *id_node = evaluated_node->owner->owner;
+  uint best_index = 0;
+  bool best_is_same_id = false;
+  for (uint i = 0; i < ready_nodes.size(); i++) {
+    const OperationNode *node = ready_nodes[i];
+    const bool is_same_id = (node->owner->owner == id_node);
+    if (is_same_id != best_is_same_id) {
+      if (is_same_id) {
+        best_index = i;
+        best_is_same_id = true;
+      }
+      continue;
+    }
+    if (node->critical_path_time > ready_nodes[best_index]->critical_path_time) {
+      best_index = i;
+    }
+  }
+  OperationNode *next_node = ready_nodes[best_index];
+  ready_nodes.remove_and_reorder(best_index);
+  return next_node;
 }
 
 /* Denotes which part of dependency graph is being evaluated. */
@@ -105,15 +161,10 @@ void evaluate_node(const DepsgraphEvalState *state, OperationNode *operation_nod
 
   /* Sanity checks. */
   BLI_assert(!operation_node->is_noop() && "NOOP nodes should not actually be scheduled");
-  /* Perform operation. */
-  if (state->do_stats) {
-    const double start_time = PIL_check_seconds_timer();
-    operation_node->evaluate(depsgraph);
-    operation_node->stats.current_time += PIL_check_seconds_timer() - start_time;
-  }
-  else {
-    operation_node->evaluate(depsgraph);
-  }
+  /* Perform operation. Time is always measured, it is used to find the critical path. */
+  const double start_time = PIL_check_seconds_timer();
+  operation_node->evaluate(depsgraph);
+  operation_node->stats.add_evaluation_time(PIL_check_seconds_timer() - start_time);
 }
 
 void deg_task_run_func(TaskPool *pool, void *taskdata, int thread_id)
@@ -121,14 +172,24 @@ void deg_task_run_func(TaskPool *pool, void *taskdata, int thread_id)
   void *userdata_v = BLI_task_pool_userdata(pool);
   DepsgraphEvalState *state = (DepsgraphEvalState *)userdata_v;
 
-  /* Evaluate node. */
   OperationNode *operation_node = reinterpret_cast<OperationNode *>(taskdata);
-  evaluate_node(state, operation_node);
+  ReadyOperations ready_nodes;
+  while (operation_node != nullptr) {
+    /* Evaluate node. */
+    evaluate_node(state, operation_node);
 
-  /* Schedule children. */
-  BLI_task_pool_delayed_push_begin(pool, thread_id);
-  schedule_children(state, operation_node, thread_id, schedule_node_to_pool, pool);
-  BLI_task_pool_delayed_push_end(pool, thread_id);
+    /* Schedule children. One of them is evaluated by this thread right away, avoiding overhead
+     * of the task pool and keeping chains of operations on the same thread. */
+    ready_nodes.clear();
+    schedule_children(state, operation_node, thread_id, schedule_node_to_ready_list, &ready_nodes);
+    OperationNode *next_node = pop_next_ready_node(operation_node, ready_nodes);
+    if (!ready_nodes.empty()) {
+      BLI_task_pool_delayed_push_begin(pool, thread_id);
+      push_ready_nodes_to_pool(ready_nodes, thread_id, pool);
+      BLI_task_pool_delayed_push_end(pool, thread_id);
+    }
+    operation_node = next_node;
+  }
 }
 
 bool check_operation_node_visible(OperationNode *op_node)
@@ -181,16 +242,15 @@ void calculate_pending_parents(Depsgraph *graph)
   }
 }
 
-void initialize_execution(DepsgraphEvalState *state, Depsgraph *graph)
+void initialize_execution(DepsgraphEvalState * /*state*/, Depsgraph *graph)
 {
-  const bool do_stats = state->do_stats;
   calculate_pending_parents(graph);
   /* Clear tags and other things which needs to be clear. */
   for (OperationNode *node : graph->operations) {
-    if (do_stats) {
-      node->stats.reset_current();
-    }
+    node->stats.reset_current();
   }
+  /* Prioritize operations using time they took in the previous evaluations. */
+  deg_eval_stats_critical_path(graph, false);
 }
 
 bool is_metaball_object_operation(const OperationNode *operation_node)
@@ -336,6 +396,22 @@ void evaluate_graph_single_threaded(DepsgraphEvalState *state)
   BLI_gsqueue_free(evaluation_queue);
 }
 
+void schedule_graph_to_pool(DepsgraphEvalState *state, TaskPool *pool)
+{
+  ReadyOperations ready_nodes;
+  schedule_graph(state, schedule_node_to_ready_list, &ready_nodes);
+  push_ready_nodes_to_pool(ready_nodes, -1, pool);
+}
+
+/* Time passed since the given start time, which is then moved to the current time. */
+double stage_time_advance(double *r_start_time)
+{
+  const double current_time = PIL_check_seconds_timer();
+  const double stage_time = current_time - *r_start_time;
+  *r_start_time = current_time;
+  return stage_time;
+}
+
 void depsgraph_ensure_view_layer(Depsgraph *graph)
 {
   /* We update copy-on-write scene in the following cases:
@@ -368,6 +444,9 @@ void deg_evaluate_on_refresh(Depsgraph *graph)
 
   graph->debug.begin_graph_evaluation();
 
+  EvaluationStagesTime stages_time = {0.0, 0.0, 0.0, 0.0};
+  double stage_start_time = PIL_check_seconds_timer();
+
   graph->is_evaluating = true;
   depsgraph_ensure_view_layer(graph);
   /* Set up evaluation state. */
@@ -389,23 +468,27 @@ void deg_evaluate_on_refresh(Depsgraph *graph)
   TaskPool *task_pool = BLI_task_pool_create_suspended(task_scheduler, &state);
   /* Prepare all nodes for evaluation. */
   initialize_execution(&state, graph);
+  stages_time.prepare = stage_time_advance(&stage_start_time);
 
   /* Do actual evaluation now. */
 
   /* First, process all Copy-On-Write nodes. */
   state.stage = EvaluationStage::COPY_ON_WRITE;
-  schedule_graph(&state, schedule_node_to_pool, task_pool);
+  schedule_graph_to_pool(&state, task_pool);
   BLI_task_pool_work_wait_and_reset(task_pool);
+  stages_time.copy_on_write = stage_time_advance(&stage_start_time);
 
   /* After that, process all other nodes. */
   state.stage = EvaluationStage::THREADED_EVALUATION;
-  schedule_graph(&state, schedule_node_to_pool, task_pool);
+  schedule_graph_to_pool(&state, task_pool);
   BLI_task_pool_work_and_wait(task_pool);
   BLI_task_pool_free(task_pool);
+  stages_time.threaded_evaluation = stage_time_advance(&stage_start_time);
 
   if (state.need_single_thread_pass) {
     state.stage = EvaluationStage::SINGLE_THREADED_WORKAROUND;
     evaluate_graph_single_threaded(&state);
+    stages_time.single_threaded = stage_time_advance(&stage_start_time);
   }
 
   /* Finalize statistics gathering. This is because we only gather single
@@ -413,6 +496,8 @@ void deg_evaluate_on_refresh(Depsgraph *graph)
    * synchronization. */
   if (state.do_stats) {
     deg_eval_stats_aggregate(graph);
+    deg_eval_stats_print_report(
+        graph, stages_time, BLI_task_scheduler_num_threads(task_scheduler));
   }
   /* Clear any uncleared tags - just in case. */
   deg_graph_clear_tags(graph);
@@ -41,6 +41,7 @@
 #include "BLI_string.h"
 
 #include "BKE_curve.h"
+#include "BKE_customdata.h"
 #include "BKE_global.h"
 #include "BKE_idprop.h"
 #include "BKE_layer.h"
@@ -56,6 +57,7 @@ extern "C" {
 #include "DNA_ID.h"
 #include "DNA_anim_types.h"
 #include "DNA_armature_types.h"
+#include "DNA_material_types.h"
 #include "DNA_mesh_types.h"
 #include "DNA_modifier_types.h"
 #include "DNA_scene_types.h"
@@ -97,7 +99,9 @@ extern "C" {
 #include "intern/builder/deg_builder_nodes.h"
 #include "intern/eval/deg_eval_runtime_backup.h"
 #include "intern/node/deg_node.h"
+#include "intern/node/deg_node_component.h"
 #include "intern/node/deg_node_id.h"
+#include "intern/node/deg_node_operation.h"
 
 namespace DEG {
 
@@ -298,6 +302,16 @@ bool id_copy_inplace_no_main(const ID *id, ID *newid)
   return result;
 }
 
+/* Same as id_copy_inplace_no_main(), with the custom data layers shared with the original
+ * mesh. Meshes don't have nested IDs, no need for the workarounds. */
+bool mesh_copy_inplace_no_main(const Mesh *mesh, Mesh *new_mesh)
+{
+  return BKE_id_copy_ex(nullptr,
+                        &mesh->id,
+                        (ID **)&new_mesh,
+                        LIB_ID_COPY_LOCALIZE | LIB_ID_CREATE_NO_ALLOCATE | LIB_ID_COPY_CD_SHARE);
+}
+
 /* Similar to BKE_scene_copy() but does not require main and assumes pointer
  * is already allocated. */
 bool scene_copy_inplace_no_main(const Scene *scene, Scene *new_scene)
@@ -857,8 +871,6 @@ ID *deg_expand_copy_on_write_datablock(const Depsgraph *depsgraph,
   }
   // BLI_assert(check_datablock_expanded(id_cow) == false);
   /* Copy data from original ID to a copied version. */
-  /* TODO(sergey): Avoid doing full ID copy somehow, make Mesh to reference
-   * original geometry arrays for until those are modified. */
   /* TODO(sergey): We do some trickery with temp bmain and extra ID pointer
    * just to be able to use existing API. Ideally we need to replace this with
    * in-place copy from existing datablock to a prepared memory.
@@ -882,8 +894,17 @@ ID *deg_expand_copy_on_write_datablock(const Depsgraph *depsgraph,
       break;
     }
     case ID_ME: {
-      /* TODO(sergey): Ideally we want to handle meshes in a special
-       * manner here to avoid initial copy of all the geometry arrays. */
+      /* Share geometry arrays with the original mesh instead of copying them. Evaluation
+       * duplicates them before writing.
+       * Editing code mostly writes into the original arrays in place: it runs while the
+       * dependency graph isn't evaluated and tags the mesh, which replaces this copy before
+       * it's used again. Paint modes keep writing without replacing it, they duplicate the
+       * shared arrays of the original first (see #BKE_mesh_duplicate_shared_layers).
+       * Render dependency graphs are evaluated from their own thread while the original can
+       * be edited, so they keep making full copies. */
+      if (depsgraph->is_active) {
+        done = mesh_copy_inplace_no_main((const Mesh *)id_orig, (Mesh *)id_cow);
+      }
       break;
     }
     default:
@@ -1067,6 +1088,134 @@ void deg_free_copy_on_write_datablock(ID *id_cow)
   id_cow->name[0] = '\0';
 }
 
+namespace {
+
+/* Recalc flags for which an object can be updated without re-creating its copy. */
+const int object_transform_recalc = (ID_RECALC_TRANSFORM | ID_RECALC_POINT_CACHE);
+
+/* Check whether the copy of an object only needs to have its transform synchronized with the
+ * original. This is the case for transform tools, which tag the transform only. Settings edited
+ * from the interface are also tagged for copy-on-write and get a full copy, as they might be
+ * nested in lists of the object. */
+bool object_is_transform_update(const IDNode *id_node)
+{
+  const int recalc = id_node->tagged_recalc;
+  if ((recalc & ID_RECALC_TRANSFORM) == 0 || (recalc & ~object_transform_recalc) != 0) {
+    return false;
+  }
+  if (GS(id_node->id_orig->name) != ID_OB || !check_datablock_expanded(id_node->id_cow)) {
+    return false;
+  }
+  const Object *object_orig = (const Object *)id_node->id_orig;
+  /* Bones and constraints have their own transform which is stored in lists. Physics settings
+   * are edited in-place and also only tag the transform. */
+  if (object_orig->pose != nullptr || !BLI_listbase_is_empty(&object_orig->constraints) ||
+      object_orig->pd != nullptr || object_orig->soft != nullptr ||
+      object_orig->rigidbody_object != nullptr || object_orig->rigidbody_constraint != nullptr) {
+    return false;
+  }
+  return true;
+}
+
+size_t datablock_copy_range(const void *id_orig,
+                            void *id_cow,
+                            const size_t offset_begin,
+                            const size_t offset_end)
+{
+  const size_t size = offset_end - offset_begin;
+  memcpy((char *)id_cow + offset_begin, (const char *)id_orig + offset_begin, size);
+  return size;
+}
+
+/* Synchronize all the settings stored directly in the object which are not pointers, keeping
+ * all the data owned by the copy (modifiers, evaluated geometry, runtime) intact.
+ * Returns number of bytes copied. */
+size_t object_update_transform(const IDNode *id_node)
+{
+  const Object *object_orig = (const Object *)id_node->id_orig;
+  Object *object_cow = (Object *)id_node->id_cow;
+  size_t copied_bytes = 0;
+  copied_bytes += datablock_copy_range(
+      object_orig, object_cow, offsetof(Object, type), offsetof(Object, parent));
+  /* Base flags are flushed to the copy from the view layer, keep them. */
+  copied_bytes += datablock_copy_range(
+      object_orig, object_cow, offsetof(Object, loc), offsetof(Object, base_flag));
+  copied_bytes += datablock_copy_range(
+      object_orig, object_cow, offsetof(Object, col_group), offsetof(Object, constraints));
+  copied_bytes += datablock_copy_range(
+      object_orig, object_cow, offsetof(Object, ima_ofs), offsetof(Object, iuser));
+  copied_bytes += datablock_copy_range(object_orig,
+                                       object_cow,
+                                       offsetof(Object, empty_image_visibility_flag),
+                                       offsetof(Object, lodlevels));
+  return copied_bytes;
+}
+
+/* Recalc flags for which a material can be updated without re-creating its copy. */
+const int material_shading_recalc = (ID_RECALC_SHADING | ID_RECALC_COPY_ON_WRITE);
+
+/* Check whether the copy of a material only needs its settings to be synchronized with the
+ * original. Edits of the material settings tag shading, while edits of its node tree tag the
+ * material with no flags and get a full copy. */
+bool material_is_shading_update(const IDNode *id_node)
+{
+  const int recalc = id_node->tagged_recalc;
+  if ((recalc & ID_RECALC_SHADING) == 0 || (recalc & ~material_shading_recalc) != 0) {
+    return false;
+  }
+  if (GS(id_node->id_orig->name) != ID_MA || !check_datablock_expanded(id_node->id_cow)) {
+    return false;
+  }
+  const Material *material_orig = (const Material *)id_node->id_orig;
+  const Material *material_cow = (const Material *)id_node->id_cow;
+  /* Nested data is not synchronized, make sure the copy has the same one. Grease pencil styles
+   * are edited with the material settings, so they always get a full copy. */
+  if ((material_orig->nodetree == nullptr) != (material_cow->nodetree == nullptr) ||
+      material_orig->tot_slots != material_cow->tot_slots || material_orig->gp_style != nullptr ||
+      material_cow->gp_style != nullptr) {
+    return false;
+  }
+  return true;
+}
+
+/* Synchronize the settings stored directly in the material, keeping its node tree and texture
+ * paint slots. GPU materials are freed by the material evaluation which follows.
+ * Returns number of bytes copied. */
+size_t material_update_shading(const IDNode *id_node)
+{
+  const Material *material_orig = (const Material *)id_node->id_orig;
+  Material *material_cow = (Material *)id_node->id_cow;
+  size_t copied_bytes = 0;
+  copied_bytes += datablock_copy_range(
+      material_orig, material_cow, offsetof(Material, flag), offsetof(Material, nodetree));
+  copied_bytes += datablock_copy_range(material_orig,
+                                       material_cow,
+                                       offsetof(Material, line_col),
+                                       offsetof(Material, texpaintslot));
+  return copied_bytes;
+}
+
+/* Memory allocated for a full copy of the given data-block. Only the data which is owned by
+ * the copy is taken into account, nested data other than geometry is ignored. */
+size_t copied_datablock_size(const ID *id_cow)
+{
+  if (!deg_copy_on_write_is_needed(id_cow)) {
+    return 0;
+  }
+  size_t size = MEM_allocN_len(id_cow);
+  if (GS(id_cow->name) == ID_ME) {
+    const Mesh *mesh_cow = (const Mesh *)id_cow;
+    size += CustomData_get_owned_data_size(&mesh_cow->vdata, mesh_cow->totvert);
+    size += CustomData_get_owned_data_size(&mesh_cow->edata, mesh_cow->totedge);
+    size += CustomData_get_owned_data_size(&mesh_cow->fdata, mesh_cow->totface);
+    size += CustomData_get_owned_data_size(&mesh_cow->ldata, mesh_cow->totloop);
+    size += CustomData_get_owned_data_size(&mesh_cow->pdata, mesh_cow->totpoly);
+  }
+  return size;
+}
+
+}  // namespace
+
 void deg_evaluate_copy_on_write(struct ::Depsgraph *graph, const IDNode *id_node)
 {
   const DEG::Depsgraph *depsgraph = reinterpret_cast<const DEG::Depsgraph *>(graph);
@@ -1076,7 +1225,27 @@ void deg_evaluate_copy_on_write(struct ::Depsgraph *graph, const IDNode *id_node
      * ensures scene and view layer pointers are valid. */
     return;
   }
-  deg_update_copy_on_write_datablock(depsgraph, id_node);
+  const bool do_stats = depsgraph->debug.do_time_debug();
+  size_t copied_bytes = 0;
+  /* Copy only what was changed when possible, everything else (and any update which we can not
+   * reason about) re-creates the copy from scratch. */
+  if (object_is_transform_update(id_node)) {
+    copied_bytes = object_update_transform(id_node);
+  }
+  else if (material_is_shading_update(id_node)) {
+    copied_bytes = material_update_shading(id_node);
+  }
+  else {
+    deg_update_copy_on_write_datablock(depsgraph, id_node);
+    if (do_stats) {
+      copied_bytes = copied_datablock_size(id_node->id_cow);
+    }
+  }
+  if (do_stats) {
+    ComponentNode *comp_node = id_node->find_component(NodeType::COPY_ON_WRITE);
+    OperationNode *op_node = comp_node->find_operation(OperationCode::COPY_ON_WRITE, "", -1);
+    op_node->stats.current_copied_bytes = copied_bytes;
+  }
 }
 
 bool deg_validate_copy_on_write_datablock(ID *id_cow)
@@ -394,6 +394,10 @@ void deg_graph_clear_tags(Depsgraph *graph)
   }
   /* Clear any entry tags which haven't been flushed. */
   BLI_gset_clear(graph->entry_tags, nullptr);
+  /* Clear explicit recalc flags used by copy-on-write. */
+  for (IDNode *id_node : graph->id_nodes) {
+    id_node->tagged_recalc = 0;
+  }
 }
 
 }  // namespace DEG
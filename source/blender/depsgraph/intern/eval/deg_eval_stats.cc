@@ -23,10 +23,18 @@
 
 #include "intern/eval/deg_eval_stats.h"
 
+#include <cstdio>
+
 #include "BLI_utildefines.h"
 #include "BLI_ghash.h"
+#include "BLI_math_base.h"
+
+extern "C" {
+#include "DNA_ID.h"
+} /* extern "C" */
 
 #include "intern/depsgraph.h"
+#include "intern/depsgraph_relation.h"
 
 #include "intern/node/deg_node.h"
 #include "intern/node/deg_node_component.h"
@@ -47,12 +55,195 @@ void deg_eval_stats_aggregate(Depsgraph *graph)
     GHASH_FOREACH_END();
     id_node->stats.reset_current();
   }
-  /* Now accumulate operation timings to components and IDs. */
+  graph->debug.copied_bytes = 0;
+  graph->debug.num_copied_ids = 0;
+  /* Now accumulate operation timings and copied memory to components and IDs. */
   for (OperationNode *op_node : graph->operations) {
     ComponentNode *comp_node = op_node->owner;
     IDNode *id_node = comp_node->owner;
     id_node->stats.current_time += op_node->stats.current_time;
     comp_node->stats.current_time += op_node->stats.current_time;
+    const size_t copied_bytes = op_node->stats.current_copied_bytes;
+    if (copied_bytes != 0) {
+      id_node->stats.current_copied_bytes += copied_bytes;
+      comp_node->stats.current_copied_bytes += copied_bytes;
+      graph->debug.copied_bytes += copied_bytes;
+      graph->debug.num_copied_ids++;
+    }
+  }
+}
+
+namespace {
+
+/* Time used for operations which were never evaluated yet, so chains of such operations are still
+ * prioritized by their length. */
+const double DEFAULT_OPERATION_TIME = 1e-6;
+
+/* Markers used for critical path time of operations while the graph is being traversed. */
+const double CRITICAL_PATH_UNKNOWN = -1.0;
+const double CRITICAL_PATH_IN_PROGRESS = -2.0;
+
+/* Number of slowest data-blocks listed in the evaluation report. */
+const int REPORT_NUM_SLOWEST_IDS = 10;
+
+/* Matches the check done by the evaluation engine when scheduling operations. */
+bool operation_needs_evaluation(const OperationNode *op_node)
+{
+  if ((op_node->flag & DEPSOP_FLAG_NEEDS_UPDATE) == 0) {
+    return false;
+  }
+  const ComponentNode *comp_node = op_node->owner;
+  return comp_node->type == NodeType::COPY_ON_WRITE || comp_node->affects_directly_visible;
+}
+
+double operation_time(const OperationNode *op_node, bool use_current_time)
+{
+  if (op_node->is_noop()) {
+    return 0.0;
+  }
+  if (use_current_time) {
+    return op_node->stats.current_time;
+  }
+  const double average_time = op_node->stats.average_time;
+  return (average_time != 0.0) ? average_time : DEFAULT_OPERATION_TIME;
+}
+
+struct StatsEntry {
+  const IDNode *id_node;
+  double time;
+};
+
+bool stat_entry_comparator(const StatsEntry &a, const StatsEntry &b)
+{
+  return a.time > b.time;
+}
+
+double to_ms(double time)
+{
+  return time * 1000.0;
+}
+
+}  // namespace
+
+double deg_eval_stats_critical_path(Depsgraph *graph, bool use_current_time)
+{
+  for (OperationNode *op_node : graph->operations) {
+    op_node->critical_path_time = operation_needs_evaluation(op_node) ? CRITICAL_PATH_UNKNOWN :
+                                                                        0.0;
+  }
+  /* Depth-first traversal with an explicit stack, chains of operations can be too long for the
+   * recursion. Every entry stores index of the next relation to be visited. */
+  vector<pair<OperationNode *, int>> stack;
+  double graph_critical_path_time = 0.0;
+  for (OperationNode *root_node : graph->operations) {
+    if (root_node->critical_path_time != CRITICAL_PATH_UNKNOWN) {
+      continue;
+    }
+    root_node->critical_path_time = CRITICAL_PATH_IN_PROGRESS;
+    stack.push_back(make_pair(root_node, 0));
+    while (!stack.empty()) {
+      OperationNode *op_node = stack.back().first;
+      const int num_relations = op_node->outlinks.size();
+      int relation_index = stack.back().second;
+      OperationNode *child_to_visit = nullptr;
+      while (relation_index < num_relations && child_to_visit == nullptr) {
+        const Relation *rel = op_node->outlinks[relation_index++];
+        OperationNode *child = (OperationNode *)rel->to;
+        if ((rel->flag & RELATION_FLAG_CYCLIC) == 0 &&
+            child->critical_path_time == CRITICAL_PATH_UNKNOWN) {
+          child_to_visit = child;
+        }
+      }
+      stack.back().second = relation_index;
+      if (child_to_visit != nullptr) {
+        child_to_visit->critical_path_time = CRITICAL_PATH_IN_PROGRESS;
+        stack.push_back(make_pair(child_to_visit, 0));
+        continue;
+      }
+      /* All children are calculated. Children which are still in progress are coming from a
+       * cycle which was not detected, those are ignored since they are negative. */
+      double children_time = 0.0;
+      for (const Relation *rel : op_node->outlinks) {
+        if ((rel->flag & RELATION_FLAG_CYCLIC) == 0) {
+          children_time = max(children_time, ((OperationNode *)rel->to)->critical_path_time);
+        }
+      }
+      op_node->critical_path_time = operation_time(op_node, use_current_time) + children_time;
+      graph_critical_path_time = max(graph_critical_path_time, op_node->critical_path_time);
+      stack.pop_back();
+    }
+  }
+  return graph_critical_path_time;
+}
+
+void deg_eval_stats_print_report(Depsgraph *graph,
+                                 const EvaluationStagesTime &stages_time,
+                                 int num_threads)
+{
+  double copy_on_write_time = 0.0, evaluation_time = 0.0;
+  int num_operations = 0;
+  for (OperationNode *op_node : graph->operations) {
+    if (!op_node->scheduled || op_node->is_noop()) {
+      continue;
+    }
+    if (op_node->owner->type == NodeType::COPY_ON_WRITE) {
+      copy_on_write_time += op_node->stats.current_time;
+    }
+    else {
+      evaluation_time += op_node->stats.current_time;
+    }
+    num_operations++;
+  }
+  /* Longest chain of operations, the threaded evaluation can not be faster than that. */
+  const double critical_path_time = deg_eval_stats_critical_path(graph, true);
+  const double total_time = stages_time.prepare + stages_time.copy_on_write +
+                            stages_time.threaded_evaluation + stages_time.single_threaded;
+
+  printf("Depsgraph evaluation report (%d operations, %d threads):\n",
+         num_operations,
+         num_threads);
+  printf("  Total:                 %9.3f ms\n", to_ms(total_time));
+  printf("  Preparation:           %9.3f ms\n", to_ms(stages_time.prepare));
+  printf("  Copy-on-write:         %9.3f ms (operations %.3f ms)\n",
+         to_ms(stages_time.copy_on_write),
+         to_ms(copy_on_write_time));
+  printf("  Threaded evaluation:   %9.3f ms (operations %.3f ms, critical path %.3f ms)\n",
+         to_ms(stages_time.threaded_evaluation),
+         to_ms(evaluation_time),
+         to_ms(critical_path_time));
+  printf("  Single threaded:       %9.3f ms\n", to_ms(stages_time.single_threaded));
+
+  vector<StatsEntry> stats;
+  for (const IDNode *id_node : graph->id_nodes) {
+    if (id_node->stats.current_time == 0.0) {
+      continue;
+    }
+    StatsEntry entry;
+    entry.id_node = id_node;
+    entry.time = id_node->stats.current_time;
+    stats.push_back(entry);
+  }
+  if (stats.empty()) {
+    return;
+  }
+  std::sort(stats.begin(), stats.end(), stat_entry_comparator);
+  stats.resize(min_ii(stats.size(), REPORT_NUM_SLOWEST_IDS));
+  printf("  Slowest data-blocks:\n");
+  for (const StatsEntry &entry : stats) {
+    /* Component which took most of the time. */
+    const ComponentNode *slowest_comp_node = nullptr;
+    GHASH_FOREACH_BEGIN (const ComponentNode *, comp_node, entry.id_node->components) {
+      if (slowest_comp_node == nullptr ||
+          comp_node->stats.current_time > slowest_comp_node->stats.current_time) {
+        slowest_comp_node = comp_node;
+      }
+    }
+    GHASH_FOREACH_END();
+    printf("    %-24s %9.3f ms (%s %.3f ms)\n",
+           entry.id_node->id_orig->name,
+           to_ms(entry.time),
+           nodeTypeAsString(slowest_comp_node->type),
+           to_ms(slowest_comp_node->stats.current_time));
   }
 }
 
@@ -27,7 +27,27 @@ namespace DEG {
 
 struct Depsgraph;
 
+/* Wall time spent in the stages of a graph evaluation, in seconds. */
+struct EvaluationStagesTime {
+  double prepare;
+  double copy_on_write;
+  double threaded_evaluation;
+  double single_threaded;
+};
+
 /* Aggregate operation timings to overall component and ID nodes timing. */
 void deg_eval_stats_aggregate(Depsgraph *graph);
 
+/* Calculate critical path time of all operations which are to be evaluated: time needed to
+ * evaluate the operation and the longest chain of operations depending on it.
+ *
+ * Uses time measured during the current evaluation when use_current_time is true, time averaged
+ * over previous evaluations otherwise. Returns critical path time of the whole graph. */
+double deg_eval_stats_critical_path(Depsgraph *graph, bool use_current_time);
+
+/* Print where the wall time of the graph evaluation went. Expects timings to be aggregated. */
+void deg_eval_stats_print_report(Depsgraph *graph,
+                                 const EvaluationStagesTime &stages_time,
+                                 int num_threads);
+
 }  // namespace DEG
@@ -274,11 +274,22 @@ Node::Stats::Stats()
 void Node::Stats::reset()
 {
   current_time = 0.0;
+  current_copied_bytes = 0;
+  average_time = 0.0;
 }
 
 void Node::Stats::reset_current()
 {
   current_time = 0.0;
+  current_copied_bytes = 0;
+}
+
+void Node::Stats::add_evaluation_time(double time)
+{
+  current_time += time;
+  /* Exponential moving average: follows changes in the evaluated data within a few evaluations,
+   * while smoothing out noise of individual measurements. */
+  average_time = (average_time == 0.0) ? time : (average_time * 0.75 + time * 0.25);
 }
 
 /*******************************************************************************
@@ -156,8 +156,15 @@ struct Node {
     /* Reset counters needed for the current graph evaluation, does not
      * touch averaging accumulators. */
     void reset_current();
+    /* Add time spent on a single evaluation of this node. */
+    void add_evaluation_time(double time);
     /* Time spend on this node during current graph evaluation. */
     double current_time;
+    /* Time spend on evaluation of this node, averaged over the graph evaluations in which
+     * the node was evaluated. */
+    double average_time;
+    /* Memory copied by copy-on-write of this node during current graph evaluation. */
+    size_t current_copied_bytes;
   };
   /* Relationships between nodes
    * The reason why all depsgraph nodes are descended from this type (apart
@@ -104,6 +104,12 @@ struct IDNode : public Node {
   /* Accumulated flag from operation. Is initialized and used during updates flush. */
   bool is_user_modified;
 
+  /* Recalc flags this ID was explicitly tagged with since the last evaluation.
+   * Unlike recalc flags of the copied ID these are not extended by the updates flush, so
+   * copy-on-write can use them to only synchronize the data which actually changed. Set to
+   * ID_RECALC_ALL when the copy is to be fully re-created. */
+  int tagged_recalc;
+
   IDComponentsMask visible_components_mask;
   IDComponentsMask previously_visible_components_mask;
 
@@ -223,6 +223,8 @@ typedef struct MeshBatchCache {
   int vert_len;
   int mat_len;
   bool is_dirty; /* Instantly invalidates cache, skipping mesh check */
+  /* Vertex coordinates dependent buffers were cleared in place and must be extracted again. */
+  bool is_deform_dirty;
   bool is_editmode;
   bool is_uvsyncsel;
 
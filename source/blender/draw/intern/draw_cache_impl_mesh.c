@@ -493,6 +493,69 @@ static void mesh_batch_cache_discard_uvedit_select(MeshBatchCache *cache)
   cache->batch_ready &= ~MBC_EDITUV;
 }
 
+/* Clear the buffers depending on vertex coordinates but keep them allocated, as well as the
+ * batches using them, so that only these buffers are extracted again.
+ *
+ * Triangles and their edge adjacency come from the tessellation, which depends on coordinates:
+ * concave quads are split along their other diagonal and n-gons are filled from their shape.
+ * They are only kept for meshes made of triangles. The per material surfaces are sub-ranges of
+ * the triangles, re-created when these are extracted. The other index buffers and attributes
+ * only depend on topology and custom-data, which a deformation leaves untouched. */
+static void mesh_batch_cache_discard_deform(MeshBatchCache *cache, const bool is_all_tris)
+{
+  MeshBufferCache *mbufcache = &cache->final;
+  GPUVertBuf *vbos[] = {
+      mbufcache->vbo.pos_nor,
+      mbufcache->vbo.lnor,
+      mbufcache->vbo.tan,
+      mbufcache->vbo.edge_fac,
+  };
+  for (int i = 0; i < ARRAY_SIZE(vbos); i++) {
+    GPUVertBuf *vbo = vbos[i];
+    if (vbo == NULL || DRW_vbo_requested(vbo)) {
+      continue;
+    }
+    const GPUUsageType usage = vbo->usage;
+    GPU_vertbuf_clear(vbo);
+    /* Resets the format too, which makes the buffer requested again. */
+    GPU_vertbuf_init(vbo, usage);
+    cache->is_deform_dirty = true;
+  }
+  if (is_all_tris) {
+    return;
+  }
+  GPUIndexBuf *ibos[] = {
+      mbufcache->ibo.tris,
+      mbufcache->ibo.lines_adjacency,
+  };
+  for (int i = 0; i < ARRAY_SIZE(ibos); i++) {
+    GPUIndexBuf *ibo = ibos[i];
+    if (ibo == NULL || DRW_ibo_requested(ibo)) {
+      continue;
+    }
+    /* Makes the buffer requested again. */
+    GPU_indexbuf_clear(ibo);
+    cache->is_deform_dirty = true;
+  }
+}
+
+/* Batches keep the buffers cleared by #mesh_batch_cache_discard_deform but their vertex array
+ * objects still reference the discarded GPU buffers. Needs a GPU context. */
+static void mesh_batch_cache_deform_vao_clear(MeshBatchCache *cache)
+{
+  for (int i = 0; i < sizeof(cache->batch) / sizeof(void *); i++) {
+    GPUBatch *batch = ((GPUBatch **)&cache->batch)[i];
+    if (batch != NULL) {
+      GPU_batch_vao_cache_clear(batch);
+    }
+  }
+  for (int i = 0; i < cache->mat_len; i++) {
+    if (cache->surface_per_mat[i] != NULL) {
+      GPU_batch_vao_cache_clear(cache->surface_per_mat[i]);
+    }
+  }
+}
+
 void DRW_mesh_batch_cache_dirty_tag(Mesh *me, int mode)
 {
   MeshBatchCache *cache = me->runtime.batch_cache;
@@ -565,6 +628,15 @@ void DRW_mesh_batch_cache_dirty_tag(Mesh *me, int mode)
       GPU_BATCH_DISCARD_SAFE(cache->batch.edituv_fdots);
       cache->batch_ready &= ~MBC_EDITUV;
       break;
+    case BKE_MESH_BATCH_DIRTY_DEFORM:
+      if (cache->is_editmode) {
+        /* Edit-mode buffers also come from the cage, just rebuild everything. */
+        cache->is_dirty = true;
+      }
+      else {
+        mesh_batch_cache_discard_deform(cache, me->totloop == me->totpoly * 3);
+      }
+      break;
     default:
       BLI_assert(0);
   }
@@ -1123,8 +1195,12 @@ void DRW_mesh_batch_cache_create_requested(
     }
   }
 
+  if (cache->is_deform_dirty) {
+    mesh_batch_cache_deform_vao_clear(cache);
+  }
+
   /* Second chance to early out */
-  if ((batch_requested & ~cache->batch_ready) == 0) {
+  if ((batch_requested & ~cache->batch_ready) == 0 && !cache->is_deform_dirty) {
 #ifdef DEBUG
     goto check;
 #else
@@ -1374,6 +1450,8 @@ void DRW_mesh_batch_cache_create_requested(
                                      ts,
                                      use_hide);
 
+  cache->is_deform_dirty = false;
+
 #ifdef DEBUG
 check:
   /* Make sure all requested batches have been setup. */
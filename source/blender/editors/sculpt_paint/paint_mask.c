@@ -178,7 +178,7 @@ static int mask_flood_fill_exec(bContext *C, wmOperator *op)
 
   BKE_pbvh_update_vertex_data(pbvh, PBVH_UpdateMask);
 
-  sculpt_undo_push_end();
+  sculpt_undo_push_end(ob);
 
   if (nodes) {
     MEM_freeN(nodes);
@@ -359,7 +359,7 @@ bool ED_sculpt_mask_box_select(struct bContext *C, ViewContext *vc, const rcti *
 
   BKE_pbvh_update_vertex_data(pbvh, PBVH_UpdateMask);
 
-  sculpt_undo_push_end();
+  sculpt_undo_push_end(ob);
 
   ED_region_tag_redraw(ar);
 
@@ -548,7 +548,7 @@ static int paint_mask_gesture_lasso_exec(bContext *C, wmOperator *op)
 
     BKE_pbvh_update_vertex_data(pbvh, PBVH_UpdateMask);
 
-    sculpt_undo_push_end();
+    sculpt_undo_push_end(ob);
 
     ED_region_tag_redraw(vc.ar);
     MEM_freeN((void *)mcords);
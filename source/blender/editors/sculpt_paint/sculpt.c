@@ -7593,7 +7593,7 @@ static void sculpt_stroke_done(const bContext *C, struct PaintStroke *UNUSED(str
     sculpt_cache_free(ss->cache);
     ss->cache = NULL;
 
-    sculpt_undo_push_end();
+    sculpt_undo_push_end(ob);
 
     if (brush->sculpt_tool == SCULPT_TOOL_MASK) {
       sculpt_flush_update_done(C, ob, SCULPT_UPDATE_MASK);
@@ -7949,7 +7949,7 @@ static void sculpt_dynamic_topology_disable_with_undo(Main *bmain,
     sculpt_undo_push_begin("Dynamic topology disable");
     sculpt_undo_push_node(ob, NULL, SCULPT_UNDO_DYNTOPO_END);
     sculpt_dynamic_topology_disable_ex(bmain, depsgraph, scene, ob, NULL);
-    sculpt_undo_push_end();
+    sculpt_undo_push_end(ob);
   }
 }
 
@@ -7963,7 +7963,7 @@ static void sculpt_dynamic_topology_enable_with_undo(Main *bmain,
     sculpt_undo_push_begin("Dynamic topology enable");
     sculpt_dynamic_topology_enable_ex(bmain, depsgraph, scene, ob);
     sculpt_undo_push_node(ob, NULL, SCULPT_UNDO_DYNTOPO_BEGIN);
-    sculpt_undo_push_end();
+    sculpt_undo_push_end(ob);
   }
 }
 
@@ -8196,7 +8196,7 @@ static int sculpt_symmetrize_exec(bContext *C, wmOperator *UNUSED(op))
 
       /* Finish undo. */
       BM_log_all_added(ss->bm, ss->bm_log);
-      sculpt_undo_push_end();
+      sculpt_undo_push_end(ob);
 
       break;
     case PBVH_FACES:
@@ -8386,7 +8386,7 @@ void ED_object_sculptmode_enter_ex(Main *bmain,
       sculpt_dynamic_topology_enable_ex(bmain, depsgraph, scene, ob);
       if (has_undo) {
         sculpt_undo_push_node(ob, NULL, SCULPT_UNDO_DYNTOPO_BEGIN);
-        sculpt_undo_push_end();
+        sculpt_undo_push_end(ob);
       }
     }
     else {
@@ -8576,7 +8576,7 @@ static int sculpt_detail_flood_fill_exec(bContext *C, wmOperator *UNUSED(op))
   }
 
   MEM_SAFE_FREE(nodes);
-  sculpt_undo_push_end();
+  sculpt_undo_push_end(ob);
 
   /* Force rebuild of pbvh for better BB placement. */
   sculpt_pbvh_clear(ob);
@@ -9097,7 +9097,7 @@ static int sculpt_mesh_filter_modal(bContext *C, wmOperator *op, const wmEvent *
 
   if (event->type == LEFTMOUSE && event->val == KM_RELEASE) {
     sculpt_filter_cache_free(ss);
-    sculpt_undo_push_end();
+    sculpt_undo_push_end(ob);
     sculpt_flush_update_done(C, ob, SCULPT_UPDATE_COORDS);
     return OPERATOR_FINISHED;
   }
@@ -9415,7 +9415,7 @@ static int sculpt_mask_filter_exec(bContext *C, wmOperator *op)
 
   MEM_SAFE_FREE(nodes);
 
-  sculpt_undo_push_end();
+  sculpt_undo_push_end(ob);
 
   ED_region_tag_redraw(ar);
   WM_event_add_notifier(C, NC_OBJECT | ND_DRAW, ob);
@@ -9616,7 +9616,7 @@ static int sculpt_dirty_mask_exec(bContext *C, wmOperator *op)
 
   BKE_pbvh_update_vertex_data(pbvh, SCULPT_UPDATE_MASK);
 
-  sculpt_undo_push_end();
+  sculpt_undo_push_end(ob);
 
   ED_region_tag_redraw(ar);
 
@@ -9664,7 +9664,7 @@ static void sculpt_mask_expand_cancel(bContext *C, wmOperator *op)
 
   sculpt_flush_update_step(C, SCULPT_UPDATE_MASK);
   sculpt_filter_cache_free(ss);
-  sculpt_undo_push_end();
+  sculpt_undo_push_end(ob);
   sculpt_flush_update_done(C, ob, SCULPT_UPDATE_MASK);
   ED_workspace_status_text(C, NULL);
 }
@@ -9814,7 +9814,7 @@ static int sculpt_mask_expand_modal(bContext *C, wmOperator *op, const wmEvent *
 
     sculpt_filter_cache_free(ss);
 
-    sculpt_undo_push_end();
+    sculpt_undo_push_end(ob);
     sculpt_flush_update_done(C, ob, SCULPT_UPDATE_MASK);
     ED_workspace_status_text(C, NULL);
     return OPERATOR_FINISHED;
@@ -10255,7 +10255,7 @@ void ED_sculpt_end_transform(struct bContext *C)
   if (ss->filter_cache) {
     sculpt_filter_cache_free(ss);
   }
-  sculpt_undo_push_end();
+  sculpt_undo_push_end(ob);
   sculpt_flush_update_done(C, ob, SCULPT_UPDATE_COORDS);
 }
 
@@ -298,6 +298,16 @@ typedef struct SculptUndoNode {
   float pivot_pos[3];
   float pivot_rot[4];
 
+  /* Once the push is done, coordinates, mask and indices are replaced by their XOR against the
+   * result of the operation, compressed in the background, see #sculpt_undo_pack. */
+  void *packed;
+  size_t packed_size;            /* uncompressed size */
+  size_t packed_size_compressed; /* 0 while not compressed */
+  bool is_packed;
+  bool is_packed_orig_co;
+  /* XOR delta words of a packed node, only set while it is restored. */
+  uint *delta;
+
   size_t undo_size;
 } SculptUndoNode;
 
@@ -623,7 +633,7 @@ void sculpt_cache_free(StrokeCache *cache);
 SculptUndoNode *sculpt_undo_push_node(Object *ob, PBVHNode *node, SculptUndoType type);
 SculptUndoNode *sculpt_undo_get_node(PBVHNode *node);
 void sculpt_undo_push_begin(const char *name);
-void sculpt_undo_push_end(void);
+void sculpt_undo_push_end(Object *ob);
 
 void sculpt_vertcos_to_key(Object *ob, KeyBlock *kb, const float (*vertCos)[3]);
 
@@ -26,6 +26,8 @@
 
 #include "MEM_guardedalloc.h"
 
+#include "CLG_log.h"
+
 #include "BLI_math.h"
 #include "BLI_utildefines.h"
 #include "BLI_string.h"
@@ -66,13 +68,27 @@
 #include "bmesh.h"
 #include "sculpt_intern.h"
 
+#include "atomic_ops.h"
+
+#include "zlib.h"
+
+static CLG_LogRef LOG = {"ed.undo.sculpt"};
+
 typedef struct UndoSculpt {
   ListBase nodes;
 
+  /* Memory used by the nodes, and before they were packed. */
   size_t undo_size;
+  size_t undo_size_raw;
+
+  /* Compression of the packed nodes, and the number of nodes still to compress. */
+  TaskPool *pack_pool;
+  uint pack_pending;
 } UndoSculpt;
 
 static UndoSculpt *sculpt_undo_get_nodes(void);
+static UndoSculpt *sculpt_undosys_step_get_nodes(UndoStep *us_p);
+static void sculpt_undosys_step_pack_finish(UndoStep *us_p);
 
 static void update_cb(PBVHNode *node, void *rebuild)
 {
@@ -130,6 +146,406 @@ static bool test_swap_v3_v3(float a[3], float b[3])
   }
 }
 
+/* -------------------------------------------------------------------- */
+/** \name Packing
+ *
+ * Once an operation is done, coordinates and masks of the nodes are only read to undo or redo
+ * it. They are replaced by their XOR against the result of the operation: unchanged values
+ * become zero and values that barely moved keep their sign and exponent bits zero. The bytes of
+ * each word are then split in planes so the zeros line up, and the nodes are compressed on
+ * worker threads.
+ *
+ * The delta is the same in both directions, applying it to the state after the operation gives
+ * the state before it and the other way around, so nothing is compressed again on undo and redo.
+ * \{ */
+
+BLI_INLINE uint sculpt_undo_float_bits(const float f)
+{
+  uint bits;
+  memcpy(&bits, &f, sizeof(bits));
+  return bits;
+}
+
+BLI_INLINE float sculpt_undo_bits_float(const uint bits)
+{
+  float f;
+  memcpy(&f, &bits, sizeof(f));
+  return f;
+}
+
+static bool sculpt_undo_xor_f(float *value, const uint delta)
+{
+  if (delta == 0) {
+    return false;
+  }
+  *value = sculpt_undo_bits_float(sculpt_undo_float_bits(*value) ^ delta);
+  return true;
+}
+
+static bool sculpt_undo_xor_v3(float value[3], const uint delta[3])
+{
+  bool changed = false;
+  for (int i = 0; i < 3; i++) {
+    changed |= sculpt_undo_xor_f(&value[i], delta[i]);
+  }
+  return changed;
+}
+
+/* Number of coordinates or masks restored from the node. */
+static int sculpt_undo_node_totelem(const SculptUndoNode *unode)
+{
+  return unode->maxgrid ? unode->totgrid * unode->gridsize * unode->gridsize : unode->totvert;
+}
+
+/* Number of 32 bit words of the packed node. */
+static size_t sculpt_undo_node_pack_len(const SculptUndoNode *unode)
+{
+  const size_t totelem = (size_t)sculpt_undo_node_totelem(unode);
+  const size_t totindex = unode->maxgrid ? 0 : (size_t)unode->totvert;
+  return totindex + ((unode->type == SCULPT_UNDO_COORDS) ? totelem * 3 : totelem);
+}
+
+BLI_INLINE void sculpt_undo_pack_word(uchar *planes, const size_t len, size_t *i, const uint word)
+{
+  planes[*i] = (uchar)word;
+  planes[len + *i] = (uchar)(word >> 8);
+  planes[len * 2 + *i] = (uchar)(word >> 16);
+  planes[len * 3 + *i] = (uchar)(word >> 24);
+  (*i)++;
+}
+
+BLI_INLINE uint sculpt_undo_unpack_word(const uchar *planes, const size_t len, size_t *i)
+{
+  const uint word = (uint)planes[*i] | ((uint)planes[len + *i] << 8) |
+                    ((uint)planes[len * 2 + *i] << 16) | ((uint)planes[len * 3 + *i] << 24);
+  (*i)++;
+  return word;
+}
+
+static bool sculpt_undo_node_pack_poll(Object *ob, const SculptUndoNode *unode)
+{
+  SculptSession *ss = ob->sculpt;
+  SubdivCCG *subdiv_ccg = ss->subdiv_ccg;
+
+  if (unode->is_packed || unode->node == NULL || !STREQ(unode->idname, ob->id.name) ||
+      !ELEM(unode->type, SCULPT_UNDO_COORDS, SCULPT_UNDO_MASK)) {
+    return false;
+  }
+
+  if (unode->maxvert) {
+    if (BKE_pbvh_type(ss->pbvh) != PBVH_FACES || ss->totvert != unode->maxvert) {
+      return false;
+    }
+    if (unode->type == SCULPT_UNDO_MASK) {
+      return ss->vmask != NULL;
+    }
+    return (unode->orig_co == NULL) || (ss->orig_cos != NULL);
+  }
+  else if (unode->maxgrid) {
+    if (BKE_pbvh_type(ss->pbvh) != PBVH_GRIDS || subdiv_ccg == NULL ||
+        subdiv_ccg->num_grids != unode->maxgrid || subdiv_ccg->grid_size != unode->gridsize) {
+      return false;
+    }
+    if (unode->type == SCULPT_UNDO_MASK) {
+      return subdiv_ccg->has_mask;
+    }
+    return unode->orig_co == NULL;
+  }
+
+  return false;
+}
+
+/* Replace the coordinates or mask of the node by their delta against the current state, with
+ * the indices in the same buffer. */
+static void sculpt_undo_node_pack(SculptSession *ss, UndoSculpt *usculpt, SculptUndoNode *unode)
+{
+  const size_t len = sculpt_undo_node_pack_len(unode);
+  uchar *planes = MEM_mallocN(len * sizeof(uint), __func__);
+  const int *index = unode->index;
+  const bool use_orig_co = (unode->type == SCULPT_UNDO_COORDS) && (unode->orig_co != NULL);
+  size_t i = 0;
+
+  if (unode->maxvert) {
+    int index_prev = 0;
+    for (int j = 0; j < unode->totvert; j++) {
+      sculpt_undo_pack_word(planes, len, &i, (uint)(index[j] - index_prev));
+      index_prev = index[j];
+    }
+  }
+
+  if (unode->type == SCULPT_UNDO_COORDS) {
+    if (unode->maxvert) {
+      const MVert *mvert = BKE_pbvh_get_verts(ss->pbvh);
+      for (int j = 0; j < unode->totvert; j++) {
+        /* With deform modifiers the original coordinates are restored, not the deformed ones
+         * only used during the operation. */
+        const float *co = use_orig_co ? unode->orig_co[j] : unode->co[j];
+        const float *co_curr = use_orig_co ? ss->orig_cos[index[j]] : mvert[index[j]].co;
+        for (int k = 0; k < 3; k++) {
+          sculpt_undo_pack_word(
+              planes, len, &i, sculpt_undo_float_bits(co[k]) ^ sculpt_undo_float_bits(co_curr[k]));
+        }
+      }
+    }
+    else {
+      SubdivCCG *subdiv_ccg = ss->subdiv_ccg;
+      const int gridarea = unode->gridsize * unode->gridsize;
+      const float(*co)[3] = unode->co;
+      CCGKey key;
+      BKE_subdiv_ccg_key_top_level(&key, subdiv_ccg);
+      for (int j = 0; j < unode->totgrid; j++) {
+        CCGElem *grid = subdiv_ccg->grids[unode->grids[j]];
+        for (int g = 0; g < gridarea; g++, co++) {
+          const float *co_curr = CCG_elem_offset_co(&key, grid, g);
+          for (int k = 0; k < 3; k++) {
+            sculpt_undo_pack_word(planes,
+                                  len,
+                                  &i,
+                                  sculpt_undo_float_bits((*co)[k]) ^
+                                      sculpt_undo_float_bits(co_curr[k]));
+          }
+        }
+      }
+    }
+  }
+  else {
+    if (unode->maxvert) {
+      for (int j = 0; j < unode->totvert; j++) {
+        sculpt_undo_pack_word(planes,
+                              len,
+                              &i,
+                              sculpt_undo_float_bits(unode->mask[j]) ^
+                                  sculpt_undo_float_bits(ss->vmask[index[j]]));
+      }
+    }
+    else {
+      SubdivCCG *subdiv_ccg = ss->subdiv_ccg;
+      const int gridarea = unode->gridsize * unode->gridsize;
+      const float *mask = unode->mask;
+      CCGKey key;
+      BKE_subdiv_ccg_key_top_level(&key, subdiv_ccg);
+      for (int j = 0; j < unode->totgrid; j++) {
+        CCGElem *grid = subdiv_ccg->grids[unode->grids[j]];
+        for (int g = 0; g < gridarea; g++, mask++) {
+          sculpt_undo_pack_word(planes,
+                                len,
+                                &i,
+                                sculpt_undo_float_bits(*mask) ^
+                                    sculpt_undo_float_bits(*CCG_elem_offset_mask(&key, grid, g)));
+        }
+      }
+    }
+  }
+  BLI_assert(i == len);
+
+  size_t size_freed = 0;
+  void **arrays[] = {(void **)&unode->co,
+                     (void **)&unode->orig_co,
+                     (void **)&unode->mask,
+                     (void **)&unode->index};
+  for (int j = 0; j < ARRAY_SIZE(arrays); j++) {
+    if (*arrays[j]) {
+      size_freed += MEM_allocN_len(*arrays[j]);
+      MEM_freeN(*arrays[j]);
+      *arrays[j] = NULL;
+    }
+  }
+
+  unode->is_packed_orig_co = use_orig_co;
+  unode->packed = planes;
+  unode->packed_size = len * sizeof(uint);
+  unode->is_packed = true;
+
+  atomic_add_and_fetch_z(&usculpt->undo_size, unode->packed_size);
+  atomic_sub_and_fetch_z(&usculpt->undo_size, size_freed);
+}
+
+static void sculpt_undo_node_compress_task(TaskPool *__restrict pool,
+                                           void *taskdata,
+                                           int UNUSED(threadid))
+{
+  UndoSculpt *usculpt = BLI_task_pool_userdata(pool);
+  SculptUndoNode *unode = taskdata;
+
+  uLongf size_compressed = compressBound((uLong)unode->packed_size);
+  void *data_compressed = MEM_mallocN(size_compressed, __func__);
+  if (compress2(data_compressed,
+                &size_compressed,
+                unode->packed,
+                (uLong)unode->packed_size,
+                Z_BEST_SPEED) == Z_OK &&
+      size_compressed < unode->packed_size) {
+    MEM_freeN(unode->packed);
+    unode->packed = MEM_reallocN(data_compressed, size_compressed);
+    unode->packed_size_compressed = size_compressed;
+    atomic_sub_and_fetch_z(&usculpt->undo_size, unode->packed_size - size_compressed);
+  }
+  else {
+    MEM_freeN(data_compressed);
+  }
+
+  atomic_sub_and_fetch_uint32(&usculpt->pack_pending, 1);
+}
+
+typedef struct SculptUndoPackData {
+  SculptSession *ss;
+  UndoSculpt *usculpt;
+  SculptUndoNode **nodes;
+} SculptUndoPackData;
+
+static void sculpt_undo_pack_task_cb(void *__restrict userdata,
+                                     const int n,
+                                     const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  SculptUndoPackData *data = userdata;
+  sculpt_undo_node_pack(data->ss, data->usculpt, data->nodes[n]);
+}
+
+/* Pack the nodes pushed for the object, called once the operation is done. */
+static void sculpt_undo_pack(Object *ob, UndoSculpt *usculpt)
+{
+  SculptSession *ss = ob->sculpt;
+  if (ss == NULL || ss->pbvh == NULL) {
+    return;
+  }
+
+  int totnode = 0;
+  for (SculptUndoNode *unode = usculpt->nodes.first; unode; unode = unode->next) {
+    totnode += sculpt_undo_node_pack_poll(ob, unode);
+  }
+  if (totnode == 0) {
+    return;
+  }
+
+  SculptUndoNode **nodes = MEM_malloc_arrayN(totnode, sizeof(*nodes), __func__);
+  totnode = 0;
+  for (SculptUndoNode *unode = usculpt->nodes.first; unode; unode = unode->next) {
+    if (sculpt_undo_node_pack_poll(ob, unode)) {
+      nodes[totnode++] = unode;
+    }
+  }
+
+  SculptUndoPackData data = {
+      .ss = ss,
+      .usculpt = usculpt,
+      .nodes = nodes,
+  };
+  PBVHParallelSettings settings;
+  BKE_pbvh_parallel_range_settings(&settings, true, totnode);
+  BKE_pbvh_parallel_range(0, totnode, &data, sculpt_undo_pack_task_cb, &settings);
+
+  if (usculpt->pack_pool == NULL) {
+    usculpt->pack_pool = BLI_task_pool_create_background(BLI_task_scheduler_get(), usculpt);
+  }
+  atomic_add_and_fetch_uint32(&usculpt->pack_pending, (uint)totnode);
+  for (int n = 0; n < totnode; n++) {
+    /* The PBVH node is only valid during the push, don't let later pushes find this node. */
+    nodes[n]->node = NULL;
+    BLI_task_pool_push(
+        usculpt->pack_pool, sculpt_undo_node_compress_task, nodes[n], false, TASK_PRIORITY_LOW);
+  }
+
+  MEM_freeN(nodes);
+}
+
+/* Wait for the compression of the packed nodes. */
+static void sculpt_undo_pack_finish(UndoSculpt *usculpt)
+{
+  if (usculpt->pack_pool == NULL) {
+    return;
+  }
+
+  BLI_task_pool_work_and_wait(usculpt->pack_pool);
+  BLI_task_pool_free(usculpt->pack_pool);
+  usculpt->pack_pool = NULL;
+}
+
+/* Temporarily expand the indices and delta words of a packed node, to be applied by the restore
+ * functions. */
+static void sculpt_undo_node_unpack(SculptUndoNode *unode)
+{
+  const size_t len = sculpt_undo_node_pack_len(unode);
+  const uchar *planes = unode->packed;
+  uchar *planes_decompressed = NULL;
+  size_t i = 0;
+
+  BLI_assert(unode->packed_size == len * sizeof(uint));
+
+  if (unode->packed_size_compressed) {
+    uLongf size = (uLongf)unode->packed_size;
+    planes_decompressed = MEM_mallocN(unode->packed_size, __func__);
+    if (uncompress(planes_decompressed, &size, planes, (uLong)unode->packed_size_compressed) !=
+            Z_OK ||
+        size != unode->packed_size) {
+      BLI_assert(!"Corrupted sculpt undo node");
+      memset(planes_decompressed, 0, unode->packed_size);
+    }
+    planes = planes_decompressed;
+  }
+
+  if (unode->maxvert) {
+    unode->index = MEM_malloc_arrayN(unode->totvert, sizeof(*unode->index), __func__);
+    int index = 0;
+    for (int j = 0; j < unode->totvert; j++) {
+      index += (int)sculpt_undo_unpack_word(planes, len, &i);
+      unode->index[j] = index;
+    }
+  }
+
+  /* Coordinates or masks follow the indices. */
+  const size_t delta_len = len - i;
+  unode->delta = MEM_malloc_arrayN(delta_len, sizeof(*unode->delta), __func__);
+  for (size_t j = 0; j < delta_len; j++) {
+    unode->delta[j] = sculpt_undo_unpack_word(planes, len, &i);
+  }
+  BLI_assert(i == len);
+
+  MEM_SAFE_FREE(planes_decompressed);
+}
+
+static void sculpt_undo_node_unpack_free(SculptUndoNode *unode)
+{
+  MEM_SAFE_FREE(unode->delta);
+  MEM_SAFE_FREE(unode->index);
+}
+
+static void sculpt_undo_unpack_task_cb(void *__restrict userdata,
+                                       const int n,
+                                       const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  SculptUndoNode **nodes = userdata;
+  sculpt_undo_node_unpack(nodes[n]);
+}
+
+/* Unpack all packed nodes of the list, returns them to be freed once restored. */
+static SculptUndoNode **sculpt_undo_unpack_list(ListBase *lb, int *r_totnode)
+{
+  int totnode = 0;
+  for (SculptUndoNode *unode = lb->first; unode; unode = unode->next) {
+    totnode += unode->is_packed;
+  }
+  *r_totnode = totnode;
+  if (totnode == 0) {
+    return NULL;
+  }
+
+  SculptUndoNode **nodes = MEM_malloc_arrayN(totnode, sizeof(*nodes), __func__);
+  totnode = 0;
+  for (SculptUndoNode *unode = lb->first; unode; unode = unode->next) {
+    if (unode->is_packed) {
+      nodes[totnode++] = unode;
+    }
+  }
+
+  PBVHParallelSettings settings;
+  BKE_pbvh_parallel_range_settings(&settings, true, totnode);
+  BKE_pbvh_parallel_range(0, totnode, nodes, sculpt_undo_unpack_task_cb, &settings);
+
+  return nodes;
+}
+
+/** \} */
+
 static bool sculpt_undo_restore_deformed(
     const SculptSession *ss, SculptUndoNode *unode, int uindex, int oindex, float coord[3])
 {
@@ -180,7 +596,18 @@ static bool sculpt_undo_restore_coords(bContext *C, Depsgraph *depsgraph, Sculpt
       float(*vertCos)[3];
       vertCos = BKE_keyblock_convert_to_vertcos(ob, ss->shapekey_active);
 
-      if (unode->orig_co) {
+      if (unode->is_packed) {
+        const MVert *mvert_pbvh = BKE_pbvh_get_verts(ss->pbvh);
+        for (int i = 0; i < unode->totvert; i++) {
+          if (!unode->is_packed_orig_co) {
+            /* The key-block is only updated once the operation is done, the delta is against
+             * the coordinates of the PBVH. */
+            copy_v3_v3(vertCos[index[i]], mvert_pbvh[index[i]].co);
+          }
+          sculpt_undo_xor_v3(vertCos[index[i]], &unode->delta[i * 3]);
+        }
+      }
+      else if (unode->orig_co) {
         if (ss->deform_modifiers_active) {
           for (int i = 0; i < unode->totvert; i++) {
             sculpt_undo_restore_deformed(ss, unode, i, index[i], vertCos[index[i]]);
@@ -208,7 +635,14 @@ static bool sculpt_undo_restore_coords(bContext *C, Depsgraph *depsgraph, Sculpt
       MEM_freeN(vertCos);
     }
     else {
-      if (unode->orig_co) {
+      if (unode->is_packed) {
+        for (int i = 0; i < unode->totvert; i++) {
+          if (sculpt_undo_xor_v3(mvert[index[i]].co, &unode->delta[i * 3])) {
+            mvert[index[i]].flag |= ME_VERT_PBVH_UPDATE;
+          }
+        }
+      }
+      else if (unode->orig_co) {
         if (ss->deform_modifiers_active) {
           for (int i = 0; i < unode->totvert; i++) {
             sculpt_undo_restore_deformed(ss, unode, i, index[i], mvert[index[i]].co);
@@ -242,11 +676,19 @@ static bool sculpt_undo_restore_coords(bContext *C, Depsgraph *depsgraph, Sculpt
     BKE_subdiv_ccg_key_top_level(&key, subdiv_ccg);
 
     co = unode->co;
+    const uint *delta = unode->delta;
     for (int j = 0; j < unode->totgrid; j++) {
       grid = grids[unode->grids[j]];
 
-      for (int i = 0; i < gridsize * gridsize; i++, co++) {
-        swap_v3_v3(CCG_elem_offset_co(&key, grid, i), co[0]);
+      if (unode->is_packed) {
+        for (int i = 0; i < gridsize * gridsize; i++, delta += 3) {
+          sculpt_undo_xor_v3(CCG_elem_offset_co(&key, grid, i), delta);
+        }
+      }
+      else {
+        for (int i = 0; i < gridsize * gridsize; i++, co++) {
+          swap_v3_v3(CCG_elem_offset_co(&key, grid, i), co[0]);
+        }
       }
     }
   }
@@ -301,10 +743,19 @@ static bool sculpt_undo_restore_mask(bContext *C, SculptUndoNode *unode)
     mvert = ss->mvert;
     vmask = ss->vmask;
 
-    for (int i = 0; i < unode->totvert; i++) {
-      if (vmask[index[i]] != unode->mask[i]) {
-        SWAP(float, vmask[index[i]], unode->mask[i]);
-        mvert[index[i]].flag |= ME_VERT_PBVH_UPDATE;
+    if (unode->is_packed) {
+      for (int i = 0; i < unode->totvert; i++) {
+        if (sculpt_undo_xor_f(&vmask[index[i]], unode->delta[i])) {
+          mvert[index[i]].flag |= ME_VERT_PBVH_UPDATE;
+        }
+      }
+    }
+    else {
+      for (int i = 0; i < unode->totvert; i++) {
+        if (vmask[index[i]] != unode->mask[i]) {
+          SWAP(float, vmask[index[i]], unode->mask[i]);
+          mvert[index[i]].flag |= ME_VERT_PBVH_UPDATE;
+        }
       }
     }
   }
@@ -320,11 +771,19 @@ static bool sculpt_undo_restore_mask(bContext *C, SculptUndoNode *unode)
     BKE_subdiv_ccg_key_top_level(&key, subdiv_ccg);
 
     mask = unode->mask;
+    const uint *delta = unode->delta;
     for (int j = 0; j < unode->totgrid; j++) {
       grid = grids[unode->grids[j]];
 
-      for (int i = 0; i < gridsize * gridsize; i++, mask++) {
-        SWAP(float, *CCG_elem_offset_mask(&key, grid, i), *mask);
+      if (unode->is_packed) {
+        for (int i = 0; i < gridsize * gridsize; i++, delta++) {
+          sculpt_undo_xor_f(CCG_elem_offset_mask(&key, grid, i), *delta);
+        }
+      }
+      else {
+        for (int i = 0; i < gridsize * gridsize; i++, mask++) {
+          SWAP(float, *CCG_elem_offset_mask(&key, grid, i), *mask);
+        }
       }
     }
   }
@@ -544,6 +1003,9 @@ static void sculpt_undo_restore_list(bContext *C, Depsgraph *depsgraph, ListBase
   char *undo_modified_grids = NULL;
   bool use_multires_undo = false;
 
+  int totnode_packed;
+  SculptUndoNode **nodes_packed = sculpt_undo_unpack_list(lb, &totnode_packed);
+
   for (unode = lb->first; unode; unode = unode->next) {
 
     if (!STREQ(unode->idname, ob->id.name)) {
@@ -595,6 +1057,13 @@ static void sculpt_undo_restore_list(bContext *C, Depsgraph *depsgraph, ListBase
     }
   }
 
+  if (nodes_packed) {
+    for (int i = 0; i < totnode_packed; i++) {
+      sculpt_undo_node_unpack_free(nodes_packed[i]);
+    }
+    MEM_freeN(nodes_packed);
+  }
+
   if (use_multires_undo) {
     int max_grid;
     unode = lb->first;
@@ -696,6 +1165,9 @@ static void sculpt_undo_free_list(ListBase *lb)
     if (unode->mask) {
       MEM_freeN(unode->mask);
     }
+    if (unode->packed) {
+      MEM_freeN(unode->packed);
+    }
 
     if (unode->bm_entry) {
       BM_log_entry_drop(unode->bm_entry);
@@ -806,7 +1278,7 @@ static SculptUndoNode *sculpt_undo_alloc_node(Object *ob, PBVHNode *node, Sculpt
       unode->co = MEM_mapallocN(sizeof(float[3]) * allvert, "SculptUndoNode.co");
       unode->no = MEM_mapallocN(sizeof(short[3]) * allvert, "SculptUndoNode.no");
 
-      usculpt->undo_size = (sizeof(float[3]) + sizeof(short[3]) + sizeof(int)) * allvert;
+      usculpt->undo_size += (sizeof(float[3]) + sizeof(short[3]) + sizeof(int)) * allvert;
       break;
     case SCULPT_UNDO_HIDDEN:
       if (maxgrid) {
@@ -820,7 +1292,7 @@ static SculptUndoNode *sculpt_undo_alloc_node(Object *ob, PBVHNode *node, Sculpt
     case SCULPT_UNDO_MASK:
       unode->mask = MEM_mapallocN(sizeof(float) * allvert, "SculptUndoNode.mask");
 
-      usculpt->undo_size += (sizeof(float) * sizeof(int)) * allvert;
+      usculpt->undo_size += (sizeof(float) + sizeof(int)) * allvert;
 
       break;
     case SCULPT_UNDO_DYNTOPO_BEGIN:
@@ -848,6 +1320,8 @@ static SculptUndoNode *sculpt_undo_alloc_node(Object *ob, PBVHNode *node, Sculpt
 
   if (ss->deform_modifiers_active) {
     unode->orig_co = MEM_callocN(allvert * sizeof(*unode->orig_co), "undoSculpt orig_cos");
+
+    usculpt->undo_size += sizeof(*unode->orig_co) * allvert;
   }
 
   return unode;
@@ -1118,10 +1592,21 @@ void sculpt_undo_push_begin(const char *name)
   /* Special case, we never read from this. */
   bContext *C = NULL;
 
+  /* Account for the compressed size of the previous steps before the memory limit is applied,
+   * without waiting for the ones still being compressed. */
+  for (UndoStep *us = ustack->steps.first; us; us = us->next) {
+    if (us->type == BKE_UNDOSYS_TYPE_SCULPT) {
+      UndoSculpt *usculpt = sculpt_undosys_step_get_nodes(us);
+      if (usculpt->pack_pool && atomic_add_and_fetch_uint32(&usculpt->pack_pending, 0) == 0) {
+        sculpt_undosys_step_pack_finish(us);
+      }
+    }
+  }
+
   BKE_undosys_step_push_init_with_type(ustack, C, name, BKE_UNDOSYS_TYPE_SCULPT);
 }
 
-void sculpt_undo_push_end(void)
+void sculpt_undo_push_end(Object *ob)
 {
   UndoSculpt *usculpt = sculpt_undo_get_nodes();
   SculptUndoNode *unode;
@@ -1129,6 +1614,7 @@ void sculpt_undo_push_end(void)
   /* We don't need normals in the undo stack. */
   for (unode = usculpt->nodes.first; unode; unode = unode->next) {
     if (unode->no) {
+      usculpt->undo_size -= MEM_allocN_len(unode->no);
       MEM_freeN(unode->no);
       unode->no = NULL;
     }
@@ -1138,6 +1624,9 @@ void sculpt_undo_push_end(void)
     }
   }
 
+  usculpt->undo_size_raw = usculpt->undo_size;
+  sculpt_undo_pack(ob, usculpt);
+
   /* We could remove this and enforce all callers run in an operator using 'OPTYPE_UNDO'. */
   wmWindowManager *wm = G_MAIN->wm.first;
   if (wm->op_undo_depth == 0) {
@@ -1191,6 +1680,7 @@ static void sculpt_undosys_step_decode_undo_impl(struct bContext *C,
                                                  SculptUndoStep *us)
 {
   BLI_assert(us->step.is_applied == true);
+  sculpt_undosys_step_pack_finish(&us->step);
   sculpt_undo_restore_list(C, depsgraph, &us->data.nodes);
   us->step.is_applied = false;
 }
@@ -1200,6 +1690,7 @@ static void sculpt_undosys_step_decode_redo_impl(struct bContext *C,
                                                  SculptUndoStep *us)
 {
   BLI_assert(us->step.is_applied == false);
+  sculpt_undosys_step_pack_finish(&us->step);
   sculpt_undo_restore_list(C, depsgraph, &us->data.nodes);
   us->step.is_applied = true;
 }
@@ -1289,6 +1780,7 @@ static void sculpt_undosys_step_decode(
 static void sculpt_undosys_step_free(UndoStep *us_p)
 {
   SculptUndoStep *us = (SculptUndoStep *)us_p;
+  sculpt_undo_pack_finish(&us->data);
   sculpt_undo_free_list(&us->data.nodes);
 }
 
@@ -1301,7 +1793,7 @@ void ED_sculpt_undo_geometry_begin(struct Object *ob, const char *name)
 void ED_sculpt_undo_geometry_end(struct Object *ob)
 {
   sculpt_undo_push_node(ob, NULL, SCULPT_UNDO_GEOMETRY);
-  sculpt_undo_push_end();
+  sculpt_undo_push_end(ob);
 }
 
 /* Export for ED_undo_sys. */
@@ -1330,6 +1822,25 @@ static UndoSculpt *sculpt_undosys_step_get_nodes(UndoStep *us_p)
   return &us->data;
 }
 
+/* Wait for the compression of the step and report its size. */
+static void sculpt_undosys_step_pack_finish(UndoStep *us_p)
+{
+  UndoSculpt *usculpt = sculpt_undosys_step_get_nodes(us_p);
+  if (usculpt->pack_pool == NULL) {
+    return;
+  }
+
+  sculpt_undo_pack_finish(usculpt);
+  us_p->data_size = usculpt->undo_size;
+
+  CLOG_INFO(&LOG,
+            1,
+            "name='%s', size=%zu, size_raw=%zu",
+            us_p->name,
+            usculpt->undo_size,
+            usculpt->undo_size_raw);
+}
+
 static UndoSculpt *sculpt_undo_get_nodes(void)
 {
   UndoStack *ustack = ED_undo_stack_get();
@@ -99,6 +99,8 @@ void GPU_indexbuf_create_subrange_in_place(GPUIndexBuf *r_ibo,
                                            uint start,
                                            uint length);
 
+/* Free the built indices, the buffer is left as before being built. */
+void GPU_indexbuf_clear(GPUIndexBuf *);
 void GPU_indexbuf_discard(GPUIndexBuf *);
 
 int GPU_indexbuf_primitive_len(GPUPrimType prim_type);
@@ -30,6 +30,7 @@
 #include "gpu_context_private.h"
 
 #include <stdlib.h>
+#include <string.h>
 
 #define KEEP_SINGLE_COPY 1
 
@@ -393,7 +394,7 @@ void GPU_indexbuf_use(GPUIndexBuf *elem)
   }
 }
 
-void GPU_indexbuf_discard(GPUIndexBuf *elem)
+void GPU_indexbuf_clear(GPUIndexBuf *elem)
 {
   if (elem->ibo_id) {
     GPU_buf_free(elem->ibo_id);
@@ -401,5 +402,11 @@ void GPU_indexbuf_discard(GPUIndexBuf *elem)
   if (!elem->is_subrange && elem->data) {
     MEM_freeN(elem->data);
   }
+  memset(elem, 0, sizeof(*elem));
+}
+
+void GPU_indexbuf_discard(GPUIndexBuf *elem)
+{
+  GPU_indexbuf_clear(elem);
   MEM_freeN(elem);
 }
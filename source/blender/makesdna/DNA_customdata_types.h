@@ -54,6 +54,11 @@ typedef struct CustomDataLayer {
   char name[64];
   /** Layer data. */
   void *data;
+  /**
+   * Run-time user count of `data` when it is shared with layers of other #CustomData,
+   * see #CD_SHARE. NULL when the layer owns its data exclusively.
+   */
+  struct CustomDataSharingInfo *sharing_info;
 } CustomDataLayer;
 
 #define MAX_CUSTOMDATA_LAYER_NAME 64
@@ -112,7 +112,11 @@ typedef struct Mesh_Runtime {
    * In the future we may leave the mesh-data empty
    * since its not needed if we can use edit-mesh data. */
   char is_original;
-  char _pad[6];
+  /**
+   * Set when the draw cache was taken over from the previous evaluated mesh and already tagged
+   * for a deform update, so it must not be tagged dirty as a whole after evaluation. */
+  char is_batch_cache_deformed;
+  char _pad[5];
 } Mesh_Runtime;
 
 typedef struct Mesh {
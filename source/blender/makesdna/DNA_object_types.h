@@ -172,6 +172,12 @@ typedef struct Object_Runtime {
    */
   struct Mesh *object_as_temp_mesh;
 
+  /**
+   * Result of the leading part of the modifier stack which only depends on the input mesh and
+   * on modifier settings, kept across evaluations. Owned by the evaluated object.
+   */
+  struct ModifierStackCache *modifier_stack_cache;
+
   /** Runtime evaluated curve-specific data, not stored in the file. */
   struct CurveCache *curve_cache;
 
@@ -863,6 +863,13 @@ typedef struct UserDef {
   char filebrowser_display_type; /* eUserpref_TempSpaceDisplayType */
   char _pad5[4];
 
+  /** Sequencer disk cache, 1024 = FILE_MAX. */
+  char sequencer_disk_cache_dir[1024];
+  /** #eUserpref_SeqDiskCacheCompression. */
+  int sequencer_disk_cache_compression;
+  /** Size limit in gigabytes. */
+  int sequencer_disk_cache_size_limit;
+
   struct WalkNavigation walk_navigation;
 
   /** The UI for the user preferences. */
@@ -1282,6 +1289,12 @@ typedef enum eUserpref_EmulateMMBMod {
   USER_EMU_MMB_MOD_OSKEY = 1,
 } eUserpref_EmulateMMBMod;
 
+typedef enum eUserpref_SeqDiskCacheCompression {
+  USER_SEQ_DISK_CACHE_COMPRESSION_NONE = 0,
+  USER_SEQ_DISK_CACHE_COMPRESSION_LOW = 1,
+  USER_SEQ_DISK_CACHE_COMPRESSION_HIGH = 2,
+} eUserpref_SeqDiskCacheCompression;
+
 #ifdef __cplusplus
 }
 #endif
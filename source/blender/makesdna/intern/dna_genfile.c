@@ -822,6 +822,8 @@ static void cast_elem(
   curlen = DNA_elem_type_size(ctypenr);
 
   while (name_array_len > 0) {
+    /* Old data may only be 4 byte aligned when read straight from a mapped file,
+     * so 8 byte values are copied out. */
     switch (otypenr) {
       case SDNA_TYPE_CHAR:
         val = *olddata;
@@ -841,15 +843,24 @@ static void cast_elem(
       case SDNA_TYPE_FLOAT:
         val = *((float *)olddata);
         break;
-      case SDNA_TYPE_DOUBLE:
-        val = *((double *)olddata);
+      case SDNA_TYPE_DOUBLE: {
+        double old_val;
+        memcpy(&old_val, olddata, sizeof(old_val));
+        val = old_val;
         break;
-      case SDNA_TYPE_INT64:
-        val = *((int64_t *)olddata);
+      }
+      case SDNA_TYPE_INT64: {
+        int64_t old_val;
+        memcpy(&old_val, olddata, sizeof(old_val));
+        val = old_val;
         break;
-      case SDNA_TYPE_UINT64:
-        val = *((uint64_t *)olddata);
+      }
+      case SDNA_TYPE_UINT64: {
+        uint64_t old_val;
+        memcpy(&old_val, olddata, sizeof(old_val));
+        val = old_val;
         break;
+      }
     }
 
     switch (ctypenr) {
@@ -916,7 +927,7 @@ static void cast_pointer(
       memcpy(curdata, olddata, curlen);
     }
     else if (curlen == 4 && oldlen == 8) {
-      lval = *((int64_t *)olddata);
+      memcpy(&lval, olddata, sizeof(lval));
 
       /* WARNING: 32-bit Blender trying to load file saved by 64-bit Blender,
        * pointers may lose uniqueness on truncation! (Hopefully this wont
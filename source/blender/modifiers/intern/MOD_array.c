@@ -28,6 +28,7 @@
 #include "BLI_utildefines.h"
 
 #include "BLI_math.h"
+#include "BLI_task.h"
 
 #include "DNA_curve_types.h"
 #include "DNA_mesh_types.h"
@@ -146,44 +147,34 @@ static void svert_from_mvert(SortVertsElem *sv,
   }
 }
 
+/* Build the array of verts to be tested for merging, sorted by the sum of their coordinates. */
+static SortVertsElem *svert_sorted_from_mvert(const MVert *mverts,
+                                              const int start,
+                                              const int num_verts)
+{
+  SortVertsElem *sorted_verts = MEM_malloc_arrayN(num_verts, sizeof(SortVertsElem), __func__);
+  svert_from_mvert(sorted_verts, mverts + start, start, start + num_verts);
+  qsort(sorted_verts, num_verts, sizeof(SortVertsElem), svert_sum_cmp);
+  return sorted_verts;
+}
+
 /**
- * Take as inputs two sets of verts, to be processed for detection of doubles and mapping.
- * Each set of verts is defined by its start within mverts array and its num_verts;
- * It builds a mapping for all vertices within source,
- * to vertices within target, or -1 if no double found.
- * The int doubles_map[num_verts_source] array must have been allocated by caller.
+ * Same as #dm_mvert_map_doubles, for sets of verts already sorted
+ * with #svert_sorted_from_mvert.
  */
-static void dm_mvert_map_doubles(int *doubles_map,
-                                 const MVert *mverts,
-                                 const int target_start,
-                                 const int target_num_verts,
-                                 const int source_start,
-                                 const int source_num_verts,
-                                 const float dist)
+static void dm_mvert_map_doubles_sorted(int *doubles_map,
+                                        const MVert *mverts,
+                                        const SortVertsElem *sorted_verts_target,
+                                        const int target_num_verts,
+                                        const SortVertsElem *sorted_verts_source,
+                                        const int source_num_verts,
+                                        const float dist)
 {
   const float dist3 = ((float)M_SQRT3 + 0.00005f) * dist; /* Just above sqrt(3) */
-  int i_source, i_target, i_target_low_bound, target_end, source_end;
-  SortVertsElem *sorted_verts_target, *sorted_verts_source;
-  SortVertsElem *sve_source, *sve_target, *sve_target_low_bound;
+  int i_source, i_target, i_target_low_bound;
+  const SortVertsElem *sve_source, *sve_target, *sve_target_low_bound;
   bool target_scan_completed;
 
-  target_end = target_start + target_num_verts;
-  source_end = source_start + source_num_verts;
-
-  /* build array of MVerts to be tested for merging */
-  sorted_verts_target = MEM_malloc_arrayN(target_num_verts, sizeof(SortVertsElem), __func__);
-  sorted_verts_source = MEM_malloc_arrayN(source_num_verts, sizeof(SortVertsElem), __func__);
-
-  /* Copy target vertices index and cos into SortVertsElem array */
-  svert_from_mvert(sorted_verts_target, mverts + target_start, target_start, target_end);
-
-  /* Copy source vertices index and cos into SortVertsElem array */
-  svert_from_mvert(sorted_verts_source, mverts + source_start, source_start, source_end);
-
-  /* sort arrays according to sum of vertex coordinates (sumco) */
-  qsort(sorted_verts_target, target_num_verts, sizeof(SortVertsElem), svert_sum_cmp);
-  qsort(sorted_verts_source, source_num_verts, sizeof(SortVertsElem), svert_sum_cmp);
-
   sve_target_low_bound = sorted_verts_target;
   i_target_low_bound = 0;
   target_scan_completed = false;
@@ -262,11 +253,111 @@ static void dm_mvert_map_doubles(int *doubles_map,
     /* End of candidate scan: if none found then no doubles */
     doubles_map[sve_source->vertex_num] = best_target_vertex;
   }
+}
+
+/**
+ * Take as inputs two sets of verts, to be processed for detection of doubles and mapping.
+ * Each set of verts is defined by its start within mverts array and its num_verts;
+ * It builds a mapping for all vertices within source,
+ * to vertices within target, or -1 if no double found.
+ * The int doubles_map[num_verts_source] array must have been allocated by caller.
+ */
+static void dm_mvert_map_doubles(int *doubles_map,
+                                 const MVert *mverts,
+                                 const int target_start,
+                                 const int target_num_verts,
+                                 const int source_start,
+                                 const int source_num_verts,
+                                 const float dist)
+{
+  SortVertsElem *sorted_verts_target = svert_sorted_from_mvert(
+      mverts, target_start, target_num_verts);
+  SortVertsElem *sorted_verts_source = svert_sorted_from_mvert(
+      mverts, source_start, source_num_verts);
+
+  dm_mvert_map_doubles_sorted(doubles_map,
+                              mverts,
+                              sorted_verts_target,
+                              target_num_verts,
+                              sorted_verts_source,
+                              source_num_verts,
+                              dist);
 
   MEM_freeN(sorted_verts_source);
   MEM_freeN(sorted_verts_target);
 }
 
+/* Number of chunks sorted at once by #dm_mvert_map_doubles_chunks, limits memory usage. */
+#define ARRAY_SORT_CHUNKS_BATCH 64
+
+typedef struct ArraySortChunksData {
+  const MVert *mverts;
+  SortVertsElem **sorted_chunks;
+  int chunk_start;
+  int chunk_nverts;
+} ArraySortChunksData;
+
+static void array_sort_chunk_task(void *__restrict userdata,
+                                  const int i,
+                                  const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  ArraySortChunksData *data = userdata;
+  data->sorted_chunks[i] = svert_sorted_from_mvert(
+      data->mverts, (data->chunk_start + i) * data->chunk_nverts, data->chunk_nverts);
+}
+
+/**
+ * Same as calling #dm_mvert_map_doubles for every chunk after the first one, with the previous
+ * chunk as target. Chunks are sorted in parallel, mapping itself has to follow the chunk order
+ * since it depends on the mapping of the target chunk.
+ */
+static void dm_mvert_map_doubles_chunks(int *doubles_map,
+                                        const MVert *mverts,
+                                        const int chunk_nverts,
+                                        const int count,
+                                        const float dist)
+{
+  /* The last sorted chunk of the previous batch is kept first. */
+  SortVertsElem *sorted_chunks[ARRAY_SORT_CHUNKS_BATCH + 1] = {NULL};
+
+  ArraySortChunksData data = {
+      .mverts = mverts,
+      .chunk_nverts = chunk_nverts,
+  };
+
+  TaskParallelSettings settings;
+  BLI_parallel_range_settings_defaults(&settings);
+  settings.use_threading = (chunk_nverts * ARRAY_SORT_CHUNKS_BATCH > 10000);
+
+  for (int chunk_start = 0; chunk_start < count; chunk_start += ARRAY_SORT_CHUNKS_BATCH) {
+    const int batch_len = min_ii(count - chunk_start, ARRAY_SORT_CHUNKS_BATCH);
+    data.sorted_chunks = &sorted_chunks[1];
+    data.chunk_start = chunk_start;
+    BLI_task_parallel_range(0, batch_len, &data, array_sort_chunk_task, &settings);
+
+    for (int i = 0; i < batch_len; i++) {
+      if (chunk_start + i == 0) {
+        continue;
+      }
+      dm_mvert_map_doubles_sorted(doubles_map,
+                                  mverts,
+                                  sorted_chunks[i],
+                                  chunk_nverts,
+                                  sorted_chunks[i + 1],
+                                  chunk_nverts,
+                                  dist);
+    }
+
+    MEM_SAFE_FREE(sorted_chunks[0]);
+    for (int i = 0; i < batch_len - 1; i++) {
+      MEM_freeN(sorted_chunks[i + 1]);
+    }
+    sorted_chunks[0] = sorted_chunks[batch_len];
+    sorted_chunks[batch_len] = NULL;
+  }
+  MEM_SAFE_FREE(sorted_chunks[0]);
+}
+
 static void mesh_merge_transform(Mesh *result,
                                  Mesh *cap_mesh,
                                  const float cap_offset[4][4],
@@ -349,17 +440,102 @@ static void mesh_merge_transform(Mesh *result,
   }
 }
 
+typedef struct ArrayChunkData {
+  const ArrayModifierData *amd;
+  Mesh *result;
+  const Mesh *src_mesh;
+  const float (*chunk_offsets)[4][4];
+  int chunk_nverts, chunk_nedges, chunk_nloops, chunk_npolys;
+  bool use_recalc_normals;
+} ArrayChunkData;
+
+/* Copy the source geometry into chunk `c` of the result and apply its cumulative offset. */
+static void array_chunk_copy_task(void *__restrict userdata,
+                                  const int c,
+                                  const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  const ArrayChunkData *data = userdata;
+  const ArrayModifierData *amd = data->amd;
+  Mesh *result = data->result;
+  const Mesh *mesh = data->src_mesh;
+  const float(*current_offset)[4] = data->chunk_offsets[c];
+  const int chunk_nverts = data->chunk_nverts;
+  const int chunk_nedges = data->chunk_nedges;
+  const int chunk_nloops = data->chunk_nloops;
+  const int chunk_npolys = data->chunk_npolys;
+  MVert *mv;
+  MEdge *me;
+  MLoop *ml;
+  MPoly *mp;
+  int i;
+
+  /* copy customdata to new geometry */
+  CustomData_copy_data(&mesh->vdata, &result->vdata, 0, c * chunk_nverts, chunk_nverts);
+  CustomData_copy_data(&mesh->edata, &result->edata, 0, c * chunk_nedges, chunk_nedges);
+  CustomData_copy_data(&mesh->ldata, &result->ldata, 0, c * chunk_nloops, chunk_nloops);
+  CustomData_copy_data(&mesh->pdata, &result->pdata, 0, c * chunk_npolys, chunk_npolys);
+
+  /* apply offset to all new verts */
+  mv = result->mvert + c * chunk_nverts;
+  for (i = 0; i < chunk_nverts; i++, mv++) {
+    mul_m4_v3(current_offset, mv->co);
+
+    /* We have to correct normals too, if we do not tag them as dirty! */
+    if (!data->use_recalc_normals) {
+      float no[3];
+      normal_short_to_float_v3(no, mv->no);
+      mul_mat3_m4_v3(current_offset, no);
+      normalize_v3(no);
+      normal_float_to_short_v3(mv->no, no);
+    }
+  }
+
+  /* adjust edge vertex indices */
+  me = result->medge + c * chunk_nedges;
+  for (i = 0; i < chunk_nedges; i++, me++) {
+    me->v1 += c * chunk_nverts;
+    me->v2 += c * chunk_nverts;
+  }
+
+  mp = result->mpoly + c * chunk_npolys;
+  for (i = 0; i < chunk_npolys; i++, mp++) {
+    mp->loopstart += c * chunk_nloops;
+  }
+
+  /* adjust loop vertex and edge indices */
+  ml = result->mloop + c * chunk_nloops;
+  for (i = 0; i < chunk_nloops; i++, ml++) {
+    ml->v += c * chunk_nverts;
+    ml->e += c * chunk_nedges;
+  }
+
+  /* handle UVs */
+  if (chunk_nloops > 0 && is_zero_v2(amd->uv_offset) == false) {
+    const float uv_offset[2] = {
+        amd->uv_offset[0] * (float)c,
+        amd->uv_offset[1] * (float)c,
+    };
+    const int totuv = CustomData_number_of_layers(&result->ldata, CD_MLOOPUV);
+    for (i = 0; i < totuv; i++) {
+      MLoopUV *dmloopuv = CustomData_get_layer_n(&result->ldata, CD_MLOOPUV, i);
+      dmloopuv += c * chunk_nloops;
+      int l_index = chunk_nloops;
+      for (; l_index-- != 0; dmloopuv++) {
+        dmloopuv->uv[0] += uv_offset[0];
+        dmloopuv->uv[1] += uv_offset[1];
+      }
+    }
+  }
+}
+
 static Mesh *arrayModifier_doArray(ArrayModifierData *amd,
                                    const ModifierEvalContext *ctx,
                                    Mesh *mesh)
 {
   const float eps = 1e-6f;
   const MVert *src_mvert;
-  MVert *mv, *mv_prev, *result_dm_verts;
+  MVert *result_dm_verts;
 
-  MEdge *me;
-  MLoop *ml;
-  MPoly *mp;
   int i, j, c, count;
   float length = amd->length;
   /* offset matrix */
@@ -533,56 +709,44 @@ static Mesh *arrayModifier_doArray(ArrayModifierData *amd,
   first_chunk_start = 0;
   first_chunk_nverts = chunk_nverts;
 
-  unit_m4(current_offset);
+  /* Cumulative offset of each chunk. */
+  float(*chunk_offsets)[4][4] = MEM_malloc_arrayN(count, sizeof(*chunk_offsets), __func__);
+  unit_m4(chunk_offsets[0]);
   for (c = 1; c < count; c++) {
-    /* copy customdata to new geometry */
-    CustomData_copy_data(&mesh->vdata, &result->vdata, 0, c * chunk_nverts, chunk_nverts);
-    CustomData_copy_data(&mesh->edata, &result->edata, 0, c * chunk_nedges, chunk_nedges);
-    CustomData_copy_data(&mesh->ldata, &result->ldata, 0, c * chunk_nloops, chunk_nloops);
-    CustomData_copy_data(&mesh->pdata, &result->pdata, 0, c * chunk_npolys, chunk_npolys);
-
-    mv_prev = result_dm_verts;
-    mv = mv_prev + c * chunk_nverts;
-
-    /* recalculate cumulative offset here */
-    mul_m4_m4m4(current_offset, current_offset, offset);
-
-    /* apply offset to all new verts */
-    for (i = 0; i < chunk_nverts; i++, mv++, mv_prev++) {
-      mul_m4_v3(current_offset, mv->co);
-
-      /* We have to correct normals too, if we do not tag them as dirty! */
-      if (!use_recalc_normals) {
-        float no[3];
-        normal_short_to_float_v3(no, mv->no);
-        mul_mat3_m4_v3(current_offset, no);
-        normalize_v3(no);
-        normal_float_to_short_v3(mv->no, no);
-      }
-    }
-
-    /* adjust edge vertex indices */
-    me = result->medge + c * chunk_nedges;
-    for (i = 0; i < chunk_nedges; i++, me++) {
-      me->v1 += c * chunk_nverts;
-      me->v2 += c * chunk_nverts;
-    }
-
-    mp = result->mpoly + c * chunk_npolys;
-    for (i = 0; i < chunk_npolys; i++, mp++) {
-      mp->loopstart += c * chunk_nloops;
-    }
-
-    /* adjust loop vertex and edge indices */
-    ml = result->mloop + c * chunk_nloops;
-    for (i = 0; i < chunk_nloops; i++, ml++) {
-      ml->v += c * chunk_nverts;
-      ml->e += c * chunk_nedges;
-    }
+    mul_m4_m4m4(chunk_offsets[c], chunk_offsets[c - 1], offset);
+  }
+  copy_m4_m4(current_offset, chunk_offsets[count - 1]);
+
+  /* Copies are independent, they only read the first chunk. */
+  ArrayChunkData chunk_data = {
+      .amd = amd,
+      .result = result,
+      .src_mesh = mesh,
+      .chunk_offsets = (const float(*)[4][4])chunk_offsets,
+      .chunk_nverts = chunk_nverts,
+      .chunk_nedges = chunk_nedges,
+      .chunk_nloops = chunk_nloops,
+      .chunk_npolys = chunk_npolys,
+      .use_recalc_normals = use_recalc_normals,
+  };
+  TaskParallelSettings settings;
+  BLI_parallel_range_settings_defaults(&settings);
+  settings.use_threading = ((count - 1) * (chunk_nverts + chunk_nloops) > 10000);
+  BLI_task_parallel_range(1, count, &chunk_data, array_chunk_copy_task, &settings);
+  MEM_freeN(chunk_offsets);
+
+  /* Handle merge between chunk n and n-1 */
+  if (use_merge && (count > 1)) {
+    if (!offset_has_scale) {
+      dm_mvert_map_doubles(full_doubles_map,
+                           result_dm_verts,
+                           0,
+                           chunk_nverts,
+                           chunk_nverts,
+                           chunk_nverts,
+                           amd->merge_dist);
 
-    /* Handle merge between chunk n and n-1 */
-    if (use_merge && (c >= 1)) {
-      if (!offset_has_scale && (c >= 2)) {
+      for (c = 2; c < count; c++) {
         /* Mapping chunk 3 to chunk 2 is a translation of mapping 2 to 1
          * ... that is except if scaling makes the distance grow */
         int k;
@@ -608,35 +772,11 @@ static Mesh *arrayModifier_doArray(ArrayModifierData *amd,
           full_doubles_map[this_chunk_index] = target;
         }
       }
-      else {
-        dm_mvert_map_doubles(full_doubles_map,
-                             result_dm_verts,
-                             (c - 1) * chunk_nverts,
-                             chunk_nverts,
-                             c * chunk_nverts,
-                             chunk_nverts,
-                             amd->merge_dist);
-      }
     }
-  }
-
-  /* handle UVs */
-  if (chunk_nloops > 0 && is_zero_v2(amd->uv_offset) == false) {
-    const int totuv = CustomData_number_of_layers(&result->ldata, CD_MLOOPUV);
-    for (i = 0; i < totuv; i++) {
-      MLoopUV *dmloopuv = CustomData_get_layer_n(&result->ldata, CD_MLOOPUV, i);
-      dmloopuv += chunk_nloops;
-      for (c = 1; c < count; c++) {
-        const float uv_offset[2] = {
-            amd->uv_offset[0] * (float)c,
-            amd->uv_offset[1] * (float)c,
-        };
-        int l_index = chunk_nloops;
-        for (; l_index-- != 0; dmloopuv++) {
-          dmloopuv->uv[0] += uv_offset[0];
-          dmloopuv->uv[1] += uv_offset[1];
-        }
-      }
+    else {
+      /* Scaled chunks can't reuse the mapping, sort them all in parallel instead. */
+      dm_mvert_map_doubles_chunks(
+          full_doubles_map, result_dm_verts, chunk_nverts, count, amd->merge_dist);
     }
   }
 
@@ -182,10 +182,14 @@ static Mesh *applyModifier(ModifierData *md, const ModifierEvalContext *ctx, Mes
     BLI_SPACE_TRANSFORM_SETUP(space_transform, ctx->object, ob_source);
   }
 
-  if (((result == me) || (me->mvert == result->mvert) || (me->medge == result->medge)) &&
+  if (((result == me) || (me->mvert == result->mvert) || (me->medge == result->medge) ||
+       CustomData_is_referenced_layer(&result->vdata, CD_MVERT) ||
+       CustomData_is_referenced_layer(&result->edata, CD_MEDGE) ||
+       CustomData_is_referenced_layer(&result->pdata, CD_MPOLY)) &&
       (dtmd->data_types & DT_TYPES_AFFECT_MESH)) {
     /* We need to duplicate data here, otherwise setting custom normals, edges' sharpness, etc.,
-     * could modify org mesh, see T43671. */
+     * could modify org mesh, see T43671.
+     * Layers may also be shared with the modifier stack cache of the object. */
     BKE_id_copy_ex(NULL, &me_mod->id, (ID **)&result, LIB_ID_COPY_LOCALIZE);
   }
 
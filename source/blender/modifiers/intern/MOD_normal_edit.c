@@ -499,10 +499,12 @@ static Mesh *normalEditModifier_do(NormalEditModifierData *enmd,
   }
 
   Mesh *result;
-  if (mesh->medge == ((Mesh *)ob->data)->medge) {
+  if (mesh->medge == ((Mesh *)ob->data)->medge ||
+      CustomData_is_referenced_layer(&mesh->edata, CD_MEDGE)) {
     /* We need to duplicate data here, otherwise setting custom normals
      * (which may also affect sharp edges) could
-     * modify original mesh, see T43671. */
+     * modify original mesh, see T43671.
+     * Edges may also be shared with the modifier stack cache of the object. */
     BKE_id_copy_ex(NULL, &mesh->id, (ID **)&result, LIB_ID_COPY_LOCALIZE);
   }
   else {
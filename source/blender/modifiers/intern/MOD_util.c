@@ -191,7 +191,7 @@ Mesh *MOD_deform_mesh_eval_get(Object *ob,
       BKE_id_copy_ex(NULL,
                      &mesh_prior_modifiers->id,
                      (ID **)&mesh,
-                     (LIB_ID_COPY_LOCALIZE | LIB_ID_COPY_CD_REFERENCE));
+                     (LIB_ID_COPY_LOCALIZE | LIB_ID_COPY_CD_SHARE));
       mesh->runtime.deformed_only = 1;
     }
 
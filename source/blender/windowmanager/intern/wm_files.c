@@ -84,9 +84,11 @@
 #include "BKE_sound.h"
 #include "BKE_scene.h"
 #include "BKE_screen.h"
+#include "BKE_subdiv.h"
 #include "BKE_undo_system.h"
 #include "BKE_workspace.h"
 
+#include "BLO_blend_defs.h"
 #include "BLO_readfile.h"
 #include "BLO_writefile.h"
 #include "BLO_undofile.h" /* to save from an undo memfile */
@@ -368,6 +370,7 @@ static void wm_init_userdef(Main *bmain)
   }
 
   MEM_CacheLimiter_set_maximum(((size_t)U.memcachelimit) * 1024 * 1024);
+  BKE_subdiv_topology_cache_limit_set(((size_t)U.memcachelimit) * 1024 * 1024);
   BKE_sound_init(bmain);
 
   /* update tempdir from user preferences */
@@ -405,7 +408,8 @@ static int wm_read_exotic(const char *name)
     else {
       len = gzread(gzfile, header, sizeof(header));
       gzclose(gzfile);
-      if (len == sizeof(header) && STREQLEN(header, "BLENDER", 7)) {
+      if (len == sizeof(header) &&
+          (STREQLEN(header, "BLENDER", 7) || STREQLEN(header, BLEND_CHUNKED_MAGIC, 7))) {
         retval = BKE_READ_EXOTIC_OK_BLEND;
       }
       else {
@@ -608,6 +612,8 @@ bool WM_file_read(bContext *C, const char *filepath, ReportList *reports)
 
   BKE_callback_exec_null(CTX_data_main(C), BKE_CB_EVT_LOAD_PRE);
   BLI_timer_on_file_load();
+  /* Descriptors of the previous file are unlikely to be used again. */
+  BKE_subdiv_topology_cache_clear();
 
   UI_view2d_zoom_cache_reset();
 
@@ -806,6 +812,7 @@ void wm_homefile_read(bContext *C,
   if (use_data) {
     BKE_callback_exec_null(CTX_data_main(C), BKE_CB_EVT_LOAD_PRE);
     BLI_timer_on_file_load();
+    BKE_subdiv_topology_cache_clear();
 
     G.relbase_valid = 0;
 
@@ -1410,6 +1417,8 @@ static bool wm_file_write(bContext *C, const char *filepath, int fileflags, Repo
     }
 
     SET_FLAG_FROM_TEST(G.fileflags, fileflags & G_FILE_COMPRESS, G_FILE_COMPRESS);
+    SET_FLAG_FROM_TEST(
+        G.fileflags, fileflags & G_FILE_COMPRESS_CHUNKED, G_FILE_COMPRESS_CHUNKED);
 
     /* prevent background mode scripts from clobbering history */
     if (do_history) {
@@ -2543,6 +2552,12 @@ static void save_set_compress(wmOperator *op)
       RNA_property_boolean_set(op->ptr, prop, (U.flag & USER_FILECOMPRESS) != 0);
     }
   }
+
+  prop = RNA_struct_find_property(op->ptr, "compress_chunked");
+  if (!RNA_property_is_set(op->ptr, prop)) {
+    /* keep flag for existing file */
+    RNA_property_boolean_set(op->ptr, prop, (G.fileflags & G_FILE_COMPRESS_CHUNKED) != 0);
+  }
 }
 
 static void save_set_filepath(bContext *C, wmOperator *op)
@@ -2600,6 +2615,8 @@ static int wm_save_as_mainfile_exec(bContext *C, wmOperator *op)
 
   /* set compression flag */
   SET_FLAG_FROM_TEST(fileflags, RNA_boolean_get(op->ptr, "compress"), G_FILE_COMPRESS);
+  SET_FLAG_FROM_TEST(
+      fileflags, RNA_boolean_get(op->ptr, "compress_chunked"), G_FILE_COMPRESS_CHUNKED);
   SET_FLAG_FROM_TEST(fileflags, RNA_boolean_get(op->ptr, "relative_remap"), G_FILE_RELATIVE_REMAP);
   SET_FLAG_FROM_TEST(
       fileflags,
@@ -2664,6 +2681,12 @@ void WM_OT_save_as_mainfile(wmOperatorType *ot)
                                  FILE_DEFAULTDISPLAY,
                                  FILE_SORT_ALPHA);
   RNA_def_boolean(ot->srna, "compress", false, "Compress", "Write compressed .blend file");
+  RNA_def_boolean(ot->srna,
+                  "compress_chunked",
+                  false,
+                  "Chunked Compression",
+                  "Compress in independent chunks on multiple threads, faster to save and load "
+                  "(only readable by versions supporting it)");
   RNA_def_boolean(ot->srna,
                   "relative_remap",
                   true,
@@ -2736,6 +2759,12 @@ void WM_OT_save_mainfile(wmOperatorType *ot)
                                  FILE_DEFAULTDISPLAY,
                                  FILE_SORT_ALPHA);
   RNA_def_boolean(ot->srna, "compress", false, "Compress", "Write compressed .blend file");
+  RNA_def_boolean(ot->srna,
+                  "compress_chunked",
+                  false,
+                  "Chunked Compression",
+                  "Compress in independent chunks on multiple threads, faster to save and load "
+                  "(only readable by versions supporting it)");
   RNA_def_boolean(ot->srna,
                   "relative_remap",
                   false,
@@ -0,0 +1,193 @@
+/* Apache License, Version 2.0 */
+
+#include "blendfile_loading_base_test.h"
+#include "mesh_test_util.h"
+
+#include <string.h>
+
+#include "MEM_guardedalloc.h"
+
+extern "C" {
+#include "BLI_listbase.h"
+#include "BLI_utildefines.h"
+#include "BKE_collection.h"
+#include "BKE_customdata.h"
+#include "BKE_lib_id.h"
+#include "BKE_main.h"
+#include "BKE_mesh.h"
+#include "BKE_object.h"
+#include "BKE_scene.h"
+#include "DEG_depsgraph.h"
+#include "DEG_depsgraph_build.h"
+#include "DEG_depsgraph_query.h"
+#include "DNA_customdata_types.h"
+#include "DNA_mesh_types.h"
+#include "DNA_meshdata_types.h"
+#include "DNA_object_types.h"
+#include "DNA_scene_types.h"
+}
+
+#define TEST_TOTELEM 4
+
+/* Layers copied with CD_SHARE, for every layer type with data. */
+TEST(customdata_share, ShareUnshareRelease)
+{
+  for (int type = 0; type < CD_NUMTYPES; type++) {
+    const int size = CustomData_sizeof(type);
+    if (size == 0) {
+      continue;
+    }
+    const unsigned int blocks_begin = MEM_get_memory_blocks_in_use();
+    const CustomDataMask mask = CD_TYPE_AS_MASK(type);
+    const char *name = CustomData_layertype_name(type);
+
+    CustomData src, dst_a, dst_b;
+    CustomData_reset(&src);
+    CustomData_reset(&dst_a);
+    CustomData_reset(&dst_b);
+    void *data = CustomData_add_layer(&src, type, CD_CALLOC, NULL, TEST_TOTELEM);
+    ASSERT_NE(data, (void *)NULL) << name;
+    EXPECT_FALSE(CustomData_is_referenced_layer(&src, type)) << name;
+
+    /* Share, both sides see the other user. */
+    CustomData_copy(&src, &dst_a, mask, CD_SHARE, TEST_TOTELEM);
+    EXPECT_EQ(CustomData_get_layer(&dst_a, type), data) << name;
+    EXPECT_TRUE(CustomData_is_referenced_layer(&src, type)) << name;
+    EXPECT_TRUE(CustomData_is_referenced_layer(&dst_a, type)) << name;
+    EXPECT_TRUE(CustomData_has_referenced(&dst_a)) << name;
+
+    /* Writing gives the writer its own copy, leaving the source as the only user. */
+    void *data_a = CustomData_duplicate_referenced_layer(&dst_a, type, TEST_TOTELEM);
+    EXPECT_NE(data_a, data) << name;
+    EXPECT_EQ(memcmp(data_a, data, (size_t)(size * TEST_TOTELEM)), 0) << name;
+    EXPECT_FALSE(CustomData_is_referenced_layer(&src, type)) << name;
+    EXPECT_FALSE(CustomData_is_referenced_layer(&dst_a, type)) << name;
+
+    /* Releasing the source keeps the data for the remaining user, which then owns it. */
+    CustomData_copy(&src, &dst_b, mask, CD_SHARE, TEST_TOTELEM);
+    CustomData_free(&src, TEST_TOTELEM);
+    EXPECT_EQ(CustomData_get_layer(&dst_b, type), data) << name;
+    EXPECT_FALSE(CustomData_is_referenced_layer(&dst_b, type)) << name;
+    EXPECT_EQ(CustomData_duplicate_referenced_layer(&dst_b, type, TEST_TOTELEM), data) << name;
+    EXPECT_FALSE(CustomData_duplicate_shared_layers(&dst_b, TEST_TOTELEM)) << name;
+
+    CustomData_free(&dst_a, TEST_TOTELEM);
+    CustomData_free(&dst_b, TEST_TOTELEM);
+    EXPECT_EQ(MEM_get_memory_blocks_in_use(), blocks_begin) << name;
+  }
+}
+
+/* Referenced layers stay referenced, they aren't owned by the source either. */
+TEST(customdata_share, ReferencedSource)
+{
+  MVert mvert[TEST_TOTELEM] = {{{0}}};
+  CustomData src, dst;
+  CustomData_reset(&src);
+  CustomData_reset(&dst);
+  CustomData_add_layer(&src, CD_MVERT, CD_REFERENCE, mvert, TEST_TOTELEM);
+
+  CustomData_copy(&src, &dst, CD_MASK_MVERT, CD_SHARE, TEST_TOTELEM);
+  EXPECT_EQ(CustomData_get_layer(&dst, CD_MVERT), (void *)mvert);
+  EXPECT_TRUE(CustomData_is_referenced_layer(&dst, CD_MVERT));
+  EXPECT_FALSE(CustomData_duplicate_shared_layers(&dst, TEST_TOTELEM));
+  EXPECT_EQ(CustomData_get_layer(&dst, CD_MVERT), (void *)mvert);
+
+  CustomData_free(&src, TEST_TOTELEM);
+  CustomData_free(&dst, TEST_TOTELEM);
+}
+
+/* Copy-on-write of a mesh by the active depsgraph, which shares the arrays of the original. */
+class MeshCopyOnWriteShareTest : public BlendfileLoadingBaseTest {
+ protected:
+  Main *bmain = nullptr;
+  Scene *scene = nullptr;
+  Mesh *mesh = nullptr;
+
+  void SetUp() override
+  {
+    bmain = BKE_main_new();
+    scene = BKE_scene_add(bmain, "Scene");
+    ViewLayer *view_layer = (ViewLayer *)scene->view_layers.first;
+
+    mesh = BKE_mesh_add(bmain, "Grid");
+    Mesh *mesh_grid = test_mesh_grid_create(8, TEST_MESH_GRID_QUADS);
+    Object *object = BKE_object_add_only_object(bmain, OB_MESH, "Grid");
+    object->data = mesh;
+    id_us_plus(&mesh->id);
+    BKE_mesh_nomain_to_mesh(mesh_grid, mesh, object, &CD_MASK_MESH, true);
+    BKE_collection_object_add(bmain, scene->master_collection, object);
+
+    depsgraph = DEG_graph_new(bmain, scene, view_layer, DAG_EVAL_VIEWPORT);
+    DEG_make_active(depsgraph);
+    DEG_graph_build_from_view_layer(depsgraph, bmain, scene, view_layer);
+    BKE_scene_graph_update_tagged(depsgraph, bmain);
+  }
+
+  void TearDown() override
+  {
+    depsgraph_free();
+    BKE_main_free(bmain);
+    BlendfileLoadingBaseTest::TearDown();
+  }
+
+  Mesh *mesh_cow_get()
+  {
+    return (Mesh *)DEG_get_evaluated_id(depsgraph, &mesh->id);
+  }
+
+  void update()
+  {
+    DEG_id_tag_update_ex(bmain, &mesh->id, ID_RECALC_GEOMETRY);
+    BKE_scene_graph_update_tagged(depsgraph, bmain);
+  }
+
+  void expect_shared(const Mesh *mesh_cow)
+  {
+    EXPECT_NE(mesh_cow, mesh);
+    EXPECT_EQ(mesh_cow->mvert, mesh->mvert);
+    EXPECT_EQ(mesh_cow->medge, mesh->medge);
+    EXPECT_EQ(mesh_cow->mloop, mesh->mloop);
+    EXPECT_EQ(mesh_cow->mpoly, mesh->mpoly);
+    EXPECT_TRUE(CustomData_is_referenced_layer(&mesh->vdata, CD_MVERT));
+  }
+};
+
+TEST_F(MeshCopyOnWriteShareTest, CopyRecopy)
+{
+  expect_shared(mesh_cow_get());
+
+  mesh->mvert[0].co[2] += 0.5f;
+  update();
+  expect_shared(mesh_cow_get());
+  EXPECT_EQ(mesh_cow_get()->mvert[0].co[2], mesh->mvert[0].co[2]);
+  update();
+  expect_shared(mesh_cow_get());
+
+  /* Copying again released the previous copies, the original owns its arrays again once the
+   * depsgraph is gone. */
+  depsgraph_free();
+  EXPECT_FALSE(CustomData_is_referenced_layer(&mesh->vdata, CD_MVERT));
+  EXPECT_FALSE(BKE_mesh_duplicate_shared_layers(mesh));
+}
+
+/* Writing the original in place without replacing the copy, as painting does. */
+TEST_F(MeshCopyOnWriteShareTest, UnshareOriginal)
+{
+  const MVert *mvert_shared = mesh->mvert;
+  const float z = mvert_shared[0].co[2];
+
+  EXPECT_TRUE(BKE_mesh_duplicate_shared_layers(mesh));
+  EXPECT_FALSE(BKE_mesh_duplicate_shared_layers(mesh));
+  EXPECT_NE(mesh->mvert, mvert_shared);
+  EXPECT_FALSE(CustomData_is_referenced_layer(&mesh->vdata, CD_MVERT));
+
+  const Mesh *mesh_cow = mesh_cow_get();
+  EXPECT_EQ(mesh_cow->mvert, mvert_shared);
+  mesh->mvert[0].co[2] += 0.5f;
+  EXPECT_EQ(mesh_cow->mvert[0].co[2], z);
+
+  /* Shared again after the next update. */
+  update();
+  expect_shared(mesh_cow_get());
+  EXPECT_EQ(mesh_cow_get()->mvert[0].co[2], z + 0.5f);
+}
@@ -0,0 +1,484 @@
+/* Apache License, Version 2.0 */
+
+#include "testing/testing.h"
+
+#include "mesh_test_util.h"
+
+#include "MEM_guardedalloc.h"
+
+extern "C" {
+#include "BLI_utildefines.h"
+#include "BLI_math.h"
+#include "BLI_rand.h"
+#include "BLI_threads.h"
+#include "BKE_lib_id.h"
+#include "BKE_mesh.h"
+#include "DNA_mesh_types.h"
+#include "DNA_meshdata_types.h"
+}
+
+/* Split normals compared to a serial reference computing the smooth fan of every loop from
+ * scratch, vertex normals and looptris compared to serial computations. */
+
+#define GRID_SIZE 120
+#define POLE_VALENCE 2000
+
+/* Wavy grid with sharp edges and flat faces. Polygons are shuffled and their loops rotated,
+ * so the entry points of cyclic smooth fans are spread over the mesh. */
+static Mesh *test_mesh_grid_shuffled_create(const int size)
+{
+  Mesh *me = test_mesh_grid_create(size, TEST_MESH_GRID_QUADS);
+  const int polys_num = me->totpoly;
+
+  int *poly_order = (int *)MEM_malloc_arrayN((size_t)polys_num, sizeof(int), __func__);
+  for (int i = 0; i < polys_num; i++) {
+    poly_order[i] = i;
+  }
+  BLI_array_randomize(poly_order, sizeof(int), (unsigned int)polys_num, 1);
+
+  /* Grid quads are stored in order, loops and their edges move together. */
+  MLoop *mloop_src = (MLoop *)MEM_dupallocN(me->mloop);
+  for (int i = 0; i < polys_num; i++) {
+    const int x = poly_order[i] % (size - 1);
+    const int y = poly_order[i] / (size - 1);
+    MPoly *mp = &me->mpoly[i];
+    /* Some flat faces. */
+    mp->flag = (x % 17 == 3 && y % 13 == 5) ? 0 : ME_SMOOTH;
+    for (int j = 0; j < 4; j++) {
+      me->mloop[mp->loopstart + j] = mloop_src[poly_order[i] * 4 + (j + i) % 4];
+    }
+  }
+  MEM_freeN(mloop_src);
+  MEM_freeN(poly_order);
+
+  /* Sharp edges along some lines, ending inside the grid. */
+  for (int i = 0; i < me->totedge; i++) {
+    MEdge *med = &me->medge[i];
+    const int x1 = (int)med->v1 % size, y1 = (int)med->v1 / size;
+    const int x2 = (int)med->v2 % size, y2 = (int)med->v2 / size;
+    if ((x1 == x2 && x1 % 11 == 7 && y1 < size / 2) ||
+        (y1 == y2 && y1 % 9 == 4 && x1 > size / 3)) {
+      med->flag |= ME_SHARP;
+    }
+  }
+
+  return me;
+}
+
+/* Cone with a single vertex on top, with polygons ordered along or against the fan around it. */
+static Mesh *test_mesh_pole_create(const int valence, const bool reverse)
+{
+  Mesh *me = BKE_mesh_new_nomain(valence + 1, 0, 0, valence * 3, valence);
+  zero_v3(me->mvert[0].co);
+  me->mvert[0].co[2] = 0.3f;
+  for (int i = 0; i < valence; i++) {
+    const float angle = (float)(2.0 * M_PI) * (float)i / (float)valence;
+    me->mvert[i + 1].co[0] = cosf(angle);
+    me->mvert[i + 1].co[1] = sinf(angle);
+    me->mvert[i + 1].co[2] = 0.0f;
+  }
+  for (int i = 0; i < valence; i++) {
+    const int j = reverse ? valence - 1 - i : i;
+    MPoly *mp = &me->mpoly[i];
+    mp->loopstart = i * 3;
+    mp->totloop = 3;
+    mp->flag = ME_SMOOTH;
+    me->mloop[i * 3 + 0].v = 0;
+    me->mloop[i * 3 + 1].v = (unsigned int)(j + 1);
+    me->mloop[i * 3 + 2].v = (unsigned int)((j + 1) % valence + 1);
+  }
+  BKE_mesh_calc_edges(me, false, false);
+  return me;
+}
+
+static int loop_find_vert(const Mesh *me, const MPoly *mp, const unsigned int v)
+{
+  for (int i = mp->loopstart; i < mp->loopstart + mp->totloop; i++) {
+    if (me->mloop[i].v == v) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+static int fan_find(int *fan, int i)
+{
+  while (fan[i] != i) {
+    i = fan[i] = fan[fan[i]];
+  }
+  return i;
+}
+
+/* Normal of each loop is the angle weighted average of the normals of its smooth fan. */
+static void test_loop_normals_reference(const Mesh *me,
+                                        const float (*polynors)[3],
+                                        float (*r_loopnors)[3])
+{
+  int *loop_to_poly = (int *)MEM_malloc_arrayN((size_t)me->totloop, sizeof(int), __func__);
+  int(*edge_to_polys)[2] = (int(*)[2])MEM_malloc_arrayN(
+      (size_t)me->totedge, sizeof(int[2]), __func__);
+  int *edge_users = (int *)MEM_calloc_arrayN((size_t)me->totedge, sizeof(int), __func__);
+  int *fan = (int *)MEM_malloc_arrayN((size_t)me->totloop, sizeof(int), __func__);
+
+  for (int i = 0; i < me->totpoly; i++) {
+    const MPoly *mp = &me->mpoly[i];
+    for (int j = mp->loopstart; j < mp->loopstart + mp->totloop; j++) {
+      const unsigned int e = me->mloop[j].e;
+      loop_to_poly[j] = i;
+      if (edge_users[e] < 2) {
+        edge_to_polys[e][edge_users[e]] = i;
+      }
+      edge_users[e]++;
+    }
+  }
+
+  /* Loops around the vertices of a smooth edge belong to the same fan. */
+  for (int i = 0; i < me->totloop; i++) {
+    fan[i] = i;
+  }
+  for (int e = 0; e < me->totedge; e++) {
+    const MEdge *med = &me->medge[e];
+    if (edge_users[e] != 2 || (med->flag & ME_SHARP)) {
+      continue;
+    }
+    const MPoly *mp_a = &me->mpoly[edge_to_polys[e][0]];
+    const MPoly *mp_b = &me->mpoly[edge_to_polys[e][1]];
+    if (!(mp_a->flag & ME_SMOOTH) || !(mp_b->flag & ME_SMOOTH)) {
+      continue;
+    }
+    const unsigned int verts[2] = {med->v1, med->v2};
+    for (int k = 0; k < 2; k++) {
+      const int l_a = fan_find(fan, loop_find_vert(me, mp_a, verts[k]));
+      const int l_b = fan_find(fan, loop_find_vert(me, mp_b, verts[k]));
+      fan[max_ii(l_a, l_b)] = min_ii(l_a, l_b);
+    }
+  }
+
+  for (int i = 0; i < me->totloop; i++) {
+    zero_v3(r_loopnors[i]);
+  }
+  for (int i = 0; i < me->totloop; i++) {
+    const MPoly *mp = &me->mpoly[loop_to_poly[i]];
+    const int j = i - mp->loopstart;
+    const MLoop *ml_prev = &me->mloop[mp->loopstart + (j + mp->totloop - 1) % mp->totloop];
+    const MLoop *ml_next = &me->mloop[mp->loopstart + (j + 1) % mp->totloop];
+    const float *co = me->mvert[me->mloop[i].v].co;
+    const float *co_prev = me->mvert[ml_prev->v].co;
+    const float *co_next = me->mvert[ml_next->v].co;
+    float vec_prev[3], vec_next[3];
+    sub_v3_v3v3(vec_prev, co_prev, co);
+    sub_v3_v3v3(vec_next, co_next, co);
+    normalize_v3(vec_prev);
+    normalize_v3(vec_next);
+    const float angle = saacos(dot_v3v3(vec_prev, vec_next));
+    madd_v3_v3fl(r_loopnors[fan_find(fan, i)], polynors[loop_to_poly[i]], angle);
+  }
+  for (int i = 0; i < me->totloop; i++) {
+    if (fan_find(fan, i) != i) {
+      copy_v3_v3(r_loopnors[i], r_loopnors[fan_find(fan, i)]);
+    }
+  }
+  for (int i = 0; i < me->totloop; i++) {
+    normalize_v3(r_loopnors[i]);
+  }
+
+  MEM_freeN(loop_to_poly);
+  MEM_freeN(edge_to_polys);
+  MEM_freeN(edge_users);
+  MEM_freeN(fan);
+}
+
+/* Serial version of #BKE_mesh_calc_normals_poly. */
+static void test_mesh_normals_reference(const Mesh *me,
+                                        float (*r_polynors)[3],
+                                        float (*r_vertnors)[3])
+{
+  memset(r_vertnors, 0, sizeof(*r_vertnors) * (size_t)me->totvert);
+  for (int i = 0; i < me->totpoly; i++) {
+    const MPoly *mp = &me->mpoly[i];
+    const MLoop *ml = &me->mloop[mp->loopstart];
+    /* Newell's method for all polygons, like the threaded code. */
+    zero_v3(r_polynors[i]);
+    for (int j = 0; j < mp->totloop; j++) {
+      add_newell_cross_v3_v3v3(r_polynors[i],
+                               me->mvert[ml[(j + mp->totloop - 1) % mp->totloop].v].co,
+                               me->mvert[ml[j].v].co);
+    }
+    normalize_v3(r_polynors[i]);
+
+    float **vnors = (float **)MEM_malloc_arrayN((size_t)mp->totloop, sizeof(float *), __func__);
+    const float **vcos = (const float **)MEM_malloc_arrayN(
+        (size_t)mp->totloop, sizeof(float *), __func__);
+    float(*vdiffs)[3] = (float(*)[3])MEM_malloc_arrayN(
+        (size_t)mp->totloop, sizeof(*vdiffs), __func__);
+    for (int j = 0; j < mp->totloop; j++) {
+      vnors[j] = r_vertnors[ml[j].v];
+      vcos[j] = me->mvert[ml[j].v].co;
+    }
+    accumulate_vertex_normals_poly_v3(vnors, r_polynors[i], vcos, vdiffs, mp->totloop);
+    MEM_freeN(vnors);
+    MEM_freeN(vcos);
+    MEM_freeN(vdiffs);
+  }
+  for (int i = 0; i < me->totvert; i++) {
+    normalize_v3(r_vertnors[i]);
+  }
+}
+
+/* Serial version of #BKE_mesh_recalc_looptri: the threaded code needs the loops of polygons to
+ * be contiguous, so give it a copy of the loops with a gap before the first one. */
+static void test_mesh_looptri_reference(const Mesh *me, MLoopTri *r_looptris)
+{
+  MLoop *mloop = (MLoop *)MEM_calloc_arrayN((size_t)me->totloop + 1, sizeof(MLoop), __func__);
+  MPoly *mpoly = (MPoly *)MEM_dupallocN(me->mpoly);
+  memcpy(&mloop[1], me->mloop, sizeof(MLoop) * (size_t)me->totloop);
+  for (int i = 0; i < me->totpoly; i++) {
+    mpoly[i].loopstart += 1;
+  }
+
+  BKE_mesh_recalc_looptri(mloop, mpoly, me->mvert, me->totloop + 1, me->totpoly, r_looptris);
+
+  const int looptris_len = poly_to_tri_count(me->totpoly, me->totloop);
+  for (int i = 0; i < looptris_len; i++) {
+    for (int j = 0; j < 3; j++) {
+      r_looptris[i].tri[j] -= 1;
+    }
+  }
+
+  MEM_freeN(mloop);
+  MEM_freeN(mpoly);
+}
+
+class MeshNormalsTest : public testing::Test {
+ protected:
+  Mesh *me = nullptr;
+  float (*polynors)[3] = nullptr;
+  float (*loopnors)[3] = nullptr;
+  float (*loopnors_ref)[3] = nullptr;
+
+  void SetUp() override
+  {
+    /* Several threads even on a single core, fans are shared between tasks. */
+    BLI_system_num_threads_override_set(8);
+    BLI_threadapi_init();
+  }
+
+  void TearDown() override
+  {
+    MEM_SAFE_FREE(polynors);
+    MEM_SAFE_FREE(loopnors);
+    MEM_SAFE_FREE(loopnors_ref);
+    if (me != nullptr) {
+      BKE_id_free(NULL, me);
+    }
+    BLI_threadapi_exit();
+    BLI_system_num_threads_override_set(0);
+  }
+
+  void threads_num_set(const int num)
+  {
+    BLI_threadapi_exit();
+    BLI_system_num_threads_override_set(num);
+    BLI_threadapi_init();
+  }
+
+  void mesh_free()
+  {
+    MEM_SAFE_FREE(polynors);
+    MEM_SAFE_FREE(loopnors);
+    MEM_SAFE_FREE(loopnors_ref);
+    BKE_id_free(NULL, me);
+    me = nullptr;
+  }
+
+  void calc_normals_poly(float (*r_vertnors)[3])
+  {
+    BKE_mesh_calc_normals_poly(me->mvert,
+                               r_vertnors,
+                               me->totvert,
+                               me->mloop,
+                               me->mpoly,
+                               me->totloop,
+                               me->totpoly,
+                               polynors,
+                               false);
+  }
+
+  void mesh_set(Mesh *mesh)
+  {
+    me = mesh;
+    polynors = (float(*)[3])MEM_malloc_arrayN((size_t)me->totpoly, sizeof(*polynors), __func__);
+    loopnors = (float(*)[3])MEM_malloc_arrayN((size_t)me->totloop, sizeof(*loopnors), __func__);
+    loopnors_ref = (float(*)[3])MEM_malloc_arrayN(
+        (size_t)me->totloop, sizeof(*loopnors_ref), __func__);
+    calc_normals_poly(NULL);
+    test_loop_normals_reference(me, polynors, loopnors_ref);
+  }
+
+  void loop_split(MLoopNorSpaceArray *lnors_spacearr, short (*clnors)[2])
+  {
+    BKE_mesh_normals_loop_split(me->mvert,
+                                me->totvert,
+                                me->medge,
+                                me->totedge,
+                                me->mloop,
+                                loopnors,
+                                me->totloop,
+                                me->mpoly,
+                                (const float(*)[3])polynors,
+                                me->totpoly,
+                                true,
+                                (float)M_PI,
+                                lnors_spacearr,
+                                clnors,
+                                NULL);
+  }
+};
+
+TEST_F(MeshNormalsTest, LoopSplit)
+{
+  mesh_set(test_mesh_grid_shuffled_create(GRID_SIZE));
+  loop_split(NULL, NULL);
+  for (int i = 0; i < me->totloop; i++) {
+    EXPECT_V3_NEAR(loopnors[i], loopnors_ref[i], 1e-5f);
+  }
+}
+
+TEST_F(MeshNormalsTest, LoopSplitSpaces)
+{
+  mesh_set(test_mesh_grid_shuffled_create(GRID_SIZE));
+  MLoopNorSpaceArray lnors_spacearr = {NULL};
+  loop_split(&lnors_spacearr, NULL);
+  for (int i = 0; i < me->totloop; i++) {
+    EXPECT_V3_NEAR(loopnors[i], loopnors_ref[i], 1e-5f);
+    ASSERT_NE(lnors_spacearr.lspacearr[i], (MLoopNorSpace *)NULL);
+    EXPECT_V3_NEAR(lnors_spacearr.lspacearr[i]->vec_lnor, loopnors_ref[i], 1e-5f);
+  }
+  BKE_lnor_spacearr_free(&lnors_spacearr);
+}
+
+/* Custom normals are stored relative to the lnor space of their fan, so reading them back relies
+ * on each fan being defined from the same entry point every time. */
+TEST_F(MeshNormalsTest, LoopSplitCustomNormals)
+{
+  mesh_set(test_mesh_grid_shuffled_create(GRID_SIZE));
+  float(*custom_loopnors)[3] = (float(*)[3])MEM_malloc_arrayN(
+      (size_t)me->totloop, sizeof(*custom_loopnors), __func__);
+  short(*clnors)[2] = (short(*)[2])MEM_calloc_arrayN(
+      (size_t)me->totloop, sizeof(*clnors), __func__);
+  for (int i = 0; i < me->totloop; i++) {
+    const float offset[3] = {0.1f, -0.05f, 0.0f};
+    add_v3_v3v3(custom_loopnors[i], loopnors_ref[i], offset);
+    normalize_v3(custom_loopnors[i]);
+  }
+  BKE_mesh_normals_loop_custom_set(me->mvert,
+                                   me->totvert,
+                                   me->medge,
+                                   me->totedge,
+                                   me->mloop,
+                                   custom_loopnors,
+                                   me->totloop,
+                                   me->mpoly,
+                                   (const float(*)[3])polynors,
+                                   me->totpoly,
+                                   clnors);
+
+  for (int i = 0; i < me->totloop; i++) {
+    const float offset[3] = {0.1f, -0.05f, 0.0f};
+    add_v3_v3v3(custom_loopnors[i], loopnors_ref[i], offset);
+    normalize_v3(custom_loopnors[i]);
+  }
+  loop_split(NULL, clnors);
+  for (int i = 0; i < me->totloop; i++) {
+    EXPECT_V3_NEAR(loopnors[i], custom_loopnors[i], 1e-3f);
+  }
+
+  MEM_freeN(custom_loopnors);
+  MEM_freeN(clnors);
+}
+
+TEST_F(MeshNormalsTest, LoopSplitPole)
+{
+  for (int reverse = 0; reverse < 2; reverse++) {
+    mesh_set(test_mesh_pole_create(POLE_VALENCE, reverse));
+    loop_split(NULL, NULL);
+    for (int i = 0; i < me->totloop; i++) {
+      EXPECT_V3_NEAR(loopnors[i], loopnors_ref[i], 1e-5f);
+    }
+    mesh_free();
+  }
+}
+
+TEST_F(MeshNormalsTest, PolyVertNormals)
+{
+  const int poly_types[3] = {TEST_MESH_GRID_TRIS, TEST_MESH_GRID_QUADS, TEST_MESH_GRID_NGONS};
+  for (int i = 0; i < 3; i++) {
+    mesh_set(test_mesh_grid_create(GRID_SIZE, poly_types[i]));
+    float(*vertnors)[3] = (float(*)[3])MEM_malloc_arrayN(
+        (size_t)me->totvert, sizeof(*vertnors), __func__);
+    float(*polynors_ref)[3] = (float(*)[3])MEM_malloc_arrayN(
+        (size_t)me->totpoly, sizeof(*polynors_ref), __func__);
+    float(*vertnors_ref)[3] = (float(*)[3])MEM_malloc_arrayN(
+        (size_t)me->totvert, sizeof(*vertnors_ref), __func__);
+    calc_normals_poly(vertnors);
+    test_mesh_normals_reference(me, polynors_ref, vertnors_ref);
+
+    for (int j = 0; j < me->totpoly; j++) {
+      EXPECT_V3_NEAR(polynors[j], polynors_ref[j], 1e-6f);
+    }
+    for (int j = 0; j < me->totvert; j++) {
+      EXPECT_V3_NEAR(vertnors[j], vertnors_ref[j], 1e-5f);
+      float no[3];
+      normal_short_to_float_v3(no, me->mvert[j].no);
+      EXPECT_V3_NEAR(no, vertnors_ref[j], 1e-4f);
+    }
+
+    MEM_freeN(vertnors);
+    MEM_freeN(polynors_ref);
+    MEM_freeN(vertnors_ref);
+    mesh_free();
+  }
+}
+
+/* Vertex normals are exactly the same whatever the number of threads. */
+TEST_F(MeshNormalsTest, PolyVertNormalsDeterministic)
+{
+  mesh_set(test_mesh_grid_create(GRID_SIZE, TEST_MESH_GRID_NGONS));
+  const size_t vertnors_size = sizeof(float[3]) * (size_t)me->totvert;
+  float(*vertnors)[3] = (float(*)[3])MEM_mallocN(vertnors_size, __func__);
+  float(*vertnors_serial)[3] = (float(*)[3])MEM_mallocN(vertnors_size, __func__);
+  calc_normals_poly(vertnors);
+
+  threads_num_set(1);
+  calc_normals_poly(vertnors_serial);
+  EXPECT_EQ(memcmp(vertnors, vertnors_serial, vertnors_size), 0);
+
+  MEM_freeN(vertnors);
+  MEM_freeN(vertnors_serial);
+}
+
+TEST_F(MeshNormalsTest, Looptri)
+{
+  const int poly_types[3] = {TEST_MESH_GRID_TRIS, TEST_MESH_GRID_QUADS, TEST_MESH_GRID_NGONS};
+  for (int i = 0; i < 3; i++) {
+    me = test_mesh_grid_create(GRID_SIZE, poly_types[i]);
+    const int looptris_len = poly_to_tri_count(me->totpoly, me->totloop);
+    MLoopTri *looptris = (MLoopTri *)MEM_malloc_arrayN(
+        (size_t)looptris_len, sizeof(*looptris), __func__);
+    MLoopTri *looptris_ref = (MLoopTri *)MEM_malloc_arrayN(
+        (size_t)looptris_len, sizeof(*looptris_ref), __func__);
+    BKE_mesh_recalc_looptri(me->mloop, me->mpoly, me->mvert, me->totloop, me->totpoly, looptris);
+    test_mesh_looptri_reference(me, looptris_ref);
+
+    for (int j = 0; j < looptris_len; j++) {
+      EXPECT_EQ(looptris[j].poly, looptris_ref[j].poly);
+      for (int k = 0; k < 3; k++) {
+        EXPECT_EQ(looptris[j].tri[k], looptris_ref[j].tri[k]);
+      }
+    }
+
+    MEM_freeN(looptris);
+    MEM_freeN(looptris_ref);
+    mesh_free();
+  }
+}
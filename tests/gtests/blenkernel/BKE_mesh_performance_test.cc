@@ -0,0 +1,100 @@
+/* Apache License, Version 2.0 */
+
+#include "testing/testing.h"
+
+#include "mesh_test_util.h"
+
+#include "MEM_guardedalloc.h"
+
+extern "C" {
+#include "BLI_utildefines.h"
+#include "BLI_math.h"
+#include "BKE_lib_id.h"
+#include "BKE_mesh.h"
+#include "DNA_mesh_types.h"
+#include "DNA_meshdata_types.h"
+#include "PIL_time_utildefines.h"
+}
+
+/* Time vertex normals and looptri computation on grids of triangles, quads and n-gons,
+ * the two things recomputed after every geometry change.
+ *
+ * Results are checked by BKE_mesh_normals_test. */
+
+/* Run the longest tests! */
+//#define MESH_RUN_BIG
+
+#define MESH_TIMEIT_REPEAT 5
+
+static void mesh_normals_looptri_run(const char *id, const int poly_type, const int size)
+{
+  printf("\n========== STARTING %s ==========\n", id);
+
+  Mesh *me = test_mesh_grid_create(size, poly_type);
+  printf("%d verts, %d loops, %d polys\n", me->totvert, me->totloop, me->totpoly);
+
+  float(*polynors)[3] = (float(*)[3])MEM_malloc_arrayN(
+      (size_t)me->totpoly, sizeof(*polynors), __func__);
+  float(*vertnors)[3] = (float(*)[3])MEM_malloc_arrayN(
+      (size_t)me->totvert, sizeof(*vertnors), __func__);
+  {
+    TIMEIT_START(mesh_calc_normals_poly);
+    for (int i = 0; i < MESH_TIMEIT_REPEAT; i++) {
+      BKE_mesh_calc_normals_poly(me->mvert,
+                                 vertnors,
+                                 me->totvert,
+                                 me->mloop,
+                                 me->mpoly,
+                                 me->totloop,
+                                 me->totpoly,
+                                 polynors,
+                                 false);
+    }
+    TIMEIT_END(mesh_calc_normals_poly);
+  }
+
+  const int looptris_len = poly_to_tri_count(me->totpoly, me->totloop);
+  MLoopTri *looptris = (MLoopTri *)MEM_malloc_arrayN(
+      (size_t)looptris_len, sizeof(*looptris), __func__);
+  {
+    TIMEIT_START(mesh_recalc_looptri);
+    for (int i = 0; i < MESH_TIMEIT_REPEAT; i++) {
+      BKE_mesh_recalc_looptri(me->mloop, me->mpoly, me->mvert, me->totloop, me->totpoly, looptris);
+    }
+    TIMEIT_END(mesh_recalc_looptri);
+  }
+
+  MEM_freeN(looptris);
+  MEM_freeN(polynors);
+  MEM_freeN(vertnors);
+  BKE_id_free(NULL, me);
+
+  printf("========== ENDED %s ==========\n\n", id);
+}
+
+TEST(mesh_performance, Tris1000000)
+{
+  mesh_normals_looptri_run("Tris - 1000000", TEST_MESH_GRID_TRIS, 708);
+}
+
+TEST(mesh_performance, Quads1000000)
+{
+  mesh_normals_looptri_run("Quads - 1000000", TEST_MESH_GRID_QUADS, 1001);
+}
+
+TEST(mesh_performance, NGons1000000)
+{
+  mesh_normals_looptri_run("NGons - 1000000", TEST_MESH_GRID_NGONS, 1001);
+}
+
+#ifdef MESH_RUN_BIG
+TEST(mesh_performance, Quads10000000)
+{
+  mesh_normals_looptri_run("Quads - 10000000", TEST_MESH_GRID_QUADS, 3163);
+}
+
+TEST(mesh_performance, NGons10000000)
+{
+  mesh_normals_looptri_run("NGons - 10000000", TEST_MESH_GRID_NGONS, 3163);
+}
+#endif
@@ -0,0 +1,174 @@
+/* Apache License, Version 2.0 */
+
+#include "blendfile_loading_base_test.h"
+#include "mesh_test_util.h"
+
+#include "MEM_guardedalloc.h"
+
+extern "C" {
+#include "BLI_listbase.h"
+#include "BLI_math.h"
+#include "BLI_utildefines.h"
+#include "BKE_DerivedMesh.h"
+#include "BKE_collection.h"
+#include "BKE_lib_id.h"
+#include "BKE_main.h"
+#include "BKE_mesh.h"
+#include "BKE_modifier.h"
+#include "BKE_object.h"
+#include "BKE_scene.h"
+#include "DEG_depsgraph.h"
+#include "DEG_depsgraph_build.h"
+#include "DEG_depsgraph_query.h"
+#include "DNA_mesh_types.h"
+#include "DNA_meshdata_types.h"
+#include "DNA_modifier_types.h"
+#include "DNA_object_types.h"
+#include "DNA_scene_types.h"
+}
+
+/* Evaluation of a grid under a static array modifier followed by a smooth modifier, which
+ * reuses the result of the array modifier from the modifier stack cache. Results are compared
+ * to evaluations by a fresh depsgraph, which has no cache. */
+class ModifierStackCacheTest : public BlendfileLoadingBaseTest {
+ protected:
+  Main *bmain = nullptr;
+  Scene *scene = nullptr;
+  ViewLayer *view_layer = nullptr;
+  Object *object = nullptr;
+  ArrayModifierData *amd = nullptr;
+  SmoothModifierData *smd = nullptr;
+
+  void SetUp() override
+  {
+    bmain = BKE_main_new();
+    scene = BKE_scene_add(bmain, "Scene");
+    view_layer = (ViewLayer *)scene->view_layers.first;
+
+    Mesh *mesh = BKE_mesh_add(bmain, "Grid");
+    Mesh *mesh_grid = test_mesh_grid_create(16, TEST_MESH_GRID_QUADS);
+    object = BKE_object_add_only_object(bmain, OB_MESH, "Grid");
+    object->data = mesh;
+    id_us_plus(&mesh->id);
+    BKE_mesh_nomain_to_mesh(mesh_grid, mesh, object, &CD_MASK_MESH, true);
+    BKE_collection_object_add(bmain, scene->master_collection, object);
+
+    amd = (ArrayModifierData *)modifier_add(eModifierType_Array);
+    smd = (SmoothModifierData *)modifier_add(eModifierType_Smooth);
+
+    depsgraph = DEG_graph_new(bmain, scene, view_layer, DAG_EVAL_VIEWPORT);
+    DEG_graph_build_from_view_layer(depsgraph, bmain, scene, view_layer);
+    BKE_scene_graph_update_tagged(depsgraph, bmain);
+  }
+
+  void TearDown() override
+  {
+    depsgraph_free();
+    BKE_main_free(bmain);
+    BlendfileLoadingBaseTest::TearDown();
+  }
+
+  ModifierData *modifier_add(const int type)
+  {
+    ModifierData *md = modifier_new(type);
+    BLI_addtail(&object->modifiers, md);
+    modifier_unique_name(&object->modifiers, md);
+    return md;
+  }
+
+  void update(ID *id)
+  {
+    DEG_id_tag_update_ex(bmain, id, ID_RECALC_GEOMETRY);
+    BKE_scene_graph_update_tagged(depsgraph, bmain);
+  }
+
+  int cache_hits()
+  {
+    return mesh_modifier_stack_cache_hits_get(DEG_get_evaluated_object(depsgraph, object));
+  }
+
+  /* The evaluated mesh matches one from a depsgraph without cache. */
+  void expect_matches_fresh_evaluation()
+  {
+    Depsgraph *depsgraph_fresh = DEG_graph_new(bmain, scene, view_layer, DAG_EVAL_VIEWPORT);
+    DEG_graph_build_from_view_layer(depsgraph_fresh, bmain, scene, view_layer);
+    BKE_scene_graph_update_tagged(depsgraph_fresh, bmain);
+
+    Mesh *mesh = BKE_object_get_evaluated_mesh(DEG_get_evaluated_object(depsgraph, object));
+    Mesh *mesh_fresh = BKE_object_get_evaluated_mesh(
+        DEG_get_evaluated_object(depsgraph_fresh, object));
+    ASSERT_NE(mesh, nullptr);
+    ASSERT_NE(mesh_fresh, nullptr);
+    ASSERT_EQ(mesh->totvert, mesh_fresh->totvert);
+    EXPECT_EQ(mesh->totedge, mesh_fresh->totedge);
+    EXPECT_EQ(mesh->totpoly, mesh_fresh->totpoly);
+    for (int i = 0; i < mesh->totvert; i++) {
+      EXPECT_V3_NEAR(mesh->mvert[i].co, mesh_fresh->mvert[i].co, 1e-6f);
+    }
+
+    DEG_graph_free(depsgraph_fresh);
+  }
+};
+
+TEST_F(ModifierStackCacheTest, HitOnEditAfterCachedPart)
+{
+  EXPECT_EQ(cache_hits(), 0);
+  expect_matches_fresh_evaluation();
+
+  smd->fac = 0.9f;
+  update(&object->id);
+  EXPECT_EQ(cache_hits(), 1);
+  expect_matches_fresh_evaluation();
+
+  smd->repeat = 3;
+  update(&object->id);
+  EXPECT_EQ(cache_hits(), 2);
+  expect_matches_fresh_evaluation();
+}
+
+TEST_F(ModifierStackCacheTest, InvalidateOnCachedModifierEdit)
+{
+  amd->count = 4;
+  update(&object->id);
+  EXPECT_EQ(cache_hits(), 0);
+  expect_matches_fresh_evaluation();
+
+  amd->modifier.mode &= ~eModifierMode_Realtime;
+  update(&object->id);
+  EXPECT_EQ(cache_hits(), -1);
+  expect_matches_fresh_evaluation();
+
+  amd->modifier.mode |= eModifierMode_Realtime;
+  update(&object->id);
+  EXPECT_EQ(cache_hits(), 0);
+  expect_matches_fresh_evaluation();
+}
+
+TEST_F(ModifierStackCacheTest, InvalidateOnMeshEdit)
+{
+  Mesh *mesh = (Mesh *)object->data;
+  mesh->mvert[0].co[2] += 0.5f;
+  update(&mesh->id);
+  EXPECT_EQ(cache_hits(), 0);
+  expect_matches_fresh_evaluation();
+}
+
+/* Simplify limits subdivision levels, so it is part of the key. */
+TEST_F(ModifierStackCacheTest, InvalidateOnSimplify)
+{
+  scene->r.mode |= R_SIMPLIFY;
+  scene->r.simplify_subsurf = 1;
+  DEG_id_tag_update_ex(bmain, &scene->id, ID_RECALC_COPY_ON_WRITE);
+  update(&object->id);
+  EXPECT_EQ(cache_hits(), 0);
+  expect_matches_fresh_evaluation();
+
+  scene->r.simplify_subsurf = 2;
+  DEG_id_tag_update_ex(bmain, &scene->id, ID_RECALC_COPY_ON_WRITE);
+  update(&object->id);
+  EXPECT_EQ(cache_hits(), 0);
+  expect_matches_fresh_evaluation();
+
+  update(&object->id);
+  EXPECT_EQ(cache_hits(), 1);
+}
@@ -0,0 +1,356 @@
+/* Apache License, Version 2.0 */
+
+#include "testing/testing.h"
+
+#include "mesh_test_util.h"
+
+#include "MEM_guardedalloc.h"
+
+extern "C" {
+#include "BLI_utildefines.h"
+#include "BLI_bitmap.h"
+#include "BLI_math.h"
+#include "BKE_DerivedMesh.h"
+#include "BKE_ccg.h"
+#include "BKE_customdata.h"
+#include "BKE_lib_id.h"
+#include "BKE_mesh.h"
+#include "BKE_pbvh.h"
+#include "DNA_mesh_types.h"
+#include "DNA_meshdata_types.h"
+#include "PIL_time_utildefines.h"
+#include "bmesh.h"
+}
+
+/* Time the PBVH build done when entering sculpt mode, on grids of quads (regular meshes) and on
+ * multires-like grids, and check that the leaves cover the whole geometry.
+ *
+ * Also time the dynamic topology detail flood fill on a grid of triangles, refining it and then
+ * coarsening it again. */
+
+/* Run the longest tests! */
+//#define PBVH_RUN_BIG
+
+#define PBVH_TIMEIT_REPEAT 5
+
+static bool test_bb_contains(PBVHNode *node, const float co[3])
+{
+  float bb_min[3], bb_max[3];
+  BKE_pbvh_node_get_BB(node, bb_min, bb_max);
+  for (int i = 0; i < 3; i++) {
+    if (co[i] < bb_min[i] || co[i] > bb_max[i]) {
+      return false;
+    }
+  }
+  return true;
+}
+
+static PBVH *test_pbvh_build_mesh(Mesh *me, const MLoopTri *looptri_src, const int looptri_num)
+{
+  /* Owned by the PBVH. */
+  MLoopTri *looptri = (MLoopTri *)MEM_dupallocN(looptri_src);
+
+  PBVH *bvh = BKE_pbvh_new();
+  BKE_pbvh_build_mesh(bvh,
+                      NULL,
+                      me->mpoly,
+                      me->mloop,
+                      me->mvert,
+                      me->totvert,
+                      NULL,
+                      NULL,
+                      looptri,
+                      looptri_num);
+  return bvh;
+}
+
+static void pbvh_build_mesh_run(const char *id, const int size)
+{
+  printf("\n========== STARTING %s ==========\n", id);
+
+  Mesh *me = test_mesh_grid_create(size, TEST_MESH_GRID_QUADS);
+  printf("%d verts, %d polys\n", me->totvert, me->totpoly);
+
+  const int looptri_num = poly_to_tri_count(me->totpoly, me->totloop);
+  MLoopTri *looptri = (MLoopTri *)MEM_malloc_arrayN(
+      (size_t)looptri_num, sizeof(*looptri), __func__);
+  BKE_mesh_recalc_looptri(me->mloop, me->mpoly, me->mvert, me->totloop, me->totpoly, looptri);
+
+  {
+    TIMEIT_START(pbvh_build_mesh);
+    for (int i = 0; i < PBVH_TIMEIT_REPEAT; i++) {
+      BKE_pbvh_free(test_pbvh_build_mesh(me, looptri, looptri_num));
+    }
+    TIMEIT_END(pbvh_build_mesh);
+  }
+
+  /* Every vertex is unique to exactly one leaf, and within the bounds of the leaves using it. */
+  PBVH *bvh = test_pbvh_build_mesh(me, looptri, looptri_num);
+  PBVHNode **nodes;
+  int totnode;
+  BKE_pbvh_search_gather(bvh, NULL, NULL, &nodes, &totnode);
+  printf("%d leaves\n", totnode);
+
+  BLI_bitmap *verts_uniq = BLI_BITMAP_NEW(me->totvert, __func__);
+  int verts_uniq_num = 0;
+  for (int n = 0; n < totnode; n++) {
+    const int *vert_indices;
+    MVert *mvert;
+    int uniq_verts, totvert;
+    BKE_pbvh_node_get_verts(bvh, nodes[n], &vert_indices, &mvert);
+    BKE_pbvh_node_num_verts(bvh, nodes[n], &uniq_verts, &totvert);
+    for (int i = 0; i < totvert; i++) {
+      const int v = vert_indices[i];
+      EXPECT_TRUE(test_bb_contains(nodes[n], mvert[v].co));
+      if (i < uniq_verts) {
+        EXPECT_FALSE(BLI_BITMAP_TEST(verts_uniq, v));
+        BLI_BITMAP_ENABLE(verts_uniq, v);
+        verts_uniq_num++;
+      }
+    }
+  }
+  EXPECT_EQ(verts_uniq_num, me->totvert);
+
+  MEM_freeN(verts_uniq);
+  MEM_SAFE_FREE(nodes);
+  BKE_pbvh_free(bvh);
+  MEM_freeN(looptri);
+  BKE_id_free(NULL, me);
+
+  printf("========== ENDED %s ==========\n\n", id);
+}
+
+static PBVH *test_pbvh_build_grids(
+    CCGElem **grids, const int totgrid, CCGKey *key, DMFlagMat *flagmats, BLI_bitmap **hidden)
+{
+  PBVH *bvh = BKE_pbvh_new();
+  BKE_pbvh_build_grids(bvh, grids, totgrid, key, NULL, flagmats, hidden);
+  return bvh;
+}
+
+static void pbvh_build_grids_run(const char *id, const int totgrid, const int grid_size)
+{
+  printf("\n========== STARTING %s ==========\n", id);
+
+  /* Coordinates only, grids are laid out in rows. */
+  CCGKey key = {0};
+  key.elem_size = sizeof(float[3]);
+  key.grid_size = grid_size;
+  key.grid_area = grid_size * grid_size;
+  key.grid_bytes = key.grid_area * key.elem_size;
+
+  const int grids_per_row = (int)sqrtf((float)totgrid);
+  float(*grids_co)[3] = (float(*)[3])MEM_malloc_arrayN(
+      (size_t)totgrid * (size_t)key.grid_area, sizeof(float[3]), __func__);
+  CCGElem **grids = (CCGElem **)MEM_malloc_arrayN((size_t)totgrid, sizeof(CCGElem *), __func__);
+  for (int g = 0; g < totgrid; g++) {
+    float(*grid_co)[3] = grids_co + (size_t)g * (size_t)key.grid_area;
+    grids[g] = (CCGElem *)grid_co;
+    for (int y = 0; y < grid_size; y++) {
+      for (int x = 0; x < grid_size; x++) {
+        float *co = grid_co[y * grid_size + x];
+        co[0] = (float)(g % grids_per_row) + (float)x / (float)(grid_size - 1);
+        co[1] = (float)(g / grids_per_row) + (float)y / (float)(grid_size - 1);
+        co[2] = sinf(co[0] * 0.3f) * cosf(co[1] * 0.2f) * 0.05f;
+      }
+    }
+  }
+  DMFlagMat *flagmats = (DMFlagMat *)MEM_calloc_arrayN(
+      (size_t)totgrid, sizeof(DMFlagMat), __func__);
+  BLI_bitmap **hidden = (BLI_bitmap **)MEM_calloc_arrayN(
+      (size_t)totgrid, sizeof(BLI_bitmap *), __func__);
+  printf("%d grids of %dx%d\n", totgrid, grid_size, grid_size);
+
+  {
+    TIMEIT_START(pbvh_build_grids);
+    for (int i = 0; i < PBVH_TIMEIT_REPEAT; i++) {
+      BKE_pbvh_free(test_pbvh_build_grids(grids, totgrid, &key, flagmats, hidden));
+    }
+    TIMEIT_END(pbvh_build_grids);
+  }
+
+  /* Every grid is in exactly one leaf, within its bounds. */
+  PBVH *bvh = test_pbvh_build_grids(grids, totgrid, &key, flagmats, hidden);
+  PBVHNode **nodes;
+  int totnode;
+  BKE_pbvh_search_gather(bvh, NULL, NULL, &nodes, &totnode);
+  printf("%d leaves\n", totnode);
+
+  BLI_bitmap *grids_used = BLI_BITMAP_NEW(totgrid, __func__);
+  int grids_used_num = 0;
+  for (int n = 0; n < totnode; n++) {
+    int *grid_indices;
+    int node_totgrid;
+    BKE_pbvh_node_get_grids(bvh, nodes[n], &grid_indices, &node_totgrid, NULL, NULL, NULL);
+    for (int i = 0; i < node_totgrid; i++) {
+      const int g = grid_indices[i];
+      EXPECT_FALSE(BLI_BITMAP_TEST(grids_used, g));
+      BLI_BITMAP_ENABLE(grids_used, g);
+      grids_used_num++;
+      const float(*grid_co)[3] = grids_co + (size_t)g * (size_t)key.grid_area;
+      EXPECT_TRUE(test_bb_contains(nodes[n], grid_co[0]));
+      EXPECT_TRUE(test_bb_contains(nodes[n], grid_co[key.grid_area - 1]));
+    }
+  }
+  EXPECT_EQ(grids_used_num, totgrid);
+
+  MEM_freeN(grids_used);
+  MEM_SAFE_FREE(nodes);
+  BKE_pbvh_free(bvh);
+  MEM_freeN(hidden);
+  MEM_freeN(flagmats);
+  MEM_freeN(grids);
+  MEM_freeN(grids_co);
+
+  printf("========== ENDED %s ==========\n\n", id);
+}
+
+/* Same setup as dynamic topology sculpting: triangles, with paint mask and node layers. */
+static BMesh *test_bmesh_grid_create(const int size, int *r_cd_vert_node, int *r_cd_face_node)
+{
+  BMeshCreateParams params = {0};
+  BMesh *bm = BM_mesh_create(&bm_mesh_allocsize_default, &params);
+  BM_data_layer_add(bm, &bm->vdata, CD_PAINT_MASK);
+  BM_data_layer_add_named(bm, &bm->vdata, CD_PROP_INT, "_dyntopo_node_id");
+  BM_data_layer_add_named(bm, &bm->pdata, CD_PROP_INT, "_dyntopo_node_id");
+  *r_cd_vert_node = CustomData_get_offset(&bm->vdata, CD_PROP_INT);
+  *r_cd_face_node = CustomData_get_offset(&bm->pdata, CD_PROP_INT);
+
+  BMVert **verts = (BMVert **)MEM_malloc_arrayN((size_t)(size * size), sizeof(BMVert *), __func__);
+  for (int y = 0; y < size; y++) {
+    for (int x = 0; x < size; x++) {
+      const float co[3] = {(float)x / (float)(size - 1),
+                           (float)y / (float)(size - 1),
+                           sinf((float)x * 0.3f) * cosf((float)y * 0.2f) * 0.01f};
+      verts[y * size + x] = BM_vert_create(bm, co, NULL, BM_CREATE_NOP);
+    }
+  }
+  for (int y = 0; y < size - 1; y++) {
+    for (int x = 0; x < size - 1; x++) {
+      BMVert *tri_a[3] = {
+          verts[y * size + x], verts[y * size + x + 1], verts[(y + 1) * size + x + 1]};
+      BMVert *tri_b[3] = {
+          verts[y * size + x], verts[(y + 1) * size + x + 1], verts[(y + 1) * size + x]};
+      BM_face_create_verts(bm, tri_a, 3, NULL, BM_CREATE_NOP, true);
+      BM_face_create_verts(bm, tri_b, 3, NULL, BM_CREATE_NOP, true);
+    }
+  }
+  MEM_freeN(verts);
+
+  BM_mesh_normals_update(bm);
+  return bm;
+}
+
+/* Same loop as the detail flood fill operator. */
+static void test_pbvh_bmesh_detail_flood_fill(PBVH *bvh, const float detail_size)
+{
+  PBVHNode **nodes;
+  int totnode;
+  float bb_min[3], bb_max[3], center[3], dim[3];
+
+  BKE_pbvh_search_gather(bvh, NULL, NULL, &nodes, &totnode);
+  for (int i = 0; i < totnode; i++) {
+    BKE_pbvh_node_mark_topology_update(nodes[i]);
+  }
+  BKE_pbvh_bounding_box(bvh, bb_min, bb_max);
+  mid_v3_v3v3(center, bb_min, bb_max);
+  sub_v3_v3v3(dim, bb_max, bb_min);
+  const float size = max_fff(dim[0], dim[1], dim[2]);
+
+  BKE_pbvh_bmesh_detail_size_set(bvh, detail_size);
+  const PBVHTopologyUpdateMode mode = (PBVHTopologyUpdateMode)(PBVH_Collapse | PBVH_Subdivide);
+  while (BKE_pbvh_bmesh_update_topology(bvh, mode, center, NULL, size, false, false)) {
+    for (int i = 0; i < totnode; i++) {
+      BKE_pbvh_node_mark_topology_update(nodes[i]);
+    }
+  }
+  MEM_SAFE_FREE(nodes);
+}
+
+static float test_bmesh_edge_len_max(BMesh *bm)
+{
+  BMIter iter;
+  BMEdge *e;
+  float len_sq_max = 0.0f;
+  BM_ITER_MESH (e, &iter, bm, BM_EDGES_OF_MESH) {
+    len_sq_max = max_ff(len_sq_max, BM_edge_calc_length_squared(e));
+  }
+  return sqrtf(len_sq_max);
+}
+
+static void pbvh_bmesh_detail_flood_fill_run(const char *id, const int size, const int refine)
+{
+  printf("\n========== STARTING %s ==========\n", id);
+
+  int cd_vert_node, cd_face_node;
+  BMesh *bm = test_bmesh_grid_create(size, &cd_vert_node, &cd_face_node);
+  BMLog *log = BM_log_create(bm);
+  /* Changes are logged in the entry of the undo step, as when sculpting. */
+  BM_log_entry_add(log);
+  PBVH *bvh = BKE_pbvh_new();
+  BKE_pbvh_build_bmesh(bvh, bm, true, log, cd_vert_node, cd_face_node);
+  printf("%d verts, %d faces\n", bm->totvert, bm->totface);
+
+  const float detail_fine = 1.0f / (float)((size - 1) * refine);
+  {
+    TIMEIT_START(pbvh_bmesh_detail_flood_fill_refine);
+    test_pbvh_bmesh_detail_flood_fill(bvh, detail_fine);
+    TIMEIT_END(pbvh_bmesh_detail_flood_fill_refine);
+  }
+  printf("%d verts, %d faces\n", bm->totvert, bm->totface);
+  EXPECT_LE(test_bmesh_edge_len_max(bm), detail_fine * 1.0001f);
+
+  const float detail_coarse = 1.0f / (float)(size - 1);
+  {
+    TIMEIT_START(pbvh_bmesh_detail_flood_fill_coarsen);
+    test_pbvh_bmesh_detail_flood_fill(bvh, detail_coarse);
+    TIMEIT_END(pbvh_bmesh_detail_flood_fill_coarsen);
+  }
+  printf("%d verts, %d faces\n", bm->totvert, bm->totface);
+  EXPECT_LE(test_bmesh_edge_len_max(bm), detail_coarse * 1.0001f);
+
+  /* Every face is still in a leaf. */
+  BMIter iter;
+  BMFace *f;
+  BM_ITER_MESH (f, &iter, bm, BM_FACES_OF_MESH) {
+    EXPECT_NE(BM_ELEM_CD_GET_INT(f, cd_face_node), DYNTOPO_NODE_NONE);
+  }
+
+  BKE_pbvh_free(bvh);
+  BM_log_free(log);
+  BM_mesh_free(bm);
+
+  printf("========== ENDED %s ==========\n\n", id);
+}
+
+TEST(pbvh_performance, MeshQuads1000000)
+{
+  pbvh_build_mesh_run("Mesh Quads - 1000000", 1001);
+}
+
+TEST(pbvh_performance, Grids65536x9)
+{
+  pbvh_build_grids_run("Grids - 65536 of 9x9", 65536, 9);
+}
+
+TEST(pbvh_performance, DetailFloodFill128x2)
+{
+  pbvh_bmesh_detail_flood_fill_run("Detail Flood Fill - 128x128 refined 2 times", 129, 2);
+}
+
+#ifdef PBVH_RUN_BIG
+TEST(pbvh_performance, MeshQuads10000000)
+{
+  pbvh_build_mesh_run("Mesh Quads - 10000000", 3163);
+}
+
+TEST(pbvh_performance, Grids262144x17)
+{
+  pbvh_build_grids_run("Grids - 262144 of 17x17", 262144, 17);
+}
+
+TEST(pbvh_performance, DetailFloodFill256x8)
+{
+  pbvh_bmesh_detail_flood_fill_run("Detail Flood Fill - 256x256 refined 8 times", 257, 8);
+}
+#endif
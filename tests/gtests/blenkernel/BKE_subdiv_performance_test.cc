@@ -0,0 +1,187 @@
+/* Apache License, Version 2.0 */
+
+#include "testing/testing.h"
+
+#include "mesh_test_util.h"
+
+#include "MEM_guardedalloc.h"
+
+extern "C" {
+#include "BLI_utildefines.h"
+#include "BLI_math.h"
+#include "BLI_threads.h"
+#include "BKE_lib_id.h"
+#include "BKE_mesh.h"
+#include "BKE_subdiv.h"
+#include "BKE_subdiv_eval.h"
+#include "BKE_subdiv_mesh.h"
+#include "DNA_mesh_types.h"
+#include "DNA_meshdata_types.h"
+#include "PIL_time_utildefines.h"
+#include "opensubdiv_capi_type.h"
+#include "opensubdiv_topology_refiner_capi.h"
+}
+
+/* Time limit surface evaluation of quad grids, point by point and in batches of patch
+ * coordinates, as well as the creation of the final subdivided mesh which uses the batches.
+ *
+ * Does nothing in builds without OpenSubdiv. */
+
+/* Run the longest tests! */
+//#define SUBDIV_RUN_BIG
+
+#define SUBDIV_TIMEIT_REPEAT 5
+
+/* Same as SUBDIV_MESH_EVAL_BATCH_SIZE. */
+#define SUBDIV_EVAL_BATCH_SIZE 128
+
+static void test_subdiv_settings_init(SubdivSettings *settings)
+{
+  settings->is_simple = false;
+  settings->is_adaptive = true;
+  settings->level = 3;
+  settings->use_creases = false;
+  settings->vtx_boundary_interpolation = SUBDIV_VTX_BOUNDARY_EDGE_ONLY;
+  settings->fvar_linear_interpolation = SUBDIV_FVAR_LINEAR_INTERPOLATION_ALL;
+}
+
+static void subdiv_eval_run(const char *id, const int size, const int level)
+{
+  printf("\n========== STARTING %s ==========\n", id);
+
+  BLI_threadapi_init();
+
+  Mesh *me = test_mesh_grid_create(size, TEST_MESH_GRID_QUADS);
+  printf("%d verts, %d edges, %d polys\n", me->totvert, me->totedge, me->totpoly);
+
+  SubdivSettings settings;
+  test_subdiv_settings_init(&settings);
+  Subdiv *subdiv = BKE_subdiv_new_from_mesh(&settings, me);
+  if (subdiv == NULL || !BKE_subdiv_eval_update_from_mesh(subdiv, me, NULL)) {
+    printf("Built without OpenSubdiv, nothing to time\n");
+    if (subdiv != NULL) {
+      BKE_subdiv_free(subdiv);
+    }
+    BKE_id_free(NULL, me);
+    printf("========== ENDED %s ==========\n\n", id);
+    return;
+  }
+
+  /* Regular grid of points on every ptex face, as traversed by subdiv_foreach. */
+  OpenSubdiv_TopologyRefiner *topology_refiner = subdiv->topology_refiner;
+  const int num_ptex_faces = topology_refiner->getNumPtexFaces(topology_refiner);
+  const int resolution = (1 << level) + 1;
+  const int num_points = num_ptex_faces * resolution * resolution;
+  OpenSubdiv_PatchCoord *patch_coords = (OpenSubdiv_PatchCoord *)MEM_malloc_arrayN(
+      (size_t)num_points, sizeof(*patch_coords), __func__);
+  const float inv_resolution_1 = 1.0f / (float)(resolution - 1);
+  for (int ptex_face_index = 0, i = 0; ptex_face_index < num_ptex_faces; ptex_face_index++) {
+    for (int y = 0; y < resolution; y++) {
+      for (int x = 0; x < resolution; x++, i++) {
+        patch_coords[i].ptex_face = ptex_face_index;
+        patch_coords[i].u = (float)x * inv_resolution_1;
+        patch_coords[i].v = (float)y * inv_resolution_1;
+      }
+    }
+  }
+  printf("%d points\n", num_points);
+
+  float(*P_single)[3] = (float(*)[3])MEM_malloc_arrayN((size_t)num_points, sizeof(float[3]), "P");
+  float(*dPdu_single)[3] = (float(*)[3])MEM_malloc_arrayN(
+      (size_t)num_points, sizeof(float[3]), "dPdu");
+  float(*dPdv_single)[3] = (float(*)[3])MEM_malloc_arrayN(
+      (size_t)num_points, sizeof(float[3]), "dPdv");
+  {
+    TIMEIT_START(subdiv_eval_single);
+    for (int i = 0; i < SUBDIV_TIMEIT_REPEAT; i++) {
+      for (int j = 0; j < num_points; j++) {
+        BKE_subdiv_eval_limit_point_and_derivatives(subdiv,
+                                                    patch_coords[j].ptex_face,
+                                                    patch_coords[j].u,
+                                                    patch_coords[j].v,
+                                                    P_single[j],
+                                                    dPdu_single[j],
+                                                    dPdv_single[j]);
+      }
+    }
+    TIMEIT_END(subdiv_eval_single);
+  }
+
+  float(*P)[3] = (float(*)[3])MEM_malloc_arrayN((size_t)num_points, sizeof(float[3]), "P");
+  float(*dPdu)[3] = (float(*)[3])MEM_malloc_arrayN((size_t)num_points, sizeof(float[3]), "dPdu");
+  float(*dPdv)[3] = (float(*)[3])MEM_malloc_arrayN((size_t)num_points, sizeof(float[3]), "dPdv");
+  {
+    TIMEIT_START(subdiv_eval_batched);
+    for (int i = 0; i < SUBDIV_TIMEIT_REPEAT; i++) {
+      for (int j = 0; j < num_points; j += SUBDIV_EVAL_BATCH_SIZE) {
+        const int batch_size = min_ii(SUBDIV_EVAL_BATCH_SIZE, num_points - j);
+        BKE_subdiv_eval_limit_points(
+            subdiv, &patch_coords[j], batch_size, &P[j], &dPdu[j], &dPdv[j]);
+      }
+    }
+    TIMEIT_END(subdiv_eval_batched);
+  }
+
+  /* Both paths run the same evaluation. */
+  for (int i = 0; i < num_points; i++) {
+    EXPECT_V3_NEAR(P[i], P_single[i], 1e-6f);
+    EXPECT_V3_NEAR(dPdu[i], dPdu_single[i], 1e-6f);
+    EXPECT_V3_NEAR(dPdv[i], dPdv_single[i], 1e-6f);
+  }
+
+  SubdivToMeshSettings mesh_settings;
+  mesh_settings.resolution = resolution;
+  mesh_settings.use_optimal_display = false;
+  {
+    TIMEIT_START(subdiv_to_mesh);
+    for (int i = 0; i < SUBDIV_TIMEIT_REPEAT; i++) {
+      Mesh *result = BKE_subdiv_to_mesh(subdiv, &mesh_settings, me);
+      ASSERT_NE(result, (Mesh *)NULL);
+      EXPECT_EQ(result->totpoly, num_ptex_faces * (resolution - 1) * (resolution - 1));
+      BKE_id_free(NULL, result);
+    }
+    TIMEIT_END(subdiv_to_mesh);
+  }
+
+  MEM_freeN(P);
+  MEM_freeN(dPdu);
+  MEM_freeN(dPdv);
+  MEM_freeN(P_single);
+  MEM_freeN(dPdu_single);
+  MEM_freeN(dPdv_single);
+  MEM_freeN(patch_coords);
+
+  /* Released descriptor is cached, and given back for the same topology. */
+  SubdivTopologyCacheStats stats_before, stats_after;
+  BKE_subdiv_topology_cache_stats_get(&stats_before);
+  BKE_subdiv_topology_cache_limit_set(MAX2(stats_before.memory_limit, subdiv->cache_.memory_size));
+  BKE_subdiv_free(subdiv);
+  subdiv = BKE_subdiv_new_from_mesh(&settings, me);
+  BKE_subdiv_topology_cache_stats_get(&stats_after);
+  EXPECT_EQ(stats_after.num_hits, stats_before.num_hits + 1);
+  EXPECT_NE(subdiv->evaluator, (OpenSubdiv_Evaluator *)NULL);
+  BKE_subdiv_free(subdiv);
+  BKE_subdiv_topology_cache_clear();
+  BKE_subdiv_topology_cache_limit_set(stats_before.memory_limit);
+
+  BKE_id_free(NULL, me);
+
+  printf("========== ENDED %s ==========\n\n", id);
+}
+
+TEST(subdiv_performance, Quads10000Level2)
+{
+  subdiv_eval_run("Quads - 10000 - level 2", 101, 2);
+}
+
+TEST(subdiv_performance, Quads10000Level4)
+{
+  subdiv_eval_run("Quads - 10000 - level 4", 101, 4);
+}
+
+#ifdef SUBDIV_RUN_BIG
+TEST(subdiv_performance, Quads100000Level4)
+{
+  subdiv_eval_run("Quads - 100000 - level 4", 317, 4);
+}
+#endif
@@ -0,0 +1,151 @@
+/* Apache License, Version 2.0 */
+
+#include "testing/testing.h"
+
+#include "MEM_guardedalloc.h"
+
+extern "C" {
+#include "BLI_utildefines.h"
+#include "BKE_subdiv.h"
+}
+
+/* Bookkeeping of the topology cache, on descriptors without topology refiner so it does not
+ * depend on OpenSubdiv. Which candidates have the requested topology is told by the test. */
+
+#define TEST_SUBDIV_MEMORY_SIZE 1000
+
+class SubdivTopologyCacheTest : public testing::Test {
+ protected:
+  SubdivTopologyCacheStats stats_begin;
+
+  void SetUp() override
+  {
+    BKE_subdiv_topology_cache_clear();
+    BKE_subdiv_topology_cache_limit_set(TEST_SUBDIV_MEMORY_SIZE * 3);
+    BKE_subdiv_topology_cache_stats_get(&stats_begin);
+  }
+
+  void TearDown() override
+  {
+    BKE_subdiv_topology_cache_clear();
+    BKE_subdiv_topology_cache_limit_set(32 * 1024 * 1024);
+  }
+
+  /* Descriptor as created for a mesh with the given number of vertices. */
+  Subdiv *subdiv_new(const int num_vertices)
+  {
+    Subdiv *subdiv = (Subdiv *)MEM_callocN(sizeof(Subdiv), __func__);
+    subdiv->settings.is_adaptive = true;
+    subdiv->settings.level = 2;
+    subdiv->cache_.num_vertices = num_vertices;
+    subdiv->cache_.num_edges = num_vertices * 2;
+    subdiv->cache_.num_faces = num_vertices;
+    subdiv->cache_.memory_size = TEST_SUBDIV_MEMORY_SIZE;
+    return subdiv;
+  }
+
+  Subdiv *acquire(const int num_vertices, Subdiv *subdiv_expected)
+  {
+    SubdivSettings settings = {0};
+    settings.is_adaptive = true;
+    settings.level = 2;
+    return BKE_subdiv_topology_cache_acquire(
+        &settings, num_vertices, num_vertices * 2, num_vertices, topology_equal, subdiv_expected);
+  }
+
+  /* A NULL user_data matches any candidate. */
+  static bool topology_equal(const Subdiv *subdiv, void *user_data)
+  {
+    return ELEM(user_data, NULL, subdiv);
+  }
+
+  void expect_stats(const int num_items, const int hits, const int misses, const int evictions)
+  {
+    SubdivTopologyCacheStats stats;
+    BKE_subdiv_topology_cache_stats_get(&stats);
+    EXPECT_EQ(stats.num_items, num_items);
+    EXPECT_EQ(stats.memory_size, (size_t)(num_items * TEST_SUBDIV_MEMORY_SIZE));
+    EXPECT_EQ(stats.num_hits - stats_begin.num_hits, hits);
+    EXPECT_EQ(stats.num_misses - stats_begin.num_misses, misses);
+    EXPECT_EQ(stats.num_evictions - stats_begin.num_evictions, evictions);
+  }
+};
+
+TEST_F(SubdivTopologyCacheTest, AcquireRelease)
+{
+  EXPECT_EQ(acquire(8, NULL), (Subdiv *)NULL);
+  expect_stats(0, 0, 1, 0);
+
+  Subdiv *subdiv = subdiv_new(8);
+  BKE_subdiv_topology_cache_release(subdiv);
+  expect_stats(1, 0, 1, 0);
+
+  /* Another number of elements is a miss, without looking at the topology. */
+  EXPECT_EQ(acquire(9, NULL), (Subdiv *)NULL);
+  expect_stats(1, 0, 2, 0);
+
+  /* A hit gives the descriptor back to its new owner. */
+  EXPECT_EQ(acquire(8, NULL), subdiv);
+  expect_stats(0, 1, 2, 0);
+  EXPECT_EQ(acquire(8, NULL), (Subdiv *)NULL);
+  expect_stats(0, 1, 3, 0);
+
+  BKE_subdiv_topology_cache_release(subdiv);
+  expect_stats(1, 1, 3, 0);
+}
+
+TEST_F(SubdivTopologyCacheTest, TopologyMismatchStaysCached)
+{
+  Subdiv *subdiv_a = subdiv_new(8);
+  Subdiv *subdiv_b = subdiv_new(8);
+  BKE_subdiv_topology_cache_release(subdiv_a);
+  BKE_subdiv_topology_cache_release(subdiv_b);
+
+  /* Most recently released first, candidates with another topology are kept. */
+  EXPECT_EQ(acquire(8, subdiv_a), subdiv_a);
+  expect_stats(1, 1, 0, 0);
+  EXPECT_EQ(acquire(8, subdiv_b), subdiv_b);
+  expect_stats(0, 2, 0, 0);
+
+  BKE_subdiv_free(subdiv_a);
+  BKE_subdiv_free(subdiv_b);
+}
+
+TEST_F(SubdivTopologyCacheTest, EvictLeastRecentlyUsed)
+{
+  Subdiv *subdiv[4];
+  for (int i = 0; i < 4; i++) {
+    subdiv[i] = subdiv_new(8 + i);
+    BKE_subdiv_topology_cache_release(subdiv[i]);
+  }
+  /* The oldest one is freed above the memory limit. */
+  expect_stats(3, 0, 0, 1);
+  EXPECT_EQ(acquire(8, NULL), (Subdiv *)NULL);
+
+  /* Acquiring and releasing makes a descriptor the most recently used. */
+  EXPECT_EQ(acquire(9, NULL), subdiv[1]);
+  BKE_subdiv_topology_cache_release(subdiv[1]);
+  BKE_subdiv_topology_cache_release(subdiv_new(12));
+  expect_stats(3, 1, 1, 2);
+  EXPECT_EQ(acquire(10, NULL), (Subdiv *)NULL);
+  EXPECT_EQ(acquire(9, NULL), subdiv[1]);
+  BKE_subdiv_free(subdiv[1]);
+}
+
+TEST_F(SubdivTopologyCacheTest, LimitSet)
+{
+  for (int i = 0; i < 3; i++) {
+    BKE_subdiv_topology_cache_release(subdiv_new(8 + i));
+  }
+  expect_stats(3, 0, 0, 0);
+
+  BKE_subdiv_topology_cache_limit_set(TEST_SUBDIV_MEMORY_SIZE);
+  expect_stats(1, 0, 0, 2);
+  EXPECT_EQ(acquire(9, NULL), (Subdiv *)NULL);
+
+  /* Zero disables the cache. */
+  BKE_subdiv_topology_cache_limit_set(0);
+  expect_stats(0, 0, 1, 3);
+  BKE_subdiv_topology_cache_release(subdiv_new(8));
+  expect_stats(0, 0, 1, 4);
+}
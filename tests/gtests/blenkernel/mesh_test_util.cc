@@ -0,0 +1,106 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * The Original Code is Copyright (C) 2020 by Blender Foundation.
+ */
+#include "mesh_test_util.h"
+
+extern "C" {
+#include "BLI_utildefines.h"
+#include "BLI_math.h"
+#include "BKE_mesh.h"
+#include "DNA_mesh_types.h"
+#include "DNA_meshdata_types.h"
+}
+
+/* Number of grid cells merged in a single polygon, along X. */
+static int grid_cells_per_poly(const int poly_type, const int x)
+{
+  switch (poly_type) {
+    case TEST_MESH_GRID_TRIS:
+    case TEST_MESH_GRID_QUADS:
+      return 1;
+    default:
+      return 1 + (x % 3);
+  }
+}
+
+Mesh *test_mesh_grid_create(const int size, const int poly_type)
+{
+  int polys_num = 0, loops_num = 0;
+  for (int y = 0; y < size - 1; y++) {
+    for (int x = 0; x < size - 1;) {
+      const int cells = min_ii(grid_cells_per_poly(poly_type, x), size - 1 - x);
+      polys_num += (poly_type == TEST_MESH_GRID_TRIS) ? 2 : 1;
+      loops_num += (poly_type == TEST_MESH_GRID_TRIS) ? 6 : (cells + 1) * 2;
+      x += cells;
+    }
+  }
+
+  Mesh *me = BKE_mesh_new_nomain(size * size, 0, 0, loops_num, polys_num);
+  for (int y = 0; y < size; y++) {
+    for (int x = 0; x < size; x++) {
+      float *co = me->mvert[y * size + x].co;
+      co[0] = (float)x / (float)size;
+      co[1] = (float)y / (float)size;
+      co[2] = sinf((float)x * 0.3f) * cosf((float)y * 0.2f) * 0.05f;
+    }
+  }
+
+  MLoop *ml = me->mloop;
+  MPoly *mp = me->mpoly;
+
+#define ADD_LOOP(_x, _y) (ml++)->v = (unsigned int)((_y)*size + (_x))
+
+  for (int y = 0; y < size - 1; y++) {
+    for (int x = 0; x < size - 1;) {
+      const int cells = min_ii(grid_cells_per_poly(poly_type, x), size - 1 - x);
+      if (poly_type == TEST_MESH_GRID_TRIS) {
+        mp->loopstart = (int)(ml - me->mloop);
+        mp->totloop = 3;
+        (mp++)->flag = ME_SMOOTH;
+        ADD_LOOP(x, y);
+        ADD_LOOP(x + 1, y);
+        ADD_LOOP(x + 1, y + 1);
+        mp->loopstart = (int)(ml - me->mloop);
+        mp->totloop = 3;
+        (mp++)->flag = ME_SMOOTH;
+        ADD_LOOP(x, y);
+        ADD_LOOP(x + 1, y + 1);
+        ADD_LOOP(x, y + 1);
+      }
+      else {
+        mp->loopstart = (int)(ml - me->mloop);
+        mp->totloop = (cells + 1) * 2;
+        (mp++)->flag = ME_SMOOTH;
+        for (int i = 0; i <= cells; i++) {
+          ADD_LOOP(x + i, y);
+        }
+        for (int i = cells; i >= 0; i--) {
+          ADD_LOOP(x + i, y + 1);
+        }
+      }
+      x += cells;
+    }
+  }
+
+#undef ADD_LOOP
+
+  BLI_assert(mp - me->mpoly == polys_num && ml - me->mloop == loops_num);
+
+  BKE_mesh_calc_edges(me, false, false);
+  BKE_mesh_calc_normals(me);
+  return me;
+}
@@ -0,0 +1,37 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * The Original Code is Copyright (C) 2020 by Blender Foundation.
+ */
+#ifndef __MESH_TEST_UTIL_H__
+#define __MESH_TEST_UTIL_H__
+
+struct Mesh;
+
+/* Polygon types of #test_mesh_grid_create. */
+enum {
+  TEST_MESH_GRID_TRIS = 3,
+  TEST_MESH_GRID_QUADS = 4,
+  /* Mix of quads, hexagons and octagons. */
+  TEST_MESH_GRID_NGONS = 0,
+};
+
+/**
+ * Wavy grid of `size * size` vertices, with smooth polygons, edges and vertex normals.
+ * Free it with #BKE_id_free.
+ */
+struct Mesh *test_mesh_grid_create(const int size, const int poly_type);
+
+#endif /* __MESH_TEST_UTIL_H__ */
@@ -0,0 +1,183 @@
+/* Apache License, Version 2.0 */
+
+#include "testing/testing.h"
+
+#include "MEM_guardedalloc.h"
+
+extern "C" {
+#include "BLI_utildefines.h"
+#include "BLI_kdopbvh.h"
+#include "BLI_math_vector.h"
+#include "BLI_rand.h"
+#include "PIL_time_utildefines.h"
+}
+
+#include "stubs/bf_intern_eigen_stubs.h"
+
+/* Time building, refitting and querying trees of small random triangles,
+ * using the same tree type as BKE_bvhutils for looptris. */
+
+/* Run the longest tests! */
+//#define KDOPBVH_RUN_BIG
+
+#define TREE_TYPE 4
+#define TREE_AXIS 6
+
+static float (*tris_create(const int tris_len, const int random_seed))[3][3]
+{
+  float(*tris)[3][3] = (float(*)[3][3])MEM_mallocN(sizeof(*tris) * (size_t)tris_len, __func__);
+  /* Keep the triangle size proportional to the average spacing, like a dense mesh. */
+  const float size = 1.0f / cbrtf((float)tris_len);
+  RNG *rng = BLI_rng_new(random_seed);
+
+  for (int i = 0; i < tris_len; i++) {
+    float co[3];
+    BLI_rng_get_float_unit_v3(rng, co);
+    mul_v3_fl(co, BLI_rng_get_float(rng));
+    for (int j = 0; j < 3; j++) {
+      float offset[3];
+      BLI_rng_get_float_unit_v3(rng, offset);
+      madd_v3_v3v3fl(tris[i][j], co, offset, size);
+    }
+  }
+  BLI_rng_free(rng);
+  return tris;
+}
+
+static void refit_tri_callback(void *userdata, BVHTree *tree, int index)
+{
+  float(*tris)[3][3] = (float(*)[3][3])userdata;
+  BLI_bvhtree_update_node(tree, index, tris[index][0], NULL, 3);
+}
+
+static void kdopbvh_run(const char *id, const int tris_len)
+{
+  printf("\n========== STARTING %s ==========\n", id);
+
+  float(*tris)[3][3] = tris_create(tris_len, 1234);
+  BVHTree *tree = BLI_bvhtree_new(tris_len, 0.0f, TREE_TYPE, TREE_AXIS);
+
+  {
+    TIMEIT_START(kdopbvh_insert);
+    for (int i = 0; i < tris_len; i++) {
+      BLI_bvhtree_insert(tree, i, tris[i][0], 3);
+    }
+    TIMEIT_END(kdopbvh_insert);
+  }
+  {
+    TIMEIT_START(kdopbvh_balance);
+    BLI_bvhtree_balance(tree);
+    TIMEIT_END(kdopbvh_balance);
+  }
+  {
+    TIMEIT_START(kdopbvh_update_serial);
+    for (int i = 0; i < tris_len; i++) {
+      BLI_bvhtree_update_node(tree, i, tris[i][0], NULL, 3);
+    }
+    BLI_bvhtree_update_tree(tree);
+    TIMEIT_END(kdopbvh_update_serial);
+  }
+  {
+    TIMEIT_START(kdopbvh_refit);
+    BLI_bvhtree_refit(tree, refit_tri_callback, tris);
+    TIMEIT_END(kdopbvh_refit);
+  }
+
+  /* Queries sweep over the sphere in order, like the vertices of a mesh would. */
+  const int queries_len = min_ii(tris_len, 100000);
+  float(*co)[3] = (float(*)[3])MEM_mallocN(sizeof(*co) * (size_t)queries_len, __func__);
+  for (int i = 0; i < queries_len; i++) {
+    const float fac = (float)i / (float)queries_len;
+    const float z = fac * 2.0f - 1.0f;
+    const float r = sqrtf(1.0f - z * z);
+    copy_v3_fl3(co[i], cosf(fac * 500.0f) * r, sinf(fac * 500.0f) * r, z);
+  }
+
+  BVHTreeNearest *nearest = (BVHTreeNearest *)MEM_mallocN(sizeof(*nearest) * (size_t)queries_len,
+                                                          __func__);
+  {
+    TIMEIT_START(kdopbvh_find_nearest);
+    for (int i = 0; i < queries_len; i++) {
+      nearest[i].index = -1;
+      nearest[i].dist_sq = FLT_MAX;
+      BLI_bvhtree_find_nearest(tree, co[i], &nearest[i], NULL, NULL);
+    }
+    TIMEIT_END(kdopbvh_find_nearest);
+  }
+  for (int use_previous = 0; use_previous < 2; use_previous++) {
+    for (int i = 0; i < queries_len; i++) {
+      nearest[i].index = -1;
+      nearest[i].dist_sq = FLT_MAX;
+    }
+    TIMEIT_START(kdopbvh_find_nearest_batch);
+    BLI_bvhtree_find_nearest_batch(
+        tree, co, queries_len, nearest, NULL, NULL, use_previous ? BVH_NEAREST_USE_PREVIOUS : 0);
+    TIMEIT_END(kdopbvh_find_nearest_batch);
+    for (int i = 0; i < queries_len; i++) {
+      EXPECT_NE(nearest[i].index, -1);
+    }
+  }
+  MEM_freeN(nearest);
+
+  BVHTreeRay *rays = (BVHTreeRay *)MEM_mallocN(sizeof(*rays) * (size_t)queries_len, __func__);
+  BVHTreeRayHit *hits = (BVHTreeRayHit *)MEM_mallocN(sizeof(*hits) * (size_t)queries_len,
+                                                     __func__);
+  for (int i = 0; i < queries_len; i++) {
+    copy_v3_v3(rays[i].origin, co[i]);
+    mul_v3_v3fl(rays[i].direction, co[i], -1.0f);
+    normalize_v3(rays[i].direction);
+    rays[i].radius = 0.0f;
+  }
+  {
+    int found = 0;
+    TIMEIT_START(kdopbvh_ray_cast);
+    for (int i = 0; i < queries_len; i++) {
+      hits[i].index = -1;
+      hits[i].dist = BVH_RAYCAST_DIST_MAX;
+      found += (BLI_bvhtree_ray_cast(
+                    tree, rays[i].origin, rays[i].direction, 0.0f, &hits[i], NULL, NULL) != -1);
+    }
+    TIMEIT_END(kdopbvh_ray_cast);
+    EXPECT_GT(found, 0);
+  }
+  {
+    int found = 0;
+    for (int i = 0; i < queries_len; i++) {
+      hits[i].index = -1;
+      hits[i].dist = BVH_RAYCAST_DIST_MAX;
+    }
+    TIMEIT_START(kdopbvh_ray_cast_batch);
+    BLI_bvhtree_ray_cast_batch(tree, rays, queries_len, hits, NULL, NULL, BVH_RAYCAST_DEFAULT);
+    TIMEIT_END(kdopbvh_ray_cast_batch);
+    for (int i = 0; i < queries_len; i++) {
+      found += (hits[i].index != -1);
+    }
+    EXPECT_GT(found, 0);
+  }
+  MEM_freeN(rays);
+  MEM_freeN(hits);
+  MEM_freeN(co);
+
+
+  BLI_bvhtree_free(tree);
+  MEM_freeN(tris);
+
+  printf("========== ENDED %s ==========\n\n", id);
+}
+
+TEST(kdopbvh, Tris100000)
+{
+  kdopbvh_run("Tris - 100000", 100000);
+}
+
+TEST(kdopbvh, Tris1000000)
+{
+  kdopbvh_run("Tris - 1000000", 1000000);
+}
+
+#ifdef KDOPBVH_RUN_BIG
+TEST(kdopbvh, Tris10000000)
+{
+  kdopbvh_run("Tris - 10000000", 10000000);
+}
+#endif
@@ -136,3 +136,177 @@ TEST(kdopbvh, OptimalFindNearest_500)
 {
   find_nearest_points_test(500, 1.0, 1000, 12, true);
 }
+
+/* Large enough for the top levels to be partitioned using threads. */
+TEST(kdopbvh, FindNearest_70000)
+{
+  find_nearest_points_test(70000, 1.0, 100000, 1234);
+}
+
+static const float refit_offset[3] = {10.0f, -5.0f, 2.0f};
+
+static void refit_offset_callback(void *userdata, BVHTree *tree, int index)
+{
+  float(*points)[3] = (float(*)[3])userdata;
+  float co[3];
+
+  add_v3_v3v3(co, points[index], refit_offset);
+  BLI_bvhtree_update_node(tree, index, co, NULL, 1);
+}
+
+static void refit_points_test(int points_len, int random_seed)
+{
+  struct RNG *rng = BLI_rng_new(random_seed);
+  BVHTree *tree = BLI_bvhtree_new(points_len, 0.0, 4, 8);
+
+  void *mem = MEM_mallocN(sizeof(float[3]) * points_len, __func__);
+  float(*points)[3] = (float(*)[3])mem;
+
+  for (int i = 0; i < points_len; i++) {
+    rng_v3_round(points[i], 3, rng, 1000, 1.0f);
+    BLI_bvhtree_insert(tree, i, points[i], 1);
+  }
+  BLI_bvhtree_balance(tree);
+
+  BLI_bvhtree_refit(tree, refit_offset_callback, points);
+
+  for (int i = 0; i < points_len; i++) {
+    float co[3];
+    add_v3_v3v3(co, points[i], refit_offset);
+    const int j = BLI_bvhtree_find_nearest(tree, co, NULL, NULL, NULL);
+    EXPECT_GE(j, 0);
+    EXPECT_LT(j, points_len);
+    if (j != i) {
+      EXPECT_EQ_ARRAY(points[i], points[j], 3);
+    }
+  }
+  BLI_bvhtree_free(tree);
+  BLI_rng_free(rng);
+  MEM_freeN(points);
+}
+
+TEST(kdopbvh, Refit_500)
+{
+  refit_points_test(500, 12);
+}
+TEST(kdopbvh, Refit_100000)
+{
+  refit_points_test(100000, 123);
+}
+
+static BVHTree *random_points_tree(float (*points)[3], int points_len, struct RNG *rng)
+{
+  BVHTree *tree = BLI_bvhtree_new(points_len, 0.001f, 4, 6);
+  for (int i = 0; i < points_len; i++) {
+    BLI_rng_get_float_unit_v3(rng, points[i]);
+    mul_v3_fl(points[i], BLI_rng_get_float(rng));
+    BLI_bvhtree_insert(tree, i, points[i], 1);
+  }
+  BLI_bvhtree_balance(tree);
+  return tree;
+}
+
+/* Batched queries must give the same results as single queries. */
+static void find_nearest_batch_test(int points_len, int queries_len, int random_seed, int flag)
+{
+  struct RNG *rng = BLI_rng_new(random_seed);
+  float(*points)[3] = (float(*)[3])MEM_mallocN(sizeof(float[3]) * points_len, __func__);
+  BVHTree *tree = random_points_tree(points, points_len, rng);
+
+  float(*co)[3] = (float(*)[3])MEM_mallocN(sizeof(float[3]) * queries_len, __func__);
+  BVHTreeNearest *nearest = (BVHTreeNearest *)MEM_mallocN(sizeof(*nearest) * queries_len,
+                                                          __func__);
+  for (int i = 0; i < queries_len; i++) {
+    /* Points along a spiral, so neighboring queries are coherent. */
+    const float fac = (float)i / (float)queries_len;
+    co[i][0] = cosf(fac * 50.0f) * fac;
+    co[i][1] = sinf(fac * 50.0f) * fac;
+    co[i][2] = fac - 0.5f;
+    nearest[i].index = -1;
+    nearest[i].dist_sq = (i % 7) ? FLT_MAX : 0.0001f;
+  }
+
+  BLI_bvhtree_find_nearest_batch(tree, co, queries_len, nearest, NULL, NULL, flag);
+
+  for (int i = 0; i < queries_len; i++) {
+    BVHTreeNearest nearest_single;
+    nearest_single.index = -1;
+    nearest_single.dist_sq = (i % 7) ? FLT_MAX : 0.0001f;
+    BLI_bvhtree_find_nearest(tree, co[i], &nearest_single, NULL, NULL);
+    EXPECT_EQ(nearest[i].index, nearest_single.index);
+    EXPECT_EQ(nearest[i].dist_sq, nearest_single.dist_sq);
+  }
+
+  BLI_bvhtree_free(tree);
+  BLI_rng_free(rng);
+  MEM_freeN(points);
+  MEM_freeN(co);
+  MEM_freeN(nearest);
+}
+
+TEST(kdopbvh, FindNearestBatch)
+{
+  find_nearest_batch_test(10000, 5000, 1234, 0);
+}
+TEST(kdopbvh, FindNearestBatch_UsePrevious)
+{
+  find_nearest_batch_test(10000, 5000, 1234, BVH_NEAREST_USE_PREVIOUS);
+}
+
+static void ray_cast_batch_test(int points_len, int rays_len, int random_seed, float radius)
+{
+  struct RNG *rng = BLI_rng_new(random_seed);
+  float(*points)[3] = (float(*)[3])MEM_mallocN(sizeof(float[3]) * points_len, __func__);
+  BVHTree *tree = random_points_tree(points, points_len, rng);
+
+  BVHTreeRay *rays = (BVHTreeRay *)MEM_mallocN(sizeof(*rays) * rays_len, __func__);
+  BVHTreeRayHit *hits = (BVHTreeRayHit *)MEM_mallocN(sizeof(*hits) * rays_len, __func__);
+  for (int i = 0; i < rays_len; i++) {
+    /* Rays from a point outside, fanning out over the points (with some axis aligned ones). */
+    const float fac = (float)i / (float)rays_len;
+    const float target[3] = {fac - 0.5f, (float)(i % 37) / 37.0f - 0.5f, 0.0f};
+    copy_v3_fl3(rays[i].origin, -0.5f, -0.5f, 2.0f);
+    if (i % 11) {
+      sub_v3_v3v3(rays[i].direction, target, rays[i].origin);
+      normalize_v3(rays[i].direction);
+    }
+    else {
+      copy_v3_v3(rays[i].origin, target);
+      rays[i].origin[2] = 2.0f;
+      copy_v3_fl3(rays[i].direction, 0.0f, 0.0f, -1.0f);
+    }
+    rays[i].radius = radius;
+    hits[i].index = -1;
+    hits[i].dist = (i % 5) ? BVH_RAYCAST_DIST_MAX : 2.0f;
+  }
+
+  BLI_bvhtree_ray_cast_batch(tree, rays, rays_len, hits, NULL, NULL, BVH_RAYCAST_DEFAULT);
+
+  int hits_num = 0;
+  for (int i = 0; i < rays_len; i++) {
+    BVHTreeRayHit hit_single;
+    hit_single.index = -1;
+    hit_single.dist = (i % 5) ? BVH_RAYCAST_DIST_MAX : 2.0f;
+    BLI_bvhtree_ray_cast(
+        tree, rays[i].origin, rays[i].direction, radius, &hit_single, NULL, NULL);
+    EXPECT_EQ(hits[i].dist, hit_single.dist);
+    EXPECT_EQ(hits[i].index != -1, hit_single.index != -1);
+    hits_num += (hit_single.index != -1);
+  }
+  EXPECT_GT(hits_num, 0);
+
+  BLI_bvhtree_free(tree);
+  BLI_rng_free(rng);
+  MEM_freeN(points);
+  MEM_freeN(rays);
+  MEM_freeN(hits);
+}
+
+TEST(kdopbvh, RayCastBatch)
+{
+  ray_cast_batch_test(10000, 5003, 1234, 0.0f);
+}
+TEST(kdopbvh, RayCastBatch_Radius)
+{
+  ray_cast_batch_test(10000, 5003, 1234, 0.01f);
+}
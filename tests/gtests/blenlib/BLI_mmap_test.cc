@@ -0,0 +1,77 @@
+/* Apache License, Version 2.0 */
+
+#include "testing/testing.h"
+
+extern "C" {
+#include "BLI_fileops.h"
+#include "BLI_mmap.h"
+}
+
+#ifndef WIN32
+#  include <fcntl.h>
+#  include <unistd.h>
+
+#  define MMAP_TEST_PAGES 4
+
+static int mmap_test_file_create(const char *filepath, const size_t length)
+{
+  int file = BLI_open(filepath, O_BINARY | O_RDWR | O_CREAT | O_TRUNC, 0666);
+  if (file == -1) {
+    return -1;
+  }
+  char *data = (char *)malloc(length);
+  for (size_t i = 0; i < length; i++) {
+    data[i] = (char)(i % 251);
+  }
+  EXPECT_EQ(write(file, data, length), (ssize_t)length);
+  free(data);
+  return file;
+}
+
+TEST(mmap, Read)
+{
+  const char *filepath = "/tmp/blender_mmap_test_read";
+  const size_t length = (size_t)sysconf(_SC_PAGESIZE) * MMAP_TEST_PAGES;
+  int file = mmap_test_file_create(filepath, length);
+  ASSERT_NE(file, -1);
+
+  BLI_mmap_file *mmap_file = BLI_mmap_open(file);
+  ASSERT_NE(mmap_file, (BLI_mmap_file *)NULL);
+  EXPECT_EQ(BLI_mmap_get_length(mmap_file), length);
+
+  char buffer[16];
+  EXPECT_TRUE(BLI_mmap_read(mmap_file, buffer, 1000, sizeof(buffer)));
+  EXPECT_EQ(buffer[0], (char)(1000 % 251));
+  EXPECT_FALSE(BLI_mmap_read(mmap_file, buffer, length - 1, sizeof(buffer)));
+  EXPECT_FALSE(BLI_mmap_any_io_error(mmap_file));
+
+  BLI_mmap_free(mmap_file);
+  close(file);
+  BLI_delete(filepath, false, false);
+}
+
+/* Accessing pages of a mapped file beyond its end after it got truncated raises SIGBUS, which
+ * must turn into a read error instead of a crash. */
+TEST(mmap, Truncated)
+{
+  const char *filepath = "/tmp/blender_mmap_test_truncated";
+  const size_t page_size = (size_t)sysconf(_SC_PAGESIZE);
+  const size_t length = page_size * MMAP_TEST_PAGES;
+  int file = mmap_test_file_create(filepath, length);
+  ASSERT_NE(file, -1);
+
+  BLI_mmap_file *mmap_file = BLI_mmap_open(file);
+  ASSERT_NE(mmap_file, (BLI_mmap_file *)NULL);
+  ASSERT_EQ(ftruncate(file, (off_t)page_size), 0);
+
+  char buffer[16];
+  EXPECT_FALSE(BLI_mmap_read(mmap_file, buffer, length - page_size, sizeof(buffer)));
+  EXPECT_TRUE(BLI_mmap_any_io_error(mmap_file));
+  /* Once an error happened, the whole file is considered invalid. */
+  EXPECT_FALSE(BLI_mmap_read(mmap_file, buffer, 0, sizeof(buffer)));
+
+  BLI_mmap_free(mmap_file);
+  close(file);
+  BLI_delete(filepath, false, false);
+}
+#endif
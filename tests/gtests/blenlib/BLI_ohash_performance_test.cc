@@ -0,0 +1,294 @@
+/* Apache License, Version 2.0 */
+
+#include "testing/testing.h"
+#include "BLI_ressource_strings.h"
+
+#include "MEM_guardedalloc.h"
+
+extern "C" {
+#include "BLI_utildefines.h"
+#include "BLI_ghash.h"
+#include "BLI_ohash.h"
+#include "BLI_rand.h"
+#include "BLI_string.h"
+#include "PIL_time_utildefines.h"
+}
+
+/* Compare OHash against GHash on identical workloads,
+ * timing insertion, lookup, iteration and removal. */
+
+/* Run the longest tests! */
+//#define OHASH_RUN_BIG
+
+#define PRINTF_OHASH_STATS(_oh) \
+  { \
+    int probe_max; \
+    const double probe_avg = BLI_ohash_calc_probe_length((_oh), &probe_max); \
+    printf("OHash stats (%u entries):\n\tAverage probe: %f\n\tLongest probe: %d\n", \
+           BLI_ohash_len(_oh), \
+           probe_avg, \
+           probe_max); \
+  } \
+  void(0)
+
+enum {
+  KEYS_SEQUENTIAL = 0,
+  KEYS_RANDOM = 1,
+  /* Addresses of separately allocated blocks, the most common use of GHash in Blender. */
+  KEYS_POINTER = 2,
+};
+
+/* All keys are even, so `key + 1` can be used to test lookups of missing keys. */
+static void **keys_create(const int keys_type, const unsigned int nbr)
+{
+  void **keys = (void **)MEM_mallocN(sizeof(*keys) * (size_t)nbr, __func__);
+  switch (keys_type) {
+    case KEYS_SEQUENTIAL:
+      for (unsigned int i = 0; i < nbr; i++) {
+        keys[i] = POINTER_FROM_UINT(i * 2);
+      }
+      break;
+    case KEYS_RANDOM: {
+      /* Unique keys (an odd multiplier is a bijection on 31bit integers). */
+      RNG *rng = BLI_rng_new(0);
+      const unsigned int offset = BLI_rng_get_uint(rng);
+      for (unsigned int i = 0; i < nbr; i++) {
+        keys[i] = POINTER_FROM_UINT((((i + offset) * 2654435761u) & 0x7fffffff) << 1);
+      }
+      BLI_rng_free(rng);
+      break;
+    }
+    case KEYS_POINTER:
+      for (unsigned int i = 0; i < nbr; i++) {
+        keys[i] = MEM_mallocN(16, __func__);
+      }
+      break;
+  }
+  return keys;
+}
+
+static void keys_free(const int keys_type, void **keys, const unsigned int nbr)
+{
+  if (keys_type == KEYS_POINTER) {
+    for (unsigned int i = 0; i < nbr; i++) {
+      MEM_freeN(keys[i]);
+    }
+  }
+  MEM_freeN(keys);
+}
+
+static void **keys_shuffled(void **keys, const unsigned int nbr)
+{
+  void **keys_lookup = (void **)MEM_dupallocN(keys);
+  RNG *rng = BLI_rng_new(1);
+  BLI_rng_shuffle_array(rng, keys_lookup, sizeof(*keys_lookup), nbr);
+  BLI_rng_free(rng);
+  return keys_lookup;
+}
+
+static void ghash_run(GHash *ghash, void **keys, void **keys_lookup, const unsigned int nbr)
+{
+  {
+    TIMEIT_START(ghash_insert);
+    for (unsigned int i = 0; i < nbr; i++) {
+      BLI_ghash_insert(ghash, keys[i], POINTER_FROM_UINT(i));
+    }
+    TIMEIT_END(ghash_insert);
+  }
+  {
+    TIMEIT_START(ghash_lookup);
+    for (unsigned int i = 0; i < nbr; i++) {
+      EXPECT_TRUE(BLI_ghash_lookup_p(ghash, keys_lookup[i]) != NULL);
+    }
+    TIMEIT_END(ghash_lookup);
+  }
+  {
+    TIMEIT_START(ghash_lookup_miss);
+    for (unsigned int i = 0; i < nbr; i++) {
+      EXPECT_FALSE(BLI_ghash_haskey(ghash, (char *)keys_lookup[i] + 1));
+    }
+    TIMEIT_END(ghash_lookup_miss);
+  }
+  {
+    GHashIterator gh_iter;
+    uint64_t sum = 0;
+    TIMEIT_START(ghash_iter);
+    GHASH_ITER (gh_iter, ghash) {
+      sum += POINTER_AS_UINT(BLI_ghashIterator_getValue(&gh_iter));
+    }
+    TIMEIT_END(ghash_iter);
+    EXPECT_EQ(sum, (uint64_t)nbr * (nbr - 1) / 2);
+  }
+  {
+    TIMEIT_START(ghash_remove);
+    for (unsigned int i = 0; i < nbr; i++) {
+      EXPECT_TRUE(BLI_ghash_remove(ghash, keys_lookup[i], NULL, NULL));
+    }
+    TIMEIT_END(ghash_remove);
+  }
+  EXPECT_EQ(BLI_ghash_len(ghash), 0);
+}
+
+static void ohash_run(OHash *ohash, void **keys, void **keys_lookup, const unsigned int nbr)
+{
+  {
+    TIMEIT_START(ohash_insert);
+    for (unsigned int i = 0; i < nbr; i++) {
+      BLI_ohash_insert(ohash, keys[i], POINTER_FROM_UINT(i));
+    }
+    TIMEIT_END(ohash_insert);
+  }
+
+  PRINTF_OHASH_STATS(ohash);
+
+  {
+    TIMEIT_START(ohash_lookup);
+    for (unsigned int i = 0; i < nbr; i++) {
+      EXPECT_TRUE(BLI_ohash_lookup_p(ohash, keys_lookup[i]) != NULL);
+    }
+    TIMEIT_END(ohash_lookup);
+  }
+  {
+    TIMEIT_START(ohash_lookup_miss);
+    for (unsigned int i = 0; i < nbr; i++) {
+      EXPECT_FALSE(BLI_ohash_haskey(ohash, (char *)keys_lookup[i] + 1));
+    }
+    TIMEIT_END(ohash_lookup_miss);
+  }
+  {
+    OHashIterator oh_iter;
+    uint64_t sum = 0;
+    TIMEIT_START(ohash_iter);
+    OHASH_ITER (oh_iter, ohash) {
+      sum += POINTER_AS_UINT(BLI_ohashIterator_getValue(&oh_iter));
+    }
+    TIMEIT_END(ohash_iter);
+    EXPECT_EQ(sum, (uint64_t)nbr * (nbr - 1) / 2);
+  }
+  {
+    TIMEIT_START(ohash_remove);
+    for (unsigned int i = 0; i < nbr; i++) {
+      EXPECT_TRUE(BLI_ohash_remove(ohash, keys_lookup[i], NULL, NULL));
+    }
+    TIMEIT_END(ohash_remove);
+  }
+  EXPECT_EQ(BLI_ohash_len(ohash), 0);
+}
+
+static void compare_tests(const char *id, const int keys_type, const unsigned int nbr)
+{
+  printf("\n========== STARTING %s ==========\n", id);
+
+  void **keys = keys_create(keys_type, nbr);
+  void **keys_lookup = keys_shuffled(keys, nbr);
+
+  GHash *ghash = BLI_ghash_ptr_new(__func__);
+  ghash_run(ghash, keys, keys_lookup, nbr);
+  BLI_ghash_free(ghash, NULL, NULL);
+
+  OHash *ohash = BLI_ohash_ptr_new(__func__);
+  ohash_run(ohash, keys, keys_lookup, nbr);
+  BLI_ohash_free(ohash, NULL, NULL);
+
+  MEM_freeN(keys_lookup);
+  keys_free(keys_type, keys, nbr);
+
+  printf("========== ENDED %s ==========\n\n", id);
+}
+
+TEST(ohash, IntSequential1000000)
+{
+  compare_tests("IntSequential - 1000000", KEYS_SEQUENTIAL, 1000000);
+}
+
+TEST(ohash, IntRandom1000000)
+{
+  compare_tests("IntRandom - 1000000", KEYS_RANDOM, 1000000);
+}
+
+TEST(ohash, Pointer1000000)
+{
+  compare_tests("Pointer - 1000000", KEYS_POINTER, 1000000);
+}
+
+#ifdef OHASH_RUN_BIG
+TEST(ohash, IntSequential20000000)
+{
+  compare_tests("IntSequential - 20000000", KEYS_SEQUENTIAL, 20000000);
+}
+
+TEST(ohash, IntRandom20000000)
+{
+  compare_tests("IntRandom - 20000000", KEYS_RANDOM, 20000000);
+}
+
+TEST(ohash, Pointer10000000)
+{
+  compare_tests("Pointer - 10000000", KEYS_POINTER, 10000000);
+}
+#endif
+
+/* Str: words from a text, keys are compared with #BLI_ghashutil_strcmp. */
+
+TEST(ohash, TextWords)
+{
+  printf("\n========== STARTING TextWords ==========\n");
+
+  char *data = BLI_strdup(words10k);
+  char *data_end = data + strlen(data);
+  unsigned int words_len = 0;
+  for (char *c = data; *c; c++) {
+    if (ELEM(*c, ' ', '.')) {
+      *c = '\0';
+      words_len++;
+    }
+  }
+
+  GHash *ghash = BLI_ghash_str_new(__func__);
+  OHash *ohash = BLI_ohash_str_new(__func__);
+
+  {
+    TIMEIT_START(ghash_string_insert);
+    for (char *w = data; w < data_end; w += strlen(w) + 1) {
+      void **val;
+      if (!BLI_ghash_ensure_p(ghash, w, &val)) {
+        *val = w;
+      }
+    }
+    TIMEIT_END(ghash_string_insert);
+  }
+  {
+    TIMEIT_START(ohash_string_insert);
+    for (char *w = data; w < data_end; w += strlen(w) + 1) {
+      void **val;
+      if (!BLI_ohash_ensure_p(ohash, w, &val)) {
+        *val = w;
+      }
+    }
+    TIMEIT_END(ohash_string_insert);
+  }
+
+  EXPECT_EQ(BLI_ghash_len(ghash), BLI_ohash_len(ohash));
+  PRINTF_OHASH_STATS(ohash);
+
+  {
+    TIMEIT_START(ghash_string_lookup);
+    for (char *w = data; w < data_end; w += strlen(w) + 1) {
+      EXPECT_TRUE(BLI_ghash_haskey(ghash, w));
+    }
+    TIMEIT_END(ghash_string_lookup);
+  }
+  {
+    TIMEIT_START(ohash_string_lookup);
+    for (char *w = data; w < data_end; w += strlen(w) + 1) {
+      EXPECT_TRUE(BLI_ohash_haskey(ohash, w));
+    }
+    TIMEIT_END(ohash_string_lookup);
+  }
+
+  BLI_ghash_free(ghash, NULL, NULL);
+  BLI_ohash_free(ohash, NULL, NULL);
+  MEM_freeN(data);
+
+  printf("========== ENDED TextWords (%u words) ==========\n\n", words_len);
+}
@@ -0,0 +1,245 @@
+/* Apache License, Version 2.0 */
+
+#include "testing/testing.h"
+
+extern "C" {
+#include "BLI_utildefines.h"
+#include "BLI_ohash.h"
+#include "BLI_rand.h"
+}
+
+#define TESTCASE_SIZE 10000
+
+/* Unique pseudo-random keys: multiplying by an odd number is a bijection on 32bit integers. */
+static void init_keys(unsigned int keys[TESTCASE_SIZE], const unsigned int seed)
+{
+  for (unsigned int i = 0; i < TESTCASE_SIZE; i++) {
+    keys[i] = (i + seed * TESTCASE_SIZE) * 2654435761u;
+  }
+}
+
+/* Force every key into the same probe sequence. */
+static unsigned int ohashutil_tests_constant_hash_p(const void *UNUSED(p))
+{
+  return 42;
+}
+
+TEST(ohash, InsertLookup)
+{
+  OHash *ohash = BLI_ohash_int_new(__func__);
+  unsigned int keys[TESTCASE_SIZE];
+
+  init_keys(keys, 0);
+
+  for (int i = 0; i < TESTCASE_SIZE; i++) {
+    BLI_ohash_insert(ohash, POINTER_FROM_UINT(keys[i]), POINTER_FROM_UINT(keys[i]));
+  }
+
+  EXPECT_EQ(BLI_ohash_len(ohash), TESTCASE_SIZE);
+
+  for (int i = 0; i < TESTCASE_SIZE; i++) {
+    void *v = BLI_ohash_lookup(ohash, POINTER_FROM_UINT(keys[i]));
+    EXPECT_EQ(POINTER_AS_UINT(v), keys[i]);
+  }
+  EXPECT_FALSE(BLI_ohash_haskey(ohash, POINTER_FROM_UINT(1)));
+  EXPECT_EQ(BLI_ohash_lookup_p(ohash, POINTER_FROM_UINT(1)), (void **)NULL);
+  EXPECT_EQ(BLI_ohash_lookup_default(ohash, POINTER_FROM_UINT(1), POINTER_FROM_INT(-1)),
+            POINTER_FROM_INT(-1));
+
+  int probe_max;
+  const double probe_avg = BLI_ohash_calc_probe_length(ohash, &probe_max);
+  EXPECT_GE(probe_avg, 1.0);
+  EXPECT_LT(probe_avg, 2.0);
+
+  BLI_ohash_free(ohash, NULL, NULL);
+}
+
+/* Remove every other key, checking the remaining ones are still found after each removal
+ * (removal moves both slots and entries around). */
+TEST(ohash, InsertRemove)
+{
+  OHash *ohash = BLI_ohash_int_new(__func__);
+  unsigned int keys[TESTCASE_SIZE];
+
+  init_keys(keys, 1);
+
+  for (int i = 0; i < TESTCASE_SIZE; i++) {
+    BLI_ohash_insert(ohash, POINTER_FROM_UINT(keys[i]), POINTER_FROM_UINT(keys[i]));
+  }
+
+  for (int i = 0; i < TESTCASE_SIZE; i += 2) {
+    void *v = BLI_ohash_popkey(ohash, POINTER_FROM_UINT(keys[i]), NULL);
+    EXPECT_EQ(POINTER_AS_UINT(v), keys[i]);
+    EXPECT_FALSE(BLI_ohash_remove(ohash, POINTER_FROM_UINT(keys[i]), NULL, NULL));
+  }
+
+  EXPECT_EQ(BLI_ohash_len(ohash), TESTCASE_SIZE / 2);
+
+  for (int i = 0; i < TESTCASE_SIZE; i++) {
+    void **v_p = BLI_ohash_lookup_p(ohash, POINTER_FROM_UINT(keys[i]));
+    if (i % 2) {
+      ASSERT_NE(v_p, (void **)NULL);
+      EXPECT_EQ(POINTER_AS_UINT(*v_p), keys[i]);
+    }
+    else {
+      EXPECT_EQ(v_p, (void **)NULL);
+    }
+  }
+
+  for (int i = 1; i < TESTCASE_SIZE; i += 2) {
+    EXPECT_TRUE(BLI_ohash_remove(ohash, POINTER_FROM_UINT(keys[i]), NULL, NULL));
+  }
+  EXPECT_EQ(BLI_ohash_len(ohash), 0);
+
+  BLI_ohash_free(ohash, NULL, NULL);
+}
+
+/* Same as above with all keys colliding. */
+TEST(ohash, InsertRemoveCollide)
+{
+  OHash *ohash = BLI_ohash_new(ohashutil_tests_constant_hash_p, BLI_ghashutil_intcmp, __func__);
+  const unsigned int keys_len = 500;
+
+  for (unsigned int i = 0; i < keys_len; i++) {
+    BLI_ohash_insert(ohash, POINTER_FROM_UINT(i), POINTER_FROM_UINT(i));
+  }
+  for (unsigned int i = 0; i < keys_len; i += 3) {
+    EXPECT_TRUE(BLI_ohash_remove(ohash, POINTER_FROM_UINT(i), NULL, NULL));
+  }
+  for (unsigned int i = 0; i < keys_len; i++) {
+    EXPECT_EQ(BLI_ohash_haskey(ohash, POINTER_FROM_UINT(i)), (i % 3) != 0);
+  }
+
+  BLI_ohash_free(ohash, NULL, NULL);
+}
+
+TEST(ohash, EnsureReinsert)
+{
+  OHash *ohash = BLI_ohash_int_new_ex(__func__, 4);
+  void **val_p;
+
+  for (int i = 0; i < 100; i++) {
+    EXPECT_FALSE(BLI_ohash_ensure_p(ohash, POINTER_FROM_INT(i), &val_p));
+    *val_p = POINTER_FROM_INT(i * 2);
+  }
+  for (int i = 0; i < 100; i++) {
+    EXPECT_TRUE(BLI_ohash_ensure_p(ohash, POINTER_FROM_INT(i), &val_p));
+    EXPECT_EQ(POINTER_AS_INT(*val_p), i * 2);
+  }
+
+  EXPECT_FALSE(BLI_ohash_reinsert(ohash, POINTER_FROM_INT(5), POINTER_FROM_INT(-5), NULL, NULL));
+  EXPECT_TRUE(
+      BLI_ohash_reinsert(ohash, POINTER_FROM_INT(500), POINTER_FROM_INT(-500), NULL, NULL));
+  EXPECT_EQ(POINTER_AS_INT(BLI_ohash_lookup(ohash, POINTER_FROM_INT(5))), -5);
+  EXPECT_EQ(POINTER_AS_INT(BLI_ohash_lookup(ohash, POINTER_FROM_INT(500))), -500);
+  EXPECT_EQ(BLI_ohash_len(ohash), 101);
+
+  BLI_ohash_free(ohash, NULL, NULL);
+}
+
+TEST(ohash, Iterator)
+{
+  OHash *ohash = BLI_ohash_int_new(__func__);
+  unsigned int keys[TESTCASE_SIZE];
+  OHashIterator ohi;
+  unsigned int i;
+
+  init_keys(keys, 2);
+
+  for (i = 0; i < TESTCASE_SIZE; i++) {
+    BLI_ohash_insert(ohash, POINTER_FROM_UINT(keys[i]), POINTER_FROM_UINT(i));
+  }
+
+  /* Without removal, iteration follows insertion order. */
+  OHASH_ITER_INDEX (ohi, ohash, i) {
+    EXPECT_EQ(POINTER_AS_UINT(BLI_ohashIterator_getKey(&ohi)), keys[i]);
+    EXPECT_EQ(POINTER_AS_UINT(BLI_ohashIterator_getValue(&ohi)), i);
+  }
+  EXPECT_EQ(i, TESTCASE_SIZE);
+
+  BLI_ohash_free(ohash, NULL, NULL);
+}
+
+TEST(ohash, Pop)
+{
+  OHash *ohash = BLI_ohash_int_new(__func__);
+  unsigned int keys[TESTCASE_SIZE];
+  int i;
+
+  init_keys(keys, 3);
+
+  for (i = 0; i < TESTCASE_SIZE; i++) {
+    BLI_ohash_insert(ohash, POINTER_FROM_UINT(keys[i]), POINTER_FROM_UINT(keys[i]));
+  }
+
+  OHashIterState pop_state = {0};
+
+  for (i = TESTCASE_SIZE / 2; i--;) {
+    void *k, *v;
+    bool success = BLI_ohash_pop(ohash, &pop_state, &k, &v);
+    EXPECT_EQ(k, v);
+    EXPECT_TRUE(success);
+
+    if (i % 2) {
+      BLI_ohash_insert(ohash, POINTER_FROM_UINT(i * 4), POINTER_FROM_UINT(i * 4));
+    }
+  }
+
+  EXPECT_EQ(BLI_ohash_len(ohash), (TESTCASE_SIZE - TESTCASE_SIZE / 2 + TESTCASE_SIZE / 4));
+
+  {
+    void *k, *v;
+    while (BLI_ohash_pop(ohash, &pop_state, &k, &v)) {
+      EXPECT_EQ(k, v);
+    }
+  }
+  EXPECT_EQ(BLI_ohash_len(ohash), 0);
+
+  BLI_ohash_free(ohash, NULL, NULL);
+}
+
+TEST(ohash, Clear)
+{
+  OHash *ohash = BLI_ohash_int_new(__func__);
+
+  for (int pass = 0; pass < 3; pass++) {
+    for (int i = 0; i < 1000; i++) {
+      BLI_ohash_insert(ohash, POINTER_FROM_INT(i + pass), POINTER_FROM_INT(i));
+    }
+    EXPECT_EQ(BLI_ohash_len(ohash), 1000);
+    EXPECT_TRUE(BLI_ohash_haskey(ohash, POINTER_FROM_INT(pass)));
+    BLI_ohash_clear_ex(ohash, NULL, NULL, 1000);
+    EXPECT_EQ(BLI_ohash_len(ohash), 0);
+    EXPECT_FALSE(BLI_ohash_haskey(ohash, POINTER_FROM_INT(pass)));
+  }
+
+  BLI_ohash_free(ohash, NULL, NULL);
+}
+
+TEST(oset, AddRemove)
+{
+  OSet *oset = BLI_oset_str_new(__func__);
+  const char *words[] = {"one", "two", "three", "four"};
+  char one[] = "one";
+
+  for (int i = 0; i < ARRAY_SIZE(words); i++) {
+    EXPECT_TRUE(BLI_oset_add(oset, (void *)words[i]));
+  }
+  EXPECT_FALSE(BLI_oset_add(oset, one));
+  EXPECT_EQ(BLI_oset_len(oset), ARRAY_SIZE(words));
+
+  /* Lookup returns the stored key, not the one passed in. */
+  EXPECT_EQ(BLI_oset_lookup(oset, one), (void *)words[0]);
+  EXPECT_EQ(BLI_oset_pop_key(oset, one), (void *)words[0]);
+  EXPECT_FALSE(BLI_oset_haskey(oset, one));
+
+  OSetIterator osi;
+  int len = 0;
+  OSET_ITER (osi, oset) {
+    EXPECT_TRUE(BLI_oset_haskey(oset, BLI_osetIterator_getKey(&osi)));
+    len++;
+  }
+  EXPECT_EQ(len, ARRAY_SIZE(words) - 1);
+
+  BLI_oset_free(oset, NULL);
+}
@@ -137,6 +137,99 @@ TEST(task, RangeIterPool)
   BLI_threadapi_exit();
 }
 
+/* *** Nested parallel ranges and pools. *** */
+
+#define NUM_NESTED_TASKS 16
+
+static void task_nested_range_iter_func(void *userdata,
+                                        int index,
+                                        const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  int *data = (int *)userdata;
+  atomic_add_and_fetch_int32(&data[index], 1);
+}
+
+static void task_nested_range_pool_func(TaskPool *__restrict pool,
+                                        void *taskdata,
+                                        int UNUSED(threadid))
+{
+  int *data = (int *)BLI_task_pool_userdata(pool) + POINTER_AS_INT(taskdata) * NUM_ITEMS;
+
+  TaskParallelSettings settings;
+  BLI_parallel_range_settings_defaults(&settings);
+  settings.min_iter_per_thread = 1;
+
+  BLI_task_parallel_range(0, NUM_ITEMS, data, task_nested_range_iter_func, &settings);
+}
+
+TEST(task, NestedRangeIter)
+{
+  int *data = (int *)MEM_calloc_arrayN(NUM_NESTED_TASKS * NUM_ITEMS, sizeof(int), __func__);
+
+  BLI_threadapi_init();
+  /* Make sure there are worker threads to steal work even on single core machines. */
+  BLI_system_num_threads_override_set(4);
+
+  TaskPool *pool = BLI_task_pool_create(BLI_task_scheduler_get(), data);
+  for (int i = 0; i < NUM_NESTED_TASKS; i++) {
+    BLI_task_pool_push(
+        pool, task_nested_range_pool_func, POINTER_FROM_INT(i), false, TASK_PRIORITY_LOW);
+  }
+  BLI_task_pool_work_and_wait(pool);
+  BLI_task_pool_free(pool);
+
+  /* Every item of every nested range must be processed once, and only once. */
+  for (int i = 0; i < NUM_NESTED_TASKS * NUM_ITEMS; i++) {
+    EXPECT_EQ(data[i], 1);
+  }
+
+  MEM_freeN(data);
+  BLI_threadapi_exit();
+  BLI_system_num_threads_override_set(0);
+}
+
+static void task_spawn_pool_func(TaskPool *__restrict pool, void *taskdata, int threadid)
+{
+  int *count = (int *)BLI_task_pool_userdata(pool);
+  const int depth = POINTER_AS_INT(taskdata);
+
+  atomic_add_and_fetch_int32(count, 1);
+
+  /* Every task spawns two children into the same pool, from the worker thread's own queue. */
+  if (depth > 0) {
+    BLI_task_pool_delayed_push_begin(pool, threadid);
+    for (int i = 0; i < 2; i++) {
+      BLI_task_pool_push_from_thread(pool,
+                                     task_spawn_pool_func,
+                                     POINTER_FROM_INT(depth - 1),
+                                     false,
+                                     TASK_PRIORITY_HIGH,
+                                     threadid);
+    }
+    BLI_task_pool_delayed_push_end(pool, threadid);
+  }
+}
+
+TEST(task, PoolSpawnFromThread)
+{
+  const int depth = 10;
+  int count = 0;
+
+  BLI_threadapi_init();
+  BLI_system_num_threads_override_set(4);
+
+  TaskPool *pool = BLI_task_pool_create(BLI_task_scheduler_get(), &count);
+  BLI_task_pool_push(pool, task_spawn_pool_func, POINTER_FROM_INT(depth), false, TASK_PRIORITY_HIGH);
+  BLI_task_pool_work_and_wait(pool);
+  BLI_task_pool_free(pool);
+
+  /* Full binary tree of tasks. */
+  EXPECT_EQ(count, (1 << (depth + 1)) - 1);
+
+  BLI_threadapi_exit();
+  BLI_system_num_threads_override_set(0);
+}
+
 /* *** Parallel iterations over mempool items. *** */
 
 static void task_mempool_iter_func(void *userdata, MempoolIterData *item)
@@ -206,6 +299,86 @@ TEST(task, MempoolIter)
   BLI_threadapi_exit();
 }
 
+/* *** Parallel allocations from a threaded mempool. *** */
+
+typedef struct MempoolAllocData {
+  BLI_mempool *mempool;
+  int **data;
+} MempoolAllocData;
+
+static void task_mempool_alloc_func(void *__restrict userdata,
+                                    const int index,
+                                    const TaskParallelTLS *__restrict tls)
+{
+  MempoolAllocData *alloc_data = (MempoolAllocData *)userdata;
+  int *item = (int *)BLI_mempool_alloc_threaded(alloc_data->mempool, tls->thread_id);
+  *item = index;
+  alloc_data->data[index] = item;
+}
+
+static void task_mempool_free_func(void *__restrict userdata,
+                                   const int index,
+                                   const TaskParallelTLS *__restrict tls)
+{
+  MempoolAllocData *alloc_data = (MempoolAllocData *)userdata;
+  /* Free in reverse order, so items are likely freed by another thread than the allocating one.
+   */
+  const int index_free = NUM_ITEMS - 1 - index;
+  if (index_free % 3 == 0) {
+    BLI_mempool_free_threaded(alloc_data->mempool, alloc_data->data[index_free], tls->thread_id);
+    alloc_data->data[index_free] = NULL;
+  }
+}
+
+TEST(task, MempoolAllocThreaded)
+{
+  int *data[NUM_ITEMS];
+  BLI_threadapi_init();
+  BLI_mempool *mempool = BLI_mempool_create(
+      sizeof(*data[0]), 0, 32, BLI_MEMPOOL_ALLOW_ITER | BLI_MEMPOOL_ALLOW_THREADED);
+
+  MempoolAllocData alloc_data = {mempool, data};
+
+  TaskParallelSettings settings;
+  BLI_parallel_range_settings_defaults(&settings);
+  settings.min_iter_per_thread = 1;
+
+  BLI_task_parallel_range(0, NUM_ITEMS, &alloc_data, task_mempool_alloc_func, &settings);
+  EXPECT_EQ(BLI_mempool_len(mempool), NUM_ITEMS);
+
+  BLI_task_parallel_range(0, NUM_ITEMS, &alloc_data, task_mempool_free_func, &settings);
+
+  int num_items = 0;
+  for (int i = 0; i < NUM_ITEMS; i++) {
+    if (data[i] != NULL) {
+      EXPECT_EQ(*data[i], i);
+      num_items++;
+    }
+  }
+  EXPECT_EQ(BLI_mempool_len(mempool), num_items);
+
+  /* Re-use freed items from the main thread. */
+  for (int i = 0; i < NUM_ITEMS; i += 3) {
+    data[i] = (int *)BLI_mempool_alloc(mempool);
+    *data[i] = i;
+    num_items++;
+  }
+  EXPECT_EQ(num_items, NUM_ITEMS);
+
+  /* Iteration sees every allocated item exactly once. */
+  for (int i = 0; i < NUM_ITEMS; i++) {
+    *data[i] = -1;
+  }
+  BLI_task_parallel_mempool(mempool, &num_items, task_mempool_iter_func, true);
+  EXPECT_EQ(num_items, 0);
+  for (int i = 0; i < NUM_ITEMS; i++) {
+    EXPECT_EQ(*data[i], 0);
+  }
+
+  BLI_mempool_destroy(mempool);
+  BLI_threadapi_exit();
+}
+
 /* *** Parallel iterations over double-linked list items. *** */
 
 static void task_listbase_iter_func(void *userdata,
@@ -0,0 +1,148 @@
+/* Apache License, Version 2.0 */
+
+#include "testing/testing.h"
+
+#include "mesh_test_util.h"
+
+#include "MEM_guardedalloc.h"
+
+extern "C" {
+#include "BLI_utildefines.h"
+#include "BLI_math.h"
+#include "BLI_threads.h"
+#include "BKE_lib_id.h"
+#include "BKE_mesh.h"
+#include "DNA_mesh_types.h"
+#include "DNA_meshdata_types.h"
+#include "DNA_object_types.h"
+#include "DNA_scene_types.h"
+#include "GPU_batch.h"
+#include "PIL_time_utildefines.h"
+#include "draw_cache_impl.h"
+}
+
+/* Time the CPU side of the mesh draw cache: extraction of the vertex and index buffers used in
+ * object mode, on grids of quads and triangles. No GPU context is needed as nothing is uploaded.
+ *
+ * Compares a full rebuild of the cache with the update done after a deformation, which only
+ * extracts the coordinate dependent buffers again. Triangles are extracted again too, unless
+ * the mesh only has triangles. */
+
+/* Run the longest tests! */
+//#define MESH_EXTRACT_RUN_BIG
+
+#define MESH_EXTRACT_TIMEIT_REPEAT 5
+
+static void test_mesh_deform(Mesh *me, const float time)
+{
+  for (int i = 0; i < me->totvert; i++) {
+    float *co = me->mvert[i].co;
+    co[2] = sinf(co[0] * 10.0f + time) * cosf(co[1] * 7.0f + time) * 0.1f;
+  }
+  BKE_mesh_calc_normals(me);
+}
+
+/* Request the batches drawn by the workbench and overlay engines, and extract their buffers. */
+static GPUBatch *test_mesh_batches_extract(const Scene *scene, Object *ob, Mesh *me)
+{
+  bool is_manifold;
+  DRW_mesh_batch_cache_validate(me);
+  GPUBatch *surface = DRW_mesh_batch_cache_get_surface(me);
+  DRW_mesh_batch_cache_get_all_verts(me);
+  DRW_mesh_batch_cache_get_all_edges(me);
+  DRW_mesh_batch_cache_get_loose_edges(me);
+  DRW_mesh_batch_cache_get_wireframes_face(me);
+  DRW_mesh_batch_cache_get_edge_detection(me, &is_manifold);
+  DRW_mesh_batch_cache_create_requested(ob, me, scene, false, false);
+  return surface;
+}
+
+static void mesh_extract_run(const char *id, const int size, const int poly_type)
+{
+  printf("\n========== STARTING %s ==========\n", id);
+
+  BLI_threadapi_init();
+
+  Mesh *me = test_mesh_grid_create(size, poly_type);
+  printf("%d verts, %d edges, %d polys\n", me->totvert, me->totedge, me->totpoly);
+
+  /* Only the render settings of the scene are read. */
+  Scene scene;
+  memset(&scene, 0, sizeof(scene));
+  Object ob;
+  memset(&ob, 0, sizeof(ob));
+  ob.type = OB_MESH;
+  ob.data = me;
+  unit_m4(ob.obmat);
+
+  test_mesh_batches_extract(&scene, &ob, me);
+
+  {
+    TIMEIT_START(mesh_extract_full);
+    for (int i = 0; i < MESH_EXTRACT_TIMEIT_REPEAT; i++) {
+      test_mesh_deform(me, (float)i);
+      DRW_mesh_batch_cache_dirty_tag(me, BKE_MESH_BATCH_DIRTY_ALL);
+      test_mesh_batches_extract(&scene, &ob, me);
+    }
+    TIMEIT_END(mesh_extract_full);
+  }
+
+  {
+    TIMEIT_START(mesh_extract_deform);
+    for (int i = 0; i < MESH_EXTRACT_TIMEIT_REPEAT; i++) {
+      test_mesh_deform(me, (float)i + 0.5f);
+      DRW_mesh_batch_cache_dirty_tag(me, BKE_MESH_BATCH_DIRTY_DEFORM);
+      test_mesh_batches_extract(&scene, &ob, me);
+    }
+    TIMEIT_END(mesh_extract_deform);
+  }
+
+  /* The deform update must give the same buffers as a full rebuild. */
+  GPUBatch *surface = test_mesh_batches_extract(&scene, &ob, me);
+  void *vbos_deform_data[GPU_BATCH_VBO_MAX_LEN] = {NULL};
+  for (int i = 0; i < GPU_BATCH_VBO_MAX_LEN; i++) {
+    if (surface->verts[i] != NULL) {
+      vbos_deform_data[i] = MEM_dupallocN(surface->verts[i]->data);
+    }
+  }
+  DRW_mesh_batch_cache_dirty_tag(me, BKE_MESH_BATCH_DIRTY_ALL);
+  surface = test_mesh_batches_extract(&scene, &ob, me);
+  for (int i = 0; i < GPU_BATCH_VBO_MAX_LEN; i++) {
+    if (vbos_deform_data[i] == NULL) {
+      EXPECT_EQ(surface->verts[i], (GPUVertBuf *)NULL);
+      continue;
+    }
+    ASSERT_NE(surface->verts[i], (GPUVertBuf *)NULL);
+    const uint size_deform = (uint)MEM_allocN_len(vbos_deform_data[i]);
+    EXPECT_EQ(size_deform, GPU_vertbuf_size_get(surface->verts[i]));
+    EXPECT_EQ(memcmp(vbos_deform_data[i], surface->verts[i]->data, size_deform), 0);
+    MEM_freeN(vbos_deform_data[i]);
+  }
+
+  DRW_mesh_batch_cache_free(me);
+  BKE_id_free(NULL, me);
+
+  printf("========== ENDED %s ==========\n\n", id);
+}
+
+TEST(mesh_extract_performance, Quads100000)
+{
+  mesh_extract_run("Quads - 100000", 317, TEST_MESH_GRID_QUADS);
+}
+
+TEST(mesh_extract_performance, Quads1000000)
+{
+  mesh_extract_run("Quads - 1000000", 1001, TEST_MESH_GRID_QUADS);
+}
+
+TEST(mesh_extract_performance, Tris2000000)
+{
+  mesh_extract_run("Tris - 2000000", 1001, TEST_MESH_GRID_TRIS);
+}
+
+#ifdef MESH_EXTRACT_RUN_BIG
+TEST(mesh_extract_performance, Quads10000000)
+{
+  mesh_extract_run("Quads - 10000000", 3163, TEST_MESH_GRID_QUADS);
+}
+#endif
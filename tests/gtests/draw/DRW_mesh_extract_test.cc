@@ -0,0 +1,169 @@
+/* Apache License, Version 2.0 */
+
+#include "testing/testing.h"
+
+#include "mesh_test_util.h"
+
+#include <string>
+#include <vector>
+
+#include "MEM_guardedalloc.h"
+
+extern "C" {
+#include "BLI_utildefines.h"
+#include "BLI_math.h"
+#include "BLI_threads.h"
+#include "BKE_lib_id.h"
+#include "BKE_mesh.h"
+#include "DNA_mesh_types.h"
+#include "DNA_meshdata_types.h"
+#include "DNA_object_types.h"
+#include "DNA_scene_types.h"
+#include "GPU_batch.h"
+#include "draw_cache_impl.h"
+}
+
+/* Update of the mesh draw cache after a deformation, which can change the tessellation of the
+ * polygons, compared to a full rebuild of the cache. No GPU context is needed as nothing is
+ * uploaded. */
+class MeshExtractTest : public testing::Test {
+ protected:
+  Scene scene;
+  Object ob;
+  Mesh *me = nullptr;
+  GPUBatch *surface = nullptr;
+  GPUBatch *edge_detection = nullptr;
+  GPUBatch **surface_per_mat = nullptr;
+
+  void SetUp() override
+  {
+    BLI_threadapi_init();
+    /* Only the render settings of the scene are read. */
+    memset(&scene, 0, sizeof(scene));
+    memset(&ob, 0, sizeof(ob));
+    ob.type = OB_MESH;
+    unit_m4(ob.obmat);
+  }
+
+  void TearDown() override
+  {
+    DRW_mesh_batch_cache_free(me);
+    BKE_id_free(NULL, me);
+  }
+
+  /* Grid with two materials, alternating between polygons. */
+  void mesh_create(const int size, const int poly_type)
+  {
+    me = test_mesh_grid_create(size, poly_type);
+    me->totcol = 2;
+    for (int i = 0; i < me->totpoly; i++) {
+      me->mpoly[i].mat_nr = (short)(i % 2);
+    }
+    ob.data = me;
+  }
+
+  void extract()
+  {
+    GPUMaterial *gpumat_array[2] = {NULL, NULL};
+    DRW_mesh_batch_cache_validate(me);
+    surface = DRW_mesh_batch_cache_get_surface(me);
+    edge_detection = DRW_mesh_batch_cache_get_edge_detection(me, NULL);
+    surface_per_mat = DRW_mesh_batch_cache_get_surface_shaded(me, gpumat_array, 2);
+    DRW_mesh_batch_cache_create_requested(&ob, me, &scene, false, false);
+  }
+
+  static std::string index_buffer_get(const GPUIndexBuf *elem)
+  {
+    EXPECT_NE(elem, (GPUIndexBuf *)NULL);
+    EXPECT_NE(elem->data, (void *)NULL);
+    return std::string((const char *)elem->data, GPU_indexbuf_size_get(elem));
+  }
+
+  /* Triangles first, then their edge adjacency, vertex buffers and per material ranges. */
+  std::vector<std::string> buffers_get()
+  {
+    std::vector<std::string> buffers;
+    buffers.push_back(index_buffer_get(surface->elem));
+    buffers.push_back(index_buffer_get(edge_detection->elem));
+    for (int i = 0; i < GPU_BATCH_VBO_MAX_LEN; i++) {
+      const GPUVertBuf *vbo = surface->verts[i];
+      if (vbo != NULL) {
+        buffers.push_back(std::string((const char *)vbo->data, GPU_vertbuf_size_get(vbo)));
+      }
+    }
+    for (int i = 0; i < 2; i++) {
+      const GPUIndexBuf *elem = surface_per_mat[i]->elem;
+      EXPECT_TRUE(elem->is_subrange);
+      EXPECT_EQ(elem->src, surface->elem);
+      buffers.push_back(std::to_string(elem->index_start) + " " +
+                        std::to_string(elem->index_len));
+    }
+    return buffers;
+  }
+
+  /* Buffers updated after deformation are those of a full rebuild. */
+  void expect_deform_update_matches_full(void (*deform_fn)(Mesh *me),
+                                         const bool is_tessellation_changed)
+  {
+    extract();
+    const std::vector<std::string> buffers_orig = buffers_get();
+
+    deform_fn(me);
+    BKE_mesh_calc_normals(me);
+    DRW_mesh_batch_cache_dirty_tag(me, BKE_MESH_BATCH_DIRTY_DEFORM);
+    extract();
+    const std::vector<std::string> buffers_deform = buffers_get();
+
+    DRW_mesh_batch_cache_dirty_tag(me, BKE_MESH_BATCH_DIRTY_ALL);
+    extract();
+    const std::vector<std::string> buffers_full = buffers_get();
+
+    EXPECT_EQ(buffers_orig[0] != buffers_full[0], is_tessellation_changed);
+    EXPECT_EQ(buffers_orig[1] != buffers_full[1], is_tessellation_changed);
+    ASSERT_EQ(buffers_deform.size(), buffers_full.size());
+    for (int i = 0; i < buffers_full.size(); i++) {
+      EXPECT_TRUE(buffers_deform[i] == buffers_full[i]) << "buffer " << i;
+    }
+  }
+};
+
+/* Move the second corner of the first polygon across the diagonal from its first corner, so a
+ * quad is split along the other diagonal. */
+static void test_mesh_quad_flip(Mesh *me)
+{
+  const MLoop *ml = &me->mloop[me->mpoly[0].loopstart];
+  float mid[3];
+  mid_v3_v3v3(mid, me->mvert[ml[0].v].co, me->mvert[ml[2].v].co);
+  interp_v3_v3v3(me->mvert[ml[1].v].co, mid, me->mvert[ml[3].v].co, 0.5f);
+}
+
+/* Push every other vertex inwards, making the n-gons concave. */
+static void test_mesh_ngons_dent(Mesh *me)
+{
+  const int size = (int)sqrtf((float)me->totvert);
+  for (int i = 0; i < me->totvert; i++) {
+    if ((i % size) % 2 == 1) {
+      float *co = me->mvert[i].co;
+      co[1] += (((i / size) % 2) ? -0.4f : 0.4f) / (float)size;
+    }
+  }
+}
+
+TEST_F(MeshExtractTest, DeformQuadFlip)
+{
+  mesh_create(3, TEST_MESH_GRID_QUADS);
+  expect_deform_update_matches_full(test_mesh_quad_flip, true);
+}
+
+TEST_F(MeshExtractTest, DeformNgons)
+{
+  mesh_create(8, TEST_MESH_GRID_NGONS);
+  expect_deform_update_matches_full(test_mesh_ngons_dent, true);
+}
+
+/* Triangles are kept. */
+TEST_F(MeshExtractTest, DeformTris)
+{
+  mesh_create(3, TEST_MESH_GRID_TRIS);
+  expect_deform_update_matches_full(test_mesh_quad_flip, false);
+}
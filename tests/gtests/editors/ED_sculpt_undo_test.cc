@@ -0,0 +1,241 @@
+/* Apache License, Version 2.0 */
+
+#include "blendfile_loading_base_test.h"
+#include "mesh_test_util.h"
+
+#include "MEM_guardedalloc.h"
+
+#include "CLG_log.h"
+
+extern "C" {
+#include "BLI_listbase.h"
+#include "BLI_math.h"
+#include "BLI_utildefines.h"
+#include "DNA_brush_types.h" /* Before BKE_paint.h, for C++. */
+#include "BKE_context.h"
+#include "BKE_customdata.h"
+#include "BKE_global.h"
+#include "BKE_lib_id.h"
+#include "BKE_main.h"
+#include "BKE_mesh.h"
+#include "BKE_object.h"
+#include "BKE_paint.h"
+#include "BKE_pbvh.h"
+#include "BKE_scene.h"
+#include "BKE_undo_system.h"
+#include "DNA_mesh_types.h"
+#include "DNA_meshdata_types.h"
+#include "DNA_object_types.h"
+#include "DNA_scene_types.h"
+#include "DNA_windowmanager_types.h"
+#include "ED_object.h"
+#include "ED_undo.h"
+#include "sculpt_intern.h"
+}
+
+/* Undo and redo of sculpt strokes on a grid, through the packed and compressed deltas the undo
+ * nodes are stored as once a stroke is done. */
+class SculptUndoTest : public BlendfileLoadingBaseTest {
+ protected:
+  Main *bmain = nullptr;
+  Main *bmain_orig = nullptr;
+  bContext *C = nullptr;
+  wmWindowManager *wm = nullptr;
+  Scene *scene = nullptr;
+  Object *object = nullptr;
+
+  static void SetUpTestCase()
+  {
+    BlendfileLoadingBaseTest::SetUpTestCase();
+    CLG_init();
+    ED_undosys_type_init();
+  }
+
+  static void TearDownTestCase()
+  {
+    ED_undosys_type_free();
+    CLG_exit();
+    BlendfileLoadingBaseTest::TearDownTestCase();
+  }
+
+  void SetUp() override
+  {
+    /* The undo system finds its stack in the window manager of the global main. */
+    wm = (wmWindowManager *)G_MAIN->wm.first;
+    wm->undo_stack = BKE_undosys_stack_create();
+    bmain_orig = G_MAIN;
+    bmain = BKE_main_new();
+    bmain->wm.first = wm;
+    G_MAIN = bmain;
+
+    scene = BKE_scene_add(bmain, "Scene");
+    ViewLayer *view_layer = (ViewLayer *)scene->view_layers.first;
+    object = BKE_object_add(bmain, scene, view_layer, OB_MESH, "Grid");
+    Mesh *mesh = (Mesh *)object->data;
+    BKE_mesh_nomain_to_mesh(
+        test_mesh_grid_create(64, TEST_MESH_GRID_QUADS), mesh, object, &CD_MASK_MESH, true);
+    CustomData_add_layer(&mesh->vdata, CD_PAINT_MASK, CD_CALLOC, NULL, mesh->totvert);
+
+    C = CTX_create();
+    CTX_data_main_set(C, bmain);
+    CTX_data_scene_set(C, scene);
+    CTX_wm_manager_set(C, wm);
+
+    Depsgraph *depsgraph = CTX_data_ensure_evaluated_depsgraph(C);
+    ED_object_sculptmode_enter_ex(bmain, depsgraph, scene, object, false, NULL);
+    BKE_sculpt_update_object_for_edit(depsgraph, object, false, true);
+
+    /* State before the strokes. */
+    sculpt_undo_push_begin("Initial");
+    sculpt_undo_push_end(object);
+  }
+
+  void TearDown() override
+  {
+    BKE_undosys_stack_destroy(wm->undo_stack);
+    wm->undo_stack = NULL;
+    BLI_freelistN(&wm->paintcursors);
+    BLI_freelistN(&wm->queue);
+    CTX_free(C);
+    BKE_sculptsession_free(object);
+
+    bmain->wm.first = NULL;
+    G_MAIN = bmain_orig;
+    BKE_main_free(bmain);
+    BlendfileLoadingBaseTest::TearDown();
+  }
+
+  /* Push all PBVH nodes, then let \a stroke_fn change the sculpt session. */
+  void stroke(const SculptUndoType type, void (*stroke_fn)(SculptSession *ss))
+  {
+    SculptSession *ss = object->sculpt;
+    PBVHNode **nodes;
+    int totnode;
+    BKE_pbvh_search_gather(ss->pbvh, NULL, NULL, &nodes, &totnode);
+
+    sculpt_undo_push_begin("Stroke");
+    for (int i = 0; i < totnode; i++) {
+      sculpt_undo_push_node(object, nodes[i], type);
+    }
+    stroke_fn(ss);
+    sculpt_undo_push_end(object);
+
+    MEM_SAFE_FREE(nodes);
+  }
+
+  float (*coords_get())[3]
+  {
+    SculptSession *ss = object->sculpt;
+    float(*coords)[3] = (float(*)[3])MEM_malloc_arrayN(
+        (size_t)ss->totvert, sizeof(*coords), __func__);
+    for (int i = 0; i < ss->totvert; i++) {
+      copy_v3_v3(coords[i], ss->mvert[i].co);
+    }
+    return coords;
+  }
+
+  float *mask_get()
+  {
+    SculptSession *ss = object->sculpt;
+    return (float *)MEM_dupallocN(ss->vmask);
+  }
+
+  /* Coordinates and masks are restored bit for bit. */
+  void expect_coords_eq(const float (*coords)[3])
+  {
+    SculptSession *ss = object->sculpt;
+    for (int i = 0; i < ss->totvert; i++) {
+      EXPECT_EQ(memcmp(ss->mvert[i].co, coords[i], sizeof(float[3])), 0) << "vertex " << i;
+    }
+  }
+
+  void expect_mask_eq(const float *mask)
+  {
+    SculptSession *ss = object->sculpt;
+    for (int i = 0; i < ss->totvert; i++) {
+      EXPECT_EQ(memcmp(&ss->vmask[i], &mask[i], sizeof(float)), 0) << "vertex " << i;
+    }
+  }
+
+  /* Once compressed, the active step is much smaller than the values it restores. */
+  void expect_step_compressed(const size_t size_raw)
+  {
+    UndoStep *us = wm->undo_stack->step_active;
+    ASSERT_NE(us, nullptr);
+    EXPECT_GT(us->data_size, (size_t)0);
+    EXPECT_LT(us->data_size, size_raw / 4);
+  }
+};
+
+/* Raise a bump in the middle of the grid, leaving most vertices untouched. */
+static void stroke_coords(SculptSession *ss)
+{
+  const float center[2] = {0.5f, 0.5f};
+  for (int i = 0; i < ss->totvert; i++) {
+    float *co = ss->mvert[i].co;
+    const float dist = len_v2v2(co, center);
+    if (dist < 0.2f) {
+      co[2] += cosf(dist * (float)M_PI * 2.5f) * 0.1f;
+      ss->mvert[i].flag |= ME_VERT_PBVH_UPDATE;
+    }
+  }
+}
+
+static void stroke_mask(SculptSession *ss)
+{
+  for (int i = 0; i < ss->totvert; i++) {
+    if (ss->mvert[i].co[0] < 0.1f) {
+      ss->vmask[i] = ss->mvert[i].co[1];
+    }
+  }
+}
+
+TEST_F(SculptUndoTest, CoordsUndoRedo)
+{
+  float(*coords_before)[3] = coords_get();
+  stroke(SCULPT_UNDO_COORDS, stroke_coords);
+  float(*coords_after)[3] = coords_get();
+  const size_t size_raw = sizeof(float[3]) * (size_t)object->sculpt->totvert;
+
+  for (int i = 0; i < 2; i++) {
+    ASSERT_TRUE(BKE_undosys_step_undo(wm->undo_stack, C));
+    expect_coords_eq(coords_before);
+
+    ASSERT_TRUE(BKE_undosys_step_redo(wm->undo_stack, C));
+    expect_coords_eq(coords_after);
+    expect_step_compressed(size_raw);
+  }
+
+  MEM_freeN(coords_before);
+  MEM_freeN(coords_after);
+}
+
+TEST_F(SculptUndoTest, MaskAndCoordsUndoRedo)
+{
+  float(*coords_before)[3] = coords_get();
+  float *mask_before = mask_get();
+  stroke(SCULPT_UNDO_COORDS, stroke_coords);
+  float(*coords_after)[3] = coords_get();
+  stroke(SCULPT_UNDO_MASK, stroke_mask);
+  float *mask_after = mask_get();
+  const size_t size_raw = sizeof(float) * (size_t)object->sculpt->totvert;
+
+  ASSERT_TRUE(BKE_undosys_step_undo(wm->undo_stack, C));
+  expect_mask_eq(mask_before);
+  expect_coords_eq(coords_after);
+
+  ASSERT_TRUE(BKE_undosys_step_undo(wm->undo_stack, C));
+  expect_mask_eq(mask_before);
+  expect_coords_eq(coords_before);
+
+  ASSERT_TRUE(BKE_undosys_step_redo(wm->undo_stack, C));
+  ASSERT_TRUE(BKE_undosys_step_redo(wm->undo_stack, C));
+  expect_mask_eq(mask_after);
+  expect_coords_eq(coords_after);
+  expect_step_compressed(size_raw);
+
+  MEM_freeN(coords_before);
+  MEM_freeN(coords_after);
+  MEM_freeN(mask_before);
+  MEM_freeN(mask_after);
+}
@@ -0,0 +1,126 @@
+# ##### BEGIN GPL LICENSE BLOCK #####
+#
+#  This program is free software; you can redistribute it and/or
+#  modify it under the terms of the GNU General Public License
+#  as published by the Free Software Foundation; either version 2
+#  of the License, or (at your option) any later version.
+#
+#  This program is distributed in the hope that it will be useful,
+#  but WITHOUT ANY WARRANTY; without even the implied warranty of
+#  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+#  GNU General Public License for more details.
+#
+#  You should have received a copy of the GNU General Public License
+#  along with this program; if not, write to the Free Software Foundation,
+#  Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+#
+# ##### END GPL LICENSE BLOCK #####
+
+# <pep8 compliant>
+
+"""
+Time the evaluation of generative modifiers on procedurally built meshes.
+Not part of the regular test suite, run manually:
+
+  blender --background --factory-startup --python tests/python/modifiers_performance.py
+
+Optional arguments after '--':
+  --repeat N     number of evaluations per case, the fastest one is reported (default 5).
+"""
+
+import argparse
+import sys
+import time
+
+import bpy
+
+
+def grid_object(name, size):
+    """
+    Add a grid object with size * size vertices to the scene.
+    """
+    bpy.ops.mesh.primitive_grid_add(x_subdivisions=size, y_subdivisions=size, size=1.0)
+    ob = bpy.context.active_object
+    ob.name = name
+    return ob
+
+
+def clear_scene():
+    for ob in list(bpy.data.objects):
+        bpy.data.objects.remove(ob)
+    for me in list(bpy.data.meshes):
+        bpy.data.meshes.remove(me)
+
+
+def time_evaluation(ob, repeat):
+    """
+    Force re-evaluation of the object, return the best time and the number of evaluated vertices.
+
+    The merge distance of the first modifier is nudged before each evaluation. Re-evaluating the
+    same settings would only copy the result kept by the modifier stack cache.
+    """
+    depsgraph = bpy.context.evaluated_depsgraph_get()
+    mod = ob.modifiers[0]
+    merge_threshold = mod.merge_threshold
+    best = None
+    for i in range(repeat):
+        # Far below the spacing of the grid, merged vertices stay the same.
+        mod.merge_threshold = merge_threshold * (1.0 + (i + 1) * 1e-4)
+        start = time.perf_counter()
+        depsgraph.update()
+        elapsed = time.perf_counter() - start
+        best = elapsed if best is None else min(best, elapsed)
+    verts_num = len(ob.evaluated_get(depsgraph).data.vertices)
+    return best, verts_num
+
+
+def array_cases():
+    """
+    Yield (name, grid size, list of array modifier settings) tuples.
+    """
+    yield ("array_1000", 32, [{'count': 1000}])
+    yield ("array_1000_merge", 32, [{'count': 1000, 'use_merge_vertices': True}])
+    yield ("array_200_merge_scaled", 64, [
+        {'count': 200, 'use_merge_vertices': True, 'use_relative_offset': False,
+         'use_object_offset': True, 'offset_scale': 0.99},
+    ])
+    yield ("array_50x50_merge", 32, [
+        {'count': 50, 'use_merge_vertices': True},
+        {'count': 50, 'use_merge_vertices': True, 'relative_offset_displace': (0.0, 1.0, 0.0)},
+    ])
+
+
+def run_array_case(name, grid_size, modifiers_settings, repeat):
+    clear_scene()
+    ob = grid_object(name, grid_size)
+    for i, settings in enumerate(modifiers_settings):
+        mod = ob.modifiers.new("Array %d" % i, 'ARRAY')
+        offset_scale = settings.pop('offset_scale', None)
+        for key, value in settings.items():
+            setattr(mod, key, value)
+        if offset_scale is not None:
+            bpy.ops.object.empty_add()
+            offset_ob = bpy.context.active_object
+            offset_ob.location = (1.0, 0.0, 0.0)
+            offset_ob.scale = (offset_scale, offset_scale, offset_scale)
+            mod.offset_object = offset_ob
+            bpy.context.view_layer.objects.active = ob
+
+    elapsed, verts_num = time_evaluation(ob, repeat)
+    print("{:<28} {:>10} verts {:>10.3f} ms {:>10.3f} ns/vert".format(
+        name, verts_num, elapsed * 1e3, elapsed * 1e9 / max(verts_num, 1)))
+
+
+def main():
+    argv = sys.argv[sys.argv.index("--") + 1:] if "--" in sys.argv else []
+    parser = argparse.ArgumentParser(description="Modifier evaluation timings")
+    parser.add_argument("--repeat", type=int, default=5)
+    args = parser.parse_args(argv)
+
+    print("Threads: %d" % bpy.context.scene.render.threads)
+    for name, grid_size, modifiers_settings in array_cases():
+        run_array_case(name, grid_size, modifiers_settings, args.repeat)
+
+
+if __name__ == "__main__":
+    main()